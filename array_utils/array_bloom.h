@@ -0,0 +1,432 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016 Kuan-Chung Huang
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#ifndef ARRAY_BLOOM_H_
+#define ARRAY_BLOOM_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+/**
+ * @defgroup array_bloom Array bloom filter
+ * @ingroup array_utils
+ *
+ * @brief A blocked bloom filter to reject lookups of absent keys.
+ *
+ * All bits of a key are set in one 64-byte block selected by the key hash, so
+ * a query touches a single cache line. Consult the filter before searching an
+ * array map or a red black tree:
+ * @code
+ * if (array_bloom_may_contain(&bf, hash(key))
+ *         && ARRAY_MAP_FIND(item_map, &map, key, &item))
+ * @endcode
+ * #ARRAY_BLOOM_GEN and #ARRAY_BLOOM_GEN_RB generate insert and remove
+ * wrappers of an array map or a red black tree which keep the filter up to
+ * date. Bits cannot be cleared when a key is removed. #array_bloom_remove only
+ * counts the removal; once #ARRAY_BLOOM_NEED_REBUILD is true, the filter
+ * should be rebuilt from the container by #ARRAY_BLOOM_REBUILD or
+ * #ARRAY_BLOOM_RB_REBUILD.
+ * @{
+ */
+/**@brief Block of a bloom filter, one cache line. */
+typedef struct
+{
+    uint64_t ab_word[8];
+} ARRAY_BLOOM_BLOCK;
+
+/**@brief Blocked bloom filter. */
+typedef struct
+{
+    ARRAY_BLOOM_BLOCK *ab_block;
+    uint32_t ab_nblock;
+    uint32_t ab_nhash;
+    uint32_t ab_len;
+    uint32_t ab_stale;
+} ARRAY_BLOOM;
+
+/**
+ * @brief Number of blocks needed for a bloom filter.
+ * @param n  Expected number of keys.
+ * @param bits_per_key  Bits per key. 10 bits per key gives about 1% false
+ * positive rate.
+ */
+#define ARRAY_BLOOM_NBLOCK(n, bits_per_key) \
+    ((((uint32_t) (n) * (bits_per_key) + 511) / 512) + 1)
+
+/**
+ * @brief Initialize a bloom filter.
+ * @param bf  Pointer to the bloom filter.
+ * @param buf  Pointer to the buffer of blocks. It should be 64-byte aligned.
+ * @param nblock  Number of blocks in \a buf.
+ * @param bits_per_key  Bits per key the buffer is sized for. It decides the
+ * number of bits set per key.
+ */
+#define ARRAY_BLOOM_INIT(bf, buf, nblock, bits_per_key) \
+do { \
+    uint32_t nhash_ = (uint32_t) (bits_per_key) * 69 / 100; \
+    (bf)->ab_block = (buf); \
+    (bf)->ab_nblock = (nblock); \
+    (bf)->ab_nhash = (nhash_ < 1 ? 1 : (nhash_ > 16 ? 16 : nhash_)); \
+    ARRAY_BLOOM_CLEAR(bf); \
+} while (0)
+
+/**
+ * @brief Clear a bloom filter.
+ * @param bf  Pointer to the bloom filter.
+ */
+#define ARRAY_BLOOM_CLEAR(bf) \
+do { \
+    memset((bf)->ab_block, 0, sizeof(ARRAY_BLOOM_BLOCK) * (bf)->ab_nblock); \
+    (bf)->ab_len = 0; \
+    (bf)->ab_stale = 0; \
+} while (0)
+
+/**
+ * @brief Test if a bloom filter should be rebuilt.
+ *
+ * It is true once more than half of the keys added have been removed.
+ * @param bf  Pointer to the bloom filter.
+ */
+#define ARRAY_BLOOM_NEED_REBUILD(bf) ((bf)->ab_stale * 2 > (bf)->ab_len)
+/**@}*/
+
+static inline ARRAY_BLOOM_BLOCK *array_bloom_block(const ARRAY_BLOOM *bf,
+        uint64_t hash)
+{
+    /* Map the high half of hash to [0, ab_nblock) without division. */
+    return &bf->ab_block[((hash >> 32) * bf->ab_nblock) >> 32];
+}
+
+/**
+ * @addtogroup array_bloom
+ * @{
+ */
+/**
+ * @brief Add a key to a bloom filter.
+ * @param bf  Pointer to the bloom filter.
+ * @param hash  64-bit hash of the key.
+ */
+static inline void array_bloom_add(ARRAY_BLOOM *bf, uint64_t hash)
+{
+    ARRAY_BLOOM_BLOCK *block = array_bloom_block(bf, hash);
+    uint32_t h1 = (uint32_t) hash;
+    uint32_t h2 = (uint32_t) ((hash * 0x9e3779b97f4a7c15ULL) >> 32) | 1;
+    uint32_t i;
+    for (i = 0; i < bf->ab_nhash; ++i)
+    {
+        uint32_t bit = h1 & 511;
+        block->ab_word[bit >> 6] |= (1ULL << (bit & 63));
+        h1 += h2;
+    }
+    ++bf->ab_len;
+}
+
+/**
+ * @brief Test if a key may be in a bloom filter.
+ * @param bf  Pointer to the bloom filter.
+ * @param hash  64-bit hash of the key.
+ * @return  \c false if the key is definitely not added; otherwise, \c true.
+ */
+static inline bool array_bloom_may_contain(const ARRAY_BLOOM *bf, uint64_t hash)
+{
+    const ARRAY_BLOOM_BLOCK *block = array_bloom_block(bf, hash);
+    uint32_t h1 = (uint32_t) hash;
+    uint32_t h2 = (uint32_t) ((hash * 0x9e3779b97f4a7c15ULL) >> 32) | 1;
+    uint32_t i;
+    for (i = 0; i < bf->ab_nhash; ++i)
+    {
+        uint32_t bit = h1 & 511;
+        if ((block->ab_word[bit >> 6] & (1ULL << (bit & 63))) == 0)
+        {
+            return false;
+        }
+        h1 += h2;
+    }
+    return true;
+}
+
+/**
+ * @brief Record the removal of a key from a bloom filter.
+ *
+ * The bits of the key are kept and the key still passes the filter until the
+ * filter is rebuilt.
+ * @param bf  Pointer to the bloom filter.
+ */
+static inline void array_bloom_remove(ARRAY_BLOOM *bf)
+{
+    ++bf->ab_stale;
+}
+
+/**
+ * @brief Hash an integer key.
+ * @param key  The key.
+ * @return  64-bit hash of \a key.
+ */
+static inline uint64_t array_bloom_hash64(uint64_t key)
+{
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    key *= 0xc4ceb9fe1a85ec53ULL;
+    key ^= key >> 33;
+    return key;
+}
+
+/**
+ * @brief Hash a string key.
+ * @param str  Null-terminated string.
+ * @return  64-bit hash of \a str.
+ */
+static inline uint64_t array_bloom_hash_str(const char *str)
+{
+    uint64_t h = 0xcbf29ce484222325ULL;
+    while (*str != '\0')
+    {
+        h ^= (uint8_t) *str++;
+        h *= 0x100000001b3ULL;
+    }
+    return array_bloom_hash64(h);
+}
+/**@}*/
+
+#define ARRAY_BLOOM_GENERATE_INSERT_PROTO(name, map_type, key_type, type) \
+bool name##_array_bloom_insert(ARRAY_BLOOM *bf, map_type *map, key_type key, \
+        type value)
+#define ARRAY_BLOOM_GENERATE_INSERT(name, map_type, key_type, type, hash) \
+ARRAY_BLOOM_GENERATE_INSERT_PROTO(name, map_type, key_type, type) \
+{ \
+    if (!ARRAY_MAP_INSERT(name, map, key, value)) \
+    { \
+        return false; \
+    } \
+    array_bloom_add(bf, hash(value)); \
+    return true; \
+}
+
+#define ARRAY_BLOOM_GENERATE_REMOVE_PROTO(name, map_type, key_type) \
+bool name##_array_bloom_remove(ARRAY_BLOOM *bf, map_type *map, key_type key)
+#define ARRAY_BLOOM_GENERATE_REMOVE(name, map_type, key_type) \
+ARRAY_BLOOM_GENERATE_REMOVE_PROTO(name, map_type, key_type) \
+{ \
+    uint32_t len = map->am_len; \
+    ARRAY_MAP_REMOVE(name, map, key); \
+    if (map->am_len == len) \
+    { \
+        return false; \
+    } \
+    array_bloom_remove(bf); \
+    return true; \
+}
+
+#define ARRAY_BLOOM_GENERATE_REBUILD_PROTO(name, map_type) \
+void name##_array_bloom_rebuild(ARRAY_BLOOM *bf, map_type *map)
+#define ARRAY_BLOOM_GENERATE_REBUILD(name, map_type, hash) \
+ARRAY_BLOOM_GENERATE_REBUILD_PROTO(name, map_type) \
+{ \
+    uint32_t i; \
+    ARRAY_BLOOM_CLEAR(bf); \
+    for (i = 0; i < map->am_len; ++i) \
+    { \
+        array_bloom_add(bf, hash(map->am_item[i])); \
+    } \
+}
+
+/**
+ * @addtogroup array_bloom
+ * @{
+ */
+/**
+ * @brief Insert a value into an array map and add its key to a bloom filter.
+ * @param name  Prefix name used by #ARRAY_BLOOM_GEN.
+ * @param bf  Pointer to the bloom filter.
+ * @param map  Pointer to the array map.
+ * @param key  Key associated with the value.
+ * @param value  Value to insert.
+ * @return  \c true if insertion is successful; otherwise, \c false if key is
+ * already existed or the map is full.
+ */
+#define ARRAY_BLOOM_INSERT(name, bf, map, key, value) \
+    name##_array_bloom_insert(bf, map, key, value)
+
+/**
+ * @brief Remove a value from an array map and record it in a bloom filter.
+ * @param name  Prefix name used by #ARRAY_BLOOM_GEN.
+ * @param bf  Pointer to the bloom filter.
+ * @param map  Pointer to the array map.
+ * @param key  Key associated with the value.
+ * @return  \c true if the value is removed; otherwise, \c false.
+ */
+#define ARRAY_BLOOM_REMOVE(name, bf, map, key) \
+    name##_array_bloom_remove(bf, map, key)
+
+/**
+ * @brief Rebuild a bloom filter from the values of an array map.
+ * @param name  Prefix name used by #ARRAY_BLOOM_GEN.
+ * @param bf  Pointer to the bloom filter.
+ * @param map  Pointer to the array map.
+ */
+#define ARRAY_BLOOM_REBUILD(name, bf, map) name##_array_bloom_rebuild(bf, map)
+
+/**
+ * @brief Generate declaration for an array map maintaining a bloom filter.
+ * @param name  Prefix name of the array map.
+ * @param map_type  Type of the array map.
+ * @param key_type  Type of key.
+ * @param type  Type of value contained in the array map.
+ */
+#define ARRAY_BLOOM_GEN_PROTO(name, map_type, key_type, type) \
+ARRAY_BLOOM_GENERATE_INSERT_PROTO(name, map_type, key_type, type); \
+ARRAY_BLOOM_GENERATE_REMOVE_PROTO(name, map_type, key_type); \
+ARRAY_BLOOM_GENERATE_REBUILD_PROTO(name, map_type);
+
+/**
+ * @brief Generate implementation for an array map maintaining a bloom filter.
+ *
+ * The array map should be generated by #ARRAY_MAP_GEN with the same \a name.
+ * @param name  Prefix name of the array map.
+ * @param map_type  Type of the array map.
+ * @param key_type  Type of key.
+ * @param type  Type of value contained in the array map.
+ * @param hash  Hash of values. It takes one parameter, the value, and returns
+ * the same 64-bit hash as the one used to query the key of the value.
+ */
+#define ARRAY_BLOOM_GEN(name, map_type, key_type, type, hash) \
+ARRAY_BLOOM_GENERATE_INSERT(name, map_type, key_type, type, hash) \
+ARRAY_BLOOM_GENERATE_REMOVE(name, map_type, key_type) \
+ARRAY_BLOOM_GENERATE_REBUILD(name, map_type, hash)
+/**@}*/
+
+#define ARRAY_BLOOM_GENERATE_RB_INSERT_PROTO(name, type) \
+type *name##_rb_bloom_insert(ARRAY_BLOOM *bf, RB_ROOT *root, type *node)
+#define ARRAY_BLOOM_GENERATE_RB_INSERT(name, type, hash) \
+ARRAY_BLOOM_GENERATE_RB_INSERT_PROTO(name, type) \
+{ \
+    type *ent = RB_INSERT(name, root, node); \
+    if (ent == node) \
+    { \
+        array_bloom_add(bf, hash(node)); \
+    } \
+    return ent; \
+}
+
+#define ARRAY_BLOOM_GENERATE_RB_REMOVE_PROTO(name, key_type, type) \
+type *name##_rb_bloom_remove(ARRAY_BLOOM *bf, RB_ROOT *root, key_type key)
+#define ARRAY_BLOOM_GENERATE_RB_REMOVE(name, key_type, type) \
+ARRAY_BLOOM_GENERATE_RB_REMOVE_PROTO(name, key_type, type) \
+{ \
+    type *node = RB_REMOVE(name, root, key); \
+    if (node != NULL) \
+    { \
+        array_bloom_remove(bf); \
+    } \
+    return node; \
+}
+
+#define ARRAY_BLOOM_GENERATE_RB_REBUILD_PROTO(name) \
+void name##_rb_bloom_rebuild(ARRAY_BLOOM *bf, RB_ROOT *root)
+#define ARRAY_BLOOM_GENERATE_RB_REBUILD(name, type, field, hash) \
+static void name##_rb_bloom_add_tree(ARRAY_BLOOM *bf, RB_NODE *node) \
+{ \
+    /* Any order will do; recurse left and loop right, O(log n) stack. */ \
+    while (node != NULL) \
+    { \
+        name##_rb_bloom_add_tree(bf, rb_child(node, RB_LEFT)); \
+        array_bloom_add(bf, hash(RB_ENTRY(node, type, field))); \
+        node = rb_child(node, RB_RIGHT); \
+    } \
+} \
+ARRAY_BLOOM_GENERATE_RB_REBUILD_PROTO(name) \
+{ \
+    ARRAY_BLOOM_CLEAR(bf); \
+    name##_rb_bloom_add_tree(bf, root->rb_root); \
+}
+
+/**
+ * @addtogroup array_bloom
+ * @{
+ */
+/**
+ * @brief Insert a node into a red black tree and add its key to a bloom
+ * filter.
+ * @param name  Prefix name used by #ARRAY_BLOOM_GEN_RB.
+ * @param bf  Pointer to the bloom filter.
+ * @param root  Pointer to the root of the tree.
+ * @param node  Node to insert.
+ * @return  \a node if inserted; otherwise, the node with the same key.
+ */
+#define ARRAY_BLOOM_RB_INSERT(name, bf, root, node) \
+    name##_rb_bloom_insert(bf, root, node)
+
+/**
+ * @brief Remove a node from a red black tree and record it in a bloom filter.
+ * @param name  Prefix name used by #ARRAY_BLOOM_GEN_RB.
+ * @param bf  Pointer to the bloom filter.
+ * @param root  Pointer to the root of the tree.
+ * @param key  Key of the node.
+ * @return  The node removed, or \c NULL if not found.
+ */
+#define ARRAY_BLOOM_RB_REMOVE(name, bf, root, key) \
+    name##_rb_bloom_remove(bf, root, key)
+
+/**
+ * @brief Rebuild a bloom filter from the nodes of a red black tree.
+ * @param name  Prefix name used by #ARRAY_BLOOM_GEN_RB.
+ * @param bf  Pointer to the bloom filter.
+ * @param root  Pointer to the root of the tree.
+ */
+#define ARRAY_BLOOM_RB_REBUILD(name, bf, root) name##_rb_bloom_rebuild(bf, root)
+
+/**
+ * @brief Generate declaration for a red black tree maintaining a bloom filter.
+ * @param name  Prefix name of the tree.
+ * @param key_type  Type of key.
+ * @param type  Type of node.
+ */
+#define ARRAY_BLOOM_GEN_RB_PROTO(name, key_type, type) \
+ARRAY_BLOOM_GENERATE_RB_INSERT_PROTO(name, type); \
+ARRAY_BLOOM_GENERATE_RB_REMOVE_PROTO(name, key_type, type); \
+ARRAY_BLOOM_GENERATE_RB_REBUILD_PROTO(name);
+
+/**
+ * @brief Generate implementation for a red black tree maintaining a bloom
+ * filter.
+ *
+ * The tree should be generated by #RB_GEN of rbtree.h or rbtree_compact.h with
+ * the same \a name, and the header should be included first.
+ * @param name  Prefix name of the tree.
+ * @param key_type  Type of key.
+ * @param type  Type of node.
+ * @param field  Name of the #RB_NODE field in \a type.
+ * @param hash  Hash of nodes. It takes one parameter, the pointer to the node,
+ * and returns the same 64-bit hash as the one used to query the key of the
+ * node.
+ */
+#define ARRAY_BLOOM_GEN_RB(name, key_type, type, field, hash) \
+ARRAY_BLOOM_GENERATE_RB_INSERT(name, type, hash) \
+ARRAY_BLOOM_GENERATE_RB_REMOVE(name, key_type, type) \
+ARRAY_BLOOM_GENERATE_RB_REBUILD(name, type, field, hash)
+/**@}*/
+
+#endif /* ARRAY_BLOOM_H_ */
@@ -0,0 +1,357 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016 Kuan-Chung Huang
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#ifndef ARRAY_CODEL_H_
+#define ARRAY_CODEL_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "array_queue.h"
+
+/**
+ * @defgroup array_codel Array CoDel queue
+ * @ingroup array_utils
+ *
+ * @brief An array queue with sojourn-time based active queue management.
+ *
+ * Each item is timestamped on enqueue, and its sojourn time is measured on
+ * dequeue. A CoDel controller watches the minimum sojourn time over an
+ * interval: once it stays above the target for a whole interval, items are
+ * dropped at a rate growing with the square root of the number of drops,
+ * until the queue drains below the target again. A queue under overload then
+ * keeps a short standing queue instead of a full one.
+ *
+ * #ARRAY_QUEUE_CODEL_DEQUEUE returns every item with a verdict. The caller
+ * discards an item with #ARRAY_CODEL_DROP and dequeues again, or delivers it
+ * flagged as congested instead of dropping it. The queue shares its first
+ * fields with #ARRAY_QUEUE_TYPE_32, so the other queue macros not adding
+ * items, e.g. #ARRAY_QUEUE_IS_EMPTY or #ARRAY_QUEUE_FRONT, apply as well.
+ *
+ * Times are in any unit chosen by the caller, e.g. nanoseconds, and the
+ * sojourn times are counted in a log2 histogram read by
+ * #array_codel_percentile.
+ * @code
+ * ARRAY_QUEUE_CODEL_ENQUEUE_RET(&q, pkt, now_ns(), ret);
+ * ...
+ * do
+ * {
+ *     ARRAY_QUEUE_CODEL_DEQUEUE(&q, &pkt, now_ns(), verdict);
+ *     if (verdict == ARRAY_CODEL_DROP)
+ *     {
+ *         free_pkt(pkt);
+ *     }
+ * } while (verdict == ARRAY_CODEL_DROP);
+ * @endcode
+ * @{
+ */
+/**@brief Number of histogram buckets. Bucket b counts sojourn times in
+ * [2^(b-1), 2^b). */
+#define ARRAY_CODEL_HIST_SIZE 65
+
+/**@brief Verdict of a dequeue. */
+typedef enum
+{
+    ARRAY_CODEL_EMPTY,  /**< The queue is empty; no item is returned. */
+    ARRAY_CODEL_PASS,   /**< Deliver the item. */
+    ARRAY_CODEL_DROP,   /**< Drop, or flag, the item. */
+} ARRAY_CODEL_VERDICT;
+
+/**@brief CoDel controller state and counters. */
+typedef struct
+{
+    uint64_t acd_target;
+    uint64_t acd_interval;
+    uint64_t acd_first_above;
+    uint64_t acd_drop_next;
+    uint32_t acd_count;
+    uint32_t acd_lastcount;
+    bool acd_dropping;
+    uint64_t acd_npass;
+    uint64_t acd_ndrop;
+    uint64_t acd_hist[ARRAY_CODEL_HIST_SIZE];
+} ARRAY_CODEL;
+
+/**
+ * @brief Initialize a controller.
+ * @param c  Pointer to the controller.
+ * @param target  Acceptable standing sojourn time, typically 5 ms.
+ * @param interval  Time to tolerate a sojourn time above \a target, typically
+ * 100 ms, i.e. a worst-case round trip of the traffic.
+ */
+static inline void array_codel_init(ARRAY_CODEL *c, uint64_t target,
+        uint64_t interval)
+{
+    memset(c, 0, sizeof(*c));
+    c->acd_target = target;
+    c->acd_interval = interval;
+}
+
+/**
+ * @brief Reset the counters and the histogram.
+ * @param c  Pointer to the controller.
+ */
+static inline void array_codel_reset_stats(ARRAY_CODEL *c)
+{
+    c->acd_npass = 0;
+    c->acd_ndrop = 0;
+    memset(c->acd_hist, 0, sizeof(c->acd_hist));
+}
+
+static inline uint64_t _array_codel_isqrt(uint64_t x)
+{
+    uint64_t r = 0;
+    uint64_t bit = (uint64_t) 1 << 62;
+    while (bit > x)
+    {
+        bit >>= 2;
+    }
+    while (bit != 0)
+    {
+        if (x >= r + bit)
+        {
+            x -= r + bit;
+            r = (r >> 1) + bit;
+        }
+        else
+        {
+            r >>= 1;
+        }
+        bit >>= 2;
+    }
+    return r;
+}
+
+/* Next drop time: t + interval / sqrt(count), with 10 fractional bits. */
+static inline uint64_t _array_codel_control_law(const ARRAY_CODEL *c,
+        uint64_t t, uint32_t count)
+{
+    return t + (c->acd_interval << 10) / _array_codel_isqrt((uint64_t) count << 20);
+}
+
+static inline bool _array_codel_should_drop(ARRAY_CODEL *c, uint64_t now,
+        uint64_t sojourn, bool empty)
+{
+    if (sojourn < c->acd_target || empty)
+    {
+        /* Below target, or the queue went empty: no standing queue. */
+        c->acd_first_above = 0;
+        return false;
+    }
+    if (c->acd_first_above == 0)
+    {
+        c->acd_first_above = now + c->acd_interval;
+        return false;
+    }
+    return now >= c->acd_first_above;
+}
+
+/**
+ * @brief Decide on an item just dequeued.
+ *
+ * Queues other than #ARRAY_QUEUE_CODEL_TYPE_32 may call it directly.
+ * @param c  Pointer to the controller.
+ * @param now  Current time.
+ * @param sojourn  Time the item spent in the queue.
+ * @param empty  Whether the queue is empty after dequeuing the item.
+ * @return  #ARRAY_CODEL_PASS or #ARRAY_CODEL_DROP.
+ */
+static inline ARRAY_CODEL_VERDICT array_codel_decide(ARRAY_CODEL *c,
+        uint64_t now, uint64_t sojourn, bool empty)
+{
+    ++c->acd_hist[sojourn == 0 ? 0 : 64 - __builtin_clzll(sojourn)];
+
+    bool drop = false;
+    bool ok_to_drop = _array_codel_should_drop(c, now, sojourn, empty);
+    if (c->acd_dropping)
+    {
+        if (!ok_to_drop)
+        {
+            c->acd_dropping = false;
+        }
+        else if (now >= c->acd_drop_next)
+        {
+            ++c->acd_count;
+            c->acd_drop_next = _array_codel_control_law(c, c->acd_drop_next,
+                    c->acd_count);
+            drop = true;
+        }
+    }
+    else if (ok_to_drop)
+    {
+        /* Resume near the last drop rate if the previous dropping state
+         * ended recently. */
+        uint32_t delta = c->acd_count - c->acd_lastcount;
+        c->acd_count = 1;
+        if (delta > 1 && (int64_t) (now - c->acd_drop_next)
+                < (int64_t) (16 * c->acd_interval))
+        {
+            c->acd_count = delta;
+        }
+        c->acd_lastcount = c->acd_count;
+        c->acd_drop_next = _array_codel_control_law(c, now, c->acd_count);
+        c->acd_dropping = true;
+        drop = true;
+    }
+
+    if (drop)
+    {
+        ++c->acd_ndrop;
+        return ARRAY_CODEL_DROP;
+    }
+    ++c->acd_npass;
+    return ARRAY_CODEL_PASS;
+}
+
+/**
+ * @brief Tell the controller the queue is empty.
+ * @param c  Pointer to the controller.
+ * @return  #ARRAY_CODEL_EMPTY.
+ */
+static inline ARRAY_CODEL_VERDICT array_codel_empty(ARRAY_CODEL *c)
+{
+    c->acd_dropping = false;
+    c->acd_first_above = 0;
+    return ARRAY_CODEL_EMPTY;
+}
+
+/**
+ * @brief Estimate a percentile of the sojourn times.
+ * @param c  Pointer to the controller.
+ * @param permille  Percentile in per mille, e.g. 500 for the median or 999.
+ * @return  Upper bound of the histogram bucket holding the percentile, or 0
+ * if no item has been dequeued.
+ */
+static inline uint64_t array_codel_percentile(const ARRAY_CODEL *c,
+        uint32_t permille)
+{
+    uint64_t total = 0;
+    int b;
+    for (b = 0; b < ARRAY_CODEL_HIST_SIZE; ++b)
+    {
+        total += c->acd_hist[b];
+    }
+    /* Smallest rank covering the percentile, at least 1. */
+    uint64_t rank = (total * permille + 999) / 1000;
+    rank = (rank == 0 ? 1 : rank);
+    uint64_t seen = 0;
+    for (b = 0; b < ARRAY_CODEL_HIST_SIZE; ++b)
+    {
+        seen += c->acd_hist[b];
+        if (seen >= rank)
+        {
+            return (b == 64 ? UINT64_MAX : ((uint64_t) 1 << b) - 1);
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Define type for a CoDel queue.
+ * @param name  Type name of the queue.
+ * @param type  Type of items.
+ */
+#define ARRAY_QUEUE_CODEL_TYPE_32(name, type) \
+typedef struct \
+{ \
+    type *aq_item; \
+    uint32_t aq_size; \
+    uint32_t aq_front; \
+    uint32_t aq_back; \
+    uint32_t aq_len; \
+    uint64_t *aq_ts; \
+    ARRAY_CODEL aq_codel; \
+} name
+
+/**
+ * @brief Initialize a CoDel queue.
+ * @param q  Pointer to the queue.
+ * @param buf  Item buffer.
+ * @param ts_buf  Timestamp buffer of the same number of entries.
+ * @param siz  Number of items in \a buf.
+ * @param target  Target sojourn time, see #array_codel_init.
+ * @param interval  Interval, see #array_codel_init.
+ */
+#define ARRAY_QUEUE_CODEL_INIT(q, buf, ts_buf, siz, target, interval) \
+do { \
+    ARRAY_QUEUE_INIT(q, buf, siz); \
+    (q)->aq_ts = (ts_buf); \
+    array_codel_init(&(q)->aq_codel, target, interval); \
+} while (0)
+
+#define _ARRAY_QUEUE_CODEL_ENQUEUE_IMPL(q, data, now, ret_func, ret) \
+do { \
+    if (ARRAY_QUEUE_IS_FULL(q)) \
+    { \
+        ret_func(ret, false); \
+    } \
+    else \
+    { \
+        (q)->aq_ts[(q)->aq_back] = (now); \
+        ARRAY_QUEUE_ENQUEUE(q, data); \
+        ret_func(ret, true); \
+    } \
+} while (0)
+
+/**
+ * @brief Enqueue an item stamped with the current time.
+ * @param q  Pointer to the queue.
+ * @param data  Item to enqueue.
+ * @param now  Current time.
+ */
+#define ARRAY_QUEUE_CODEL_ENQUEUE(q, data, now) _ARRAY_QUEUE_CODEL_ENQUEUE_IMPL(q, data, now, _ARRAY_QUEUE_NO_RET,)
+/**
+ * @brief Enqueue an item stamped with the current time.
+ * @param q  Pointer to the queue.
+ * @param data  Item to enqueue.
+ * @param now  Current time.
+ * @param ret  Set to \c false if the queue is full; otherwise, \c true.
+ */
+#define ARRAY_QUEUE_CODEL_ENQUEUE_RET(q, data, now, ret) _ARRAY_QUEUE_CODEL_ENQUEUE_IMPL(q, data, now, _ARRAY_QUEUE_RET, ret)
+
+/**
+ * @brief Dequeue an item and decide whether to deliver it.
+ * @param q  Pointer to the queue.
+ * @param pdata  Returned item, unless the verdict is #ARRAY_CODEL_EMPTY.
+ * @param now  Current time, not earlier than the enqueue times.
+ * @param verdict  Set to the #ARRAY_CODEL_VERDICT of the item.
+ */
+#define ARRAY_QUEUE_CODEL_DEQUEUE(q, pdata, now, verdict) \
+do { \
+    if (ARRAY_QUEUE_IS_EMPTY(q)) \
+    { \
+        (verdict) = array_codel_empty(&(q)->aq_codel); \
+    } \
+    else \
+    { \
+        uint64_t now_ = (now); \
+        uint64_t sojourn_ = now_ - (q)->aq_ts[(q)->aq_front]; \
+        ARRAY_QUEUE_DEQUEUE(q, pdata); \
+        (verdict) = array_codel_decide(&(q)->aq_codel, now_, sojourn_, \
+                ARRAY_QUEUE_IS_EMPTY(q)); \
+    } \
+} while (0)
+/** @} */
+
+#endif /* ARRAY_CODEL_H_ */
@@ -0,0 +1,59 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016 Kuan-Chung Huang
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#include "array_event.h"
+#include <errno.h>
+#include <unistd.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+
+bool array_event_wait(ARRAY_EVENT *ev, uint32_t key,
+        const struct timespec *deadline)
+{
+    long r = 0;
+    if (atomic_load_explicit(&ev->aev_seq, memory_order_acquire) == key)
+    {
+        /* The bitset flavour takes an absolute CLOCK_MONOTONIC timeout. */
+        r = syscall(SYS_futex, (uint32_t *) &ev->aev_seq,
+                FUTEX_WAIT_BITSET | FUTEX_PRIVATE_FLAG, key, deadline, NULL,
+                FUTEX_BITSET_MATCH_ANY);
+    }
+    atomic_fetch_sub_explicit(&ev->aev_waiters, 1, memory_order_relaxed);
+    return !(r == -1 && errno == ETIMEDOUT);
+}
+
+void array_event_wake(ARRAY_EVENT *ev, int n)
+{
+    atomic_fetch_add_explicit(&ev->aev_seq, 1, memory_order_release);
+    syscall(SYS_futex, (uint32_t *) &ev->aev_seq, FUTEX_WAKE | FUTEX_PRIVATE_FLAG,
+            n, NULL, NULL, 0);
+}
+
+void array_event_deadline(struct timespec *deadline, uint64_t timeout_ns)
+{
+    clock_gettime(CLOCK_MONOTONIC, deadline);
+    timeout_ns += (uint64_t) deadline->tv_nsec;
+    deadline->tv_sec += (time_t) (timeout_ns / 1000000000u);
+    deadline->tv_nsec = (long) (timeout_ns % 1000000000u);
+}
@@ -0,0 +1,166 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016 Kuan-Chung Huang
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#ifndef ARRAY_EVENT_H_
+#define ARRAY_EVENT_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <time.h>
+
+/**
+ * @defgroup array_event Array event
+ * @ingroup array_utils
+ *
+ * @brief An event count to block on the lock-free queues.
+ *
+ * A waiter registers itself, checks its condition again and then sleeps on a
+ * Linux futex until a notifier bumps the sequence. A notifier only enters the
+ * kernel when a waiter is registered, so the uncontended path costs a fence
+ * and a load. #ARRAY_EVENT_WAIT_FOR wraps the protocol around a condition,
+ * e.g. a blocking enqueue to and dequeue from #ARRAY_MPMC_TYPE:
+ * @code
+ * ARRAY_EVENT_WAIT_FOR(&not_full, ARRAY_MPMC_TRY_ENQUEUE(job, &q, j), NULL, ret);
+ * array_event_notify(&not_empty, 1);
+ *
+ * ARRAY_EVENT_WAIT_FOR(&not_empty, ARRAY_MPMC_TRY_DEQUEUE(job, &q, &j), NULL, ret);
+ * array_event_notify(&not_full, 1);
+ * @endcode
+ * Only available on Linux.
+ * @{
+ */
+/**@brief Event count. */
+typedef struct
+{
+    _Atomic uint32_t aev_seq;
+    _Atomic uint32_t aev_waiters;
+} ARRAY_EVENT;
+
+/**@brief Number of waiters to wake up all of them. */
+#define ARRAY_EVENT_ALL INT32_MAX
+
+/**
+ * @brief Initialize an event.
+ * @param ev  Pointer to the event.
+ */
+#define ARRAY_EVENT_INIT(ev) \
+do { \
+    atomic_init(&(ev)->aev_seq, 0); \
+    atomic_init(&(ev)->aev_waiters, 0); \
+} while (0)
+
+/**
+ * @brief Register as a waiter before checking the wait condition again.
+ * @param ev  Pointer to the event.
+ * @return  Key for #array_event_wait.
+ */
+static inline uint32_t array_event_prepare_wait(ARRAY_EVENT *ev)
+{
+    atomic_fetch_add_explicit(&ev->aev_waiters, 1, memory_order_seq_cst);
+    atomic_thread_fence(memory_order_seq_cst);
+    return atomic_load_explicit(&ev->aev_seq, memory_order_acquire);
+}
+
+/**
+ * @brief Unregister a waiter whose condition became true after
+ * #array_event_prepare_wait.
+ * @param ev  Pointer to the event.
+ */
+static inline void array_event_cancel_wait(ARRAY_EVENT *ev)
+{
+    atomic_fetch_sub_explicit(&ev->aev_waiters, 1, memory_order_relaxed);
+}
+
+/**
+ * @brief Sleep until the event is notified after #array_event_prepare_wait,
+ * and unregister the waiter.
+ *
+ * It may return early, so the caller should check its condition again.
+ * @param ev  Pointer to the event.
+ * @param key  Key returned by #array_event_prepare_wait.
+ * @param deadline  Absolute \c CLOCK_MONOTONIC time to give up, or \c NULL to
+ * wait forever.
+ * @return  \c false if the deadline passed; otherwise, \c true.
+ */
+bool array_event_wait(ARRAY_EVENT *ev, uint32_t key,
+        const struct timespec *deadline);
+
+/**
+ * @brief Wake up waiters. Use #array_event_notify instead.
+ */
+void array_event_wake(ARRAY_EVENT *ev, int n);
+
+/**
+ * @brief Notify waiters after making their condition true.
+ * @param ev  Pointer to the event.
+ * @param n  Maximal number of waiters to wake up, e.g. the number of items
+ * just enqueued, or #ARRAY_EVENT_ALL.
+ */
+static inline void array_event_notify(ARRAY_EVENT *ev, int n)
+{
+    /* Pairs with the fence in array_event_prepare_wait: either the waiter
+     * sees the condition, or the notifier sees the waiter. */
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&ev->aev_waiters, memory_order_relaxed) != 0)
+    {
+        array_event_wake(ev, n);
+    }
+}
+
+/**
+ * @brief Compute the deadline for a relative timeout.
+ * @param deadline  Pointer to the returned deadline.
+ * @param timeout_ns  Timeout in nanoseconds.
+ */
+void array_event_deadline(struct timespec *deadline, uint64_t timeout_ns);
+
+/**
+ * @brief Wait until a condition is true.
+ * @param ev  Pointer to the event notified when \a cond may become true.
+ * @param cond  Condition to evaluate, e.g. a try-enqueue. It is evaluated
+ * until it returns \c true, and once more when the deadline passes.
+ * @param deadline  Absolute deadline as for #array_event_wait, or \c NULL.
+ * @param ret  Set to the last result of \a cond.
+ */
+#define ARRAY_EVENT_WAIT_FOR(ev, cond, deadline, ret) \
+do { \
+    while (!((ret) = (cond))) \
+    { \
+        uint32_t key_ = array_event_prepare_wait(ev); \
+        if (((ret) = (cond))) \
+        { \
+            array_event_cancel_wait(ev); \
+            break; \
+        } \
+        if (!array_event_wait(ev, key_, deadline)) \
+        { \
+            (ret) = (cond); \
+            break; \
+        } \
+    } \
+} while (0)
+/** @} */
+
+#endif /* ARRAY_EVENT_H_ */
@@ -0,0 +1,341 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016 Kuan-Chung Huang
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#ifndef ARRAY_HEAP_H_
+#define ARRAY_HEAP_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * @defgroup array_heap Array heap
+ * @ingroup array_utils
+ *
+ * @brief A d-ary heap priority queue on a fixed buffer.
+ *
+ * The children of item i are items d * i + 1 to d * i + d. With d = 4 and
+ * pointer-sized items, all children of an item share one cache line, and the
+ * tree is half as deep as a binary heap.
+ *
+ * The heap may keep the position of every item up to date through a
+ * \a set_pos callback, e.g. by storing it in the item. The position is a
+ * handle to #ARRAY_HEAP_REMOVE_AT and #ARRAY_HEAP_UPDATE_AT, which change the
+ * priority or remove an item in O(log n). Use #ARRAY_HEAP_NO_POS if handles
+ * are not needed.
+ * @{
+ */
+/**@brief Default number of children per item. */
+#define ARRAY_HEAP_DEFAULT_D 4
+
+/**@brief Position passed to \a set_pos when an item leaves the heap. */
+#define ARRAY_HEAP_NPOS UINT32_MAX
+
+/**@brief \a set_pos for heaps without position index. */
+#define ARRAY_HEAP_NO_POS(item, pos)
+
+/**
+ * @brief Define type for a array heap.
+ * @param name  Type name of the array heap.
+ * @param type  Type of objects contained in the array heap.
+ */
+#define ARRAY_HEAP_TYPE(name, type) \
+typedef struct \
+{ \
+    type *ah_item; \
+    uint32_t ah_size; \
+    uint32_t ah_len; \
+} name
+
+/**
+ * @brief Initialize a array heap.
+ * @param heap  Pointer to the array heap.
+ * @param buf  Pointer to the buffer of objects contained in the array heap.
+ * @param siz  Maximal number of objects in \a buf.
+ */
+#define ARRAY_HEAP_INIT(heap, buf, siz) \
+do { \
+    (heap)->ah_item = (buf); \
+    (heap)->ah_size = (siz); \
+    (heap)->ah_len = 0; \
+} while (0)
+
+/**
+ * @brief Clear a array heap.
+ * @param heap  Pointer to the array heap.
+ */
+#define ARRAY_HEAP_CLEAR(heap) ((heap)->ah_len = 0)
+
+#define ARRAY_HEAP_LEN(heap) ((heap)->ah_len)
+
+#define ARRAY_HEAP_IS_EMPTY(heap) ((heap)->ah_len == 0)
+
+#define ARRAY_HEAP_IS_FULL(heap) ((heap)->ah_len == (heap)->ah_size)
+
+/**
+ * @brief The object with the highest priority. The heap should not be empty.
+ */
+#define ARRAY_HEAP_TOP(heap) ((heap)->ah_item[0])
+
+/**
+ * @brief Insert an object.
+ * @param name  Prefix name used by #ARRAY_HEAP_GEN.
+ * @param heap  Pointer to the array heap.
+ * @param item  The object.
+ * @return  \c true if successful; otherwise, \c false if the heap is full.
+ */
+#define ARRAY_HEAP_PUSH(name, heap, item) name##_array_heap_push(heap, item)
+
+/**
+ * @brief Remove the object with the highest priority.
+ * @param name  Prefix name used by #ARRAY_HEAP_GEN.
+ * @param heap  Pointer to the array heap.
+ * @param pitem  Pointer to the removed object.
+ * @return  \c true if successful; otherwise, \c false if the heap is empty.
+ */
+#define ARRAY_HEAP_POP(name, heap, pitem) name##_array_heap_pop(heap, pitem)
+
+/**
+ * @brief Remove the object at a position.
+ * @param name  Prefix name used by #ARRAY_HEAP_GEN.
+ * @param heap  Pointer to the array heap.
+ * @param pos  Position of the object.
+ * @param pitem  Pointer to the removed object.
+ * @return  \c true if successful; otherwise, \c false if \a pos is out of
+ * range.
+ */
+#define ARRAY_HEAP_REMOVE_AT(name, heap, pos, pitem) name##_array_heap_remove_at(heap, pos, pitem)
+
+/**
+ * @brief Restore the heap order after the priority of the object at a
+ * position changed, in either direction.
+ * @param name  Prefix name used by #ARRAY_HEAP_GEN.
+ * @param heap  Pointer to the array heap.
+ * @param pos  Position of the object.
+ */
+#define ARRAY_HEAP_UPDATE_AT(name, heap, pos) name##_array_heap_update_at(heap, pos)
+
+/**
+ * @brief Build a heap in O(n) from the first \a len objects of the buffer.
+ * @param name  Prefix name used by #ARRAY_HEAP_GEN.
+ * @param heap  Pointer to the array heap.
+ * @param len  Number of objects already in the buffer.
+ * @return  \c true if successful; otherwise, \c false if \a len exceeds the
+ * buffer size.
+ */
+#define ARRAY_HEAP_HEAPIFY(name, heap, len) name##_array_heap_heapify(heap, len)
+/**@}*/
+
+#define ARRAY_HEAP_GENERATE_SIFT_UP_PROTO(name, heap_type) \
+void name##_array_heap_sift_up(heap_type *heap, uint32_t pos)
+#define ARRAY_HEAP_GENERATE_SIFT_UP(name, heap_type, type, d, cmp, set_pos) \
+ARRAY_HEAP_GENERATE_SIFT_UP_PROTO(name, heap_type) \
+{ \
+    type item = heap->ah_item[pos]; \
+    while (pos > 0) \
+    { \
+        uint32_t parent = (pos - 1) / (d); \
+        if (cmp(item, heap->ah_item[parent]) >= 0) \
+        { \
+            break; \
+        } \
+        heap->ah_item[pos] = heap->ah_item[parent]; \
+        set_pos(heap->ah_item[pos], pos); \
+        pos = parent; \
+    } \
+    heap->ah_item[pos] = item; \
+    set_pos(heap->ah_item[pos], pos); \
+}
+
+#define ARRAY_HEAP_GENERATE_SIFT_DOWN_PROTO(name, heap_type) \
+void name##_array_heap_sift_down(heap_type *heap, uint32_t pos)
+#define ARRAY_HEAP_GENERATE_SIFT_DOWN(name, heap_type, type, d, cmp, set_pos) \
+ARRAY_HEAP_GENERATE_SIFT_DOWN_PROTO(name, heap_type) \
+{ \
+    type item = heap->ah_item[pos]; \
+    for (;;) \
+    { \
+        uint32_t first = pos * (d) + 1; \
+        if (first >= heap->ah_len) \
+        { \
+            break; \
+        } \
+        uint32_t last = (heap->ah_len - first > (d) ? first + (d) : heap->ah_len); \
+        uint32_t best = first; \
+        uint32_t c; \
+        for (c = first + 1; c < last; ++c) \
+        { \
+            if (cmp(heap->ah_item[c], heap->ah_item[best]) < 0) \
+            { \
+                best = c; \
+            } \
+        } \
+        if (cmp(heap->ah_item[best], item) >= 0) \
+        { \
+            break; \
+        } \
+        heap->ah_item[pos] = heap->ah_item[best]; \
+        set_pos(heap->ah_item[pos], pos); \
+        pos = best; \
+    } \
+    heap->ah_item[pos] = item; \
+    set_pos(heap->ah_item[pos], pos); \
+}
+
+#define ARRAY_HEAP_GENERATE_PUSH_PROTO(name, heap_type, type) \
+bool name##_array_heap_push(heap_type *heap, type item)
+#define ARRAY_HEAP_GENERATE_PUSH(name, heap_type, type) \
+ARRAY_HEAP_GENERATE_PUSH_PROTO(name, heap_type, type) \
+{ \
+    if (heap->ah_len == heap->ah_size) \
+    { \
+        return false; \
+    } \
+    heap->ah_item[heap->ah_len] = item; \
+    name##_array_heap_sift_up(heap, heap->ah_len++); \
+    return true; \
+}
+
+#define ARRAY_HEAP_GENERATE_REMOVE_AT_PROTO(name, heap_type, type) \
+bool name##_array_heap_remove_at(heap_type *heap, uint32_t pos, type *pitem)
+#define ARRAY_HEAP_GENERATE_REMOVE_AT(name, heap_type, type, cmp, set_pos) \
+ARRAY_HEAP_GENERATE_REMOVE_AT_PROTO(name, heap_type, type) \
+{ \
+    if (pos >= heap->ah_len) \
+    { \
+        return false; \
+    } \
+    *pitem = heap->ah_item[pos]; \
+    set_pos(*pitem, ARRAY_HEAP_NPOS); \
+    if (pos != --heap->ah_len) \
+    { \
+        /* Fill the hole with the last object and move it either way. */ \
+        heap->ah_item[pos] = heap->ah_item[heap->ah_len]; \
+        if (pos > 0 && cmp(heap->ah_item[pos], *pitem) < 0) \
+        { \
+            name##_array_heap_sift_up(heap, pos); \
+        } \
+        else \
+        { \
+            name##_array_heap_sift_down(heap, pos); \
+        } \
+    } \
+    return true; \
+}
+
+#define ARRAY_HEAP_GENERATE_POP_PROTO(name, heap_type, type) \
+bool name##_array_heap_pop(heap_type *heap, type *pitem)
+#define ARRAY_HEAP_GENERATE_POP(name, heap_type, type) \
+ARRAY_HEAP_GENERATE_POP_PROTO(name, heap_type, type) \
+{ \
+    return name##_array_heap_remove_at(heap, 0, pitem); \
+}
+
+#define ARRAY_HEAP_GENERATE_UPDATE_AT_PROTO(name, heap_type) \
+void name##_array_heap_update_at(heap_type *heap, uint32_t pos)
+#define ARRAY_HEAP_GENERATE_UPDATE_AT(name, heap_type, d, cmp) \
+ARRAY_HEAP_GENERATE_UPDATE_AT_PROTO(name, heap_type) \
+{ \
+    if (pos > 0 && cmp(heap->ah_item[pos], heap->ah_item[(pos - 1) / (d)]) < 0) \
+    { \
+        name##_array_heap_sift_up(heap, pos); \
+    } \
+    else \
+    { \
+        name##_array_heap_sift_down(heap, pos); \
+    } \
+}
+
+#define ARRAY_HEAP_GENERATE_HEAPIFY_PROTO(name, heap_type) \
+bool name##_array_heap_heapify(heap_type *heap, uint32_t len)
+#define ARRAY_HEAP_GENERATE_HEAPIFY(name, heap_type, d, set_pos) \
+ARRAY_HEAP_GENERATE_HEAPIFY_PROTO(name, heap_type) \
+{ \
+    uint32_t pos; \
+    if (len > heap->ah_size) \
+    { \
+        return false; \
+    } \
+    heap->ah_len = len; \
+    for (pos = 0; pos < len; ++pos) \
+    { \
+        set_pos(heap->ah_item[pos], pos); \
+    } \
+    /* Sift down every inner object, from the last one to the root. */ \
+    for (pos = (len > 1 ? (len - 2) / (d) + 1 : 0); pos > 0; --pos) \
+    { \
+        name##_array_heap_sift_down(heap, pos - 1); \
+    } \
+    return true; \
+}
+
+/**
+ * @addtogroup array_heap
+ * @{
+ */
+/**
+ * @brief Generate declaration for a array heap.
+ * @param name  Prefix name.
+ * @param heap_type  Type of the array heap.
+ * @param type  Type of objects contained in the array heap.
+ */
+#define ARRAY_HEAP_GEN_PROTO(name, heap_type, type) \
+ARRAY_HEAP_GENERATE_SIFT_UP_PROTO(name, heap_type); \
+ARRAY_HEAP_GENERATE_SIFT_DOWN_PROTO(name, heap_type); \
+ARRAY_HEAP_GENERATE_PUSH_PROTO(name, heap_type, type); \
+ARRAY_HEAP_GENERATE_REMOVE_AT_PROTO(name, heap_type, type); \
+ARRAY_HEAP_GENERATE_POP_PROTO(name, heap_type, type); \
+ARRAY_HEAP_GENERATE_UPDATE_AT_PROTO(name, heap_type); \
+ARRAY_HEAP_GENERATE_HEAPIFY_PROTO(name, heap_type);
+
+/**
+ * @brief Generate implementation for a d-ary array heap.
+ * @param name  Prefix name.
+ * @param heap_type  Type of the array heap.
+ * @param type  Type of objects contained in the array heap.
+ * @param d  Number of children per object.
+ * @param cmp  Comparator between objects. It takes two parameters and returns
+ * negative if the first has higher priority than the second.
+ * @param set_pos  Called as <tt>set_pos(item, pos)</tt> when an object moves
+ * to position \a pos, with #ARRAY_HEAP_NPOS when it leaves the heap. Use
+ * #ARRAY_HEAP_NO_POS if not needed.
+ */
+#define ARRAY_HEAP_GEN_D(name, heap_type, type, d, cmp, set_pos) \
+ARRAY_HEAP_GENERATE_SIFT_UP(name, heap_type, type, d, cmp, set_pos) \
+ARRAY_HEAP_GENERATE_SIFT_DOWN(name, heap_type, type, d, cmp, set_pos) \
+ARRAY_HEAP_GENERATE_PUSH(name, heap_type, type) \
+ARRAY_HEAP_GENERATE_REMOVE_AT(name, heap_type, type, cmp, set_pos) \
+ARRAY_HEAP_GENERATE_POP(name, heap_type, type) \
+ARRAY_HEAP_GENERATE_UPDATE_AT(name, heap_type, d, cmp) \
+ARRAY_HEAP_GENERATE_HEAPIFY(name, heap_type, d, set_pos)
+
+/**
+ * @brief Generate implementation for a array heap with
+ * #ARRAY_HEAP_DEFAULT_D children per object.
+ * @see #ARRAY_HEAP_GEN_D
+ */
+#define ARRAY_HEAP_GEN(name, heap_type, type, cmp, set_pos) \
+ARRAY_HEAP_GEN_D(name, heap_type, type, ARRAY_HEAP_DEFAULT_D, cmp, set_pos)
+/**@}*/
+
+#endif /* ARRAY_HEAP_H_ */
@@ -33,6 +33,22 @@ SOFTWARE.
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <string.h>
+
+/**
+ * @brief Trace hook of the generated functions.
+ *
+ * It is empty by default. Define it before generating the functions, or
+ * include array_trace.h with \c ARRAY_TRACE_HOOKS defined, to record each
+ * operation.
+ * @param op  Operation token: \c INSERT, \c REMOVE, \c FIND, \c POOL_GET,
+ * \c POOL_FREE or \c POOL_FIND.
+ * @param map  Pointer to the map.
+ * @param index  Index of the item, or -1 if not found or not inserted.
+ */
+#ifndef ARRAY_MAP_TRACE
+#define ARRAY_MAP_TRACE(op, map, index)
+#endif
 
 /**
  * @defgroup array_map_pool Array map pool
@@ -161,6 +177,7 @@ ARRAY_MAP_POOL_GENERATE_GET_PROTO(name, map_type, key_type, type) \
     { \
         if (map->amp_len >= map->amp_size) \
         { \
+            ARRAY_MAP_TRACE(POOL_GET, map, -1); \
             return (type) 0; \
         } \
         type new_item = map->amp_item[map->amp_len]; \
@@ -173,6 +190,7 @@ ARRAY_MAP_POOL_GENERATE_GET_PROTO(name, map_type, key_type, type) \
         map->amp_item[index] = new_item; \
         ++map->amp_len; \
     } \
+    ARRAY_MAP_TRACE(POOL_GET, map, index); \
     return map->amp_item[index]; \
 }
 
@@ -182,7 +200,9 @@ void name##_array_map_pool_free(map_type *map, key_type key)
 ARRAY_MAP_POOL_GENERATE_FREE_PROTO(name, map_type, key_type) \
 { \
     int index; \
-    if (ARRAY_MAP_POOL_BSEARCH(name, map, key, &index)) \
+    bool found = ARRAY_MAP_POOL_BSEARCH(name, map, key, &index); \
+    ARRAY_MAP_TRACE(POOL_FREE, map, found ? index : -1); \
+    if (found) \
     { \
         uint32_t i; \
         finalizer(map->amp_item[index]); \
@@ -203,7 +223,9 @@ ARRAY_MAP_POOL_GENERATE_FIND_PROTO(name, map_type, key_type, type) \
 { \
     type found = (type) 0; \
     int index; \
-    if (ARRAY_MAP_POOL_BSEARCH(name, map, key, &index)) \
+    bool ok = ARRAY_MAP_POOL_BSEARCH(name, map, key, &index); \
+    ARRAY_MAP_TRACE(POOL_FIND, map, ok ? index : -1); \
+    if (ok) \
     { \
         found = map->amp_item[index]; \
     } \
@@ -367,6 +389,7 @@ ARRAY_MAP_GENERATE_INSERT_PROTO(name, map_type, key_type, type) \
     { \
         if (map->am_len >= map->am_size) \
         { \
+            ARRAY_MAP_TRACE(INSERT, map, -1); \
             return false; \
         } \
         int i; \
@@ -376,8 +399,10 @@ ARRAY_MAP_GENERATE_INSERT_PROTO(name, map_type, key_type, type) \
         } \
         map->am_item[index] = value; \
         ++map->am_len; \
+        ARRAY_MAP_TRACE(INSERT, map, index); \
         return true; \
     } \
+    ARRAY_MAP_TRACE(INSERT, map, -1); \
     return false; \
 }
 
@@ -387,7 +412,9 @@ void name##_array_map_remove(map_type *map, key_type key)
 ARRAY_MAP_GENERATE_REMOVE_PROTO(name, map_type, key_type) \
 { \
     int index; \
-    if (ARRAY_MAP_BSEARCH(name, map, key, &index)) \
+    bool found = ARRAY_MAP_BSEARCH(name, map, key, &index); \
+    ARRAY_MAP_TRACE(REMOVE, map, found ? index : -1); \
+    if (found) \
     { \
         uint32_t i; \
         for (i = index; i < map->am_len - 1; ++i) \
@@ -406,9 +433,11 @@ ARRAY_MAP_GENERATE_FIND_PROTO(name, map_type, key_type, type) \
     int index; \
     if (ARRAY_MAP_BSEARCH(name, map, key, &index)) \
     { \
+        ARRAY_MAP_TRACE(FIND, map, index); \
         *value = map->am_item[index]; \
         return true; \
     } \
+    ARRAY_MAP_TRACE(FIND, map, -1); \
     return false; \
 }
 
@@ -445,4 +474,89 @@ ARRAY_MAP_GENERATE_REMOVE(name, map_type, key_type, type) \
 ARRAY_MAP_GENERATE_FIND(name, map_type, key_type, type)
 /**@}*/
 
+/**
+ * @defgroup array_map_str_key Array map string key
+ * @ingroup array_utils
+ *
+ * @brief String key with a cached prefix for array maps.
+ *
+ * Comparing string keys by \c strcmp dereferences the string of every probed
+ * value. #ARRAY_MAP_STR_KEY stores the first 8 bytes of the string as a
+ * big-endian integer next to the string pointer, so most probes are resolved
+ * by an integer comparison and the string is only read on prefix ties.
+ *
+ * Embed #ARRAY_MAP_STR_KEY in the values, use <tt>const ARRAY_MAP_STR_KEY *</tt>
+ * as the key type, and compare by #array_map_str_key_cmp, e.g.
+ * @code
+ * #define ITEM_KEY_CMP(item, key) array_map_str_key_cmp(&(item).name, (key))
+ * ARRAY_MAP_GEN(item_map, ITEM_MAP, const ARRAY_MAP_STR_KEY *, ITEM, ITEM_KEY_CMP)
+ * @endcode
+ * @{
+ */
+/**@brief String key with cached prefix. */
+typedef struct
+{
+    uint64_t am_prefix;
+    const char *am_str;
+} ARRAY_MAP_STR_KEY;
+
+/**
+ * @brief Get the normalized prefix of a string.
+ *
+ * The first 8 bytes of \a str are packed in big-endian order and padded with
+ * zeros, so comparing prefixes as integers gives the same order as \c strcmp.
+ * @param str  Null-terminated string.
+ * @return  The prefix of \a str.
+ */
+static inline uint64_t array_map_str_prefix(const char *str)
+{
+    uint64_t prefix = 0;
+    int i;
+    for (i = 0; i < 8; ++i)
+    {
+        prefix <<= 8;
+        if (*str != '\0')
+        {
+            prefix |= (uint8_t) *str++;
+        }
+    }
+    return prefix;
+}
+
+/**
+ * @brief Initialize a string key.
+ * @param key  Pointer to the #ARRAY_MAP_STR_KEY.
+ * @param str  Null-terminated string. It is referenced, not copied.
+ */
+#define ARRAY_MAP_STR_KEY_INIT(key, str) \
+do { \
+    (key)->am_prefix = array_map_str_prefix(str); \
+    (key)->am_str = (str); \
+} while (0)
+
+/**
+ * @brief Compare two string keys.
+ *
+ * The strings are only dereferenced if the prefixes are equal and not
+ * terminated within the prefix.
+ * @param a  Pointer to the first key.
+ * @param b  Pointer to the second key.
+ * @return  A value less than, equal to, or greater than zero if \a a is less
+ * than, equal to, or greater than \a b.
+ */
+static inline int array_map_str_key_cmp(const ARRAY_MAP_STR_KEY *a,
+        const ARRAY_MAP_STR_KEY *b)
+{
+    if (a->am_prefix != b->am_prefix)
+    {
+        return (a->am_prefix < b->am_prefix ? -1 : 1);
+    }
+    if ((a->am_prefix & 0xff) == 0)
+    {
+        return 0;
+    }
+    return strcmp(a->am_str + 8, b->am_str + 8);
+}
+/**@}*/
+
 #endif /* ARRAY_MAP_H_ */
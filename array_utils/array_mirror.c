@@ -0,0 +1,91 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016 Kuan-Chung Huang
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#define _GNU_SOURCE
+#include "array_mirror.h"
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+static int mirror_memfd(void)
+{
+    /* Call memfd_create through syscall, which predates its libc wrapper. */
+    return (int) syscall(SYS_memfd_create, "array_mirror", 0);
+}
+
+bool array_mirror_alloc(ARRAY_MIRROR *m, size_t size)
+{
+    long page = sysconf(_SC_PAGESIZE);
+    if (page <= 0 || size == 0 || size > SIZE_MAX / 2)
+    {
+        return false;
+    }
+    size = (size + (size_t) page - 1) / (size_t) page * (size_t) page;
+
+    int fd = mirror_memfd();
+    if (fd < 0)
+    {
+        return false;
+    }
+    if (ftruncate(fd, (off_t) size) != 0)
+    {
+        close(fd);
+        return false;
+    }
+
+    /* Reserve the address range first, then map the pages twice over it. */
+    uint8_t *base = mmap(NULL, 2 * size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS,
+            -1, 0);
+    if (base == MAP_FAILED)
+    {
+        close(fd);
+        return false;
+    }
+    if (mmap(base, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0)
+            == MAP_FAILED
+            || mmap(base + size, size, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED)
+    {
+        munmap(base, 2 * size);
+        close(fd);
+        return false;
+    }
+    /* The mappings keep the memory alive. */
+    close(fd);
+
+    m->amr_base = base;
+    m->amr_size = size;
+    return true;
+}
+
+void array_mirror_free(ARRAY_MIRROR *m)
+{
+    if (m->amr_base != NULL)
+    {
+        munmap(m->amr_base, 2 * m->amr_size);
+        m->amr_base = NULL;
+        m->amr_size = 0;
+    }
+}
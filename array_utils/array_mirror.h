@@ -0,0 +1,77 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016 Kuan-Chung Huang
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#ifndef ARRAY_MIRROR_H_
+#define ARRAY_MIRROR_H_
+
+#include <stddef.h>
+#include <stdbool.h>
+
+/**
+ * @defgroup array_mirror Array mirrored buffer
+ * @ingroup array_utils
+ *
+ * @brief A queue buffer mapped twice back to back in virtual memory.
+ *
+ * The same memory pages are mapped at [base, base + size) and
+ * [base + size, base + 2 * size), so writing past the end of the buffer writes
+ * to its beginning. Any region of at most \a size bytes starting inside the
+ * buffer is contiguous, and a queue using it as item buffer never needs to
+ * split a copy or a parse at the wrap point, e.g.
+ * @code
+ * ARRAY_MIRROR mirror;
+ * array_mirror_alloc(&mirror, 1 << 16);
+ * ARRAY_QUEUE_INIT(&queue, (uint8_t *) mirror.amr_base, mirror.amr_size);
+ * ...
+ * ARRAY_QUEUE_MIRROR_PEEK(&queue, n, &span);
+ * @endcode
+ * The capacity of the queue must cover the whole buffer, i.e. the item size
+ * should divide the page size.
+ *
+ * Only available on Linux; it relies on \c memfd_create.
+ * @{
+ */
+/**@brief Mirrored buffer. */
+typedef struct
+{
+    void *amr_base;
+    size_t amr_size;
+} ARRAY_MIRROR;
+
+/**
+ * @brief Allocate a mirrored buffer.
+ * @param m  Pointer to the mirrored buffer.
+ * @param size  Size in bytes. It is rounded up to a multiple of the page size.
+ * @return  \c true if successful; otherwise, \c false.
+ */
+bool array_mirror_alloc(ARRAY_MIRROR *m, size_t size);
+
+/**
+ * @brief Free a mirrored buffer.
+ * @param m  Pointer to the mirrored buffer.
+ */
+void array_mirror_free(ARRAY_MIRROR *m);
+/** @} */
+
+#endif /* ARRAY_MIRROR_H_ */
@@ -0,0 +1,285 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016 Kuan-Chung Huang
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#ifndef ARRAY_MPMC_H_
+#define ARRAY_MPMC_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+/**
+ * @defgroup array_mpmc Array MPMC queue
+ * @ingroup array_utils
+ *
+ * @brief A bounded lock-free queue for many producers and many consumers.
+ *
+ * Every cell of the caller-supplied buffer carries a sequence number telling
+ * which lap of the ring it is ready for. A producer claims the back index with
+ * one compare-and-swap when the cell's sequence equals the index, writes the
+ * item and publishes it by advancing the sequence. A consumer does the same on
+ * the front index. Producers and consumers only contend among themselves, and
+ * a stalled thread only blocks the cell it has claimed.
+ *
+ * Usage:
+ * @code
+ * ARRAY_MPMC_TYPE(JOB_QUEUE, JOB *);
+ * ARRAY_MPMC_GEN(job, JOB_QUEUE, JOB *);
+ *
+ * JOB_QUEUE_CELL job_buf[1024];
+ * JOB_QUEUE job_queue;
+ * ARRAY_MPMC_INIT(&job_queue, job_buf, 1024);
+ * ARRAY_MPMC_ENQUEUE(job, &job_queue, job);
+ * @endcode
+ * @{
+ */
+#ifndef ARRAY_MPMC_CACHE_LINE
+#define ARRAY_MPMC_CACHE_LINE 64
+#endif
+
+/**
+ * @brief Hint the processor that the caller is spinning.
+ */
+#ifndef ARRAY_MPMC_PAUSE
+#if defined(__x86_64__) || defined(__i386__)
+#define ARRAY_MPMC_PAUSE() __builtin_ia32_pause()
+#elif defined(__aarch64__)
+#define ARRAY_MPMC_PAUSE() __asm__ __volatile__("yield")
+#else
+#define ARRAY_MPMC_PAUSE() ((void) 0)
+#endif
+#endif
+
+/**
+ * @brief Give up the processor after spinning for a while. It may be defined
+ * to nothing on a system without a scheduler.
+ */
+#ifndef ARRAY_MPMC_YIELD
+#include <sched.h>
+#define ARRAY_MPMC_YIELD() sched_yield()
+#endif
+
+/**@brief Number of pauses before the spin variants start yielding. */
+#ifndef ARRAY_MPMC_SPIN
+#define ARRAY_MPMC_SPIN 64
+#endif
+
+/**
+ * @brief Declare a MPMC queue type and its cell type name##_CELL.
+ * @param name  Name of the queue type.
+ * @param type  Type of the queue items.
+ */
+#define ARRAY_MPMC_TYPE(name, type) \
+typedef struct \
+{ \
+    _Atomic uint32_t amc_seq; \
+    type amc_data; \
+} name##_CELL; \
+typedef struct \
+{ \
+    _Alignas(ARRAY_MPMC_CACHE_LINE) name##_CELL *amc_cell; \
+    uint32_t amc_mask; \
+    _Alignas(ARRAY_MPMC_CACHE_LINE) _Atomic uint32_t amc_back; \
+    _Alignas(ARRAY_MPMC_CACHE_LINE) _Atomic uint32_t amc_front; \
+} name
+
+#define _ARRAY_MPMC_RET(ret, val) ((ret) = (val))
+#define _ARRAY_MPMC_NO_RET(ret, val)
+
+#define _ARRAY_MPMC_INIT_IMPL(q, buf, siz, ret_func, ret) \
+do { \
+    uint32_t i_; \
+    (q)->amc_cell = (buf); \
+    (q)->amc_mask = (uint32_t) (siz) - 1; \
+    for (i_ = 0; i_ < (uint32_t) (siz); ++i_) \
+    { \
+        atomic_init(&(q)->amc_cell[i_].amc_seq, i_); \
+    } \
+    atomic_init(&(q)->amc_back, 0); \
+    atomic_init(&(q)->amc_front, 0); \
+    ret_func(ret, (siz) != 0 && ((siz) & ((siz) - 1)) == 0 \
+            && (uint64_t) (siz) <= UINT32_C(0x80000000)); \
+} while (0)
+
+/**
+ * @brief Initialize a MPMC queue before it is shared with other threads.
+ * @param q  Pointer to the queue.
+ * @param buf  Pointer to the cell buffer.
+ * @param siz  Number of cells in \a buf, a power of two no more than 2^31.
+ */
+#define ARRAY_MPMC_INIT(q, buf, siz) _ARRAY_MPMC_INIT_IMPL(q, buf, siz, _ARRAY_MPMC_NO_RET,)
+/**
+ * @brief Initialize a MPMC queue and check its capacity.
+ * @param ret  Set to false if \a siz is not a valid capacity.
+ */
+#define ARRAY_MPMC_INIT_RET(q, buf, siz, ret) _ARRAY_MPMC_INIT_IMPL(q, buf, siz, _ARRAY_MPMC_RET, ret)
+
+/**@brief Capacity of a MPMC queue. */
+#define ARRAY_MPMC_SIZE(q) ((q)->amc_mask + 1)
+
+/**
+ * @brief Number of items in a MPMC queue, including items being written or
+ * read. Only a snapshot when other threads are running concurrently.
+ */
+#define ARRAY_MPMC_LEN(q) \
+    (atomic_load_explicit(&(q)->amc_back, memory_order_relaxed) \
+            - atomic_load_explicit(&(q)->amc_front, memory_order_relaxed))
+
+#define _ARRAY_MPMC_GENERATE_CLAIM(q, index, cell, seq_off) \
+    uint32_t pos = atomic_load_explicit(&(q)->index, memory_order_relaxed); \
+    for (;;) \
+    { \
+        cell = &(q)->amc_cell[pos & (q)->amc_mask]; \
+        uint32_t seq = atomic_load_explicit(&cell->amc_seq, memory_order_acquire); \
+        int32_t diff = (int32_t) (seq - (pos + (seq_off))); \
+        if (diff == 0) \
+        { \
+            if (atomic_compare_exchange_weak_explicit(&(q)->index, &pos, \
+                    pos + 1, memory_order_relaxed, memory_order_relaxed)) \
+            { \
+                break; \
+            } \
+        } \
+        else if (diff < 0) \
+        { \
+            return false; \
+        } \
+        else \
+        { \
+            pos = atomic_load_explicit(&(q)->index, memory_order_relaxed); \
+        } \
+    }
+
+#define _ARRAY_MPMC_GENERATE_SPIN(cond) \
+    unsigned spin = 0; \
+    while (!(cond)) \
+    { \
+        if (++spin < ARRAY_MPMC_SPIN) \
+        { \
+            ARRAY_MPMC_PAUSE(); \
+        } \
+        else \
+        { \
+            ARRAY_MPMC_YIELD(); \
+        } \
+    }
+
+#define ARRAY_MPMC_GENERATE_TRY_ENQUEUE_PROTO(name, queue_type, type) \
+bool name##_array_mpmc_try_enqueue(queue_type *q, type data)
+#define ARRAY_MPMC_GENERATE_TRY_ENQUEUE(name, queue_type, type) \
+ARRAY_MPMC_GENERATE_TRY_ENQUEUE_PROTO(name, queue_type, type) \
+{ \
+    __typeof__(q->amc_cell) cell; \
+    _ARRAY_MPMC_GENERATE_CLAIM(q, amc_back, cell, 0) \
+    cell->amc_data = data; \
+    atomic_store_explicit(&cell->amc_seq, pos + 1, memory_order_release); \
+    return true; \
+}
+
+#define ARRAY_MPMC_GENERATE_TRY_DEQUEUE_PROTO(name, queue_type, type) \
+bool name##_array_mpmc_try_dequeue(queue_type *q, type *pdata)
+#define ARRAY_MPMC_GENERATE_TRY_DEQUEUE(name, queue_type, type) \
+ARRAY_MPMC_GENERATE_TRY_DEQUEUE_PROTO(name, queue_type, type) \
+{ \
+    __typeof__(q->amc_cell) cell; \
+    _ARRAY_MPMC_GENERATE_CLAIM(q, amc_front, cell, 1) \
+    *pdata = cell->amc_data; \
+    atomic_store_explicit(&cell->amc_seq, pos + q->amc_mask + 1, \
+            memory_order_release); \
+    return true; \
+}
+
+#define ARRAY_MPMC_GENERATE_ENQUEUE_PROTO(name, queue_type, type) \
+void name##_array_mpmc_enqueue(queue_type *q, type data)
+#define ARRAY_MPMC_GENERATE_ENQUEUE(name, queue_type, type) \
+ARRAY_MPMC_GENERATE_ENQUEUE_PROTO(name, queue_type, type) \
+{ \
+    _ARRAY_MPMC_GENERATE_SPIN(name##_array_mpmc_try_enqueue(q, data)) \
+}
+
+#define ARRAY_MPMC_GENERATE_DEQUEUE_PROTO(name, queue_type, type) \
+void name##_array_mpmc_dequeue(queue_type *q, type *pdata)
+#define ARRAY_MPMC_GENERATE_DEQUEUE(name, queue_type, type) \
+ARRAY_MPMC_GENERATE_DEQUEUE_PROTO(name, queue_type, type) \
+{ \
+    _ARRAY_MPMC_GENERATE_SPIN(name##_array_mpmc_try_dequeue(q, pdata)) \
+}
+
+/**
+ * @brief Try to enqueue an item.
+ * @param name  Prefix name used by #ARRAY_MPMC_GEN.
+ * @param q  Pointer to the queue.
+ * @param data  The item.
+ * @return  \c true if successful; otherwise, \c false if the queue is full.
+ */
+#define ARRAY_MPMC_TRY_ENQUEUE(name, q, data) name##_array_mpmc_try_enqueue(q, data)
+/**
+ * @brief Try to dequeue an item.
+ * @param name  Prefix name used by #ARRAY_MPMC_GEN.
+ * @param q  Pointer to the queue.
+ * @param pdata  Pointer to the returned item.
+ * @return  \c true if successful; otherwise, \c false if the queue is empty.
+ */
+#define ARRAY_MPMC_TRY_DEQUEUE(name, q, pdata) name##_array_mpmc_try_dequeue(q, pdata)
+/**
+ * @brief Enqueue an item, spinning while the queue is full.
+ * @param name  Prefix name used by #ARRAY_MPMC_GEN.
+ * @param q  Pointer to the queue.
+ * @param data  The item.
+ */
+#define ARRAY_MPMC_ENQUEUE(name, q, data) name##_array_mpmc_enqueue(q, data)
+/**
+ * @brief Dequeue an item, spinning while the queue is empty.
+ * @param name  Prefix name used by #ARRAY_MPMC_GEN.
+ * @param q  Pointer to the queue.
+ * @param pdata  Pointer to the returned item.
+ */
+#define ARRAY_MPMC_DEQUEUE(name, q, pdata) name##_array_mpmc_dequeue(q, pdata)
+
+/**
+ * @brief Generate declaration for a MPMC queue.
+ * @param name  Prefix name.
+ * @param queue_type  Type of the queue declared by #ARRAY_MPMC_TYPE.
+ * @param type  Type of the queue items.
+ */
+#define ARRAY_MPMC_GEN_PROTO(name, queue_type, type) \
+ARRAY_MPMC_GENERATE_TRY_ENQUEUE_PROTO(name, queue_type, type); \
+ARRAY_MPMC_GENERATE_TRY_DEQUEUE_PROTO(name, queue_type, type); \
+ARRAY_MPMC_GENERATE_ENQUEUE_PROTO(name, queue_type, type); \
+ARRAY_MPMC_GENERATE_DEQUEUE_PROTO(name, queue_type, type);
+
+/**
+ * @brief Generate implementation for a MPMC queue.
+ * @param name  Prefix name.
+ * @param queue_type  Type of the queue declared by #ARRAY_MPMC_TYPE.
+ * @param type  Type of the queue items.
+ */
+#define ARRAY_MPMC_GEN(name, queue_type, type) \
+ARRAY_MPMC_GENERATE_TRY_ENQUEUE(name, queue_type, type) \
+ARRAY_MPMC_GENERATE_TRY_DEQUEUE(name, queue_type, type) \
+ARRAY_MPMC_GENERATE_ENQUEUE(name, queue_type, type) \
+ARRAY_MPMC_GENERATE_DEQUEUE(name, queue_type, type)
+/** @} */
+
+#endif /* ARRAY_MPMC_H_ */
@@ -28,6 +28,7 @@ SOFTWARE.
 #include <stdint.h>
 #include <stdbool.h>
 #include <stddef.h>
+#include <string.h>
 
 #define ARRAY_QUEUE_TYPE_IMPL(name, type, size_type) \
 typedef struct \
@@ -97,6 +98,139 @@ do { \
 #define ARRAY_QUEUE_ENQUEUE_RET(q, data, ret) _ARRAY_QUEUE_ENQUEUE_IMPL(q, data, _ARRAY_QUEUE_RET, ret)
 #define ARRAY_QUEUE_DEQUEUE_RET(q, pdata, ret) _ARRAY_QUEUE_DEQUEUE_IMPL(q, pdata, _ARRAY_QUEUE_RET, ret)
 
+/* Bulk enqueue and dequeue.
+ *
+ * Items are copied by at most two memcpy calls, one on each side of the wrap
+ * point, and the indices are updated once per batch. The _N flavours move all
+ * n items or none; the _BURST flavours move as many as fit and set ret to the
+ * number moved.
+ */
+#define _ARRAY_QUEUE_ENQUEUE_N_IMPL(q, data, n, all, ret_func, ret) \
+do { \
+    size_t req_ = (n), n_ = req_; \
+    size_t free_ = (size_t) (q)->aq_size - (q)->aq_len; \
+    if (n_ > free_) \
+    { \
+        n_ = (all) ? 0 : free_; \
+    } \
+    size_t first_ = (size_t) (q)->aq_size - (q)->aq_back; \
+    if (first_ > n_) \
+    { \
+        first_ = n_; \
+    } \
+    memcpy(&(q)->aq_item[(q)->aq_back], (data), first_ * sizeof(*(q)->aq_item)); \
+    memcpy(&(q)->aq_item[0], (data) + first_, (n_ - first_) * sizeof(*(q)->aq_item)); \
+    size_t back_ = (size_t) (q)->aq_back + n_; \
+    (q)->aq_back = (back_ >= (q)->aq_size ? back_ - (q)->aq_size : back_); \
+    (q)->aq_len += n_; \
+    ret_func(ret, n_, req_); \
+} while (0)
+
+#define _ARRAY_QUEUE_DEQUEUE_N_IMPL(q, data, n, all, ret_func, ret) \
+do { \
+    size_t req_ = (n), n_ = req_; \
+    if (n_ > (q)->aq_len) \
+    { \
+        n_ = (all) ? 0 : (q)->aq_len; \
+    } \
+    size_t first_ = (size_t) (q)->aq_size - (q)->aq_front; \
+    if (first_ > n_) \
+    { \
+        first_ = n_; \
+    } \
+    memcpy((data), &(q)->aq_item[(q)->aq_front], first_ * sizeof(*(q)->aq_item)); \
+    memcpy((data) + first_, &(q)->aq_item[0], (n_ - first_) * sizeof(*(q)->aq_item)); \
+    size_t front_ = (size_t) (q)->aq_front + n_; \
+    (q)->aq_front = (front_ >= (q)->aq_size ? front_ - (q)->aq_size : front_); \
+    (q)->aq_len -= n_; \
+    ret_func(ret, n_, req_); \
+} while (0)
+
+#define _ARRAY_QUEUE_N_RET(ret, n_moved, n) ((ret) = ((n_moved) == (n)))
+#define _ARRAY_QUEUE_BURST_RET(ret, n_moved, n) ((ret) = (n_moved))
+#define _ARRAY_QUEUE_N_NO_RET(ret, n_moved, n)
+
+#define ARRAY_QUEUE_ENQUEUE_N(q, data, n) _ARRAY_QUEUE_ENQUEUE_N_IMPL(q, data, n, true, _ARRAY_QUEUE_N_NO_RET,)
+#define ARRAY_QUEUE_DEQUEUE_N(q, data, n) _ARRAY_QUEUE_DEQUEUE_N_IMPL(q, data, n, true, _ARRAY_QUEUE_N_NO_RET,)
+
+#define ARRAY_QUEUE_ENQUEUE_N_RET(q, data, n, ret) _ARRAY_QUEUE_ENQUEUE_N_IMPL(q, data, n, true, _ARRAY_QUEUE_N_RET, ret)
+#define ARRAY_QUEUE_DEQUEUE_N_RET(q, data, n, ret) _ARRAY_QUEUE_DEQUEUE_N_IMPL(q, data, n, true, _ARRAY_QUEUE_N_RET, ret)
+
+#define ARRAY_QUEUE_ENQUEUE_BURST(q, data, n, ret) _ARRAY_QUEUE_ENQUEUE_N_IMPL(q, data, n, false, _ARRAY_QUEUE_BURST_RET, ret)
+#define ARRAY_QUEUE_DEQUEUE_BURST(q, data, n, ret) _ARRAY_QUEUE_DEQUEUE_N_IMPL(q, data, n, false, _ARRAY_QUEUE_BURST_RET, ret)
+
+/* Zero-copy access.
+ *
+ * ARRAY_QUEUE_RESERVE exposes up to n free slots after the back, and
+ * ARRAY_QUEUE_PEEK exposes up to n items from the front. Either may be split
+ * by the wrap point, so they fill two spans; the second span is empty unless
+ * the region wraps. Items are built or consumed in place and then published by
+ * ARRAY_QUEUE_COMMIT or freed by ARRAY_QUEUE_RELEASE with a count no more than
+ * the total length of the spans.
+ */
+#define ARRAY_QUEUE_SPAN_TYPE(name, type) \
+typedef struct \
+{ \
+    type *aq_item; \
+    size_t aq_len; \
+} name
+
+#define _ARRAY_QUEUE_SPAN_IMPL(q, start, n, avail, pspan1, pspan2) \
+do { \
+    size_t n_ = (n); \
+    size_t avail_ = (avail); \
+    if (n_ > avail_) \
+    { \
+        n_ = avail_; \
+    } \
+    size_t first_ = (size_t) (q)->aq_size - (start); \
+    if (first_ > n_) \
+    { \
+        first_ = n_; \
+    } \
+    (pspan1)->aq_item = &(q)->aq_item[(start)]; \
+    (pspan1)->aq_len = first_; \
+    (pspan2)->aq_item = &(q)->aq_item[0]; \
+    (pspan2)->aq_len = n_ - first_; \
+} while (0)
+
+#define ARRAY_QUEUE_RESERVE(q, n, pspan1, pspan2) \
+    _ARRAY_QUEUE_SPAN_IMPL(q, (q)->aq_back, n, (size_t) (q)->aq_size - (q)->aq_len, pspan1, pspan2)
+
+#define ARRAY_QUEUE_COMMIT(q, n) \
+do { \
+    size_t back_ = (size_t) (q)->aq_back + (n); \
+    (q)->aq_back = (back_ >= (q)->aq_size ? back_ - (q)->aq_size : back_); \
+    (q)->aq_len += (n); \
+} while (0)
+
+#define ARRAY_QUEUE_PEEK(q, n, pspan1, pspan2) \
+    _ARRAY_QUEUE_SPAN_IMPL(q, (q)->aq_front, n, (q)->aq_len, pspan1, pspan2)
+
+#define ARRAY_QUEUE_RELEASE(q, n) \
+do { \
+    size_t front_ = (size_t) (q)->aq_front + (n); \
+    (q)->aq_front = (front_ >= (q)->aq_size ? front_ - (q)->aq_size : front_); \
+    (q)->aq_len -= (n); \
+} while (0)
+
+/* With a mirrored item buffer from array_mirror.h, a region starting inside
+ * the buffer never wraps, so a single span covers it.
+ */
+#define _ARRAY_QUEUE_MIRROR_SPAN_IMPL(q, start, n, avail, pspan) \
+do { \
+    size_t n_ = (n); \
+    size_t avail_ = (avail); \
+    (pspan)->aq_item = &(q)->aq_item[(start)]; \
+    (pspan)->aq_len = (n_ > avail_ ? avail_ : n_); \
+} while (0)
+
+#define ARRAY_QUEUE_MIRROR_RESERVE(q, n, pspan) \
+    _ARRAY_QUEUE_MIRROR_SPAN_IMPL(q, (q)->aq_back, n, (size_t) (q)->aq_size - (q)->aq_len, pspan)
+
+#define ARRAY_QUEUE_MIRROR_PEEK(q, n, pspan) \
+    _ARRAY_QUEUE_MIRROR_SPAN_IMPL(q, (q)->aq_front, n, (q)->aq_len, pspan)
+
 #define ARRAY_QUEUE_ITER_END(q) (NULL)
 #define ARRAY_QUEUE_ITER(q) (ARRAY_QUEUE_IS_EMPTY(q) ? ARRAY_QUEUE_ITER_END(q): &(q)->aq_item[(q)->aq_front])
 #define ARRAY_QUEUE_ITER_NEXT(q, iter) \
@@ -114,25 +248,302 @@ do { \
 } while (0)
 #define ARRAY_QUEUE_ITER_REMOVE(q, iter) \
 do { \
-    ptrdiff_t idx = (iter) - (q)->aq_item; \
-    ptrdiff_t i, i_next; \
-    i = idx; \
-    i_next = (i + 1) % (q)->aq_size; \
-    if (i_next == (q)->aq_back) \
+    ptrdiff_t i = (iter) - (q)->aq_item; \
+    ptrdiff_t i_next = (i + 1 == (q)->aq_size ? 0 : i + 1); \
+    ptrdiff_t n_before = i - (q)->aq_front; \
+    if (n_before < 0) \
     { \
-        (iter) = ARRAY_QUEUE_ITER_END(q); \
+        n_before += (q)->aq_size; \
+    } \
+    if (n_before < (ptrdiff_t) (q)->aq_len - 1 - n_before) \
+    { \
+        /* Shift the items before iter toward the back. */ \
+        while (i != (q)->aq_front) \
+        { \
+            ptrdiff_t i_prev = (i == 0 ? (q)->aq_size : i) - 1; \
+            (q)->aq_item[i] = (q)->aq_item[i_prev]; \
+            i = i_prev; \
+        } \
+        (q)->aq_front = (i + 1 == (q)->aq_size ? 0 : i + 1); \
+        (iter) = &(q)->aq_item[i_next]; \
     } \
     else \
     { \
-        do \
+        /* Shift the items after iter toward the front. */ \
+        if (i_next == (q)->aq_back) \
+        { \
+            (iter) = ARRAY_QUEUE_ITER_END(q); \
+        } \
+        while (i_next != (q)->aq_back) \
         { \
             (q)->aq_item[i] = (q)->aq_item[i_next]; \
             i = i_next; \
-            i_next = (i + 1) % (q)->aq_size; \
-        } while (i_next != (q)->aq_back); \
+            i_next = (i + 1 == (q)->aq_size ? 0 : i + 1); \
+        } \
+        (q)->aq_back = i; \
     } \
-    (q)->aq_back = i; \
     --(q)->aq_len; \
 } while (0)
 
+/* Remove the items for which pred, taking a pointer to the item, is true. The
+ * kept items are compacted toward the front in one pass.
+ */
+#define ARRAY_QUEUE_REMOVE_IF(q, pred) \
+do { \
+    size_t r_ = (q)->aq_front, w_ = (q)->aq_front; \
+    size_t n_ = (q)->aq_len, k_; \
+    for (k_ = 0; k_ < n_; ++k_) \
+    { \
+        if (pred(&(q)->aq_item[r_])) \
+        { \
+            --(q)->aq_len; \
+        } \
+        else \
+        { \
+            if (w_ != r_) \
+            { \
+                (q)->aq_item[w_] = (q)->aq_item[r_]; \
+            } \
+            if (++w_ == (q)->aq_size) \
+            { \
+                w_ = 0; \
+            } \
+        } \
+        if (++r_ == (q)->aq_size) \
+        { \
+            r_ = 0; \
+        } \
+    } \
+    (q)->aq_back = w_; \
+} while (0)
+
+/* Deque operations. */
+#define _ARRAY_QUEUE_WRAP(q, idx) ((idx) >= (q)->aq_size ? (idx) - (q)->aq_size : (idx))
+
+#define ARRAY_QUEUE_AT(q, i) ((q)->aq_item[_ARRAY_QUEUE_WRAP(q, (size_t) (q)->aq_front + (i))])
+
+#define ARRAY_QUEUE_BACK(q) ((q)->aq_item[((q)->aq_back == 0 ? (q)->aq_size : (q)->aq_back) - 1])
+
+#define _ARRAY_QUEUE_PUSH_FRONT_IMPL(q, data, ret_func, ret) \
+do { \
+    if (ARRAY_QUEUE_IS_FULL(q)) \
+    { \
+        ret_func(ret, false); \
+    } \
+    else \
+    { \
+        (q)->aq_front = ((q)->aq_front == 0 ? (q)->aq_size : (q)->aq_front) - 1; \
+        (q)->aq_item[(q)->aq_front] = (data); \
+        ++(q)->aq_len; \
+        ret_func(ret, true); \
+    } \
+} while (0)
+
+#define _ARRAY_QUEUE_POP_BACK_IMPL(q, pdata, ret_func, ret) \
+do { \
+    if (ARRAY_QUEUE_IS_EMPTY(q)) \
+    { \
+        ret_func(ret, false); \
+    } \
+    else \
+    { \
+        (q)->aq_back = ((q)->aq_back == 0 ? (q)->aq_size : (q)->aq_back) - 1; \
+        *(pdata) = (q)->aq_item[(q)->aq_back]; \
+        --(q)->aq_len; \
+        ret_func(ret, true); \
+    } \
+} while (0)
+
+#define ARRAY_QUEUE_PUSH_FRONT(q, data) _ARRAY_QUEUE_PUSH_FRONT_IMPL(q, data, _ARRAY_QUEUE_NO_RET,)
+#define ARRAY_QUEUE_POP_BACK(q, pdata) _ARRAY_QUEUE_POP_BACK_IMPL(q, pdata, _ARRAY_QUEUE_NO_RET,)
+
+#define ARRAY_QUEUE_PUSH_FRONT_RET(q, data, ret) _ARRAY_QUEUE_PUSH_FRONT_IMPL(q, data, _ARRAY_QUEUE_RET, ret)
+#define ARRAY_QUEUE_POP_BACK_RET(q, pdata, ret) _ARRAY_QUEUE_POP_BACK_IMPL(q, pdata, _ARRAY_QUEUE_RET, ret)
+
+/* Power-of-two queue.
+ *
+ * The capacity is a power of two, so indices wrap by masking instead of
+ * division. aq_front and aq_back run freely and the length is their
+ * difference, so each operation stores one index and no length. The capacity
+ * should be at most half the range of size_type, i.e. 128 for
+ * ARRAY_QUEUE_P2_TYPE_8, to tell a full queue from an empty one.
+ */
+#define ARRAY_QUEUE_P2_TYPE_IMPL(name, type, size_type) \
+typedef struct \
+{ \
+    type *aq_item; \
+    size_type aq_mask; \
+    size_type aq_front; \
+    size_type aq_back; \
+} name
+
+#define ARRAY_QUEUE_P2_TYPE_8(name, type) ARRAY_QUEUE_P2_TYPE_IMPL(name, type, uint8_t)
+#define ARRAY_QUEUE_P2_TYPE_16(name, type) ARRAY_QUEUE_P2_TYPE_IMPL(name, type, uint16_t)
+#define ARRAY_QUEUE_P2_TYPE_32(name, type) ARRAY_QUEUE_P2_TYPE_IMPL(name, type, uint32_t)
+
+#define ARRAY_QUEUE_IS_POW2(siz) ((siz) != 0 && ((siz) & ((siz) - 1)) == 0)
+
+#define _ARRAY_QUEUE_P2_INIT_IMPL(q, buf, siz, ret_func, ret) \
+do { \
+    (q)->aq_item = (buf); \
+    (q)->aq_mask = (siz) - 1; \
+    /* Check twice the capacity still fits in the size type. */ \
+    (q)->aq_front = (q)->aq_mask * 2 + 1; \
+    ret_func(ret, ARRAY_QUEUE_IS_POW2(siz) \
+            && (uint64_t) (q)->aq_front == (uint64_t) (siz) * 2 - 1); \
+    (q)->aq_front = 0; \
+    (q)->aq_back = 0; \
+} while (0)
+
+#define ARRAY_QUEUE_P2_INIT(q, buf, siz) _ARRAY_QUEUE_P2_INIT_IMPL(q, buf, siz, _ARRAY_QUEUE_NO_RET,)
+#define ARRAY_QUEUE_P2_INIT_RET(q, buf, siz, ret) _ARRAY_QUEUE_P2_INIT_IMPL(q, buf, siz, _ARRAY_QUEUE_RET, ret)
+
+#define ARRAY_QUEUE_P2_SIZE(q) ((q)->aq_mask + 1)
+
+#define ARRAY_QUEUE_P2_LEN(q) (((q)->aq_back - (q)->aq_front) & ((q)->aq_mask * 2 + 1))
+
+#define ARRAY_QUEUE_P2_IS_EMPTY(q) ((q)->aq_front == (q)->aq_back)
+
+#define ARRAY_QUEUE_P2_IS_FULL(q) (ARRAY_QUEUE_P2_LEN(q) == ARRAY_QUEUE_P2_SIZE(q))
+
+#define ARRAY_QUEUE_P2_FRONT(q) ((q)->aq_item[(q)->aq_front & (q)->aq_mask])
+
+#define _ARRAY_QUEUE_P2_ENQUEUE_IMPL(q, data, ret_func, ret) \
+do { \
+    if (ARRAY_QUEUE_P2_IS_FULL(q)) \
+    { \
+        ret_func(ret, false); \
+    } \
+    else \
+    { \
+        (q)->aq_item[(q)->aq_back & (q)->aq_mask] = (data); \
+        ++(q)->aq_back; \
+        ret_func(ret, true); \
+    } \
+} while (0)
+
+#define _ARRAY_QUEUE_P2_DEQUEUE_IMPL(q, pdata, ret_func, ret) \
+do { \
+    if (ARRAY_QUEUE_P2_IS_EMPTY(q)) \
+    { \
+        ret_func(ret, false); \
+    } \
+    else \
+    { \
+        *(pdata) = (q)->aq_item[(q)->aq_front & (q)->aq_mask]; \
+        ++(q)->aq_front; \
+        ret_func(ret, true); \
+    } \
+} while (0)
+
+#define ARRAY_QUEUE_P2_ENQUEUE(q, data) _ARRAY_QUEUE_P2_ENQUEUE_IMPL(q, data, _ARRAY_QUEUE_NO_RET,)
+#define ARRAY_QUEUE_P2_DEQUEUE(q, pdata) _ARRAY_QUEUE_P2_DEQUEUE_IMPL(q, pdata, _ARRAY_QUEUE_NO_RET,)
+
+#define ARRAY_QUEUE_P2_ENQUEUE_RET(q, data, ret) _ARRAY_QUEUE_P2_ENQUEUE_IMPL(q, data, _ARRAY_QUEUE_RET, ret)
+#define ARRAY_QUEUE_P2_DEQUEUE_RET(q, pdata, ret) _ARRAY_QUEUE_P2_DEQUEUE_IMPL(q, pdata, _ARRAY_QUEUE_RET, ret)
+
+#define ARRAY_QUEUE_P2_ITER_END(q) (NULL)
+#define ARRAY_QUEUE_P2_ITER(q) (ARRAY_QUEUE_P2_IS_EMPTY(q) ? ARRAY_QUEUE_P2_ITER_END(q) : &ARRAY_QUEUE_P2_FRONT(q))
+#define ARRAY_QUEUE_P2_ITER_NEXT(q, iter) \
+do { \
+    ptrdiff_t i = ((iter) - (q)->aq_item + 1) & (q)->aq_mask; \
+    if (i == ((q)->aq_back & (q)->aq_mask)) \
+    { \
+        (iter) = ARRAY_QUEUE_P2_ITER_END(q); \
+    } \
+    else \
+    { \
+        (iter) = &(q)->aq_item[i]; \
+    } \
+} while (0)
+#define ARRAY_QUEUE_P2_ITER_REMOVE(q, iter) \
+do { \
+    ptrdiff_t i = (iter) - (q)->aq_item; \
+    ptrdiff_t i_next = (i + 1) & (q)->aq_mask; \
+    ptrdiff_t n_before = (i - (q)->aq_front) & (q)->aq_mask; \
+    if (n_before < (ptrdiff_t) ARRAY_QUEUE_P2_LEN(q) - 1 - n_before) \
+    { \
+        ptrdiff_t i_front = (q)->aq_front & (q)->aq_mask; \
+        while (i != i_front) \
+        { \
+            ptrdiff_t i_prev = (i - 1) & (q)->aq_mask; \
+            (q)->aq_item[i] = (q)->aq_item[i_prev]; \
+            i = i_prev; \
+        } \
+        ++(q)->aq_front; \
+        (iter) = &(q)->aq_item[i_next]; \
+    } \
+    else \
+    { \
+        ptrdiff_t i_back = (q)->aq_back & (q)->aq_mask; \
+        if (i_next == i_back) \
+        { \
+            (iter) = ARRAY_QUEUE_P2_ITER_END(q); \
+        } \
+        while (i_next != i_back) \
+        { \
+            (q)->aq_item[i] = (q)->aq_item[i_next]; \
+            i = i_next; \
+            i_next = (i + 1) & (q)->aq_mask; \
+        } \
+        --(q)->aq_back; \
+    } \
+} while (0)
+
+#define ARRAY_QUEUE_P2_REMOVE_IF(q, pred) \
+do { \
+    size_t r_ = (q)->aq_front, w_ = (q)->aq_front; \
+    size_t n_ = ARRAY_QUEUE_P2_LEN(q), k_; \
+    for (k_ = 0; k_ < n_; ++k_, ++r_) \
+    { \
+        if (!pred(&(q)->aq_item[r_ & (q)->aq_mask])) \
+        { \
+            if (w_ != r_) \
+            { \
+                (q)->aq_item[w_ & (q)->aq_mask] = (q)->aq_item[r_ & (q)->aq_mask]; \
+            } \
+            ++w_; \
+        } \
+    } \
+    (q)->aq_back = w_; \
+} while (0)
+
+#define ARRAY_QUEUE_P2_AT(q, i) ((q)->aq_item[((q)->aq_front + (i)) & (q)->aq_mask])
+
+#define ARRAY_QUEUE_P2_BACK(q) ((q)->aq_item[((q)->aq_back - 1) & (q)->aq_mask])
+
+#define _ARRAY_QUEUE_P2_PUSH_FRONT_IMPL(q, data, ret_func, ret) \
+do { \
+    if (ARRAY_QUEUE_P2_IS_FULL(q)) \
+    { \
+        ret_func(ret, false); \
+    } \
+    else \
+    { \
+        --(q)->aq_front; \
+        (q)->aq_item[(q)->aq_front & (q)->aq_mask] = (data); \
+        ret_func(ret, true); \
+    } \
+} while (0)
+
+#define _ARRAY_QUEUE_P2_POP_BACK_IMPL(q, pdata, ret_func, ret) \
+do { \
+    if (ARRAY_QUEUE_P2_IS_EMPTY(q)) \
+    { \
+        ret_func(ret, false); \
+    } \
+    else \
+    { \
+        --(q)->aq_back; \
+        *(pdata) = (q)->aq_item[(q)->aq_back & (q)->aq_mask]; \
+        ret_func(ret, true); \
+    } \
+} while (0)
+
+#define ARRAY_QUEUE_P2_PUSH_FRONT(q, data) _ARRAY_QUEUE_P2_PUSH_FRONT_IMPL(q, data, _ARRAY_QUEUE_NO_RET,)
+#define ARRAY_QUEUE_P2_POP_BACK(q, pdata) _ARRAY_QUEUE_P2_POP_BACK_IMPL(q, pdata, _ARRAY_QUEUE_NO_RET,)
+
+#define ARRAY_QUEUE_P2_PUSH_FRONT_RET(q, data, ret) _ARRAY_QUEUE_P2_PUSH_FRONT_IMPL(q, data, _ARRAY_QUEUE_RET, ret)
+#define ARRAY_QUEUE_P2_POP_BACK_RET(q, pdata, ret) _ARRAY_QUEUE_P2_POP_BACK_IMPL(q, pdata, _ARRAY_QUEUE_RET, ret)
+
 #endif /* ARRAY_QUEUE_H_ */
@@ -0,0 +1,172 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016 Kuan-Chung Huang
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#ifndef ARRAY_SPSC_H_
+#define ARRAY_SPSC_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+/**
+ * @defgroup array_spsc Array SPSC queue
+ * @ingroup array_utils
+ *
+ * @brief A lock-free queue for one producer thread and one consumer thread.
+ *
+ * The producer only writes asp_back and the consumer only writes asp_front.
+ * Each index lives on its own cache line together with the owner's cached copy
+ * of the other index, so the other side's line is only read when the cached
+ * copy says the queue looks full (or empty). Enqueue and dequeue are wait-free.
+ *
+ * Like #ARRAY_QUEUE_P2_TYPE_8, the capacity is a power of two and the indices
+ * run freely.
+ * @{
+ */
+#ifndef ARRAY_SPSC_CACHE_LINE
+#define ARRAY_SPSC_CACHE_LINE 64
+#endif
+
+/**
+ * @brief Declare a SPSC queue type.
+ * @param name  Name of the queue type.
+ * @param type  Type of the queue items.
+ */
+#define ARRAY_SPSC_TYPE(name, type) \
+typedef struct \
+{ \
+    _Alignas(ARRAY_SPSC_CACHE_LINE) type *asp_item; \
+    uint32_t asp_mask; \
+    _Alignas(ARRAY_SPSC_CACHE_LINE) _Atomic uint32_t asp_back; \
+    uint32_t asp_front_cache; \
+    _Alignas(ARRAY_SPSC_CACHE_LINE) _Atomic uint32_t asp_front; \
+    uint32_t asp_back_cache; \
+} name
+
+#define _ARRAY_SPSC_RET(ret, val) ((ret) = (val))
+#define _ARRAY_SPSC_NO_RET(ret, val)
+
+#define _ARRAY_SPSC_INIT_IMPL(q, buf, siz, ret_func, ret) \
+do { \
+    (q)->asp_item = (buf); \
+    (q)->asp_mask = (uint32_t) (siz) - 1; \
+    atomic_init(&(q)->asp_back, 0); \
+    (q)->asp_front_cache = 0; \
+    atomic_init(&(q)->asp_front, 0); \
+    (q)->asp_back_cache = 0; \
+    ret_func(ret, (siz) != 0 && ((siz) & ((siz) - 1)) == 0 \
+            && (uint64_t) (siz) <= UINT32_C(0x80000000)); \
+} while (0)
+
+/**
+ * @brief Initialize a SPSC queue before it is shared with other threads.
+ * @param q  Pointer to the queue.
+ * @param buf  Pointer to the item buffer.
+ * @param siz  Number of items in \a buf, a power of two no more than 2^31.
+ */
+#define ARRAY_SPSC_INIT(q, buf, siz) _ARRAY_SPSC_INIT_IMPL(q, buf, siz, _ARRAY_SPSC_NO_RET,)
+/**
+ * @brief Initialize a SPSC queue and check its capacity.
+ * @param ret  Set to false if \a siz is not a valid capacity.
+ */
+#define ARRAY_SPSC_INIT_RET(q, buf, siz, ret) _ARRAY_SPSC_INIT_IMPL(q, buf, siz, _ARRAY_SPSC_RET, ret)
+
+/**@brief Capacity of a SPSC queue. */
+#define ARRAY_SPSC_SIZE(q) ((q)->asp_mask + 1)
+
+/**
+ * @brief Number of items in a SPSC queue.
+ *
+ * Only a snapshot when the other side is running concurrently.
+ */
+#define ARRAY_SPSC_LEN(q) \
+    (atomic_load_explicit(&(q)->asp_back, memory_order_acquire) \
+            - atomic_load_explicit(&(q)->asp_front, memory_order_acquire))
+
+#define _ARRAY_SPSC_ENQUEUE_IMPL(q, data, ret_func, ret) \
+do { \
+    uint32_t back_ = atomic_load_explicit(&(q)->asp_back, memory_order_relaxed); \
+    if (back_ - (q)->asp_front_cache > (q)->asp_mask) \
+    { \
+        (q)->asp_front_cache = atomic_load_explicit(&(q)->asp_front, \
+                memory_order_acquire); \
+    } \
+    if (back_ - (q)->asp_front_cache > (q)->asp_mask) \
+    { \
+        ret_func(ret, false); \
+    } \
+    else \
+    { \
+        (q)->asp_item[back_ & (q)->asp_mask] = (data); \
+        atomic_store_explicit(&(q)->asp_back, back_ + 1, memory_order_release); \
+        ret_func(ret, true); \
+    } \
+} while (0)
+
+#define _ARRAY_SPSC_DEQUEUE_IMPL(q, pdata, ret_func, ret) \
+do { \
+    uint32_t front_ = atomic_load_explicit(&(q)->asp_front, memory_order_relaxed); \
+    if (front_ == (q)->asp_back_cache) \
+    { \
+        (q)->asp_back_cache = atomic_load_explicit(&(q)->asp_back, \
+                memory_order_acquire); \
+    } \
+    if (front_ == (q)->asp_back_cache) \
+    { \
+        ret_func(ret, false); \
+    } \
+    else \
+    { \
+        *(pdata) = (q)->asp_item[front_ & (q)->asp_mask]; \
+        atomic_store_explicit(&(q)->asp_front, front_ + 1, memory_order_release); \
+        ret_func(ret, true); \
+    } \
+} while (0)
+
+/**
+ * @brief Enqueue an item. Only the producer thread may call it.
+ *
+ * The item is dropped if the queue is full.
+ */
+#define ARRAY_SPSC_ENQUEUE(q, data) _ARRAY_SPSC_ENQUEUE_IMPL(q, data, _ARRAY_SPSC_NO_RET,)
+/**
+ * @brief Dequeue an item. Only the consumer thread may call it.
+ *
+ * \a pdata is left untouched if the queue is empty.
+ */
+#define ARRAY_SPSC_DEQUEUE(q, pdata) _ARRAY_SPSC_DEQUEUE_IMPL(q, pdata, _ARRAY_SPSC_NO_RET,)
+
+/**
+ * @brief Enqueue an item. Only the producer thread may call it.
+ * @param ret  Set to false if the queue is full.
+ */
+#define ARRAY_SPSC_ENQUEUE_RET(q, data, ret) _ARRAY_SPSC_ENQUEUE_IMPL(q, data, _ARRAY_SPSC_RET, ret)
+/**
+ * @brief Dequeue an item. Only the consumer thread may call it.
+ * @param ret  Set to false if the queue is empty.
+ */
+#define ARRAY_SPSC_DEQUEUE_RET(q, pdata, ret) _ARRAY_SPSC_DEQUEUE_IMPL(q, pdata, _ARRAY_SPSC_RET, ret)
+/** @} */
+
+#endif /* ARRAY_SPSC_H_ */
@@ -0,0 +1,267 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016 Kuan-Chung Huang
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#ifndef ARRAY_STREE_H_
+#define ARRAY_STREE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+/**
+ * @defgroup array_stree Array static search tree
+ * @ingroup array_utils
+ *
+ * @brief A read-only ordered index snapshot of an array map.
+ *
+ * The keys of an array map are laid out as a static B-tree whose nodes hold
+ * #ARRAY_STREE_B keys in one cache line. A node is searched by comparing all
+ * its keys at once (AVX2 when the compiler targets it), and a lookup touches
+ * one node per level instead of one cache line per binary search step.
+ *
+ * Keys are 32-bit signed integers extracted from the values, and they should
+ * be ordered the same as the array map. The snapshot refers to positions in
+ * \c am_item and should be rebuilt after the array map is modified.
+ * @{
+ */
+/**@brief Number of keys in a node. */
+#define ARRAY_STREE_B   16
+
+/**@brief Node of a static search tree, aligned to a cache line. */
+typedef struct
+{
+    int32_t ast_key[ARRAY_STREE_B];
+} __attribute__((aligned(64))) ARRAY_STREE_NODE;
+
+/**@brief Static search tree. */
+typedef struct
+{
+    ARRAY_STREE_NODE *as_node;
+    uint32_t *as_index;
+    uint32_t as_size;
+    uint32_t as_nnode;
+    uint32_t as_len;
+} ARRAY_STREE;
+
+/**
+ * @brief Number of nodes needed for a static search tree.
+ * @param n  Number of values in the array map.
+ */
+#define ARRAY_STREE_NNODE(n) (((n) + ARRAY_STREE_B - 1) / ARRAY_STREE_B)
+
+/**
+ * @brief Initialize a static search tree.
+ * @param t  Pointer to the static search tree.
+ * @param node_buf  Pointer to the buffer of #ARRAY_STREE_NODE. It need not
+ * be 64-byte aligned, e.g. from \c malloc(), though aligned nodes take one
+ * cache line each.
+ * @param index_buf  Pointer to the buffer of \c uint32_t with
+ * #ARRAY_STREE_B times as many entries as \a node_buf.
+ * @param nnode  Number of nodes in \a node_buf.
+ */
+#define ARRAY_STREE_INIT(t, node_buf, index_buf, nnode) \
+do { \
+    (t)->as_node = (node_buf); \
+    (t)->as_index = (index_buf); \
+    (t)->as_size = (nnode); \
+    (t)->as_nnode = 0; \
+    (t)->as_len = 0; \
+} while (0)
+/**@}*/
+
+/* Assign in-order ranks to the slots of the subtree rooted at node k. */
+static inline void array_stree_layout(ARRAY_STREE *t, uint32_t k, uint32_t *rank)
+{
+    if (k >= t->as_nnode)
+    {
+        return;
+    }
+    uint32_t i;
+    for (i = 0; i < ARRAY_STREE_B; ++i)
+    {
+        array_stree_layout(t, k * (ARRAY_STREE_B + 1) + i + 1, rank);
+        t->as_index[k * ARRAY_STREE_B + i] = (*rank)++;
+    }
+    array_stree_layout(t, k * (ARRAY_STREE_B + 1) + ARRAY_STREE_B + 1, rank);
+}
+
+/* Number of keys in the node less than x, or less than or equal to x if
+ * upper is true.
+ */
+static inline uint32_t array_stree_rank_in_node(const ARRAY_STREE_NODE *node,
+        int32_t x, bool upper)
+{
+#ifdef __AVX2__
+    __m256i xv = _mm256_set1_epi32(x);
+    __m256i lo = _mm256_loadu_si256((const __m256i *) &node->ast_key[0]);
+    __m256i hi = _mm256_loadu_si256((const __m256i *) &node->ast_key[8]);
+    __m256i c_lo, c_hi;
+    if (upper)
+    {
+        /* Keys greater than x are counted and subtracted. */
+        c_lo = _mm256_cmpgt_epi32(lo, xv);
+        c_hi = _mm256_cmpgt_epi32(hi, xv);
+    }
+    else
+    {
+        c_lo = _mm256_cmpgt_epi32(xv, lo);
+        c_hi = _mm256_cmpgt_epi32(xv, hi);
+    }
+    uint32_t mask = (uint32_t) _mm256_movemask_epi8(_mm256_packs_epi32(c_lo, c_hi));
+    uint32_t n = __builtin_popcount(mask) / 2;
+    return (upper ? ARRAY_STREE_B - n : n);
+#else
+    uint32_t n = 0;
+    uint32_t i;
+    for (i = 0; i < ARRAY_STREE_B; ++i)
+    {
+        n += (upper ? node->ast_key[i] <= x : node->ast_key[i] < x);
+    }
+    return n;
+#endif
+}
+
+static inline uint32_t array_stree_search(const ARRAY_STREE *t, int32_t x,
+        bool upper)
+{
+    uint32_t res = t->as_len;
+    uint32_t k = 0;
+    while (k < t->as_nnode)
+    {
+        uint32_t i = array_stree_rank_in_node(&t->as_node[k], x, upper);
+        if (i < ARRAY_STREE_B)
+        {
+            res = t->as_index[k * ARRAY_STREE_B + i];
+        }
+        k = k * (ARRAY_STREE_B + 1) + i + 1;
+    }
+    return (res < t->as_len ? res : t->as_len);
+}
+
+/**
+ * @addtogroup array_stree
+ * @{
+ */
+/**
+ * @brief Find the first value whose key is not less than \a x.
+ * @param t  Pointer to the static search tree.
+ * @param x  The key.
+ * @return  Index of the value in \c am_item, or the length of the array map
+ * if all keys are less than \a x.
+ */
+static inline uint32_t array_stree_lower_bound(const ARRAY_STREE *t, int32_t x)
+{
+    return array_stree_search(t, x, false);
+}
+
+/**
+ * @brief Find the first value whose key is greater than \a x.
+ * @param t  Pointer to the static search tree.
+ * @param x  The key.
+ * @return  Index of the value in \c am_item, or the length of the array map
+ * if no key is greater than \a x.
+ */
+static inline uint32_t array_stree_upper_bound(const ARRAY_STREE *t, int32_t x)
+{
+    return array_stree_search(t, x, true);
+}
+
+/**
+ * @brief Find the values whose keys are in [\a lo, \a hi].
+ *
+ * The values are <tt>am_item[*begin]</tt> to <tt>am_item[*end - 1]</tt>.
+ * @param t  Pointer to the static search tree.
+ * @param lo  The smallest key in range.
+ * @param hi  The largest key in range.
+ * @param begin  Returned index of the first value in range.
+ * @param end  Returned index past the last value in range.
+ */
+static inline void array_stree_range(const ARRAY_STREE *t, int32_t lo,
+        int32_t hi, uint32_t *begin, uint32_t *end)
+{
+    *begin = array_stree_lower_bound(t, lo);
+    *end = (lo <= hi ? array_stree_upper_bound(t, hi) : *begin);
+}
+/**@}*/
+
+#define ARRAY_STREE_GENERATE_BUILD_PROTO(name, map_type) \
+bool name##_array_stree_build(ARRAY_STREE *t, map_type *map)
+#define ARRAY_STREE_GENERATE_BUILD(name, map_type, key_of) \
+ARRAY_STREE_GENERATE_BUILD_PROTO(name, map_type) \
+{ \
+    uint32_t nnode = ARRAY_STREE_NNODE(map->am_len); \
+    if (nnode > t->as_size) \
+    { \
+        return false; \
+    } \
+    uint32_t rank = 0; \
+    uint32_t i; \
+    t->as_nnode = nnode; \
+    t->as_len = map->am_len; \
+    array_stree_layout(t, 0, &rank); \
+    for (i = 0; i < nnode * ARRAY_STREE_B; ++i) \
+    { \
+        uint32_t index = t->as_index[i]; \
+        t->as_node[i / ARRAY_STREE_B].ast_key[i % ARRAY_STREE_B] = \
+                (index < map->am_len ? key_of(map->am_item[index]) : INT32_MAX); \
+    } \
+    return true; \
+}
+
+/**
+ * @addtogroup array_stree
+ * @{
+ */
+/**
+ * @brief Build a static search tree from an array map.
+ * @param name  Prefix name used by #ARRAY_STREE_GEN.
+ * @param t  Pointer to the static search tree.
+ * @param map  Pointer to the array map.
+ * @return  \c true if successful; otherwise, \c false if the buffers of \a t
+ * are too small.
+ */
+#define ARRAY_STREE_BUILD(name, t, map) name##_array_stree_build(t, map)
+
+/**
+ * @brief Generate declaration for building a static search tree.
+ * @param name  Prefix name.
+ * @param map_type  Type of the array map.
+ */
+#define ARRAY_STREE_GEN_PROTO(name, map_type) \
+ARRAY_STREE_GENERATE_BUILD_PROTO(name, map_type);
+
+/**
+ * @brief Generate implementation for building a static search tree.
+ * @param name  Prefix name.
+ * @param map_type  Type of the array map.
+ * @param key_of  Key extractor. It takes one parameter, the value, and
+ * returns its key as \c int32_t.
+ */
+#define ARRAY_STREE_GEN(name, map_type, key_of) \
+ARRAY_STREE_GENERATE_BUILD(name, map_type, key_of)
+/**@}*/
+
+#endif /* ARRAY_STREE_H_ */
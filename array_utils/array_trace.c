@@ -0,0 +1,230 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016 Kuan-Chung Huang
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#include "array_trace.h"
+#include <string.h>
+#include <pthread.h>
+
+#define DUMP_BATCH 256
+
+_Thread_local ARRAY_TRACE_RING *array_trace_self;
+
+static pthread_mutex_t registry_lock = PTHREAD_MUTEX_INITIALIZER;
+static ARRAY_TRACE_RING *registry;
+static uint32_t registry_tid;
+
+static const char *const op_names[] =
+{
+    [ARRAY_TRACE_OP_LOST] = "lost",
+    [ARRAY_TRACE_OP_MAP_INSERT] = "map_insert",
+    [ARRAY_TRACE_OP_MAP_REMOVE] = "map_remove",
+    [ARRAY_TRACE_OP_MAP_FIND] = "map_find",
+    [ARRAY_TRACE_OP_MAP_POOL_GET] = "map_pool_get",
+    [ARRAY_TRACE_OP_MAP_POOL_FREE] = "map_pool_free",
+    [ARRAY_TRACE_OP_MAP_POOL_FIND] = "map_pool_find",
+    [ARRAY_TRACE_OP_RB_INSERT] = "rb_insert",
+    [ARRAY_TRACE_OP_RB_REMOVE] = "rb_remove",
+    [ARRAY_TRACE_OP_RB_FIND] = "rb_find",
+};
+
+bool array_trace_register(ARRAY_TRACE_RING *ring, ARRAY_TRACE_EVENT *buf,
+        uint32_t siz)
+{
+    if (siz < 2 || (siz & (siz - 1)) != 0)
+    {
+        return false;
+    }
+    ring->at_item = buf;
+    ring->at_mask = siz - 1;
+    ring->at_front = 0;
+    atomic_init(&ring->at_back, 0);
+    ring->at_lost = 0;
+
+    pthread_mutex_lock(&registry_lock);
+    ring->at_tid = registry_tid++;
+    ring->at_next = registry;
+    registry = ring;
+    pthread_mutex_unlock(&registry_lock);
+
+    array_trace_self = ring;
+    return true;
+}
+
+void array_trace_unregister(ARRAY_TRACE_RING *ring)
+{
+    if (array_trace_self == ring)
+    {
+        array_trace_self = NULL;
+    }
+
+    pthread_mutex_lock(&registry_lock);
+    ARRAY_TRACE_RING **pp;
+    for (pp = &registry; *pp != NULL; pp = &(*pp)->at_next)
+    {
+        if (*pp == ring)
+        {
+            *pp = ring->at_next;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&registry_lock);
+}
+
+/* Oldest event that cannot be overwritten by the write in progress. */
+static inline uint64_t ring_oldest(const ARRAY_TRACE_RING *ring, uint64_t back)
+{
+    return (back > ring->at_mask ? back - ring->at_mask : 0);
+}
+
+/* Copy events [first, last) and return how many of the oldest ones were
+ * overwritten during the copy. They are removed from out. */
+static uint32_t ring_copy(ARRAY_TRACE_RING *ring, uint64_t first,
+        uint64_t last, ARRAY_TRACE_EVENT *out)
+{
+    uint32_t cnt = (uint32_t) (last - first);
+    uint32_t i;
+    for (i = 0; i < cnt; ++i)
+    {
+        const ARRAY_TRACE_EVENT *ev = &ring->at_item[(first + i) & ring->at_mask];
+        out[i].ate_ts = __atomic_load_n(&ev->ate_ts, __ATOMIC_RELAXED);
+        out[i].ate_op = __atomic_load_n(&ev->ate_op, __ATOMIC_RELAXED);
+        out[i].ate_tid = __atomic_load_n(&ev->ate_tid, __ATOMIC_RELAXED);
+        out[i].ate_arg[0] = __atomic_load_n(&ev->ate_arg[0], __ATOMIC_RELAXED);
+        out[i].ate_arg[1] = __atomic_load_n(&ev->ate_arg[1], __ATOMIC_RELAXED);
+    }
+
+    /* Pairs with the fence in array_trace_record: if any slot above was
+     * being overwritten, the new at_back covers it. */
+    atomic_thread_fence(memory_order_acquire);
+    uint64_t oldest = ring_oldest(ring,
+            atomic_load_explicit(&ring->at_back, memory_order_relaxed));
+    if (oldest <= first)
+    {
+        return 0;
+    }
+    uint32_t skip = (oldest - first < cnt ? (uint32_t) (oldest - first) : cnt);
+    memmove(out, out + skip, (cnt - skip) * sizeof(*out));
+    return skip;
+}
+
+uint32_t array_trace_snapshot(ARRAY_TRACE_RING *ring, ARRAY_TRACE_EVENT *out,
+        uint32_t n)
+{
+    uint64_t back = atomic_load_explicit(&ring->at_back, memory_order_acquire);
+    uint64_t first = ring_oldest(ring, back);
+    if (back - first > n)
+    {
+        first = back - n;
+    }
+    return (uint32_t) (back - first) - ring_copy(ring, first, back, out);
+}
+
+uint32_t array_trace_drain(ARRAY_TRACE_RING *ring, ARRAY_TRACE_EVENT *out,
+        uint32_t n)
+{
+    uint64_t back = atomic_load_explicit(&ring->at_back, memory_order_acquire);
+    uint64_t first = ring->at_front;
+    uint64_t oldest = ring_oldest(ring, back);
+    if (first < oldest)
+    {
+        ring->at_lost += oldest - first;
+        first = oldest;
+    }
+    if (back - first > n)
+    {
+        back = first + n;
+    }
+    uint32_t skip = ring_copy(ring, first, back, out);
+    ring->at_lost += skip;
+    ring->at_front = back;
+    return (uint32_t) (back - first) - skip;
+}
+
+static bool dump_ring(ARRAY_TRACE_RING *ring, FILE *fp)
+{
+    ARRAY_TRACE_EVENT buf[DUMP_BATCH];
+    uint32_t total = 0;
+    uint32_t cnt;
+    /* Bound the loop by the ring size, as the owner may keep recording. */
+    do
+    {
+        cnt = array_trace_drain(ring, buf, DUMP_BATCH);
+        if (ring->at_lost != 0)
+        {
+            ARRAY_TRACE_EVENT lost =
+            {
+                .ate_ts = (cnt != 0 ? buf[0].ate_ts : array_trace_now()),
+                .ate_op = ARRAY_TRACE_OP_LOST,
+                .ate_tid = ring->at_tid,
+                .ate_arg = { ring->at_lost, 0 },
+            };
+            if (fwrite(&lost, sizeof(lost), 1, fp) != 1)
+            {
+                return false;
+            }
+            ring->at_lost = 0;
+        }
+        if (fwrite(buf, sizeof(buf[0]), cnt, fp) != cnt)
+        {
+            return false;
+        }
+        total += cnt;
+    } while (cnt == DUMP_BATCH && total <= ring->at_mask);
+    return true;
+}
+
+bool array_trace_dump(FILE *fp)
+{
+    ARRAY_TRACE_FILE_HEADER hdr =
+    {
+        .atf_magic = ARRAY_TRACE_MAGIC,
+        .atf_version = ARRAY_TRACE_VERSION,
+        .atf_clock = ARRAY_TRACE_CLOCK,
+        .atf_event_size = sizeof(ARRAY_TRACE_EVENT),
+        .atf_reserved = 0,
+    };
+    if (fwrite(&hdr, sizeof(hdr), 1, fp) != 1)
+    {
+        return false;
+    }
+
+    bool ok = true;
+    pthread_mutex_lock(&registry_lock);
+    ARRAY_TRACE_RING *ring;
+    for (ring = registry; ring != NULL && ok; ring = ring->at_next)
+    {
+        ok = dump_ring(ring, fp);
+    }
+    pthread_mutex_unlock(&registry_lock);
+    return (ok && fflush(fp) == 0);
+}
+
+const char *array_trace_op_name(uint32_t op)
+{
+    if (op < sizeof(op_names) / sizeof(op_names[0]))
+    {
+        return op_names[op];
+    }
+    return NULL;
+}
@@ -0,0 +1,263 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016 Kuan-Chung Huang
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#ifndef ARRAY_TRACE_H_
+#define ARRAY_TRACE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdatomic.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+/**
+ * @defgroup array_trace Array trace
+ * @ingroup array_utils
+ *
+ * @brief Per-thread event rings to trace hot paths.
+ *
+ * Each thread registers its own ring, a power-of-two array of fixed size
+ * binary events laid out as #ARRAY_QUEUE_P2_TYPE_32 with free-running
+ * indices. Recording an event takes a timestamp and a few plain stores, with
+ * no lock and no atomic read-modify-write. When the ring is full the oldest
+ * event is overwritten.
+ *
+ * Any thread may take a snapshot of a ring or drain it while its owner keeps
+ * recording; events overwritten during the copy are detected and dropped.
+ * #array_trace_dump drains every registered ring to a file, which
+ * \c array_trace_decode prints in time order.
+ * @code
+ * static ARRAY_TRACE_EVENT buf[1024];
+ * static _Thread_local ARRAY_TRACE_RING ring;
+ * array_trace_register(&ring, buf, 1024);
+ * ...
+ * array_trace_emit(ARRAY_TRACE_OP_USER + 1, a, b);
+ * @endcode
+ *
+ * The container generators have trace hooks, #ARRAY_MAP_TRACE and
+ * \c RB_TRACE, which are empty unless \c ARRAY_TRACE_HOOKS is defined before
+ * including this header; then they emit events to the ring of the calling
+ * thread.
+ * @{
+ */
+/**@brief Timestamps are nanoseconds of \c CLOCK_MONOTONIC. */
+#define ARRAY_TRACE_CLOCK_MONOTONIC 0
+/**@brief Timestamps are x86 time stamp counter ticks. */
+#define ARRAY_TRACE_CLOCK_TSC 1
+
+#ifndef ARRAY_TRACE_CLOCK
+#if defined(__x86_64__) || defined(__i386__)
+#define ARRAY_TRACE_CLOCK ARRAY_TRACE_CLOCK_TSC
+#else
+#define ARRAY_TRACE_CLOCK ARRAY_TRACE_CLOCK_MONOTONIC
+#endif
+#endif
+
+/**@brief Operation ids of the built-in hooks. User ids start at
+ * #ARRAY_TRACE_OP_USER. */
+enum
+{
+    ARRAY_TRACE_OP_LOST = 0,
+    ARRAY_TRACE_OP_MAP_INSERT,
+    ARRAY_TRACE_OP_MAP_REMOVE,
+    ARRAY_TRACE_OP_MAP_FIND,
+    ARRAY_TRACE_OP_MAP_POOL_GET,
+    ARRAY_TRACE_OP_MAP_POOL_FREE,
+    ARRAY_TRACE_OP_MAP_POOL_FIND,
+    ARRAY_TRACE_OP_RB_INSERT,
+    ARRAY_TRACE_OP_RB_REMOVE,
+    ARRAY_TRACE_OP_RB_FIND,
+    ARRAY_TRACE_OP_USER = 0x100
+};
+
+/**@brief Trace event. */
+typedef struct
+{
+    uint64_t ate_ts;
+    uint32_t ate_op;
+    uint32_t ate_tid;
+    uint64_t ate_arg[2];
+} ARRAY_TRACE_EVENT;
+
+/**@brief Per-thread trace ring. */
+typedef struct ARRAY_TRACE_RING_
+{
+    ARRAY_TRACE_EVENT *at_item;
+    uint32_t at_mask;
+    uint32_t at_tid;
+    /* Next event to drain, owned by the draining thread. */
+    uint64_t at_front;
+    /* Next event to record, owned by the recording thread. */
+    _Atomic uint64_t at_back;
+    uint64_t at_lost;
+    struct ARRAY_TRACE_RING_ *at_next;
+} ARRAY_TRACE_RING;
+
+/**@brief Header of a file written by #array_trace_dump. */
+typedef struct
+{
+    uint32_t atf_magic;
+    uint16_t atf_version;
+    uint16_t atf_clock;
+    uint32_t atf_event_size;
+    uint32_t atf_reserved;
+} ARRAY_TRACE_FILE_HEADER;
+
+#define ARRAY_TRACE_MAGIC 0x43525441 /* "ATRC" */
+#define ARRAY_TRACE_VERSION 1
+
+/**@brief Ring of the calling thread, or \c NULL. */
+extern _Thread_local ARRAY_TRACE_RING *array_trace_self;
+
+/**
+ * @brief Read the trace clock.
+ * @return  Timestamp in units given by #ARRAY_TRACE_CLOCK.
+ */
+static inline uint64_t array_trace_now(void)
+{
+#if ARRAY_TRACE_CLOCK == ARRAY_TRACE_CLOCK_TSC
+    return __rdtsc();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000u + (uint64_t) ts.tv_nsec;
+#endif
+}
+
+/**
+ * @brief Record an event to a ring. Only the owner thread may record.
+ * @param ring  Pointer to the ring.
+ * @param op  Operation id.
+ * @param arg0  First argument.
+ * @param arg1  Second argument.
+ */
+static inline void array_trace_record(ARRAY_TRACE_RING *ring, uint32_t op,
+        uint64_t arg0, uint64_t arg1)
+{
+    uint64_t back = atomic_load_explicit(&ring->at_back, memory_order_relaxed);
+    ARRAY_TRACE_EVENT *ev = &ring->at_item[back & ring->at_mask];
+    /* A reader that sees any of the stores below also sees at_back == back,
+     * so it knows the slot is being overwritten. */
+    atomic_thread_fence(memory_order_release);
+    __atomic_store_n(&ev->ate_ts, array_trace_now(), __ATOMIC_RELAXED);
+    __atomic_store_n(&ev->ate_op, op, __ATOMIC_RELAXED);
+    __atomic_store_n(&ev->ate_tid, ring->at_tid, __ATOMIC_RELAXED);
+    __atomic_store_n(&ev->ate_arg[0], arg0, __ATOMIC_RELAXED);
+    __atomic_store_n(&ev->ate_arg[1], arg1, __ATOMIC_RELAXED);
+    atomic_store_explicit(&ring->at_back, back + 1, memory_order_release);
+}
+
+/**
+ * @brief Record an event to the ring of the calling thread, if any.
+ * @param op  Operation id.
+ * @param arg0  First argument.
+ * @param arg1  Second argument.
+ */
+static inline void array_trace_emit(uint32_t op, uint64_t arg0, uint64_t arg1)
+{
+    ARRAY_TRACE_RING *ring = array_trace_self;
+    if (ring != NULL)
+    {
+        array_trace_record(ring, op, arg0, arg1);
+    }
+}
+
+/**
+ * @brief Initialize a ring, register it and make it the ring of the calling
+ * thread.
+ *
+ * The ring stays registered, and can be drained, after the thread exits.
+ * @param ring  Pointer to the ring.
+ * @param buf  Event buffer.
+ * @param siz  Number of events in \a buf. It must be a power of two and at
+ * least 2; one slot is kept as guard against the writer.
+ * @return  \c false if \a siz is invalid; otherwise, \c true.
+ */
+bool array_trace_register(ARRAY_TRACE_RING *ring, ARRAY_TRACE_EVENT *buf,
+        uint32_t siz);
+
+/**
+ * @brief Unregister a ring, and detach it from the calling thread if it is
+ * its ring.
+ * @param ring  Pointer to the ring.
+ */
+void array_trace_unregister(ARRAY_TRACE_RING *ring);
+
+/**
+ * @brief Copy the newest events of a ring without consuming them.
+ * @param ring  Pointer to the ring.
+ * @param out  Returned events, oldest first.
+ * @param n  Maximal number of events to copy.
+ * @return  Number of events copied.
+ */
+uint32_t array_trace_snapshot(ARRAY_TRACE_RING *ring, ARRAY_TRACE_EVENT *out,
+        uint32_t n);
+
+/**
+ * @brief Consume the oldest events of a ring not drained yet.
+ *
+ * Events overwritten before being drained are counted in \c at_lost. Only one
+ * thread at a time may drain a ring.
+ * @param ring  Pointer to the ring.
+ * @param out  Returned events, oldest first.
+ * @param n  Maximal number of events to copy.
+ * @return  Number of events copied.
+ */
+uint32_t array_trace_drain(ARRAY_TRACE_RING *ring, ARRAY_TRACE_EVENT *out,
+        uint32_t n);
+
+/**
+ * @brief Drain all registered rings to a file.
+ *
+ * The file starts with #ARRAY_TRACE_FILE_HEADER, followed by the events of
+ * each ring. Events lost since the last drain are reported as an
+ * #ARRAY_TRACE_OP_LOST event carrying the count.
+ * @param fp  Output file opened in binary mode.
+ * @return  \c false on write errors; otherwise, \c true.
+ */
+bool array_trace_dump(FILE *fp);
+
+/**
+ * @brief Name of a built-in operation id.
+ * @param op  Operation id.
+ * @return  Name, or \c NULL if \a op is not built in.
+ */
+const char *array_trace_op_name(uint32_t op);
+
+#ifdef ARRAY_TRACE_HOOKS
+#undef ARRAY_MAP_TRACE
+#define ARRAY_MAP_TRACE(op, map, index) \
+    array_trace_emit(ARRAY_TRACE_OP_MAP_##op, (uint64_t) (uintptr_t) (map), \
+            (uint64_t) (index))
+#undef RB_TRACE
+#define RB_TRACE(op, root, node) \
+    array_trace_emit(ARRAY_TRACE_OP_RB_##op, (uint64_t) (uintptr_t) (root), \
+            (uint64_t) (uintptr_t) (node))
+#endif
+/** @} */
+
+#endif /* ARRAY_TRACE_H_ */
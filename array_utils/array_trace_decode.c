@@ -0,0 +1,141 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016 Kuan-Chung Huang
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+/*
+ * Print a file written by array_trace_dump() as text, one event per line in
+ * time order:
+ *
+ *   array_trace_decode [file]
+ *
+ * It reads the standard input if no file is given.
+ */
+
+#include "array_trace.h"
+#include <stdlib.h>
+#include <inttypes.h>
+
+static int event_cmp(const void *a, const void *b)
+{
+    const ARRAY_TRACE_EVENT *ea = a;
+    const ARRAY_TRACE_EVENT *eb = b;
+    if (ea->ate_ts != eb->ate_ts)
+    {
+        return (ea->ate_ts < eb->ate_ts ? -1 : 1);
+    }
+    if (ea->ate_tid != eb->ate_tid)
+    {
+        return (ea->ate_tid < eb->ate_tid ? -1 : 1);
+    }
+    return 0;
+}
+
+static ARRAY_TRACE_EVENT *read_events(FILE *fp, size_t *n)
+{
+    size_t cap = 1024;
+    size_t len = 0;
+    ARRAY_TRACE_EVENT *ev = malloc(cap * sizeof(*ev));
+    while (ev != NULL)
+    {
+        len += fread(ev + len, sizeof(*ev), cap - len, fp);
+        if (len < cap)
+        {
+            break;
+        }
+        cap *= 2;
+        ARRAY_TRACE_EVENT *grown = realloc(ev, cap * sizeof(*ev));
+        if (grown == NULL)
+        {
+            free(ev);
+        }
+        ev = grown;
+    }
+    *n = len;
+    return ev;
+}
+
+int main(int argc, char *argv[])
+{
+    FILE *fp = stdin;
+    if (argc > 2)
+    {
+        fprintf(stderr, "usage: %s [file]\n", argv[0]);
+        return 2;
+    }
+    if (argc == 2 && (fp = fopen(argv[1], "rb")) == NULL)
+    {
+        perror(argv[1]);
+        return 1;
+    }
+
+    ARRAY_TRACE_FILE_HEADER hdr;
+    if (fread(&hdr, sizeof(hdr), 1, fp) != 1
+            || hdr.atf_magic != ARRAY_TRACE_MAGIC
+            || hdr.atf_version != ARRAY_TRACE_VERSION
+            || hdr.atf_event_size != sizeof(ARRAY_TRACE_EVENT))
+    {
+        fprintf(stderr, "not a trace file of version %d\n", ARRAY_TRACE_VERSION);
+        return 1;
+    }
+
+    size_t n;
+    ARRAY_TRACE_EVENT *ev = read_events(fp, &n);
+    if (ev == NULL)
+    {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    qsort(ev, n, sizeof(*ev), event_cmp);
+
+    const char *unit = (hdr.atf_clock == ARRAY_TRACE_CLOCK_TSC ? "ticks" : "ns");
+    printf("%16s %6s %-16s %18s %18s\n", unit, "thread", "op", "arg0", "arg1");
+    size_t i;
+    for (i = 0; i < n; ++i)
+    {
+        char user[32];
+        const char *name = array_trace_op_name(ev[i].ate_op);
+        if (name == NULL)
+        {
+            if (ev[i].ate_op >= ARRAY_TRACE_OP_USER)
+            {
+                snprintf(user, sizeof(user), "user+%" PRIu32,
+                        ev[i].ate_op - ARRAY_TRACE_OP_USER);
+            }
+            else
+            {
+                snprintf(user, sizeof(user), "op%" PRIu32, ev[i].ate_op);
+            }
+            name = user;
+        }
+        printf("%16" PRIu64 " %6" PRIu32 " %-16s %#18" PRIx64 " %#18" PRIx64 "\n",
+                ev[i].ate_ts - ev[0].ate_ts, ev[i].ate_tid, name,
+                ev[i].ate_arg[0], ev[i].ate_arg[1]);
+    }
+
+    free(ev);
+    if (fp != stdin)
+    {
+        fclose(fp);
+    }
+    return 0;
+}
@@ -0,0 +1,200 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016 Kuan-Chung Huang
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#ifndef ARRAY_WSDEQUE_H_
+#define ARRAY_WSDEQUE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+/**
+ * @defgroup array_wsdeque Array work-stealing deque
+ * @ingroup array_utils
+ *
+ * @brief A fixed-capacity Chase-Lev work-stealing deque.
+ *
+ * The owner thread pushes and pops at the bottom without atomic
+ * read-modify-write operations, except when taking the last item. Other
+ * threads steal from the top with a compare-and-swap. The buffer is supplied
+ * by the caller as for #ARRAY_QUEUE_TYPE_32, its size is a power of two and
+ * push fails when it is full.
+ *
+ * Items are copied with relaxed atomic accesses, so \a type should be a
+ * pointer or an integer.
+ * @{
+ */
+#ifndef ARRAY_WSDEQUE_CACHE_LINE
+#define ARRAY_WSDEQUE_CACHE_LINE 64
+#endif
+
+/**
+ * @brief Define type for a work-stealing deque.
+ * @param name  Type name of the deque.
+ * @param type  Type of items contained in the deque.
+ */
+#define ARRAY_WSDEQUE_TYPE(name, type) \
+typedef struct \
+{ \
+    _Alignas(ARRAY_WSDEQUE_CACHE_LINE) type *awd_item; \
+    int64_t awd_mask; \
+    _Alignas(ARRAY_WSDEQUE_CACHE_LINE) _Atomic int64_t awd_top; \
+    _Alignas(ARRAY_WSDEQUE_CACHE_LINE) _Atomic int64_t awd_bottom; \
+} name
+
+/**
+ * @brief Initialize a work-stealing deque before sharing it.
+ * @param dq  Pointer to the deque.
+ * @param buf  Pointer to the item buffer.
+ * @param siz  Number of items in \a buf, a power of two.
+ */
+#define ARRAY_WSDEQUE_INIT(dq, buf, siz) \
+do { \
+    (dq)->awd_item = (buf); \
+    (dq)->awd_mask = (int64_t) (siz) - 1; \
+    atomic_init(&(dq)->awd_top, 0); \
+    atomic_init(&(dq)->awd_bottom, 0); \
+} while (0)
+
+/**
+ * @brief Number of items. Only a snapshot when other threads are stealing.
+ */
+#define ARRAY_WSDEQUE_LEN(dq) \
+    (atomic_load_explicit(&(dq)->awd_bottom, memory_order_relaxed) \
+            - atomic_load_explicit(&(dq)->awd_top, memory_order_relaxed))
+
+/**
+ * @brief Push an item at the bottom. Only the owner may call it.
+ * @return  \c true if successful; otherwise, \c false if the deque is full.
+ */
+#define ARRAY_WSDEQUE_PUSH(name, dq, item) name##_array_wsdeque_push(dq, item)
+/**
+ * @brief Pop an item from the bottom. Only the owner may call it.
+ * @return  \c true if successful; otherwise, \c false if the deque is empty.
+ */
+#define ARRAY_WSDEQUE_POP(name, dq, pitem) name##_array_wsdeque_pop(dq, pitem)
+/**
+ * @brief Steal an item from the top. Any thread may call it.
+ * @return  \c true if successful; otherwise, \c false if the deque is empty
+ * or another thread took the item first.
+ */
+#define ARRAY_WSDEQUE_STEAL(name, dq, pitem) name##_array_wsdeque_steal(dq, pitem)
+/**@}*/
+
+#define ARRAY_WSDEQUE_GENERATE_PUSH_PROTO(name, dq_type, type) \
+bool name##_array_wsdeque_push(dq_type *dq, type item)
+#define ARRAY_WSDEQUE_GENERATE_PUSH(name, dq_type, type) \
+ARRAY_WSDEQUE_GENERATE_PUSH_PROTO(name, dq_type, type) \
+{ \
+    int64_t b = atomic_load_explicit(&dq->awd_bottom, memory_order_relaxed); \
+    int64_t t = atomic_load_explicit(&dq->awd_top, memory_order_acquire); \
+    if (b - t > dq->awd_mask) \
+    { \
+        return false; \
+    } \
+    __atomic_store(&dq->awd_item[b & dq->awd_mask], &item, __ATOMIC_RELAXED); \
+    atomic_store_explicit(&dq->awd_bottom, b + 1, memory_order_release); \
+    return true; \
+}
+
+#define ARRAY_WSDEQUE_GENERATE_POP_PROTO(name, dq_type, type) \
+bool name##_array_wsdeque_pop(dq_type *dq, type *pitem)
+#define ARRAY_WSDEQUE_GENERATE_POP(name, dq_type, type) \
+ARRAY_WSDEQUE_GENERATE_POP_PROTO(name, dq_type, type) \
+{ \
+    int64_t b = atomic_load_explicit(&dq->awd_bottom, memory_order_relaxed) - 1; \
+    atomic_store_explicit(&dq->awd_bottom, b, memory_order_relaxed); \
+    atomic_thread_fence(memory_order_seq_cst); \
+    int64_t t = atomic_load_explicit(&dq->awd_top, memory_order_relaxed); \
+    bool ret = true; \
+    if (t <= b) \
+    { \
+        __atomic_load(&dq->awd_item[b & dq->awd_mask], pitem, __ATOMIC_RELAXED); \
+        if (t == b) \
+        { \
+            /* The last item: race the stealers for it. */ \
+            ret = atomic_compare_exchange_strong_explicit(&dq->awd_top, &t, \
+                    t + 1, memory_order_seq_cst, memory_order_relaxed); \
+            atomic_store_explicit(&dq->awd_bottom, b + 1, memory_order_relaxed); \
+        } \
+    } \
+    else \
+    { \
+        ret = false; \
+        atomic_store_explicit(&dq->awd_bottom, b + 1, memory_order_relaxed); \
+    } \
+    return ret; \
+}
+
+#define ARRAY_WSDEQUE_GENERATE_STEAL_PROTO(name, dq_type, type) \
+bool name##_array_wsdeque_steal(dq_type *dq, type *pitem)
+#define ARRAY_WSDEQUE_GENERATE_STEAL(name, dq_type, type) \
+ARRAY_WSDEQUE_GENERATE_STEAL_PROTO(name, dq_type, type) \
+{ \
+    int64_t t = atomic_load_explicit(&dq->awd_top, memory_order_acquire); \
+    atomic_thread_fence(memory_order_seq_cst); \
+    int64_t b = atomic_load_explicit(&dq->awd_bottom, memory_order_acquire); \
+    if (t >= b) \
+    { \
+        return false; \
+    } \
+    type item; \
+    __atomic_load(&dq->awd_item[t & dq->awd_mask], &item, __ATOMIC_RELAXED); \
+    if (!atomic_compare_exchange_strong_explicit(&dq->awd_top, &t, t + 1, \
+            memory_order_seq_cst, memory_order_relaxed)) \
+    { \
+        return false; \
+    } \
+    *pitem = item; \
+    return true; \
+}
+
+/**
+ * @addtogroup array_wsdeque
+ * @{
+ */
+/**
+ * @brief Generate declaration for a work-stealing deque.
+ * @param name  Prefix name.
+ * @param dq_type  Type of the deque.
+ * @param type  Type of items contained in the deque.
+ */
+#define ARRAY_WSDEQUE_GEN_PROTO(name, dq_type, type) \
+ARRAY_WSDEQUE_GENERATE_PUSH_PROTO(name, dq_type, type); \
+ARRAY_WSDEQUE_GENERATE_POP_PROTO(name, dq_type, type); \
+ARRAY_WSDEQUE_GENERATE_STEAL_PROTO(name, dq_type, type);
+
+/**
+ * @brief Generate implementation for a work-stealing deque.
+ * @param name  Prefix name.
+ * @param dq_type  Type of the deque.
+ * @param type  Type of items contained in the deque.
+ */
+#define ARRAY_WSDEQUE_GEN(name, dq_type, type) \
+ARRAY_WSDEQUE_GENERATE_PUSH(name, dq_type, type) \
+ARRAY_WSDEQUE_GENERATE_POP(name, dq_type, type) \
+ARRAY_WSDEQUE_GENERATE_STEAL(name, dq_type, type)
+/**@}*/
+
+#endif /* ARRAY_WSDEQUE_H_ */
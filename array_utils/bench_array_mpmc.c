@@ -0,0 +1,150 @@
+/*
+ * Throughput of the MPMC ring against a mutex-guarded ARRAY_QUEUE, with 1 to
+ * N producer/consumer pairs.
+ *
+ * Usage: bench_array_mpmc [max_pairs] [items_per_producer]
+ */
+#include "array_mpmc.h"
+#include "array_queue.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <time.h>
+
+typedef uint32_t A_ITEM;
+ARRAY_MPMC_TYPE(A_ITEM_MPMC, A_ITEM);
+ARRAY_MPMC_GEN_PROTO(item, A_ITEM_MPMC, A_ITEM)
+ARRAY_MPMC_GEN(item, A_ITEM_MPMC, A_ITEM)
+
+ARRAY_QUEUE_TYPE_32(A_ITEM_QUEUE, A_ITEM);
+
+#define ITEM_BUF_NUM 1024
+#define MAX_PAIRS 64
+
+static A_ITEM_MPMC_CELL mpmc_buf[ITEM_BUF_NUM];
+static A_ITEM_MPMC mpmc_queue;
+
+static A_ITEM queue_buf[ITEM_BUF_NUM];
+static A_ITEM_QUEUE locked_queue;
+static pthread_mutex_t queue_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static unsigned n_per_thread;
+
+static void *mpmc_producer(void *arg)
+{
+    unsigned i;
+
+    (void) arg;
+    for (i = 0; i < n_per_thread; ++i)
+    {
+        ARRAY_MPMC_ENQUEUE(item, &mpmc_queue, i);
+    }
+    return NULL;
+}
+
+static void *mpmc_consumer(void *arg)
+{
+    unsigned i;
+    A_ITEM item;
+
+    (void) arg;
+    for (i = 0; i < n_per_thread; ++i)
+    {
+        ARRAY_MPMC_DEQUEUE(item, &mpmc_queue, &item);
+    }
+    return NULL;
+}
+
+static void *locked_producer(void *arg)
+{
+    unsigned i;
+    bool ret;
+
+    (void) arg;
+    for (i = 0; i < n_per_thread; ++i)
+    {
+        do
+        {
+            pthread_mutex_lock(&queue_lock);
+            ARRAY_QUEUE_ENQUEUE_RET(&locked_queue, i, ret);
+            pthread_mutex_unlock(&queue_lock);
+            if (!ret)
+            {
+                ARRAY_MPMC_YIELD();
+            }
+        } while (!ret);
+    }
+    return NULL;
+}
+
+static void *locked_consumer(void *arg)
+{
+    unsigned i;
+    A_ITEM item;
+    bool ret;
+
+    (void) arg;
+    for (i = 0; i < n_per_thread; ++i)
+    {
+        do
+        {
+            pthread_mutex_lock(&queue_lock);
+            ARRAY_QUEUE_DEQUEUE_RET(&locked_queue, &item, ret);
+            pthread_mutex_unlock(&queue_lock);
+            if (!ret)
+            {
+                ARRAY_MPMC_YIELD();
+            }
+        } while (!ret);
+    }
+    return NULL;
+}
+
+static double run(unsigned pairs, void *(*producer)(void *),
+        void *(*consumer)(void *))
+{
+    pthread_t threads[2 * MAX_PAIRS];
+    struct timespec begin, end;
+    unsigned i;
+
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+    for (i = 0; i < pairs; ++i)
+    {
+        pthread_create(&threads[2 * i], NULL, producer, NULL);
+        pthread_create(&threads[2 * i + 1], NULL, consumer, NULL);
+    }
+    for (i = 0; i < 2 * pairs; ++i)
+    {
+        pthread_join(threads[i], NULL);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    double sec = (end.tv_sec - begin.tv_sec) + (end.tv_nsec - begin.tv_nsec) / 1e9;
+    return (double) pairs * n_per_thread / sec / 1e6;
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned max_pairs = argc > 1 ? (unsigned) atoi(argv[1]) : 4;
+    unsigned pairs;
+
+    n_per_thread = argc > 2 ? (unsigned) atoi(argv[2]) : 1000000;
+    if (max_pairs < 1 || max_pairs > MAX_PAIRS)
+    {
+        fprintf(stderr, "max_pairs should be within 1 to %d\n", MAX_PAIRS);
+        return 1;
+    }
+
+    printf("%8s %16s %16s\n", "pairs", "mpmc (Mop/s)", "mutex (Mop/s)");
+    for (pairs = 1; pairs <= max_pairs; ++pairs)
+    {
+        ARRAY_MPMC_INIT(&mpmc_queue, mpmc_buf, ITEM_BUF_NUM);
+        double mpmc = run(pairs, mpmc_producer, mpmc_consumer);
+
+        ARRAY_QUEUE_INIT(&locked_queue, queue_buf, ITEM_BUF_NUM);
+        double locked = run(pairs, locked_producer, locked_consumer);
+
+        printf("%8u %16.2f %16.2f\n", pairs, mpmc, locked);
+    }
+    return 0;
+}
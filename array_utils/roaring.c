@@ -0,0 +1,1026 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016 Kuan-Chung Huang
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#include "roaring.h"
+#include <stdlib.h>
+#include <string.h>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+#define BITMAP_BYTES (ROARING_BITMAP_WORDS * sizeof(uint64_t))
+
+#define OP_AND      0
+#define OP_OR       1
+#define OP_ANDNOT   2
+
+
+/* Words of bitmap containers.
+ */
+
+static inline void words_set_range(uint64_t *words, uint32_t start, uint32_t end)
+{
+    /* Set bits in [start, end]. */
+    uint32_t first = start >> 6;
+    uint32_t last = end >> 6;
+    uint64_t first_mask = ~0ULL << (start & 63);
+    uint64_t last_mask = ~0ULL >> (63 - (end & 63));
+    if (first == last)
+    {
+        words[first] |= (first_mask & last_mask);
+        return;
+    }
+    words[first] |= first_mask;
+    uint32_t i;
+    for (i = first + 1; i < last; ++i)
+    {
+        words[i] = ~0ULL;
+    }
+    words[last] |= last_mask;
+}
+
+static uint32_t words_op(uint64_t *dst, const uint64_t *a, const uint64_t *b,
+        int op)
+{
+    uint32_t i = 0;
+#ifdef __AVX2__
+    for (; i < ROARING_BITMAP_WORDS; i += 4)
+    {
+        __m256i va = _mm256_loadu_si256((const __m256i *) &a[i]);
+        __m256i vb = _mm256_loadu_si256((const __m256i *) &b[i]);
+        __m256i vr;
+        if (op == OP_AND)
+        {
+            vr = _mm256_and_si256(va, vb);
+        }
+        else if (op == OP_OR)
+        {
+            vr = _mm256_or_si256(va, vb);
+        }
+        else
+        {
+            vr = _mm256_andnot_si256(vb, va);
+        }
+        _mm256_storeu_si256((__m256i *) &dst[i], vr);
+    }
+#else
+    if (op == OP_AND)
+    {
+        for (; i < ROARING_BITMAP_WORDS; ++i)
+        {
+            dst[i] = a[i] & b[i];
+        }
+    }
+    else if (op == OP_OR)
+    {
+        for (; i < ROARING_BITMAP_WORDS; ++i)
+        {
+            dst[i] = a[i] | b[i];
+        }
+    }
+    else
+    {
+        for (; i < ROARING_BITMAP_WORDS; ++i)
+        {
+            dst[i] = a[i] & ~b[i];
+        }
+    }
+#endif
+    uint32_t card = 0;
+    for (i = 0; i < ROARING_BITMAP_WORDS; ++i)
+    {
+        card += __builtin_popcountll(dst[i]);
+    }
+    return card;
+}
+
+
+/* Containers.
+ */
+
+static bool container_alloc(ROARING_CONTAINER *c, int type, uint32_t cap)
+{
+    size_t bytes;
+    if (type == ROARING_BITMAP)
+    {
+        bytes = BITMAP_BYTES;
+    }
+    else if (type == ROARING_RUN)
+    {
+        bytes = cap * 2 * sizeof(uint16_t);
+    }
+    else
+    {
+        bytes = cap * sizeof(uint16_t);
+    }
+    void *data = (type == ROARING_BITMAP ? calloc(1, bytes) : malloc(bytes));
+    if (data == NULL)
+    {
+        return false;
+    }
+    c->rc_data = data;
+    c->rc_type = type;
+    c->rc_cap = (type == ROARING_BITMAP ? 0 : cap);
+    c->rc_len = 0;
+    c->rc_card = 0;
+    return true;
+}
+
+static inline void container_replace(ROARING_CONTAINER *c, ROARING_CONTAINER *n)
+{
+    free(c->rc_data);
+    n->rc_key = c->rc_key;
+    *c = *n;
+}
+
+static bool container_array_search(const uint16_t *values, uint32_t len,
+        uint16_t v, uint32_t *index)
+{
+    int low = 0;
+    int high = (int) len - 1;
+    while (low <= high)
+    {
+        int med = (low + high) / 2;
+        if (values[med] < v)
+        {
+            low = med + 1;
+        }
+        else if (values[med] > v)
+        {
+            high = med - 1;
+        }
+        else
+        {
+            *index = med;
+            return true;
+        }
+    }
+    *index = low;
+    return false;
+}
+
+/* Index of the last run starting at or before v, or -1. */
+static int container_run_search(const ROARING_CONTAINER *c, uint16_t v)
+{
+    const uint16_t *run = c->rc_data;
+    int low = 0;
+    int high = (int) c->rc_len - 1;
+    while (low <= high)
+    {
+        int med = (low + high) / 2;
+        if (run[med * 2] <= v)
+        {
+            low = med + 1;
+        }
+        else
+        {
+            high = med - 1;
+        }
+    }
+    return low - 1;
+}
+
+static bool container_contains(const ROARING_CONTAINER *c, uint16_t v)
+{
+    if (c->rc_type == ROARING_BITMAP)
+    {
+        const uint64_t *words = c->rc_data;
+        return (words[v >> 6] >> (v & 63)) & 1;
+    }
+    else if (c->rc_type == ROARING_RUN)
+    {
+        const uint16_t *run = c->rc_data;
+        int i = container_run_search(c, v);
+        return (i >= 0 && v - run[i * 2] <= run[i * 2 + 1]);
+    }
+    else
+    {
+        uint32_t index;
+        return container_array_search(c->rc_data, c->rc_len, v, &index);
+    }
+}
+
+static void container_to_words(const ROARING_CONTAINER *c, uint64_t *words)
+{
+    if (c->rc_type == ROARING_BITMAP)
+    {
+        memcpy(words, c->rc_data, BITMAP_BYTES);
+        return;
+    }
+    memset(words, 0, BITMAP_BYTES);
+    uint32_t i;
+    if (c->rc_type == ROARING_RUN)
+    {
+        const uint16_t *run = c->rc_data;
+        for (i = 0; i < c->rc_len; ++i)
+        {
+            words_set_range(words, run[i * 2], run[i * 2] + run[i * 2 + 1]);
+        }
+    }
+    else
+    {
+        const uint16_t *values = c->rc_data;
+        for (i = 0; i < c->rc_len; ++i)
+        {
+            words[values[i] >> 6] |= (1ULL << (values[i] & 63));
+        }
+    }
+}
+
+/* Make c the smallest of array and bitmap containers holding words. */
+static bool container_from_words(ROARING_CONTAINER *c, const uint64_t *words,
+        uint32_t card)
+{
+    if (card > ROARING_ARRAY_MAX)
+    {
+        if (!container_alloc(c, ROARING_BITMAP, 0))
+        {
+            return false;
+        }
+        memcpy(c->rc_data, words, BITMAP_BYTES);
+    }
+    else
+    {
+        if (!container_alloc(c, ROARING_ARRAY, card))
+        {
+            return false;
+        }
+        uint16_t *values = c->rc_data;
+        uint32_t n = 0;
+        uint32_t i;
+        for (i = 0; i < ROARING_BITMAP_WORDS; ++i)
+        {
+            uint64_t w = words[i];
+            while (w != 0)
+            {
+                values[n++] = (uint16_t) (i * 64 + __builtin_ctzll(w));
+                w &= w - 1;
+            }
+        }
+        c->rc_len = card;
+    }
+    c->rc_card = card;
+    return true;
+}
+
+static bool container_unrun(ROARING_CONTAINER *c)
+{
+    if (c->rc_type != ROARING_RUN)
+    {
+        return true;
+    }
+    ROARING_CONTAINER n;
+    const uint16_t *run = c->rc_data;
+    uint32_t i;
+    if (c->rc_card > ROARING_ARRAY_MAX)
+    {
+        if (!container_alloc(&n, ROARING_BITMAP, 0))
+        {
+            return false;
+        }
+        for (i = 0; i < c->rc_len; ++i)
+        {
+            words_set_range(n.rc_data, run[i * 2], run[i * 2] + run[i * 2 + 1]);
+        }
+    }
+    else
+    {
+        if (!container_alloc(&n, ROARING_ARRAY, c->rc_card))
+        {
+            return false;
+        }
+        uint16_t *values = n.rc_data;
+        for (i = 0; i < c->rc_len; ++i)
+        {
+            uint32_t v = run[i * 2];
+            uint32_t end = v + run[i * 2 + 1];
+            for (; v <= end; ++v)
+            {
+                values[n.rc_len++] = (uint16_t) v;
+            }
+        }
+    }
+    n.rc_card = c->rc_card;
+    container_replace(c, &n);
+    return true;
+}
+
+static bool container_add(ROARING_CONTAINER *c, uint16_t v)
+{
+    if (!container_unrun(c))
+    {
+        return false;
+    }
+    if (c->rc_type == ROARING_BITMAP)
+    {
+        uint64_t *words = c->rc_data;
+        uint64_t bit = (1ULL << (v & 63));
+        if ((words[v >> 6] & bit) == 0)
+        {
+            words[v >> 6] |= bit;
+            ++c->rc_card;
+        }
+        return true;
+    }
+
+    uint32_t index;
+    if (container_array_search(c->rc_data, c->rc_len, v, &index))
+    {
+        return true;
+    }
+    if (c->rc_len == ROARING_ARRAY_MAX)
+    {
+        ROARING_CONTAINER n;
+        if (!container_alloc(&n, ROARING_BITMAP, 0))
+        {
+            return false;
+        }
+        container_to_words(c, n.rc_data);
+        n.rc_card = c->rc_card;
+        container_replace(c, &n);
+        return container_add(c, v);
+    }
+    if (c->rc_len == c->rc_cap)
+    {
+        uint32_t cap = c->rc_cap * 2;
+        if (cap > ROARING_ARRAY_MAX)
+        {
+            cap = ROARING_ARRAY_MAX;
+        }
+        void *data = realloc(c->rc_data, cap * sizeof(uint16_t));
+        if (data == NULL)
+        {
+            return false;
+        }
+        c->rc_data = data;
+        c->rc_cap = cap;
+    }
+    uint16_t *values = c->rc_data;
+    memmove(&values[index + 1], &values[index],
+            (c->rc_len - index) * sizeof(uint16_t));
+    values[index] = v;
+    ++c->rc_len;
+    ++c->rc_card;
+    return true;
+}
+
+static bool container_remove(ROARING_CONTAINER *c, uint16_t v)
+{
+    if (!container_contains(c, v))
+    {
+        return true;
+    }
+    if (!container_unrun(c))
+    {
+        return false;
+    }
+    if (c->rc_type == ROARING_BITMAP)
+    {
+        uint64_t *words = c->rc_data;
+        words[v >> 6] &= ~(1ULL << (v & 63));
+        --c->rc_card;
+        if (c->rc_card <= ROARING_ARRAY_MAX)
+        {
+            /* Keep the bitmap if the array cannot be allocated; it is still
+             * a valid container.
+             */
+            ROARING_CONTAINER n;
+            if (container_from_words(&n, words, c->rc_card))
+            {
+                container_replace(c, &n);
+            }
+        }
+        return true;
+    }
+    uint32_t index;
+    uint16_t *values = c->rc_data;
+    container_array_search(values, c->rc_len, v, &index);
+    memmove(&values[index], &values[index + 1],
+            (c->rc_len - index - 1) * sizeof(uint16_t));
+    --c->rc_len;
+    --c->rc_card;
+    return true;
+}
+
+static uint32_t container_rank(const ROARING_CONTAINER *c, uint16_t v)
+{
+    uint32_t rank = 0;
+    uint32_t i;
+    if (c->rc_type == ROARING_BITMAP)
+    {
+        const uint64_t *words = c->rc_data;
+        for (i = 0; i < (uint32_t) (v >> 6); ++i)
+        {
+            rank += __builtin_popcountll(words[i]);
+        }
+        rank += __builtin_popcountll(words[i] & (~0ULL >> (63 - (v & 63))));
+    }
+    else if (c->rc_type == ROARING_RUN)
+    {
+        const uint16_t *run = c->rc_data;
+        for (i = 0; i < c->rc_len && run[i * 2] <= v; ++i)
+        {
+            uint32_t end = run[i * 2] + run[i * 2 + 1];
+            rank += (end < v ? end : v) - run[i * 2] + 1;
+        }
+    }
+    else
+    {
+        if (container_array_search(c->rc_data, c->rc_len, v, &rank))
+        {
+            ++rank;
+        }
+    }
+    return rank;
+}
+
+static uint16_t container_select(const ROARING_CONTAINER *c, uint32_t k)
+{
+    uint32_t i;
+    if (c->rc_type == ROARING_BITMAP)
+    {
+        const uint64_t *words = c->rc_data;
+        for (i = 0; ; ++i)
+        {
+            uint32_t n = __builtin_popcountll(words[i]);
+            if (k < n)
+            {
+                break;
+            }
+            k -= n;
+        }
+        uint64_t w = words[i];
+        for (; k > 0; --k)
+        {
+            w &= w - 1;
+        }
+        return (uint16_t) (i * 64 + __builtin_ctzll(w));
+    }
+    else if (c->rc_type == ROARING_RUN)
+    {
+        const uint16_t *run = c->rc_data;
+        for (i = 0; k > run[i * 2 + 1]; ++i)
+        {
+            k -= run[i * 2 + 1] + 1;
+        }
+        return (uint16_t) (run[i * 2] + k);
+    }
+    else
+    {
+        return ((const uint16_t *) c->rc_data)[k];
+    }
+}
+
+static uint32_t container_count_runs(const ROARING_CONTAINER *c)
+{
+    uint32_t n = 0;
+    uint32_t i;
+    if (c->rc_type == ROARING_BITMAP)
+    {
+        const uint64_t *words = c->rc_data;
+        uint64_t carry = 0;
+        for (i = 0; i < ROARING_BITMAP_WORDS; ++i)
+        {
+            /* Count bits whose lower neighbor is not set. */
+            n += __builtin_popcountll(words[i] & ~((words[i] << 1) | carry));
+            carry = words[i] >> 63;
+        }
+    }
+    else if (c->rc_type == ROARING_RUN)
+    {
+        n = c->rc_len;
+    }
+    else
+    {
+        const uint16_t *values = c->rc_data;
+        for (i = 0; i < c->rc_len; ++i)
+        {
+            if (i == 0 || values[i] != values[i - 1] + 1)
+            {
+                ++n;
+            }
+        }
+    }
+    return n;
+}
+
+static inline void run_append(ROARING_CONTAINER *c, int32_t *prev, int32_t x)
+{
+    uint16_t *run = c->rc_data;
+    if (x != *prev + 1)
+    {
+        run[c->rc_len * 2] = (uint16_t) x;
+        run[c->rc_len * 2 + 1] = 0;
+        ++c->rc_len;
+    }
+    else
+    {
+        ++run[c->rc_len * 2 - 1];
+    }
+    *prev = x;
+}
+
+static bool container_to_run(ROARING_CONTAINER *c, uint32_t n_run)
+{
+    ROARING_CONTAINER n;
+    if (!container_alloc(&n, ROARING_RUN, n_run))
+    {
+        return false;
+    }
+    int32_t prev = -2;
+    uint32_t i;
+    if (c->rc_type == ROARING_BITMAP)
+    {
+        const uint64_t *words = c->rc_data;
+        for (i = 0; i < ROARING_BITMAP_WORDS; ++i)
+        {
+            uint64_t w = words[i];
+            while (w != 0)
+            {
+                run_append(&n, &prev, i * 64 + __builtin_ctzll(w));
+                w &= w - 1;
+            }
+        }
+    }
+    else
+    {
+        const uint16_t *values = c->rc_data;
+        for (i = 0; i < c->rc_len; ++i)
+        {
+            run_append(&n, &prev, values[i]);
+        }
+    }
+    n.rc_card = c->rc_card;
+    container_replace(c, &n);
+    return true;
+}
+
+/* Compute c = a op b. c->rc_card is 0 if the result is empty, in which case
+ * nothing is allocated.
+ */
+static bool container_op(ROARING_CONTAINER *c, const ROARING_CONTAINER *a,
+        const ROARING_CONTAINER *b, int op, uint64_t *scratch)
+{
+    uint32_t i;
+    c->rc_card = 0;
+    if ((op == OP_AND && (a->rc_type == ROARING_ARRAY || b->rc_type == ROARING_ARRAY))
+            || (op == OP_ANDNOT && a->rc_type == ROARING_ARRAY))
+    {
+        /* Filter the values of an array by membership of the other. */
+        if (op == OP_AND && a->rc_type != ROARING_ARRAY)
+        {
+            const ROARING_CONTAINER *t = a;
+            a = b;
+            b = t;
+        }
+        else if (op == OP_AND && b->rc_type == ROARING_ARRAY && b->rc_len < a->rc_len)
+        {
+            const ROARING_CONTAINER *t = a;
+            a = b;
+            b = t;
+        }
+        const uint16_t *values = a->rc_data;
+        uint32_t n = 0;
+        for (i = 0; i < a->rc_len; ++i)
+        {
+            if (container_contains(b, values[i]) == (op == OP_AND))
+            {
+                ++n;
+            }
+        }
+        if (n == 0)
+        {
+            return true;
+        }
+        if (!container_alloc(c, ROARING_ARRAY, n))
+        {
+            return false;
+        }
+        uint16_t *out = c->rc_data;
+        for (i = 0; i < a->rc_len; ++i)
+        {
+            if (container_contains(b, values[i]) == (op == OP_AND))
+            {
+                out[c->rc_len++] = values[i];
+            }
+        }
+        c->rc_card = n;
+        return true;
+    }
+    if (op == OP_OR && a->rc_type == ROARING_ARRAY && b->rc_type == ROARING_ARRAY
+            && a->rc_len + b->rc_len <= ROARING_ARRAY_MAX)
+    {
+        /* Merge two sorted arrays. */
+        if (!container_alloc(c, ROARING_ARRAY, a->rc_len + b->rc_len))
+        {
+            return false;
+        }
+        const uint16_t *va = a->rc_data;
+        const uint16_t *vb = b->rc_data;
+        uint16_t *out = c->rc_data;
+        uint32_t j = 0;
+        uint32_t n = 0;
+        i = 0;
+        while (i < a->rc_len && j < b->rc_len)
+        {
+            if (va[i] < vb[j])
+            {
+                out[n++] = va[i++];
+            }
+            else if (va[i] > vb[j])
+            {
+                out[n++] = vb[j++];
+            }
+            else
+            {
+                out[n++] = va[i++];
+                ++j;
+            }
+        }
+        while (i < a->rc_len)
+        {
+            out[n++] = va[i++];
+        }
+        while (j < b->rc_len)
+        {
+            out[n++] = vb[j++];
+        }
+        c->rc_len = n;
+        c->rc_card = n;
+        return true;
+    }
+
+    const uint64_t *wa = a->rc_data;
+    const uint64_t *wb = b->rc_data;
+    if (a->rc_type != ROARING_BITMAP)
+    {
+        container_to_words(a, scratch + ROARING_BITMAP_WORDS);
+        wa = scratch + ROARING_BITMAP_WORDS;
+    }
+    if (b->rc_type != ROARING_BITMAP)
+    {
+        container_to_words(b, scratch + ROARING_BITMAP_WORDS * 2);
+        wb = scratch + ROARING_BITMAP_WORDS * 2;
+    }
+    uint32_t card = words_op(scratch, wa, wb, op);
+    if (card == 0)
+    {
+        return true;
+    }
+    return container_from_words(c, scratch, card);
+}
+
+
+/* Roaring bitmap.
+ */
+
+static bool roaring_search(const ROARING *r, uint16_t key, uint32_t *index)
+{
+    int low = 0;
+    int high = (int) r->ro_len - 1;
+    while (low <= high)
+    {
+        int med = (low + high) / 2;
+        uint16_t k = r->ro_container[med].rc_key;
+        if (k < key)
+        {
+            low = med + 1;
+        }
+        else if (k > key)
+        {
+            high = med - 1;
+        }
+        else
+        {
+            *index = med;
+            return true;
+        }
+    }
+    *index = low;
+    return false;
+}
+
+static bool roaring_reserve(ROARING *r, uint32_t len)
+{
+    if (len <= r->ro_size)
+    {
+        return true;
+    }
+    uint32_t size = (r->ro_size == 0 ? 4 : r->ro_size * 2);
+    if (size < len)
+    {
+        size = len;
+    }
+    ROARING_CONTAINER *container = realloc(r->ro_container,
+            size * sizeof(ROARING_CONTAINER));
+    if (container == NULL)
+    {
+        return false;
+    }
+    r->ro_container = container;
+    r->ro_size = size;
+    return true;
+}
+
+static void roaring_remove_container(ROARING *r, uint32_t index)
+{
+    free(r->ro_container[index].rc_data);
+    memmove(&r->ro_container[index], &r->ro_container[index + 1],
+            (r->ro_len - index - 1) * sizeof(ROARING_CONTAINER));
+    --r->ro_len;
+}
+
+void roaring_init(ROARING *r)
+{
+    r->ro_container = NULL;
+    r->ro_size = 0;
+    r->ro_len = 0;
+}
+
+void roaring_free(ROARING *r)
+{
+    uint32_t i;
+    for (i = 0; i < r->ro_len; ++i)
+    {
+        free(r->ro_container[i].rc_data);
+    }
+    free(r->ro_container);
+    roaring_init(r);
+}
+
+bool roaring_add(ROARING *r, uint32_t x)
+{
+    uint16_t key = (uint16_t) (x >> 16);
+    uint32_t index;
+    if (!roaring_search(r, key, &index))
+    {
+        ROARING_CONTAINER c;
+        if (!roaring_reserve(r, r->ro_len + 1)
+                || !container_alloc(&c, ROARING_ARRAY, 4))
+        {
+            return false;
+        }
+        c.rc_key = key;
+        memmove(&r->ro_container[index + 1], &r->ro_container[index],
+                (r->ro_len - index) * sizeof(ROARING_CONTAINER));
+        r->ro_container[index] = c;
+        ++r->ro_len;
+    }
+    return container_add(&r->ro_container[index], (uint16_t) x);
+}
+
+bool roaring_remove(ROARING *r, uint32_t x)
+{
+    uint32_t index;
+    if (!roaring_search(r, (uint16_t) (x >> 16), &index))
+    {
+        return true;
+    }
+    if (!container_remove(&r->ro_container[index], (uint16_t) x))
+    {
+        return false;
+    }
+    if (r->ro_container[index].rc_card == 0)
+    {
+        roaring_remove_container(r, index);
+    }
+    return true;
+}
+
+bool roaring_contains(const ROARING *r, uint32_t x)
+{
+    uint32_t index;
+    return (roaring_search(r, (uint16_t) (x >> 16), &index)
+            && container_contains(&r->ro_container[index], (uint16_t) x));
+}
+
+uint64_t roaring_cardinality(const ROARING *r)
+{
+    uint64_t card = 0;
+    uint32_t i;
+    for (i = 0; i < r->ro_len; ++i)
+    {
+        card += r->ro_container[i].rc_card;
+    }
+    return card;
+}
+
+uint64_t roaring_rank(const ROARING *r, uint32_t x)
+{
+    uint64_t rank = 0;
+    uint32_t index;
+    bool found = roaring_search(r, (uint16_t) (x >> 16), &index);
+    uint32_t i;
+    for (i = 0; i < index; ++i)
+    {
+        rank += r->ro_container[i].rc_card;
+    }
+    if (found)
+    {
+        rank += container_rank(&r->ro_container[index], (uint16_t) x);
+    }
+    return rank;
+}
+
+bool roaring_select(const ROARING *r, uint64_t k, uint32_t *x)
+{
+    uint32_t i;
+    for (i = 0; i < r->ro_len; ++i)
+    {
+        const ROARING_CONTAINER *c = &r->ro_container[i];
+        if (k < c->rc_card)
+        {
+            *x = ((uint32_t) c->rc_key << 16) | container_select(c, (uint32_t) k);
+            return true;
+        }
+        k -= c->rc_card;
+    }
+    return false;
+}
+
+static bool roaring_op(ROARING *dst, const ROARING *a, const ROARING *b, int op)
+{
+    uint64_t *scratch = malloc(BITMAP_BYTES * 3);
+    if (scratch == NULL || !roaring_reserve(dst, a->ro_len + b->ro_len))
+    {
+        free(scratch);
+        return false;
+    }
+    uint32_t i;
+    for (i = 0; i < dst->ro_len; ++i)
+    {
+        free(dst->ro_container[i].rc_data);
+    }
+    dst->ro_len = 0;
+
+    bool ok = true;
+    uint32_t ia = 0;
+    uint32_t ib = 0;
+    while (ok && (ia < a->ro_len || ib < b->ro_len))
+    {
+        const ROARING_CONTAINER *ca = (ia < a->ro_len ? &a->ro_container[ia] : NULL);
+        const ROARING_CONTAINER *cb = (ib < b->ro_len ? &b->ro_container[ib] : NULL);
+        ROARING_CONTAINER *c = &dst->ro_container[dst->ro_len];
+        const ROARING_CONTAINER *copy = NULL;
+        if (cb == NULL || (ca != NULL && ca->rc_key < cb->rc_key))
+        {
+            copy = (op == OP_AND ? NULL : ca);
+            ++ia;
+        }
+        else if (ca == NULL || cb->rc_key < ca->rc_key)
+        {
+            copy = (op == OP_OR ? cb : NULL);
+            ++ib;
+        }
+        else
+        {
+            ok = container_op(c, ca, cb, op, scratch);
+            c->rc_key = ca->rc_key;
+            if (ok && c->rc_card != 0)
+            {
+                ++dst->ro_len;
+            }
+            ++ia;
+            ++ib;
+            continue;
+        }
+        if (copy != NULL)
+        {
+            size_t bytes = (copy->rc_type == ROARING_BITMAP ? BITMAP_BYTES
+                    : copy->rc_cap * sizeof(uint16_t)
+                        * (copy->rc_type == ROARING_RUN ? 2 : 1));
+            *c = *copy;
+            c->rc_data = malloc(bytes);
+            if (c->rc_data == NULL)
+            {
+                ok = false;
+                break;
+            }
+            memcpy(c->rc_data, copy->rc_data, bytes);
+            ++dst->ro_len;
+        }
+    }
+    free(scratch);
+    return ok;
+}
+
+bool roaring_and(ROARING *dst, const ROARING *a, const ROARING *b)
+{
+    return roaring_op(dst, a, b, OP_AND);
+}
+
+bool roaring_or(ROARING *dst, const ROARING *a, const ROARING *b)
+{
+    return roaring_op(dst, a, b, OP_OR);
+}
+
+bool roaring_andnot(ROARING *dst, const ROARING *a, const ROARING *b)
+{
+    return roaring_op(dst, a, b, OP_ANDNOT);
+}
+
+bool roaring_run_optimize(ROARING *r)
+{
+    uint32_t i;
+    for (i = 0; i < r->ro_len; ++i)
+    {
+        ROARING_CONTAINER *c = &r->ro_container[i];
+        if (c->rc_type == ROARING_RUN)
+        {
+            continue;
+        }
+        uint32_t n_run = container_count_runs(c);
+        size_t run_bytes = n_run * 2 * sizeof(uint16_t);
+        size_t bytes = (c->rc_type == ROARING_BITMAP ? BITMAP_BYTES
+                : c->rc_card * sizeof(uint16_t));
+        if (run_bytes < bytes && !container_to_run(c, n_run))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+void roaring_iter_init(ROARING_ITER *it, const ROARING *r)
+{
+    it->ri_roaring = r;
+    it->ri_index = 0;
+    it->ri_pos = 0;
+    it->ri_run = 0;
+}
+
+bool roaring_iter_next(ROARING_ITER *it, uint32_t *x)
+{
+    const ROARING *r = it->ri_roaring;
+    for (; it->ri_index < r->ro_len; ++it->ri_index, it->ri_pos = 0, it->ri_run = 0)
+    {
+        const ROARING_CONTAINER *c = &r->ro_container[it->ri_index];
+        uint32_t high = (uint32_t) c->rc_key << 16;
+        if (c->rc_type == ROARING_BITMAP)
+        {
+            const uint64_t *words = c->rc_data;
+            uint32_t i = it->ri_pos >> 6;
+            if (i >= ROARING_BITMAP_WORDS)
+            {
+                continue;
+            }
+            uint64_t w = words[i] & (~0ULL << (it->ri_pos & 63));
+            while (w == 0 && ++i < ROARING_BITMAP_WORDS)
+            {
+                w = words[i];
+            }
+            if (w != 0)
+            {
+                uint32_t v = i * 64 + __builtin_ctzll(w);
+                it->ri_pos = v + 1;
+                *x = high | v;
+                return true;
+            }
+        }
+        else if (c->rc_type == ROARING_RUN)
+        {
+            const uint16_t *run = c->rc_data;
+            for (; it->ri_run < c->rc_len; ++it->ri_run)
+            {
+                uint32_t start = run[it->ri_run * 2];
+                uint32_t end = start + run[it->ri_run * 2 + 1];
+                if (it->ri_pos < start)
+                {
+                    it->ri_pos = start;
+                }
+                if (it->ri_pos <= end)
+                {
+                    *x = high | it->ri_pos++;
+                    return true;
+                }
+            }
+        }
+        else if (it->ri_pos < c->rc_len)
+        {
+            *x = high | ((const uint16_t *) c->rc_data)[it->ri_pos++];
+            return true;
+        }
+    }
+    return false;
+}
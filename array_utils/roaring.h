@@ -0,0 +1,211 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016 Kuan-Chung Huang
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#ifndef ROARING_H_
+#define ROARING_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * @defgroup roaring Roaring bitmap
+ * @ingroup array_utils
+ *
+ * @brief A compressed set of 32-bit integers.
+ *
+ * Values are partitioned by their high 16 bits into containers. A container
+ * stores the low 16 bits either as a sorted array (at most
+ * #ROARING_ARRAY_MAX values), as a 65536-bit bitmap, or as runs of
+ * consecutive values. Sparse sets stay as small as a sorted array while dense
+ * sets cost at most 8 KiB per 65536 values, and set operations between
+ * bitmap containers work on whole words.
+ *
+ * Unlike the other array utilities, containers are allocated by \c malloc.
+ * Functions that may allocate return \c false if allocation fails.
+ * @{
+ */
+#define ROARING_ARRAY   0
+#define ROARING_BITMAP  1
+#define ROARING_RUN     2
+
+/**@brief Maximal number of values in an array container. */
+#define ROARING_ARRAY_MAX   4096
+
+/**@brief Number of 64-bit words in a bitmap container. */
+#define ROARING_BITMAP_WORDS    1024
+
+/**@brief Container holding values sharing the same high 16 bits. */
+typedef struct ROARING_CONTAINER_
+{
+    void *rc_data;
+    uint32_t rc_card;
+    uint16_t rc_len;
+    uint16_t rc_cap;
+    uint16_t rc_key;
+    uint8_t rc_type;
+} ROARING_CONTAINER;
+
+/**@brief Roaring bitmap. */
+typedef struct ROARING_
+{
+    ROARING_CONTAINER *ro_container;
+    uint32_t ro_size;
+    uint32_t ro_len;
+} ROARING;
+
+/**@brief Iterator over values of a roaring bitmap in ascending order. */
+typedef struct ROARING_ITER_
+{
+    const ROARING *ri_roaring;
+    uint32_t ri_index;
+    uint32_t ri_pos;
+    uint32_t ri_run;
+} ROARING_ITER;
+
+/**
+ * @brief Initializer for a roaring bitmap.
+ * @param r Pointer to the roaring bitmap.
+ */
+#define ROARING_INITIALIZER(r) { NULL, 0, 0 }
+
+/**
+ * @brief Initialize an empty roaring bitmap.
+ * @param r Pointer to the roaring bitmap.
+ */
+void roaring_init(ROARING *r);
+
+/**
+ * @brief Free all memory of a roaring bitmap and make it empty.
+ * @param r Pointer to the roaring bitmap.
+ */
+void roaring_free(ROARING *r);
+
+/**
+ * @brief Add a value.
+ * @param r Pointer to the roaring bitmap.
+ * @param x The value.
+ * @return \c false if allocation fails; otherwise, \c true.
+ */
+bool roaring_add(ROARING *r, uint32_t x);
+
+/**
+ * @brief Remove a value.
+ * @param r Pointer to the roaring bitmap.
+ * @param x The value.
+ * @return \c false if allocation fails; otherwise, \c true.
+ */
+bool roaring_remove(ROARING *r, uint32_t x);
+
+/**
+ * @brief Test if a value is in the roaring bitmap.
+ * @param r Pointer to the roaring bitmap.
+ * @param x The value.
+ * @return \c true if found; otherwise, \c false.
+ */
+bool roaring_contains(const ROARING *r, uint32_t x);
+
+/**
+ * @brief Get the number of values.
+ * @param r Pointer to the roaring bitmap.
+ * @return The number of values.
+ */
+uint64_t roaring_cardinality(const ROARING *r);
+
+/**
+ * @brief Get the number of values less than or equal to \a x.
+ * @param r Pointer to the roaring bitmap.
+ * @param x The value.
+ * @return The number of values less than or equal to \a x.
+ */
+uint64_t roaring_rank(const ROARING *r, uint32_t x);
+
+/**
+ * @brief Get the k-th smallest value.
+ * @param r Pointer to the roaring bitmap.
+ * @param k Zero-based rank.
+ * @param x Returned value.
+ * @return \c true if found; otherwise, \c false if \a k is not less than the
+ * cardinality.
+ */
+bool roaring_select(const ROARING *r, uint64_t k, uint32_t *x);
+
+/**
+ * @brief Intersection of two roaring bitmaps.
+ * @param dst Pointer to the initialized result. Its values are replaced. It
+ * should not be the same as \a a or \a b.
+ * @param a Pointer to the first operand.
+ * @param b Pointer to the second operand.
+ * @return \c false if allocation fails; otherwise, \c true.
+ */
+bool roaring_and(ROARING *dst, const ROARING *a, const ROARING *b);
+
+/**
+ * @brief Union of two roaring bitmaps.
+ * @param dst Pointer to the initialized result. Its values are replaced. It
+ * should not be the same as \a a or \a b.
+ * @param a Pointer to the first operand.
+ * @param b Pointer to the second operand.
+ * @return \c false if allocation fails; otherwise, \c true.
+ */
+bool roaring_or(ROARING *dst, const ROARING *a, const ROARING *b);
+
+/**
+ * @brief Difference of two roaring bitmaps.
+ * @param dst Pointer to the initialized result. Its values are replaced. It
+ * should not be the same as \a a or \a b.
+ * @param a Pointer to the first operand.
+ * @param b Pointer to the second operand, whose values are removed from \a a.
+ * @return \c false if allocation fails; otherwise, \c true.
+ */
+bool roaring_andnot(ROARING *dst, const ROARING *a, const ROARING *b);
+
+/**
+ * @brief Convert containers to run containers where they are smaller.
+ *
+ * Adding or removing values later converts the affected run container back.
+ * @param r Pointer to the roaring bitmap.
+ * @return \c false if allocation fails; otherwise, \c true.
+ */
+bool roaring_run_optimize(ROARING *r);
+
+/**
+ * @brief Initialize an iterator.
+ *
+ * The roaring bitmap should not be modified while iterating.
+ * @param it Pointer to the iterator.
+ * @param r Pointer to the roaring bitmap.
+ */
+void roaring_iter_init(ROARING_ITER *it, const ROARING *r);
+
+/**
+ * @brief Get the next value.
+ * @param it Pointer to the iterator.
+ * @param x Returned value.
+ * @return \c true if a value is returned; otherwise, \c false if there are
+ * no more values.
+ */
+bool roaring_iter_next(ROARING_ITER *it, uint32_t *x);
+/**@}*/
+
+#endif /* ROARING_H_ */
@@ -0,0 +1,227 @@
+#include "array_bloom.h"
+#include "array_map.h"
+#include "rbtree.h"
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define __UNUSED __attribute__((unused))
+
+#define ARRAY_SIZE(arr) (sizeof(arr) / sizeof((arr)[0]))
+
+
+typedef struct A_ITEM_
+{
+    int key;
+    int val;
+} A_ITEM;
+
+ARRAY_MAP_TYPE(A_ITEM_MAP, A_ITEM);
+
+#define A_ITEM_MAP_KEY_CMP(item, key) ((item).key - (key))
+ARRAY_MAP_GEN(item_map, A_ITEM_MAP, int, A_ITEM, A_ITEM_MAP_KEY_CMP)
+
+#define A_ITEM_HASH(item) array_bloom_hash64((item).key)
+ARRAY_BLOOM_GEN(item_map, A_ITEM_MAP, int, A_ITEM, A_ITEM_HASH)
+
+typedef struct A_NODE_
+{
+    int key;
+    RB_NODE node;
+} A_NODE;
+
+#define A_NODE_KEY_CMP(key, n) ((key) - (n)->key)
+#define A_NODE_CMP(a, b) ((a)->key - (b)->key)
+RB_GEN(node_map, int, A_NODE, node, A_NODE_KEY_CMP, A_NODE_CMP)
+
+#define A_NODE_HASH(n) array_bloom_hash64((n)->key)
+ARRAY_BLOOM_GEN_RB(node_map, int, A_NODE, node, A_NODE_HASH)
+
+#define ITEM_BUF_NUM 1000
+#define BITS_PER_KEY 10
+
+static void test_array_bloom(void **state __UNUSED)
+{
+    static ARRAY_BLOOM_BLOCK block[ARRAY_BLOOM_NBLOCK(ITEM_BUF_NUM, BITS_PER_KEY)];
+    ARRAY_BLOOM bf;
+    ARRAY_BLOOM_INIT(&bf, block, ARRAY_SIZE(block), BITS_PER_KEY);
+    int i;
+
+    /* Test case: Empty filter rejects everything */
+    for (i = 0; i < ITEM_BUF_NUM; ++i)
+    {
+        assert_false(array_bloom_may_contain(&bf, array_bloom_hash64(i)));
+    }
+
+    /* Test case: No false negatives */
+    for (i = 0; i < ITEM_BUF_NUM; ++i)
+    {
+        array_bloom_add(&bf, array_bloom_hash64(i * 2));
+    }
+    for (i = 0; i < ITEM_BUF_NUM; ++i)
+    {
+        assert_true(array_bloom_may_contain(&bf, array_bloom_hash64(i * 2)));
+    }
+
+    /* Test case: False positive rate is about 1% at 10 bits per key */
+    {
+        int n_fp = 0;
+        const int N = ITEM_BUF_NUM * 10;
+        for (i = 0; i < N; ++i)
+        {
+            if (array_bloom_may_contain(&bf, array_bloom_hash64(i * 2 + 1)))
+            {
+                ++n_fp;
+            }
+        }
+        assert_in_range(n_fp, 0, N / 33);
+    }
+
+    /* Test case: Clear */
+    ARRAY_BLOOM_CLEAR(&bf);
+    assert_false(array_bloom_may_contain(&bf, array_bloom_hash64(0)));
+}
+
+static void test_array_bloom_string(void **state __UNUSED)
+{
+    static const char *str[] = { "apple", "banana", "cherry" };
+    ARRAY_BLOOM_BLOCK block[1];
+    ARRAY_BLOOM bf;
+    unsigned int i;
+    ARRAY_BLOOM_INIT(&bf, block, ARRAY_SIZE(block), BITS_PER_KEY);
+    for (i = 0; i < ARRAY_SIZE(str); ++i)
+    {
+        array_bloom_add(&bf, array_bloom_hash_str(str[i]));
+    }
+    for (i = 0; i < ARRAY_SIZE(str); ++i)
+    {
+        assert_true(array_bloom_may_contain(&bf, array_bloom_hash_str(str[i])));
+    }
+    assert_false(array_bloom_may_contain(&bf, array_bloom_hash_str("durian")));
+}
+
+static void test_array_bloom_rebuild(void **state __UNUSED)
+{
+    static A_ITEM item_buf[ITEM_BUF_NUM];
+    static ARRAY_BLOOM_BLOCK block[ARRAY_BLOOM_NBLOCK(ITEM_BUF_NUM, BITS_PER_KEY)];
+    A_ITEM_MAP map;
+    ARRAY_BLOOM bf;
+    int i;
+    ARRAY_MAP_INIT(&map, item_buf, ITEM_BUF_NUM);
+    ARRAY_BLOOM_INIT(&bf, block, ARRAY_SIZE(block), BITS_PER_KEY);
+
+    for (i = 0; i < ITEM_BUF_NUM; ++i)
+    {
+        A_ITEM item = { i, i };
+        assert_true(ARRAY_BLOOM_INSERT(item_map, &bf, &map, item.key, item));
+        assert_true(array_bloom_may_contain(&bf, A_ITEM_HASH(item)));
+    }
+
+    /* Test case: Failed insertion and removal leave the filter alone */
+    {
+        A_ITEM item = { 0, 0 };
+        assert_false(ARRAY_BLOOM_INSERT(item_map, &bf, &map, item.key, item));
+        assert_false(ARRAY_BLOOM_REMOVE(item_map, &bf, &map, ITEM_BUF_NUM));
+        assert_int_equal(bf.ab_len, ITEM_BUF_NUM);
+        assert_int_equal(bf.ab_stale, 0);
+    }
+
+    /* Test case: Removal marks the filter stale */
+    for (i = 0; i < ITEM_BUF_NUM / 2; ++i)
+    {
+        assert_true(ARRAY_BLOOM_REMOVE(item_map, &bf, &map, i));
+    }
+    assert_false(ARRAY_BLOOM_NEED_REBUILD(&bf));
+    assert_true(ARRAY_BLOOM_REMOVE(item_map, &bf, &map, ITEM_BUF_NUM / 2));
+    assert_true(ARRAY_BLOOM_NEED_REBUILD(&bf));
+
+    /* Test case: Rebuild keeps the remaining keys only */
+    ARRAY_BLOOM_REBUILD(item_map, &bf, &map);
+    assert_false(ARRAY_BLOOM_NEED_REBUILD(&bf));
+    assert_int_equal(bf.ab_len, map.am_len);
+    for (i = ITEM_BUF_NUM / 2 + 1; i < ITEM_BUF_NUM; ++i)
+    {
+        assert_true(array_bloom_may_contain(&bf, array_bloom_hash64(i)));
+    }
+    {
+        int n_fp = 0;
+        for (i = 0; i <= ITEM_BUF_NUM / 2; ++i)
+        {
+            if (array_bloom_may_contain(&bf, array_bloom_hash64(i)))
+            {
+                ++n_fp;
+            }
+        }
+        assert_in_range(n_fp, 0, ITEM_BUF_NUM / 2 / 10);
+    }
+}
+
+static void test_array_bloom_rbtree(void **state __UNUSED)
+{
+    static A_NODE node_buf[ITEM_BUF_NUM];
+    static ARRAY_BLOOM_BLOCK block[ARRAY_BLOOM_NBLOCK(ITEM_BUF_NUM, BITS_PER_KEY)];
+    RB_ROOT root = RB_ROOT_INITIALIZER(&root);
+    ARRAY_BLOOM bf;
+    int i;
+    ARRAY_BLOOM_INIT(&bf, block, ARRAY_SIZE(block), BITS_PER_KEY);
+
+    for (i = 0; i < ITEM_BUF_NUM; ++i)
+    {
+        node_buf[i].key = i;
+        assert_ptr_equal(ARRAY_BLOOM_RB_INSERT(node_map, &bf, &root,
+                &node_buf[i]), &node_buf[i]);
+        assert_true(array_bloom_may_contain(&bf, array_bloom_hash64(i)));
+    }
+
+    /* Test case: Failed insertion and removal leave the filter alone */
+    {
+        A_NODE dup = { 0 };
+        assert_ptr_equal(ARRAY_BLOOM_RB_INSERT(node_map, &bf, &root, &dup),
+                &node_buf[0]);
+        assert_null(ARRAY_BLOOM_RB_REMOVE(node_map, &bf, &root, ITEM_BUF_NUM));
+        assert_int_equal(bf.ab_len, ITEM_BUF_NUM);
+        assert_int_equal(bf.ab_stale, 0);
+    }
+
+    /* Test case: Removal marks the filter stale */
+    for (i = 0; i <= ITEM_BUF_NUM / 2; ++i)
+    {
+        assert_ptr_equal(ARRAY_BLOOM_RB_REMOVE(node_map, &bf, &root, i),
+                &node_buf[i]);
+    }
+    assert_true(ARRAY_BLOOM_NEED_REBUILD(&bf));
+
+    /* Test case: Rebuild keeps the remaining keys only */
+    ARRAY_BLOOM_RB_REBUILD(node_map, &bf, &root);
+    assert_false(ARRAY_BLOOM_NEED_REBUILD(&bf));
+    assert_int_equal(bf.ab_len, ITEM_BUF_NUM - ITEM_BUF_NUM / 2 - 1);
+    for (i = ITEM_BUF_NUM / 2 + 1; i < ITEM_BUF_NUM; ++i)
+    {
+        assert_true(array_bloom_may_contain(&bf, array_bloom_hash64(i)));
+    }
+    {
+        int n_fp = 0;
+        for (i = 0; i <= ITEM_BUF_NUM / 2; ++i)
+        {
+            if (array_bloom_may_contain(&bf, array_bloom_hash64(i)))
+            {
+                ++n_fp;
+            }
+        }
+        assert_in_range(n_fp, 0, ITEM_BUF_NUM / 2 / 10);
+    }
+}
+
+int main(void)
+{
+    const struct CMUnitTest tests[] = {
+            cmocka_unit_test(test_array_bloom),
+            cmocka_unit_test(test_array_bloom_string),
+            cmocka_unit_test(test_array_bloom_rebuild),
+            cmocka_unit_test(test_array_bloom_rbtree),
+    };
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,128 @@
+#include "array_codel.h"
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define __UNUSED __attribute__((unused))
+
+#define ITEM_BUF_NUM 512
+#define TARGET 5
+#define INTERVAL 100
+
+typedef uint32_t A_ITEM;
+ARRAY_QUEUE_CODEL_TYPE_32(A_ITEM_CODEL_QUEUE, A_ITEM);
+
+A_ITEM item_buf[ITEM_BUF_NUM];
+uint64_t ts_buf[ITEM_BUF_NUM];
+A_ITEM_CODEL_QUEUE queue;
+
+static void test_array_codel_pass(__UNUSED void **state)
+{
+    ARRAY_QUEUE_CODEL_INIT(&queue, item_buf, ts_buf, ITEM_BUF_NUM, TARGET, INTERVAL);
+
+    A_ITEM item;
+    ARRAY_CODEL_VERDICT verdict;
+    ARRAY_QUEUE_CODEL_DEQUEUE(&queue, &item, 0, verdict);
+    assert_int_equal(verdict, ARRAY_CODEL_EMPTY);
+    assert_int_equal(array_codel_percentile(&queue.aq_codel, 500), 0);
+
+    /* Test case: Sojourn times 0 to 99 stay long above target, but each item
+     * empties the queue, so there is no standing queue to control */
+    uint64_t t;
+    for (t = 0; t < 100; ++t)
+    {
+        bool ret;
+        ARRAY_QUEUE_CODEL_ENQUEUE_RET(&queue, (A_ITEM) t, 1000 * t, ret);
+        assert_true(ret);
+        ARRAY_QUEUE_CODEL_DEQUEUE(&queue, &item, 1000 * t + t, verdict);
+        assert_int_equal(verdict, ARRAY_CODEL_PASS);
+        assert_int_equal(item, t);
+    }
+    assert_int_equal(queue.aq_codel.acd_npass, 100);
+    assert_int_equal(queue.aq_codel.acd_ndrop, 0);
+
+    /* Test case: Percentiles are upper bounds of log2 buckets */
+    assert_int_equal(array_codel_percentile(&queue.aq_codel, 100), 15);
+    assert_int_equal(array_codel_percentile(&queue.aq_codel, 500), 63);
+    assert_int_equal(array_codel_percentile(&queue.aq_codel, 1000), 127);
+    assert_int_equal(array_codel_percentile(&queue.aq_codel, 0), 0);
+
+    array_codel_reset_stats(&queue.aq_codel);
+    assert_int_equal(array_codel_percentile(&queue.aq_codel, 999), 0);
+    assert_int_equal(queue.aq_codel.acd_npass, 0);
+}
+
+static void test_array_codel_standing_queue(__UNUSED void **state)
+{
+    ARRAY_QUEUE_CODEL_INIT(&queue, item_buf, ts_buf, ITEM_BUF_NUM, TARGET, INTERVAL);
+
+    /* Test case: A burst leaves a standing queue of 200 items served at the
+     * arrival rate, one per tick */
+    A_ITEM seq = 0;
+    int i;
+    for (i = 0; i < 200; ++i)
+    {
+        ARRAY_QUEUE_CODEL_ENQUEUE(&queue, seq++, 0);
+    }
+
+    A_ITEM item;
+    A_ITEM prev = 0;
+    ARRAY_CODEL_VERDICT verdict;
+    uint64_t last_drop = 0;
+    uint64_t t;
+    for (t = 1; t <= 10000; ++t)
+    {
+        ARRAY_QUEUE_CODEL_ENQUEUE(&queue, seq++, t);
+        do
+        {
+            ARRAY_QUEUE_CODEL_DEQUEUE(&queue, &item, t, verdict);
+            assert_int_not_equal(verdict, ARRAY_CODEL_EMPTY);
+            assert_true(item >= prev);
+            prev = item;
+            if (verdict == ARRAY_CODEL_DROP)
+            {
+                last_drop = t;
+            }
+        } while (verdict == ARRAY_CODEL_DROP);
+    }
+
+    /* Test case: Drops shrink the queue below target within seconds, then
+     * stop */
+    uint64_t ndrop = queue.aq_codel.acd_ndrop;
+    assert_in_range(ndrop, 190, 200);
+    assert_in_range(queue.aq_len, 1, TARGET);
+    assert_in_range(last_drop, INTERVAL, 5000);
+    assert_false(queue.aq_codel.acd_dropping);
+    assert_int_equal(queue.aq_codel.acd_npass + ndrop, seq - queue.aq_len);
+    assert_true(array_codel_percentile(&queue.aq_codel, 500) < 2 * TARGET);
+    assert_true(array_codel_percentile(&queue.aq_codel, 1000) >= 200);
+
+    /* Test case: A second burst soon after resumes near the last drop rate */
+    for (i = 0; i < 200; ++i)
+    {
+        ARRAY_QUEUE_CODEL_ENQUEUE(&queue, seq++, t);
+    }
+    uint64_t start = t;
+    while (queue.aq_codel.acd_ndrop < ndrop + 20)
+    {
+        ++t;
+        ARRAY_QUEUE_CODEL_ENQUEUE(&queue, seq++, t);
+        do
+        {
+            ARRAY_QUEUE_CODEL_DEQUEUE(&queue, &item, t, verdict);
+        } while (verdict == ARRAY_CODEL_DROP);
+    }
+    assert_true(t - start < last_drop);
+}
+
+int main(void)
+{
+    const struct CMUnitTest tests[] = {
+            cmocka_unit_test(test_array_codel_pass),
+            cmocka_unit_test(test_array_codel_standing_queue),
+    };
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,201 @@
+#include "array_event.h"
+#include "array_spsc.h"
+#include "array_mpmc.h"
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+
+#define __UNUSED __attribute__((unused))
+
+typedef uint32_t A_ITEM;
+ARRAY_SPSC_TYPE(A_ITEM_SPSC, A_ITEM);
+ARRAY_MPMC_TYPE(A_ITEM_MPMC, A_ITEM);
+ARRAY_MPMC_GEN_PROTO(item, A_ITEM_MPMC, A_ITEM)
+ARRAY_MPMC_GEN(item, A_ITEM_MPMC, A_ITEM)
+
+#define ITEM_BUF_NUM 8
+#define N_TRANSFER 100000
+#define N_CONSUMER 4
+
+A_ITEM spsc_buf[ITEM_BUF_NUM];
+A_ITEM_SPSC spsc_queue;
+A_ITEM_MPMC_CELL mpmc_buf[ITEM_BUF_NUM];
+A_ITEM_MPMC mpmc_queue;
+ARRAY_EVENT not_empty, not_full;
+
+static bool spsc_try_enqueue(A_ITEM item)
+{
+    bool ret;
+    ARRAY_SPSC_ENQUEUE_RET(&spsc_queue, item, ret);
+    return ret;
+}
+
+static bool spsc_try_dequeue(A_ITEM *item)
+{
+    bool ret;
+    ARRAY_SPSC_DEQUEUE_RET(&spsc_queue, item, ret);
+    return ret;
+}
+
+static void test_array_event_no_waiter(void **state __UNUSED)
+{
+    ARRAY_EVENT_INIT(&not_empty);
+
+    /* Test case: Notifying without waiters does not touch the sequence */
+    array_event_notify(&not_empty, 1);
+    array_event_notify(&not_empty, ARRAY_EVENT_ALL);
+    assert_int_equal(atomic_load(&not_empty.aev_seq), 0);
+
+    /* Test case: A cancelled wait unregisters */
+    uint32_t key = array_event_prepare_wait(&not_empty);
+    assert_int_equal(key, 0);
+    assert_int_equal(atomic_load(&not_empty.aev_waiters), 1);
+    array_event_cancel_wait(&not_empty);
+    assert_int_equal(atomic_load(&not_empty.aev_waiters), 0);
+
+    /* Test case: Waiting on a stale key returns at once */
+    key = array_event_prepare_wait(&not_empty);
+    array_event_notify(&not_empty, 1);
+    assert_int_equal(atomic_load(&not_empty.aev_seq), 1);
+    assert_true(array_event_wait(&not_empty, key, NULL));
+    assert_int_equal(atomic_load(&not_empty.aev_waiters), 0);
+}
+
+static void test_array_event_timeout(void **state __UNUSED)
+{
+    struct timespec deadline, now;
+    A_ITEM item;
+    bool ret;
+
+    ARRAY_EVENT_INIT(&not_empty);
+    ARRAY_SPSC_INIT(&spsc_queue, spsc_buf, ITEM_BUF_NUM);
+
+    /* Test case: Timed wait on an empty queue gives up at the deadline */
+    array_event_deadline(&deadline, 20000000);
+    ARRAY_EVENT_WAIT_FOR(&not_empty, spsc_try_dequeue(&item), &deadline, ret);
+    assert_false(ret);
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    assert_true(now.tv_sec > deadline.tv_sec
+            || (now.tv_sec == deadline.tv_sec && now.tv_nsec >= deadline.tv_nsec));
+    assert_int_equal(atomic_load(&not_empty.aev_waiters), 0);
+
+    /* Test case: Timed wait succeeds at once when the condition holds */
+    assert_true(spsc_try_enqueue(7));
+    array_event_deadline(&deadline, 20000000);
+    ARRAY_EVENT_WAIT_FOR(&not_empty, spsc_try_dequeue(&item), &deadline, ret);
+    assert_true(ret);
+    assert_int_equal(item, 7);
+}
+
+static void *spsc_producer(void *arg __UNUSED)
+{
+    A_ITEM i;
+    bool ret;
+
+    for (i = 0; i < N_TRANSFER; ++i)
+    {
+        ARRAY_EVENT_WAIT_FOR(&not_full, spsc_try_enqueue(i), NULL, ret);
+        array_event_notify(&not_empty, 1);
+    }
+    return NULL;
+}
+
+static void test_array_event_spsc(void **state __UNUSED)
+{
+    pthread_t thread;
+    A_ITEM i, item = 0;
+    bool ret = true;
+
+    ARRAY_EVENT_INIT(&not_empty);
+    ARRAY_EVENT_INIT(&not_full);
+    ARRAY_SPSC_INIT(&spsc_queue, spsc_buf, ITEM_BUF_NUM);
+    assert_int_equal(pthread_create(&thread, NULL, spsc_producer, NULL), 0);
+
+    /* Test case: Blocking transfer keeps every item in order */
+    for (i = 0; i < N_TRANSFER && ret; ++i)
+    {
+        ARRAY_EVENT_WAIT_FOR(&not_empty, spsc_try_dequeue(&item), NULL, ret);
+        array_event_notify(&not_full, 1);
+        ret = ret && item == i;
+    }
+    assert_int_equal(pthread_join(thread, NULL), 0);
+    assert_true(ret);
+    assert_int_equal(ARRAY_SPSC_LEN(&spsc_queue), 0);
+}
+
+static void *mpmc_consumer(void *arg)
+{
+    uint64_t *sum = arg;
+    A_ITEM item;
+    bool ret;
+
+    for (;;)
+    {
+        ARRAY_EVENT_WAIT_FOR(&not_empty,
+                ARRAY_MPMC_TRY_DEQUEUE(item, &mpmc_queue, &item), NULL, ret);
+        array_event_notify(&not_full, 1);
+        if (item == UINT32_MAX)
+        {
+            break;
+        }
+        *sum += item;
+    }
+    return NULL;
+}
+
+static void test_array_event_mpmc(void **state __UNUSED)
+{
+    pthread_t threads[N_CONSUMER];
+    uint64_t sums[N_CONSUMER] = { 0 };
+    uint64_t sum = 0;
+    A_ITEM i;
+    bool ret;
+
+    ARRAY_EVENT_INIT(&not_empty);
+    ARRAY_EVENT_INIT(&not_full);
+    ARRAY_MPMC_INIT(&mpmc_queue, mpmc_buf, ITEM_BUF_NUM);
+    for (i = 0; i < N_CONSUMER; ++i)
+    {
+        assert_int_equal(pthread_create(&threads[i], NULL, mpmc_consumer,
+                &sums[i]), 0);
+    }
+
+    /* Test case: Batched wake-ups after enqueuing several items */
+    for (i = 0; i < N_TRANSFER; i += 4)
+    {
+        A_ITEM k;
+        for (k = i; k < i + 4; ++k)
+        {
+            ARRAY_EVENT_WAIT_FOR(&not_full,
+                    ARRAY_MPMC_TRY_ENQUEUE(item, &mpmc_queue, k), NULL, ret);
+        }
+        array_event_notify(&not_empty, 4);
+    }
+    for (i = 0; i < N_CONSUMER; ++i)
+    {
+        ARRAY_EVENT_WAIT_FOR(&not_full,
+                ARRAY_MPMC_TRY_ENQUEUE(item, &mpmc_queue, UINT32_MAX), NULL, ret);
+        array_event_notify(&not_empty, ARRAY_EVENT_ALL);
+    }
+    for (i = 0; i < N_CONSUMER; ++i)
+    {
+        assert_int_equal(pthread_join(threads[i], NULL), 0);
+        sum += sums[i];
+    }
+    assert_true(sum == (uint64_t) N_TRANSFER * (N_TRANSFER - 1) / 2);
+}
+
+int main(void)
+{
+    const struct CMUnitTest tests[] = {
+            cmocka_unit_test(test_array_event_no_waiter),
+            cmocka_unit_test(test_array_event_timeout),
+            cmocka_unit_test(test_array_event_spsc),
+            cmocka_unit_test(test_array_event_mpmc),
+    };
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,153 @@
+#include "array_heap.h"
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define __UNUSED __attribute__((unused))
+
+/* Heap of integers, binary and default arity, without position index */
+#define INT_CMP(a, b) ((a) < (b) ? -1 : (a) > (b))
+ARRAY_HEAP_TYPE(INT_HEAP, int);
+ARRAY_HEAP_GEN_PROTO(int2, INT_HEAP, int)
+ARRAY_HEAP_GEN_D(int2, INT_HEAP, int, 2, INT_CMP, ARRAY_HEAP_NO_POS)
+ARRAY_HEAP_GEN_PROTO(int4, INT_HEAP, int)
+ARRAY_HEAP_GEN(int4, INT_HEAP, int, INT_CMP, ARRAY_HEAP_NO_POS)
+
+/* Heap of task pointers keeping their positions */
+typedef struct
+{
+    int prio;
+    uint32_t pos;
+} TASK;
+#define TASK_CMP(a, b) INT_CMP((a)->prio, (b)->prio)
+#define TASK_SET_POS(task, p) ((task)->pos = (p))
+ARRAY_HEAP_TYPE(TASK_HEAP, TASK *);
+ARRAY_HEAP_GEN_PROTO(task, TASK_HEAP, TASK *)
+ARRAY_HEAP_GEN_D(task, TASK_HEAP, TASK *, 3, TASK_CMP, TASK_SET_POS)
+
+#define N_ITEM 500
+
+static void test_array_heap_sort(void **state __UNUSED)
+{
+    int buf[N_ITEM];
+    INT_HEAP heap2, heap4;
+    int i, prev2, prev4, item2, item4;
+
+    ARRAY_HEAP_INIT(&heap2, buf, N_ITEM);
+    srand(1);
+
+    /* Test case: Push until full */
+    for (i = 0; i < N_ITEM; ++i)
+    {
+        assert_true(ARRAY_HEAP_PUSH(int2, &heap2, rand() % 100));
+    }
+    assert_true(ARRAY_HEAP_IS_FULL(&heap2));
+    assert_false(ARRAY_HEAP_PUSH(int2, &heap2, 0));
+
+    /* Test case: Pop in non-decreasing order */
+    prev2 = -1;
+    for (i = 0; i < N_ITEM; ++i)
+    {
+        assert_true(ARRAY_HEAP_POP(int2, &heap2, &item2));
+        assert_true(prev2 <= item2);
+        prev2 = item2;
+    }
+    assert_true(ARRAY_HEAP_IS_EMPTY(&heap2));
+    assert_false(ARRAY_HEAP_POP(int2, &heap2, &item2));
+
+    /* Test case: Heapify an array, binary and 4-ary give the same order */
+    int buf4[N_ITEM];
+    for (i = 0; i < N_ITEM; ++i)
+    {
+        buf[i] = buf4[i] = rand() % 1000;
+    }
+    ARRAY_HEAP_INIT(&heap4, buf4, N_ITEM);
+    assert_false(ARRAY_HEAP_HEAPIFY(int4, &heap4, N_ITEM + 1));
+    assert_true(ARRAY_HEAP_HEAPIFY(int2, &heap2, N_ITEM));
+    assert_true(ARRAY_HEAP_HEAPIFY(int4, &heap4, N_ITEM));
+    prev2 = prev4 = -1;
+    for (i = 0; i < N_ITEM; ++i)
+    {
+        assert_true(ARRAY_HEAP_POP(int2, &heap2, &item2));
+        assert_true(ARRAY_HEAP_POP(int4, &heap4, &item4));
+        assert_int_equal(item2, item4);
+        assert_true(prev4 <= item4);
+        prev4 = item4;
+    }
+}
+
+static void check_task_heap(TASK_HEAP *heap)
+{
+    uint32_t i;
+    for (i = 0; i < heap->ah_len; ++i)
+    {
+        assert_int_equal(heap->ah_item[i]->pos, i);
+        if (i > 0)
+        {
+            assert_true(heap->ah_item[(i - 1) / 3]->prio <= heap->ah_item[i]->prio);
+        }
+    }
+}
+
+static void test_array_heap_handle(void **state __UNUSED)
+{
+    TASK tasks[N_ITEM];
+    TASK *buf[N_ITEM];
+    TASK_HEAP heap;
+    TASK *task;
+    int i, step;
+
+    ARRAY_HEAP_INIT(&heap, buf, N_ITEM);
+    srand(2);
+    for (i = 0; i < N_ITEM; ++i)
+    {
+        tasks[i].prio = rand() % 1000;
+        buf[i] = &tasks[i];
+    }
+    assert_true(ARRAY_HEAP_HEAPIFY(task, &heap, N_ITEM));
+    check_task_heap(&heap);
+
+    for (step = 0; step < 2000; ++step)
+    {
+        TASK *t = &tasks[rand() % N_ITEM];
+        if (t->pos == ARRAY_HEAP_NPOS)
+        {
+            /* Test case: Reinsert a removed task */
+            assert_true(ARRAY_HEAP_PUSH(task, &heap, t));
+        }
+        else if (rand() % 3 == 0)
+        {
+            /* Test case: Remove by handle */
+            assert_true(ARRAY_HEAP_REMOVE_AT(task, &heap, t->pos, &task));
+            assert_ptr_equal(task, t);
+            assert_int_equal(t->pos, ARRAY_HEAP_NPOS);
+        }
+        else
+        {
+            /* Test case: Increase or decrease the key by handle */
+            t->prio += rand() % 201 - 100;
+            ARRAY_HEAP_UPDATE_AT(task, &heap, t->pos);
+        }
+        check_task_heap(&heap);
+    }
+
+    assert_false(ARRAY_HEAP_REMOVE_AT(task, &heap, heap.ah_len, &task));
+    int prev = -1000000;
+    while (ARRAY_HEAP_POP(task, &heap, &task))
+    {
+        assert_true(prev <= task->prio);
+        prev = task->prio;
+    }
+}
+
+int main(void)
+{
+    const struct CMUnitTest tests[] = {
+            cmocka_unit_test(test_array_heap_sort),
+            cmocka_unit_test(test_array_heap_handle),
+    };
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
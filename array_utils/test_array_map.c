@@ -5,6 +5,7 @@
 #include <cmocka.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #define __UNUSED __attribute__((unused))
 
@@ -354,6 +355,81 @@ static void test_array_map_remove(void **state __UNUSED)
     }
 }
 
+typedef struct S_ITEM_
+{
+    ARRAY_MAP_STR_KEY key;
+    int val;
+} S_ITEM;
+
+ARRAY_MAP_TYPE(S_ITEM_MAP, S_ITEM);
+
+#define S_ITEM_MAP_KEY_CMP(item, key) array_map_str_key_cmp(&(item).key, (key))
+ARRAY_MAP_GEN(str_item_map, S_ITEM_MAP, const ARRAY_MAP_STR_KEY *, S_ITEM, S_ITEM_MAP_KEY_CMP)
+
+static void test_array_map_str_key(void **state __UNUSED)
+{
+    static const char *str[] = {
+            "applesauce_b", "", "apple", "applesauce_a", "\xff",
+            "applesau", "b", "applesauce",
+    };
+    static const char *sorted_str[] = {
+            "", "apple", "applesau", "applesauce", "applesauce_a",
+            "applesauce_b", "b", "\xff",
+    };
+    const unsigned int N = ARRAY_SIZE(str);
+    S_ITEM buf[ARRAY_SIZE(str)];
+    S_ITEM_MAP map;
+    unsigned int i;
+    ARRAY_MAP_INIT(&map, buf, N);
+
+    /* Test case: Insert keys sharing prefixes */
+    for (i = 0; i < N; ++i)
+    {
+        S_ITEM item;
+        ARRAY_MAP_STR_KEY_INIT(&item.key, str[i]);
+        item.val = i;
+        assert_true(ARRAY_MAP_INSERT(str_item_map, &map, &item.key, item));
+    }
+    for (i = 0; i < N; ++i)
+    {
+        assert_string_equal(map.am_item[i].key.am_str, sorted_str[i]);
+    }
+
+    /* Test case: Find by keys not sharing storage with the inserted ones */
+    for (i = 0; i < N; ++i)
+    {
+        char copy[16];
+        ARRAY_MAP_STR_KEY key;
+        S_ITEM item;
+        strcpy(copy, str[i]);
+        ARRAY_MAP_STR_KEY_INIT(&key, copy);
+        assert_true(ARRAY_MAP_FIND(str_item_map, &map, &key, &item));
+        assert_int_equal(item.val, i);
+    }
+
+    /* Test case: Keys that only differ after the prefix or in length */
+    {
+        static const char *missing[] = { "applesauce_c", "applesauc", "apples", "a" };
+        for (i = 0; i < ARRAY_SIZE(missing); ++i)
+        {
+            ARRAY_MAP_STR_KEY key;
+            S_ITEM item;
+            ARRAY_MAP_STR_KEY_INIT(&key, missing[i]);
+            assert_false(ARRAY_MAP_FIND(str_item_map, &map, &key, &item));
+        }
+    }
+
+    /* Test case: Remove */
+    {
+        ARRAY_MAP_STR_KEY key;
+        S_ITEM item;
+        ARRAY_MAP_STR_KEY_INIT(&key, "applesauce_a");
+        ARRAY_MAP_REMOVE(str_item_map, &map, &key);
+        assert_int_equal(map.am_len, N - 1);
+        assert_false(ARRAY_MAP_FIND(str_item_map, &map, &key, &item));
+    }
+}
+
 int main(void)
 {
     const struct CMUnitTest tests[] = {
@@ -363,6 +439,7 @@ int main(void)
             cmocka_unit_test(test_array_map_bsearch),
             cmocka_unit_test(test_array_map_insert),
             cmocka_unit_test(test_array_map_remove),
+            cmocka_unit_test(test_array_map_str_key),
     };
     return cmocka_run_group_tests(tests, NULL, NULL);
 }
@@ -0,0 +1,91 @@
+#include "array_mirror.h"
+#include "array_queue.h"
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define __UNUSED __attribute__((unused))
+
+ARRAY_QUEUE_TYPE_32(BYTE_QUEUE, uint8_t);
+ARRAY_QUEUE_SPAN_TYPE(BYTE_SPAN, uint8_t);
+
+static void test_array_mirror_alloc(void **state __UNUSED)
+{
+    ARRAY_MIRROR mirror;
+    uint8_t *base;
+
+    assert_false(array_mirror_alloc(&mirror, 0));
+
+    /* Test case: Size is rounded up to whole pages */
+    assert_true(array_mirror_alloc(&mirror, 100));
+    assert_true(mirror.amr_size >= 100);
+    assert_int_equal(mirror.amr_size % sysconf(_SC_PAGESIZE), 0);
+
+    /* Test case: Both halves alias the same memory */
+    base = mirror.amr_base;
+    base[0] = 0x5a;
+    assert_int_equal(base[mirror.amr_size], 0x5a);
+    base[2 * mirror.amr_size - 1] = 0xa5;
+    assert_int_equal(base[mirror.amr_size - 1], 0xa5);
+
+    array_mirror_free(&mirror);
+    assert_null(mirror.amr_base);
+}
+
+static void test_array_mirror_queue(void **state __UNUSED)
+{
+    ARRAY_MIRROR mirror;
+    BYTE_QUEUE queue;
+    BYTE_SPAN span;
+    uint8_t msg[300];
+    size_t i;
+    uint32_t size;
+
+    for (i = 0; i < sizeof(msg); ++i)
+    {
+        msg[i] = (uint8_t) (i * 7 + 1);
+    }
+    assert_true(array_mirror_alloc(&mirror, 4096));
+    size = (uint32_t) mirror.amr_size;
+    ARRAY_QUEUE_INIT(&queue, (uint8_t *) mirror.amr_base, size);
+
+    /* Move the back near the end of the buffer */
+    ARRAY_QUEUE_RESERVE(&queue, size - 100, &span, &span);
+    ARRAY_QUEUE_COMMIT(&queue, size - 100);
+    ARRAY_QUEUE_RELEASE(&queue, size - 100);
+
+    /* Test case: A reservation across the wrap point is one span */
+    ARRAY_QUEUE_MIRROR_RESERVE(&queue, sizeof(msg), &span);
+    assert_int_equal(span.aq_len, sizeof(msg));
+    memcpy(span.aq_item, msg, sizeof(msg));
+    ARRAY_QUEUE_COMMIT(&queue, sizeof(msg));
+    assert_int_equal(queue.aq_back, sizeof(msg) - 100);
+
+    /* Test case: A peek across the wrap point is one span */
+    ARRAY_QUEUE_MIRROR_PEEK(&queue, size, &span);
+    assert_int_equal(span.aq_len, sizeof(msg));
+    assert_memory_equal(span.aq_item, msg, sizeof(msg));
+    ARRAY_QUEUE_RELEASE(&queue, span.aq_len);
+
+    assert_true(ARRAY_QUEUE_IS_EMPTY(&queue));
+
+    /* Test case: Reservation is clamped to the free space */
+    ARRAY_QUEUE_MIRROR_RESERVE(&queue, 2 * size, &span);
+    assert_int_equal(span.aq_len, size);
+
+    array_mirror_free(&mirror);
+}
+
+int main(void)
+{
+    const struct CMUnitTest tests[] = {
+            cmocka_unit_test(test_array_mirror_alloc),
+            cmocka_unit_test(test_array_mirror_queue),
+    };
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
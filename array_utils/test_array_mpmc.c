@@ -0,0 +1,150 @@
+#include "array_mpmc.h"
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+
+#define __UNUSED __attribute__((unused))
+
+typedef uint32_t A_ITEM;
+ARRAY_MPMC_TYPE(A_ITEM_MPMC, A_ITEM);
+ARRAY_MPMC_GEN_PROTO(item, A_ITEM_MPMC, A_ITEM)
+ARRAY_MPMC_GEN(item, A_ITEM_MPMC, A_ITEM)
+
+#define ITEM_BUF_NUM 16
+#define N_PRODUCER 3
+#define N_CONSUMER 3
+#define N_PER_PRODUCER 100000
+A_ITEM_MPMC_CELL item_buf[ITEM_BUF_NUM];
+A_ITEM_MPMC item_queue;
+
+static void test_array_mpmc(void **state __UNUSED)
+{
+    bool ret;
+    A_ITEM i, item;
+
+    ARRAY_MPMC_INIT_RET(&item_queue, item_buf, 12, ret);
+    assert_false(ret);
+    ARRAY_MPMC_INIT_RET(&item_queue, item_buf, ITEM_BUF_NUM, ret);
+    assert_true(ret);
+    assert_int_equal(ARRAY_MPMC_SIZE(&item_queue), ITEM_BUF_NUM);
+
+    /* Test case: Dequeue from an empty queue */
+    assert_false(ARRAY_MPMC_TRY_DEQUEUE(item, &item_queue, &item));
+
+    /* Test case: Fill the queue and wrap around several times */
+    for (i = 0; i < ITEM_BUF_NUM; ++i)
+    {
+        assert_true(ARRAY_MPMC_TRY_ENQUEUE(item, &item_queue, i));
+    }
+    assert_false(ARRAY_MPMC_TRY_ENQUEUE(item, &item_queue, i));
+    assert_int_equal(ARRAY_MPMC_LEN(&item_queue), ITEM_BUF_NUM);
+    for (i = 0; i < ITEM_BUF_NUM * 5; ++i)
+    {
+        assert_true(ARRAY_MPMC_TRY_DEQUEUE(item, &item_queue, &item));
+        assert_int_equal(item, i);
+        assert_true(ARRAY_MPMC_TRY_ENQUEUE(item, &item_queue, i + ITEM_BUF_NUM));
+    }
+    for (; i < ITEM_BUF_NUM * 6; ++i)
+    {
+        ARRAY_MPMC_DEQUEUE(item, &item_queue, &item);
+        assert_int_equal(item, i);
+    }
+    assert_false(ARRAY_MPMC_TRY_DEQUEUE(item, &item_queue, &item));
+    assert_int_equal(ARRAY_MPMC_LEN(&item_queue), 0);
+}
+
+typedef struct
+{
+    A_ITEM id;
+    uint64_t sum;
+    A_ITEM n;
+    bool in_order;
+} WORKER;
+
+static void *producer(void *arg)
+{
+    WORKER *w = arg;
+    A_ITEM i;
+
+    for (i = 0; i < N_PER_PRODUCER; ++i)
+    {
+        ARRAY_MPMC_ENQUEUE(item, &item_queue, w->id * N_PER_PRODUCER + i);
+    }
+    return NULL;
+}
+
+static void *consumer(void *arg)
+{
+    WORKER *w = arg;
+    A_ITEM last[N_PRODUCER];
+    A_ITEM i, item;
+
+    for (i = 0; i < N_PRODUCER; ++i)
+    {
+        last[i] = 0;
+    }
+    w->in_order = true;
+    for (i = 0; i < N_PRODUCER * N_PER_PRODUCER / N_CONSUMER; ++i)
+    {
+        ARRAY_MPMC_DEQUEUE(item, &item_queue, &item);
+        /* Items of one producer are dequeued in the order enqueued */
+        A_ITEM p = item / N_PER_PRODUCER;
+        A_ITEM seq = item % N_PER_PRODUCER + 1;
+        if (p >= N_PRODUCER || seq <= last[p])
+        {
+            w->in_order = false;
+        }
+        else
+        {
+            last[p] = seq;
+        }
+        w->sum += item;
+        ++w->n;
+    }
+    return NULL;
+}
+
+static void test_array_mpmc_threads(void **state __UNUSED)
+{
+    pthread_t threads[N_PRODUCER + N_CONSUMER];
+    WORKER workers[N_PRODUCER + N_CONSUMER] = { { 0 } };
+    uint64_t n = N_PRODUCER * N_PER_PRODUCER;
+    uint64_t sum = 0;
+    A_ITEM i, total = 0;
+
+    ARRAY_MPMC_INIT(&item_queue, item_buf, ITEM_BUF_NUM);
+    for (i = 0; i < N_PRODUCER + N_CONSUMER; ++i)
+    {
+        workers[i].id = i;
+        assert_int_equal(pthread_create(&threads[i], NULL,
+                i < N_PRODUCER ? producer : consumer, &workers[i]), 0);
+    }
+    for (i = 0; i < N_PRODUCER + N_CONSUMER; ++i)
+    {
+        assert_int_equal(pthread_join(threads[i], NULL), 0);
+    }
+
+    /* Test case: Every item is dequeued exactly once */
+    for (i = N_PRODUCER; i < N_PRODUCER + N_CONSUMER; ++i)
+    {
+        assert_true(workers[i].in_order);
+        sum += workers[i].sum;
+        total += workers[i].n;
+    }
+    assert_int_equal(total, n);
+    assert_true(sum == n * (n - 1) / 2);
+    assert_int_equal(ARRAY_MPMC_LEN(&item_queue), 0);
+}
+
+int main(void)
+{
+    const struct CMUnitTest tests[] = {
+            cmocka_unit_test(test_array_mpmc),
+            cmocka_unit_test(test_array_mpmc_threads),
+    };
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -5,6 +5,7 @@
 #include <cmocka.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #define __UNUSED __attribute__((unused))
 
@@ -18,6 +19,12 @@ ARRAY_QUEUE_TYPE_8(A_ITEM_QUEUE, A_ITEM);
 A_ITEM item_buf[ITEM_BUF_NUM];
 A_ITEM_QUEUE item_queue;
 
+ARRAY_QUEUE_P2_TYPE_8(A_ITEM_P2_QUEUE, A_ITEM);
+
+#define P2_BUF_NUM 128
+A_ITEM p2_buf[P2_BUF_NUM];
+A_ITEM_P2_QUEUE p2_queue;
+
 static A_ITEM item_queue_get_item_at(A_ITEM_QUEUE *queue, int index)
 {
     assert_in_range(index, 0, queue->aq_len - 1);
@@ -205,12 +212,491 @@ static void test_array_queue_iterator_remove(void **state __UNUSED)
     }
 }
 
+static void test_array_queue_p2_init(void **state __UNUSED)
+{
+    bool ret;
+
+    /* Test case: Capacity must be a power of two */
+    ARRAY_QUEUE_P2_INIT_RET(&p2_queue, p2_buf, 6, ret);
+    assert_false(ret);
+    ARRAY_QUEUE_P2_INIT_RET(&p2_queue, p2_buf, 0, ret);
+    assert_false(ret);
+
+    /* Test case: Capacity must fit twice in the size type */
+    ARRAY_QUEUE_P2_INIT_RET(&p2_queue, p2_buf, 256, ret);
+    assert_false(ret);
+
+    ARRAY_QUEUE_P2_INIT_RET(&p2_queue, p2_buf, P2_BUF_NUM, ret);
+    assert_true(ret);
+    assert_int_equal(ARRAY_QUEUE_P2_SIZE(&p2_queue), P2_BUF_NUM);
+    assert_int_equal(ARRAY_QUEUE_P2_LEN(&p2_queue), 0);
+    assert_true(ARRAY_QUEUE_P2_IS_EMPTY(&p2_queue));
+}
+
+static void test_array_queue_p2(void **state __UNUSED)
+{
+    bool ret;
+    int i, round;
+    int next_in = 0, next_out = 0;
+    A_ITEM item;
+
+    ARRAY_QUEUE_P2_INIT(&p2_queue, p2_buf, P2_BUF_NUM);
+
+    /* Run the 8-bit indices around several times at varying fill levels */
+    for (round = 0; round < 64; ++round)
+    {
+        int n_in = (round * 37) % (P2_BUF_NUM + 1);
+        int n_out;
+
+        for (i = 0; i < n_in; ++i)
+        {
+            bool full = ARRAY_QUEUE_P2_IS_FULL(&p2_queue);
+            ARRAY_QUEUE_P2_ENQUEUE_RET(&p2_queue, next_in, ret);
+            assert_int_equal(ret, !full);
+            if (ret)
+            {
+                ++next_in;
+            }
+        }
+        assert_int_equal(ARRAY_QUEUE_P2_LEN(&p2_queue), next_in - next_out);
+
+        n_out = (round * 53) % (P2_BUF_NUM + 1);
+        for (i = 0; i < n_out; ++i)
+        {
+            bool empty = ARRAY_QUEUE_P2_IS_EMPTY(&p2_queue);
+            if (!empty)
+            {
+                assert_int_equal(ARRAY_QUEUE_P2_FRONT(&p2_queue), next_out);
+            }
+            ARRAY_QUEUE_P2_DEQUEUE_RET(&p2_queue, &item, ret);
+            assert_int_equal(ret, !empty);
+            if (ret)
+            {
+                assert_int_equal(item, next_out);
+                ++next_out;
+            }
+        }
+        assert_int_equal(ARRAY_QUEUE_P2_LEN(&p2_queue), next_in - next_out);
+    }
+    assert_true(next_in > 4 * 256);
+
+    /* Test case: A full queue is not mistaken for an empty one */
+    while (!ARRAY_QUEUE_P2_IS_FULL(&p2_queue))
+    {
+        ARRAY_QUEUE_P2_ENQUEUE(&p2_queue, next_in);
+        ++next_in;
+    }
+    assert_false(ARRAY_QUEUE_P2_IS_EMPTY(&p2_queue));
+    assert_int_equal(ARRAY_QUEUE_P2_LEN(&p2_queue), P2_BUF_NUM);
+    ARRAY_QUEUE_P2_ENQUEUE_RET(&p2_queue, -1, ret);
+    assert_false(ret);
+
+    /* Test case: Iteration visits items in queue order */
+    A_ITEM *iter = ARRAY_QUEUE_P2_ITER(&p2_queue);
+    i = next_out;
+    while (iter != ARRAY_QUEUE_P2_ITER_END(&p2_queue))
+    {
+        assert_int_equal(*iter, i);
+        ++i;
+        ARRAY_QUEUE_P2_ITER_NEXT(&p2_queue, iter);
+    }
+    assert_int_equal(i, next_in);
+
+    /* Test case: Remove every other item while iterating */
+    iter = ARRAY_QUEUE_P2_ITER(&p2_queue);
+    while (iter != ARRAY_QUEUE_P2_ITER_END(&p2_queue))
+    {
+        if (*iter % 2 == 0)
+        {
+            ARRAY_QUEUE_P2_ITER_REMOVE(&p2_queue, iter);
+        }
+        else
+        {
+            ARRAY_QUEUE_P2_ITER_NEXT(&p2_queue, iter);
+        }
+    }
+    assert_int_equal(ARRAY_QUEUE_P2_LEN(&p2_queue), P2_BUF_NUM / 2);
+    for (i = next_out; i < next_in; ++i)
+    {
+        if (i % 2 != 0)
+        {
+            ARRAY_QUEUE_P2_DEQUEUE_RET(&p2_queue, &item, ret);
+            assert_true(ret);
+            assert_int_equal(item, i);
+        }
+    }
+    assert_true(ARRAY_QUEUE_P2_IS_EMPTY(&p2_queue));
+}
+
+#define BULK_BUF_NUM 8
+A_ITEM bulk_buf[BULK_BUF_NUM];
+
+static void test_array_queue_bulk(void **state __UNUSED)
+{
+    A_ITEM_QUEUE queue;
+    A_ITEM in[BULK_BUF_NUM * 2], out[BULK_BUF_NUM * 2];
+    bool ret;
+    size_t n;
+    int i;
+
+    for (i = 0; i < BULK_BUF_NUM * 2; ++i)
+    {
+        in[i] = i + 1;
+    }
+    ARRAY_QUEUE_INIT(&queue, bulk_buf, BULK_BUF_NUM);
+
+    /* Test case: Move the front so later batches wrap around */
+    ARRAY_QUEUE_ENQUEUE_N_RET(&queue, in, 5, ret);
+    assert_true(ret);
+    ARRAY_QUEUE_DEQUEUE_N_RET(&queue, out, 5, ret);
+    assert_true(ret);
+    assert_memory_equal(out, in, 5 * sizeof(A_ITEM));
+    assert_int_equal(queue.aq_front, 5);
+
+    /* Test case: All or nothing */
+    ARRAY_QUEUE_ENQUEUE_N_RET(&queue, in, BULK_BUF_NUM + 1, ret);
+    assert_false(ret);
+    assert_int_equal(queue.aq_len, 0);
+    ARRAY_QUEUE_ENQUEUE_N_RET(&queue, in, 6, ret);
+    assert_true(ret);
+    assert_int_equal(queue.aq_back, 3);
+    for (i = 0; i < 6; ++i)
+    {
+        assert_int_equal(item_queue_get_item_at(&queue, i), in[i]);
+    }
+    ARRAY_QUEUE_DEQUEUE_N_RET(&queue, out, 7, ret);
+    assert_false(ret);
+    assert_int_equal(queue.aq_len, 6);
+
+    /* Test case: Best effort fills the free slots */
+    ARRAY_QUEUE_ENQUEUE_BURST(&queue, in + 6, 5, n);
+    assert_int_equal(n, 2);
+    assert_true(ARRAY_QUEUE_IS_FULL(&queue));
+    ARRAY_QUEUE_ENQUEUE_BURST(&queue, in, 1, n);
+    assert_int_equal(n, 0);
+
+    /* Test case: Best effort drains across the wrap point */
+    ARRAY_QUEUE_DEQUEUE_BURST(&queue, out, BULK_BUF_NUM * 2, n);
+    assert_int_equal(n, BULK_BUF_NUM);
+    assert_memory_equal(out, in, BULK_BUF_NUM * sizeof(A_ITEM));
+    assert_true(ARRAY_QUEUE_IS_EMPTY(&queue));
+    assert_int_equal(queue.aq_front, queue.aq_back);
+
+    /* Test case: Bulk and single operations interleave */
+    ARRAY_QUEUE_ENQUEUE(&queue, 100);
+    ARRAY_QUEUE_ENQUEUE_N(&queue, in, 3);
+    ARRAY_QUEUE_DEQUEUE(&queue, &out[0]);
+    assert_int_equal(out[0], 100);
+    ARRAY_QUEUE_DEQUEUE_N(&queue, out, 3);
+    assert_memory_equal(out, in, 3 * sizeof(A_ITEM));
+    assert_true(ARRAY_QUEUE_IS_EMPTY(&queue));
+}
+
+typedef struct
+{
+    int id;
+    char payload[60];
+} BIG_ITEM;
+ARRAY_QUEUE_TYPE_8(BIG_ITEM_QUEUE, BIG_ITEM);
+ARRAY_QUEUE_SPAN_TYPE(BIG_ITEM_SPAN, BIG_ITEM);
+
+#define BIG_BUF_NUM 6
+BIG_ITEM big_buf[BIG_BUF_NUM];
+
+static void test_array_queue_span(void **state __UNUSED)
+{
+    BIG_ITEM_QUEUE queue;
+    BIG_ITEM_SPAN span1, span2;
+    size_t i;
+    int next_id = 0, expect_id = 0;
+
+    ARRAY_QUEUE_INIT(&queue, big_buf, BIG_BUF_NUM);
+
+    /* Test case: Reserve without wrap, build in place and commit part */
+    ARRAY_QUEUE_RESERVE(&queue, 4, &span1, &span2);
+    assert_ptr_equal(span1.aq_item, &big_buf[0]);
+    assert_int_equal(span1.aq_len, 4);
+    assert_int_equal(span2.aq_len, 0);
+    for (i = 0; i < 3; ++i)
+    {
+        span1.aq_item[i].id = next_id++;
+    }
+    ARRAY_QUEUE_COMMIT(&queue, 3);
+    assert_int_equal(queue.aq_len, 3);
+    assert_int_equal(queue.aq_back, 3);
+
+    /* Test case: Peek is clamped to the length and released in place */
+    ARRAY_QUEUE_PEEK(&queue, 10, &span1, &span2);
+    assert_int_equal(span1.aq_len, 3);
+    assert_int_equal(span2.aq_len, 0);
+    assert_int_equal(span1.aq_item[0].id, expect_id++);
+    assert_int_equal(span1.aq_item[1].id, expect_id++);
+    ARRAY_QUEUE_RELEASE(&queue, 2);
+    assert_int_equal(queue.aq_front, 2);
+    assert_int_equal(ARRAY_QUEUE_FRONT(&queue).id, expect_id);
+
+    /* Test case: Reserve is split at the wrap point and clamped to free slots */
+    ARRAY_QUEUE_RESERVE(&queue, 10, &span1, &span2);
+    assert_ptr_equal(span1.aq_item, &big_buf[3]);
+    assert_int_equal(span1.aq_len, 3);
+    assert_ptr_equal(span2.aq_item, &big_buf[0]);
+    assert_int_equal(span2.aq_len, 2);
+    for (i = 0; i < span1.aq_len; ++i)
+    {
+        span1.aq_item[i].id = next_id++;
+    }
+    for (i = 0; i < span2.aq_len; ++i)
+    {
+        span2.aq_item[i].id = next_id++;
+    }
+    ARRAY_QUEUE_COMMIT(&queue, span1.aq_len + span2.aq_len);
+    assert_true(ARRAY_QUEUE_IS_FULL(&queue));
+    assert_int_equal(queue.aq_back, 2);
+
+    ARRAY_QUEUE_RESERVE(&queue, 1, &span1, &span2);
+    assert_int_equal(span1.aq_len + span2.aq_len, 0);
+
+    /* Test case: Peek across the wrap point */
+    ARRAY_QUEUE_PEEK(&queue, BIG_BUF_NUM, &span1, &span2);
+    assert_int_equal(span1.aq_len, 4);
+    assert_int_equal(span2.aq_len, 2);
+    for (i = 0; i < span1.aq_len; ++i)
+    {
+        assert_int_equal(span1.aq_item[i].id, expect_id++);
+    }
+    for (i = 0; i < span2.aq_len; ++i)
+    {
+        assert_int_equal(span2.aq_item[i].id, expect_id++);
+    }
+    ARRAY_QUEUE_RELEASE(&queue, span1.aq_len + span2.aq_len);
+    assert_true(ARRAY_QUEUE_IS_EMPTY(&queue));
+    assert_int_equal(queue.aq_front, queue.aq_back);
+    assert_int_equal(expect_id, next_id);
+}
+
+#define DEQUE_BUF_NUM 7
+#define IS_ODD(pitem) (*(pitem) % 2 != 0)
+
+static void check_deque(A_ITEM_QUEUE *queue, const A_ITEM *ref, int n_ref)
+{
+    int i;
+    assert_int_equal(queue->aq_len, n_ref);
+    for (i = 0; i < n_ref; ++i)
+    {
+        assert_int_equal(ARRAY_QUEUE_AT(queue, i), ref[i]);
+    }
+    if (n_ref > 0)
+    {
+        assert_int_equal(ARRAY_QUEUE_FRONT(queue), ref[0]);
+        assert_int_equal(ARRAY_QUEUE_BACK(queue), ref[n_ref - 1]);
+    }
+}
+
+static void test_array_queue_deque(void **state __UNUSED)
+{
+    A_ITEM buf[DEQUE_BUF_NUM];
+    A_ITEM_QUEUE queue;
+    A_ITEM ref[DEQUE_BUF_NUM];
+    A_ITEM item;
+    int n_ref = 0, next = 0, step, i;
+    bool ret;
+
+    srand(7);
+    ARRAY_QUEUE_INIT(&queue, buf, DEQUE_BUF_NUM);
+    for (step = 0; step < 5000; ++step)
+    {
+        switch (rand() % 6)
+        {
+        case 0:
+            ARRAY_QUEUE_ENQUEUE_RET(&queue, next, ret);
+            assert_int_equal(ret, n_ref < DEQUE_BUF_NUM);
+            if (ret)
+            {
+                ref[n_ref++] = next;
+            }
+            break;
+        case 1:
+            ARRAY_QUEUE_PUSH_FRONT_RET(&queue, next, ret);
+            assert_int_equal(ret, n_ref < DEQUE_BUF_NUM);
+            if (ret)
+            {
+                memmove(&ref[1], &ref[0], n_ref * sizeof(A_ITEM));
+                ref[0] = next;
+                ++n_ref;
+            }
+            break;
+        case 2:
+            ARRAY_QUEUE_DEQUEUE_RET(&queue, &item, ret);
+            assert_int_equal(ret, n_ref > 0);
+            if (ret)
+            {
+                assert_int_equal(item, ref[0]);
+                memmove(&ref[0], &ref[1], --n_ref * sizeof(A_ITEM));
+            }
+            break;
+        case 3:
+            ARRAY_QUEUE_POP_BACK_RET(&queue, &item, ret);
+            assert_int_equal(ret, n_ref > 0);
+            if (ret)
+            {
+                assert_int_equal(item, ref[--n_ref]);
+            }
+            break;
+        case 4:
+            if (n_ref > 0)
+            {
+                /* Remove one item and check the iterator moves to the next */
+                int pos = rand() % n_ref;
+                A_ITEM *iter = ARRAY_QUEUE_ITER(&queue);
+                for (i = 0; i < pos; ++i)
+                {
+                    ARRAY_QUEUE_ITER_NEXT(&queue, iter);
+                }
+                ARRAY_QUEUE_ITER_REMOVE(&queue, iter);
+                memmove(&ref[pos], &ref[pos + 1], (n_ref - pos - 1) * sizeof(A_ITEM));
+                --n_ref;
+                if (pos == n_ref)
+                {
+                    assert_null(iter);
+                }
+                else
+                {
+                    assert_int_equal(*iter, ref[pos]);
+                }
+            }
+            break;
+        default:
+            if (rand() % 4 == 0)
+            {
+                int n_kept = 0;
+                ARRAY_QUEUE_REMOVE_IF(&queue, IS_ODD);
+                for (i = 0; i < n_ref; ++i)
+                {
+                    if (!IS_ODD(&ref[i]))
+                    {
+                        ref[n_kept++] = ref[i];
+                    }
+                }
+                n_ref = n_kept;
+            }
+            break;
+        }
+        ++next;
+        check_deque(&queue, ref, n_ref);
+    }
+}
+
+static void test_array_queue_p2_deque(void **state __UNUSED)
+{
+    A_ITEM ref[8];
+    A_ITEM item;
+    int n_ref = 0, next = 0, step, i;
+    bool ret;
+
+    srand(11);
+    ARRAY_QUEUE_P2_INIT(&p2_queue, p2_buf, 8);
+    for (step = 0; step < 5000; ++step)
+    {
+        switch (rand() % 6)
+        {
+        case 0:
+            ARRAY_QUEUE_P2_ENQUEUE_RET(&p2_queue, next, ret);
+            assert_int_equal(ret, n_ref < 8);
+            if (ret)
+            {
+                ref[n_ref++] = next;
+            }
+            break;
+        case 1:
+            ARRAY_QUEUE_P2_PUSH_FRONT_RET(&p2_queue, next, ret);
+            assert_int_equal(ret, n_ref < 8);
+            if (ret)
+            {
+                memmove(&ref[1], &ref[0], n_ref * sizeof(A_ITEM));
+                ref[0] = next;
+                ++n_ref;
+            }
+            break;
+        case 2:
+            ARRAY_QUEUE_P2_DEQUEUE_RET(&p2_queue, &item, ret);
+            assert_int_equal(ret, n_ref > 0);
+            if (ret)
+            {
+                assert_int_equal(item, ref[0]);
+                memmove(&ref[0], &ref[1], --n_ref * sizeof(A_ITEM));
+            }
+            break;
+        case 3:
+            ARRAY_QUEUE_P2_POP_BACK_RET(&p2_queue, &item, ret);
+            assert_int_equal(ret, n_ref > 0);
+            if (ret)
+            {
+                assert_int_equal(item, ref[--n_ref]);
+            }
+            break;
+        case 4:
+            if (n_ref > 0)
+            {
+                int pos = rand() % n_ref;
+                A_ITEM *iter = ARRAY_QUEUE_P2_ITER(&p2_queue);
+                for (i = 0; i < pos; ++i)
+                {
+                    ARRAY_QUEUE_P2_ITER_NEXT(&p2_queue, iter);
+                }
+                ARRAY_QUEUE_P2_ITER_REMOVE(&p2_queue, iter);
+                memmove(&ref[pos], &ref[pos + 1], (n_ref - pos - 1) * sizeof(A_ITEM));
+                --n_ref;
+                if (pos == n_ref)
+                {
+                    assert_null(iter);
+                }
+                else
+                {
+                    assert_int_equal(*iter, ref[pos]);
+                }
+            }
+            break;
+        default:
+            if (rand() % 4 == 0)
+            {
+                int n_kept = 0;
+                ARRAY_QUEUE_P2_REMOVE_IF(&p2_queue, IS_ODD);
+                for (i = 0; i < n_ref; ++i)
+                {
+                    if (!IS_ODD(&ref[i]))
+                    {
+                        ref[n_kept++] = ref[i];
+                    }
+                }
+                n_ref = n_kept;
+            }
+            break;
+        }
+        ++next;
+        assert_int_equal(ARRAY_QUEUE_P2_LEN(&p2_queue), n_ref);
+        for (i = 0; i < n_ref; ++i)
+        {
+            assert_int_equal(ARRAY_QUEUE_P2_AT(&p2_queue, i), ref[i]);
+        }
+        if (n_ref > 0)
+        {
+            assert_int_equal(ARRAY_QUEUE_P2_BACK(&p2_queue), ref[n_ref - 1]);
+        }
+    }
+}
+
 int main(void)
 {
     const struct CMUnitTest tests[] = {
             cmocka_unit_test(test_array_queue),
             cmocka_unit_test(test_array_queue_iterator),
             cmocka_unit_test(test_array_queue_iterator_remove),
+            cmocka_unit_test(test_array_queue_bulk),
+            cmocka_unit_test(test_array_queue_span),
+            cmocka_unit_test(test_array_queue_p2_init),
+            cmocka_unit_test(test_array_queue_p2),
+            cmocka_unit_test(test_array_queue_deque),
+            cmocka_unit_test(test_array_queue_p2_deque),
     };
     return cmocka_run_group_tests(tests, NULL, NULL);
 }
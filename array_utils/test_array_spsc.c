@@ -0,0 +1,127 @@
+#include "array_spsc.h"
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <sched.h>
+
+#define __UNUSED __attribute__((unused))
+
+typedef uint32_t A_ITEM;
+ARRAY_SPSC_TYPE(A_ITEM_SPSC, A_ITEM);
+
+#define ITEM_BUF_NUM 64
+#define N_TRANSFER 1000000
+A_ITEM item_buf[ITEM_BUF_NUM];
+A_ITEM_SPSC item_queue;
+
+static void test_array_spsc_layout(void **state __UNUSED)
+{
+    /* The two indices must not share a cache line */
+    assert_true(offsetof(A_ITEM_SPSC, asp_front) - offsetof(A_ITEM_SPSC, asp_back)
+            >= ARRAY_SPSC_CACHE_LINE);
+    assert_int_equal(offsetof(A_ITEM_SPSC, asp_back) % ARRAY_SPSC_CACHE_LINE, 0);
+    assert_int_equal(offsetof(A_ITEM_SPSC, asp_front) % ARRAY_SPSC_CACHE_LINE, 0);
+}
+
+static void test_array_spsc(void **state __UNUSED)
+{
+    bool ret;
+    A_ITEM i, item;
+
+    ARRAY_SPSC_INIT_RET(&item_queue, item_buf, 48, ret);
+    assert_false(ret);
+    ARRAY_SPSC_INIT_RET(&item_queue, item_buf, ITEM_BUF_NUM, ret);
+    assert_true(ret);
+    assert_int_equal(ARRAY_SPSC_SIZE(&item_queue), ITEM_BUF_NUM);
+
+    /* Test case: Dequeue from an empty queue */
+    ARRAY_SPSC_DEQUEUE_RET(&item_queue, &item, ret);
+    assert_false(ret);
+
+    /* Test case: Fill the queue */
+    for (i = 0; i < ITEM_BUF_NUM; ++i)
+    {
+        ARRAY_SPSC_ENQUEUE_RET(&item_queue, i, ret);
+        assert_true(ret);
+    }
+    ARRAY_SPSC_ENQUEUE_RET(&item_queue, i, ret);
+    assert_false(ret);
+    assert_int_equal(ARRAY_SPSC_LEN(&item_queue), ITEM_BUF_NUM);
+
+    /* Test case: Wrap around */
+    for (i = 0; i < ITEM_BUF_NUM / 2; ++i)
+    {
+        ARRAY_SPSC_DEQUEUE_RET(&item_queue, &item, ret);
+        assert_true(ret);
+        assert_int_equal(item, i);
+    }
+    for (i = ITEM_BUF_NUM; i < ITEM_BUF_NUM * 3 / 2; ++i)
+    {
+        ARRAY_SPSC_ENQUEUE_RET(&item_queue, i, ret);
+        assert_true(ret);
+    }
+    for (i = ITEM_BUF_NUM / 2; i < ITEM_BUF_NUM * 3 / 2; ++i)
+    {
+        ARRAY_SPSC_DEQUEUE_RET(&item_queue, &item, ret);
+        assert_true(ret);
+        assert_int_equal(item, i);
+    }
+    ARRAY_SPSC_DEQUEUE_RET(&item_queue, &item, ret);
+    assert_false(ret);
+    assert_int_equal(ARRAY_SPSC_LEN(&item_queue), 0);
+}
+
+static void *producer(void *arg __UNUSED)
+{
+    A_ITEM i;
+    bool ret;
+
+    for (i = 0; i < N_TRANSFER; ++i)
+    {
+        do
+        {
+            ARRAY_SPSC_ENQUEUE_RET(&item_queue, i, ret);
+        } while (!ret && sched_yield() == 0);
+    }
+    return NULL;
+}
+
+static void test_array_spsc_threads(void **state __UNUSED)
+{
+    pthread_t thread;
+    A_ITEM i, item = 0;
+    bool ret;
+
+    ARRAY_SPSC_INIT(&item_queue, item_buf, ITEM_BUF_NUM);
+    assert_int_equal(pthread_create(&thread, NULL, producer, NULL), 0);
+
+    /* Test case: Items arrive complete and in order */
+    for (i = 0; i < N_TRANSFER; ++i)
+    {
+        do
+        {
+            ARRAY_SPSC_DEQUEUE_RET(&item_queue, &item, ret);
+        } while (!ret && sched_yield() == 0);
+        if (item != i)
+        {
+            break;
+        }
+    }
+    assert_int_equal(pthread_join(thread, NULL), 0);
+    assert_int_equal(i, N_TRANSFER);
+    assert_int_equal(ARRAY_SPSC_LEN(&item_queue), 0);
+}
+
+int main(void)
+{
+    const struct CMUnitTest tests[] = {
+            cmocka_unit_test(test_array_spsc_layout),
+            cmocka_unit_test(test_array_spsc),
+            cmocka_unit_test(test_array_spsc_threads),
+    };
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
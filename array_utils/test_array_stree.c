@@ -0,0 +1,124 @@
+#include "array_stree.h"
+#include "array_map.h"
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define __UNUSED __attribute__((unused))
+
+#define ARRAY_SIZE(arr) (sizeof(arr) / sizeof((arr)[0]))
+
+
+typedef struct A_ITEM_
+{
+    int32_t key;
+    int val;
+} A_ITEM;
+
+ARRAY_MAP_TYPE(A_ITEM_MAP, A_ITEM);
+
+#define A_ITEM_MAP_KEY_CMP(item, key) \
+    ((item).key < (key) ? -1 : ((item).key > (key) ? 1 : 0))
+ARRAY_MAP_GEN(item_map, A_ITEM_MAP, int32_t, A_ITEM, A_ITEM_MAP_KEY_CMP)
+
+#define A_ITEM_KEY(item) ((item).key)
+ARRAY_STREE_GEN(item_map, A_ITEM_MAP, A_ITEM_KEY)
+
+#define ITEM_BUF_NUM 1000
+
+static uint32_t linear_bound(A_ITEM_MAP *map, int32_t x, bool upper)
+{
+    uint32_t i;
+    for (i = 0; i < map->am_len; ++i)
+    {
+        if (upper ? map->am_item[i].key > x : map->am_item[i].key >= x)
+        {
+            break;
+        }
+    }
+    return i;
+}
+
+static void validate_array_stree(ARRAY_STREE *t, A_ITEM_MAP *map, int32_t x)
+{
+    uint32_t begin, end;
+    assert_int_equal(array_stree_lower_bound(t, x), linear_bound(map, x, false));
+    assert_int_equal(array_stree_upper_bound(t, x), linear_bound(map, x, true));
+    array_stree_range(t, x, x + 20, &begin, &end);
+    assert_int_equal(begin, linear_bound(map, x, false));
+    assert_int_equal(end, linear_bound(map, x + 20, true));
+}
+
+static void test_array_stree(void **state __UNUSED)
+{
+    static A_ITEM item_buf[ITEM_BUF_NUM];
+    static ARRAY_STREE_NODE node_buf[ARRAY_STREE_NNODE(ITEM_BUF_NUM)];
+    static uint32_t index_buf[ARRAY_SIZE(node_buf) * ARRAY_STREE_B];
+    A_ITEM_MAP map;
+    ARRAY_STREE t;
+    ARRAY_MAP_INIT(&map, item_buf, ITEM_BUF_NUM);
+    ARRAY_STREE_INIT(&t, node_buf, index_buf, ARRAY_SIZE(node_buf));
+
+    /* Test case: Empty map */
+    assert_true(ARRAY_STREE_BUILD(item_map, &t, &map));
+    assert_int_equal(array_stree_lower_bound(&t, 0), 0);
+
+    /* Test case: Sizes around node boundaries */
+    static const uint32_t size[] = { 1, 15, 16, 17, 272, 273, 500, ITEM_BUF_NUM };
+    unsigned int i;
+    srand(1);
+    for (i = 0; i < ARRAY_SIZE(size); ++i)
+    {
+        ARRAY_MAP_CLEAR(&map);
+        while (map.am_len < size[i])
+        {
+            A_ITEM item = { (rand() % (ITEM_BUF_NUM * 4)) - ITEM_BUF_NUM * 2, 0 };
+            ARRAY_MAP_INSERT(item_map, &map, item.key, item);
+        }
+        assert_true(ARRAY_STREE_BUILD(item_map, &t, &map));
+        int32_t x;
+        for (x = -ITEM_BUF_NUM * 2 - 2; x < ITEM_BUF_NUM * 2 + 2; ++x)
+        {
+            validate_array_stree(&t, &map, x);
+        }
+    }
+
+    /* Test case: Extreme keys */
+    {
+        A_ITEM item[] = { { INT32_MIN, 0 }, { 0, 0 }, { INT32_MAX, 0 } };
+        ARRAY_MAP_CLEAR(&map);
+        for (i = 0; i < ARRAY_SIZE(item); ++i)
+        {
+            ARRAY_MAP_INSERT(item_map, &map, item[i].key, item[i]);
+        }
+        assert_true(ARRAY_STREE_BUILD(item_map, &t, &map));
+        validate_array_stree(&t, &map, INT32_MIN);
+        validate_array_stree(&t, &map, INT32_MAX - 20);
+        assert_int_equal(array_stree_lower_bound(&t, INT32_MAX), 2);
+        assert_int_equal(array_stree_upper_bound(&t, INT32_MAX), 3);
+    }
+
+    /* Test case: Buffers too small */
+    {
+        ARRAY_STREE small;
+        ARRAY_STREE_INIT(&small, node_buf, index_buf, 1);
+        ARRAY_MAP_CLEAR(&map);
+        for (i = 0; i < ARRAY_STREE_B + 1; ++i)
+        {
+            A_ITEM item = { i, 0 };
+            ARRAY_MAP_INSERT(item_map, &map, item.key, item);
+        }
+        assert_false(ARRAY_STREE_BUILD(item_map, &small, &map));
+    }
+}
+
+int main(void)
+{
+    const struct CMUnitTest tests[] = {
+            cmocka_unit_test(test_array_stree),
+    };
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,247 @@
+#define ARRAY_TRACE_HOOKS
+#include "array_trace.h"
+#include "array_map.h"
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sched.h>
+#include <pthread.h>
+
+#define __UNUSED __attribute__((unused))
+
+#define RING_SIZE 8
+#define N_RECORD 200000
+
+typedef int A_ITEM;
+#define A_ITEM_CMP(a, b) ((a) < (b) ? -1 : (a) > (b))
+ARRAY_MAP_TYPE(A_ITEM_MAP, A_ITEM);
+ARRAY_MAP_GEN(item, A_ITEM_MAP, A_ITEM, A_ITEM, A_ITEM_CMP)
+
+ARRAY_TRACE_EVENT ring_buf[RING_SIZE];
+ARRAY_TRACE_RING ring;
+ARRAY_TRACE_EVENT out[1024];
+
+static void test_array_trace_snapshot(__UNUSED void **state)
+{
+    /* Test case: Only power-of-two sizes */
+    assert_false(array_trace_register(&ring, ring_buf, 6));
+    assert_false(array_trace_register(&ring, ring_buf, 1));
+    assert_true(array_trace_register(&ring, ring_buf, RING_SIZE));
+    assert_ptr_equal(array_trace_self, &ring);
+
+    /* Test case: Events in order */
+    uint32_t i;
+    for (i = 0; i < 3; ++i)
+    {
+        array_trace_emit(ARRAY_TRACE_OP_USER + i, i, 10 * i);
+    }
+    assert_int_equal(array_trace_snapshot(&ring, out, 1024), 3);
+    for (i = 0; i < 3; ++i)
+    {
+        assert_int_equal(out[i].ate_op, ARRAY_TRACE_OP_USER + i);
+        assert_int_equal(out[i].ate_tid, ring.at_tid);
+        assert_int_equal(out[i].ate_arg[0], i);
+        assert_int_equal(out[i].ate_arg[1], 10 * i);
+        assert_true(i == 0 || out[i - 1].ate_ts <= out[i].ate_ts);
+    }
+
+    /* Test case: Newest events only */
+    assert_int_equal(array_trace_snapshot(&ring, out, 2), 2);
+    assert_int_equal(out[0].ate_arg[0], 1);
+    assert_int_equal(out[1].ate_arg[0], 2);
+
+    /* Test case: Overwrite the oldest events, keeping a guard slot */
+    for (i = 3; i < 20; ++i)
+    {
+        array_trace_emit(ARRAY_TRACE_OP_USER, i, 0);
+    }
+    assert_int_equal(array_trace_snapshot(&ring, out, 1024), RING_SIZE - 1);
+    assert_int_equal(out[0].ate_arg[0], 20 - (RING_SIZE - 1));
+    assert_int_equal(out[RING_SIZE - 2].ate_arg[0], 19);
+
+    array_trace_unregister(&ring);
+    assert_null(array_trace_self);
+
+    /* Test case: Nothing is recorded without a ring */
+    array_trace_emit(ARRAY_TRACE_OP_USER, 0, 0);
+    assert_int_equal(atomic_load(&ring.at_back), 20);
+}
+
+static void test_array_trace_drain(__UNUSED void **state)
+{
+    assert_true(array_trace_register(&ring, ring_buf, RING_SIZE));
+
+    uint32_t i;
+    for (i = 0; i < 20; ++i)
+    {
+        array_trace_emit(ARRAY_TRACE_OP_USER, i, 0);
+    }
+
+    /* Test case: Overwritten events are lost */
+    assert_int_equal(array_trace_drain(&ring, out, 3), 3);
+    assert_int_equal(ring.at_lost, 20 - (RING_SIZE - 1));
+    assert_int_equal(out[0].ate_arg[0], 13);
+    assert_int_equal(out[2].ate_arg[0], 15);
+    assert_int_equal(array_trace_drain(&ring, out, 1024), 4);
+    assert_int_equal(out[0].ate_arg[0], 16);
+    assert_int_equal(out[3].ate_arg[0], 19);
+    assert_int_equal(array_trace_drain(&ring, out, 1024), 0);
+
+    /* Test case: Drained events are not returned again */
+    array_trace_emit(ARRAY_TRACE_OP_USER, 20, 0);
+    assert_int_equal(array_trace_drain(&ring, out, 1024), 1);
+    assert_int_equal(out[0].ate_arg[0], 20);
+    assert_int_equal(ring.at_lost, 20 - (RING_SIZE - 1));
+
+    array_trace_unregister(&ring);
+}
+
+static void test_array_trace_hooks(__UNUSED void **state)
+{
+    A_ITEM buf[4];
+    A_ITEM_MAP map;
+    A_ITEM value;
+    ARRAY_MAP_INIT(&map, buf, 4);
+    assert_true(array_trace_register(&ring, ring_buf, RING_SIZE));
+
+    assert_true(ARRAY_MAP_INSERT(item, &map, 5, 5));
+    assert_true(ARRAY_MAP_INSERT(item, &map, 3, 3));
+    assert_true(ARRAY_MAP_FIND(item, &map, 5, &value));
+    ARRAY_MAP_REMOVE(item, &map, 4);
+
+    assert_int_equal(array_trace_drain(&ring, out, 1024), 4);
+    assert_int_equal(out[0].ate_op, ARRAY_TRACE_OP_MAP_INSERT);
+    assert_int_equal(out[0].ate_arg[0], (uintptr_t) &map);
+    assert_int_equal(out[0].ate_arg[1], 0);
+    assert_int_equal(out[1].ate_op, ARRAY_TRACE_OP_MAP_INSERT);
+    assert_int_equal(out[1].ate_arg[1], 0);
+    assert_int_equal(out[2].ate_op, ARRAY_TRACE_OP_MAP_FIND);
+    assert_int_equal(out[2].ate_arg[1], 1);
+    assert_int_equal(out[3].ate_op, ARRAY_TRACE_OP_MAP_REMOVE);
+    assert_int_equal(out[3].ate_arg[1], UINT64_MAX);
+    assert_string_equal(array_trace_op_name(out[3].ate_op), "map_remove");
+    assert_null(array_trace_op_name(ARRAY_TRACE_OP_USER));
+
+    array_trace_unregister(&ring);
+}
+
+static ARRAY_TRACE_EVENT writer_buf[64];
+static ARRAY_TRACE_RING writer_ring;
+static _Atomic int writer_state;
+
+static void *writer_main(__UNUSED void *arg)
+{
+    array_trace_register(&writer_ring, writer_buf, 64);
+    atomic_store(&writer_state, 1);
+    uint64_t i;
+    for (i = 0; i < N_RECORD; ++i)
+    {
+        array_trace_emit(ARRAY_TRACE_OP_USER, i, ~i);
+        if (i % 64 == 0)
+        {
+            sched_yield();
+        }
+    }
+    atomic_store(&writer_state, 2);
+    return NULL;
+}
+
+static void test_array_trace_threads(__UNUSED void **state)
+{
+    pthread_t writer;
+    atomic_store(&writer_state, 0);
+    pthread_create(&writer, NULL, writer_main, NULL);
+    while (atomic_load(&writer_state) == 0)
+    {
+        sched_yield();
+    }
+
+    /* Test case: Drain while recording, never returning torn events */
+    uint64_t drained = 0;
+    uint64_t next = 0;
+    for (;;)
+    {
+        bool done = (atomic_load(&writer_state) == 2);
+        uint32_t n = array_trace_drain(&writer_ring, out, 16);
+        uint32_t i;
+        for (i = 0; i < n; ++i)
+        {
+            assert_true(out[i].ate_arg[0] >= next);
+            assert_int_equal(out[i].ate_arg[1], ~out[i].ate_arg[0]);
+            next = out[i].ate_arg[0] + 1;
+        }
+        drained += n;
+        if (n == 0)
+        {
+            if (done)
+            {
+                break;
+            }
+            sched_yield();
+        }
+    }
+    pthread_join(writer, NULL);
+    assert_int_equal(drained + writer_ring.at_lost, N_RECORD);
+    assert_int_equal(next, N_RECORD);
+
+    /* Test case: Snapshot of the ring of a thread that exited */
+    assert_int_equal(array_trace_snapshot(&writer_ring, out, 1024), 63);
+    assert_int_equal(out[62].ate_arg[0], N_RECORD - 1);
+}
+
+static void test_array_trace_dump(__UNUSED void **state)
+{
+    assert_true(array_trace_register(&ring, ring_buf, RING_SIZE));
+    uint32_t i;
+    for (i = 0; i < 10; ++i)
+    {
+        array_trace_emit(ARRAY_TRACE_OP_USER, i, 0);
+    }
+    array_trace_emit(ARRAY_TRACE_OP_USER, 10, 0);
+    /* The writer thread exited, so this thread may record to its ring. */
+    writer_ring.at_lost = 0;
+    array_trace_record(&writer_ring, ARRAY_TRACE_OP_USER, 0, 0);
+    array_trace_record(&writer_ring, ARRAY_TRACE_OP_USER, 1, 0);
+
+    /* Test case: Events and losses of every registered ring */
+    FILE *fp = tmpfile();
+    assert_non_null(fp);
+    assert_true(array_trace_dump(fp));
+    rewind(fp);
+    ARRAY_TRACE_FILE_HEADER hdr;
+    assert_int_equal(fread(&hdr, sizeof(hdr), 1, fp), 1);
+    assert_int_equal(hdr.atf_magic, ARRAY_TRACE_MAGIC);
+    assert_int_equal(hdr.atf_event_size, sizeof(ARRAY_TRACE_EVENT));
+    size_t n = fread(out, sizeof(out[0]), 1024, fp);
+    assert_int_equal(n, 1 + (RING_SIZE - 1) + 2);
+    uint32_t lost = 0;
+    for (i = 0; i < n; ++i)
+    {
+        if (out[i].ate_op == ARRAY_TRACE_OP_LOST)
+        {
+            assert_int_equal(out[i].ate_tid, ring.at_tid);
+            assert_int_equal(out[i].ate_arg[0], 11 - (RING_SIZE - 1));
+            ++lost;
+        }
+    }
+    assert_int_equal(lost, 1);
+    fclose(fp);
+
+    array_trace_unregister(&ring);
+    array_trace_unregister(&writer_ring);
+}
+
+int main(void)
+{
+    const struct CMUnitTest tests[] = {
+            cmocka_unit_test(test_array_trace_snapshot),
+            cmocka_unit_test(test_array_trace_drain),
+            cmocka_unit_test(test_array_trace_hooks),
+            cmocka_unit_test(test_array_trace_threads),
+            cmocka_unit_test(test_array_trace_dump),
+    };
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,123 @@
+#include "array_wsdeque.h"
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <sched.h>
+
+#define __UNUSED __attribute__((unused))
+
+typedef uint32_t A_ITEM;
+ARRAY_WSDEQUE_TYPE(A_ITEM_DEQUE, A_ITEM);
+ARRAY_WSDEQUE_GEN_PROTO(item, A_ITEM_DEQUE, A_ITEM)
+ARRAY_WSDEQUE_GEN(item, A_ITEM_DEQUE, A_ITEM)
+
+#define ITEM_BUF_NUM 64
+#define N_ITEM 200000
+#define N_THIEF 3
+
+A_ITEM item_buf[ITEM_BUF_NUM];
+A_ITEM_DEQUE item_deque;
+_Atomic uint8_t taken[N_ITEM];
+_Atomic bool owner_done;
+
+static void test_array_wsdeque(void **state __UNUSED)
+{
+    A_ITEM i, item;
+
+    ARRAY_WSDEQUE_INIT(&item_deque, item_buf, ITEM_BUF_NUM);
+    assert_false(ARRAY_WSDEQUE_POP(item, &item_deque, &item));
+    assert_false(ARRAY_WSDEQUE_STEAL(item, &item_deque, &item));
+
+    /* Test case: Push until full */
+    for (i = 0; i < ITEM_BUF_NUM; ++i)
+    {
+        assert_true(ARRAY_WSDEQUE_PUSH(item, &item_deque, i));
+    }
+    assert_false(ARRAY_WSDEQUE_PUSH(item, &item_deque, i));
+    assert_int_equal(ARRAY_WSDEQUE_LEN(&item_deque), ITEM_BUF_NUM);
+
+    /* Test case: The owner pops LIFO and thieves steal FIFO */
+    assert_true(ARRAY_WSDEQUE_POP(item, &item_deque, &item));
+    assert_int_equal(item, ITEM_BUF_NUM - 1);
+    assert_true(ARRAY_WSDEQUE_STEAL(item, &item_deque, &item));
+    assert_int_equal(item, 0);
+    for (i = ITEM_BUF_NUM - 2; i > 0; --i)
+    {
+        assert_true(ARRAY_WSDEQUE_POP(item, &item_deque, &item));
+        assert_int_equal(item, i);
+    }
+    assert_false(ARRAY_WSDEQUE_POP(item, &item_deque, &item));
+    assert_int_equal(ARRAY_WSDEQUE_LEN(&item_deque), 0);
+}
+
+static void *thief(void *arg __UNUSED)
+{
+    A_ITEM item;
+    while (!atomic_load(&owner_done) || ARRAY_WSDEQUE_LEN(&item_deque) > 0)
+    {
+        if (ARRAY_WSDEQUE_STEAL(item, &item_deque, &item))
+        {
+            atomic_fetch_add(&taken[item], 1);
+        }
+        else
+        {
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+static void test_array_wsdeque_threads(void **state __UNUSED)
+{
+    pthread_t threads[N_THIEF];
+    A_ITEM i, item;
+
+    ARRAY_WSDEQUE_INIT(&item_deque, item_buf, ITEM_BUF_NUM);
+    atomic_store(&owner_done, false);
+    for (i = 0; i < N_THIEF; ++i)
+    {
+        assert_int_equal(pthread_create(&threads[i], NULL, thief, NULL), 0);
+    }
+
+    /* Test case: Every item is taken exactly once by the owner or a thief */
+    for (i = 0; i < N_ITEM; ++i)
+    {
+        while (!ARRAY_WSDEQUE_PUSH(item, &item_deque, i))
+        {
+            if (ARRAY_WSDEQUE_POP(item, &item_deque, &item))
+            {
+                atomic_fetch_add(&taken[item], 1);
+            }
+        }
+        if (i % 3 == 0 && ARRAY_WSDEQUE_POP(item, &item_deque, &item))
+        {
+            atomic_fetch_add(&taken[item], 1);
+        }
+    }
+    while (ARRAY_WSDEQUE_POP(item, &item_deque, &item))
+    {
+        atomic_fetch_add(&taken[item], 1);
+    }
+    atomic_store(&owner_done, true);
+    for (i = 0; i < N_THIEF; ++i)
+    {
+        assert_int_equal(pthread_join(threads[i], NULL), 0);
+    }
+    for (i = 0; i < N_ITEM; ++i)
+    {
+        assert_int_equal(atomic_load(&taken[i]), 1);
+    }
+}
+
+int main(void)
+{
+    const struct CMUnitTest tests[] = {
+            cmocka_unit_test(test_array_wsdeque),
+            cmocka_unit_test(test_array_wsdeque_threads),
+    };
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,241 @@
+#include "roaring.h"
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define __UNUSED __attribute__((unused))
+
+#define ARRAY_SIZE(arr) (sizeof(arr) / sizeof((arr)[0]))
+
+/* Values are drawn from [0, N_VALUE) so that a plain bool array can serve as
+ * the reference set.
+ */
+#define N_VALUE (4 * 65536)
+
+static bool ref_a[N_VALUE];
+static bool ref_b[N_VALUE];
+
+static void validate_roaring(const ROARING *r, const bool *ref)
+{
+    uint64_t card = 0;
+    uint32_t x;
+    ROARING_ITER it;
+    roaring_iter_init(&it, r);
+    for (x = 0; x < N_VALUE; ++x)
+    {
+        if (ref[x])
+        {
+            uint32_t y;
+            assert_true(roaring_iter_next(&it, &y));
+            assert_int_equal(y, x);
+            ++card;
+        }
+    }
+    assert_false(roaring_iter_next(&it, &x));
+    assert_int_equal(roaring_cardinality(r), card);
+}
+
+/* Fill with a mix of sparse, dense and consecutive containers. */
+static void fill_roaring(ROARING *r, bool *ref, int seed)
+{
+    uint32_t x;
+    memset(ref, 0, N_VALUE);
+    srand(seed);
+    for (x = 0; x < 65536; ++x)
+    {
+        if (rand() % 64 == 0)
+        {
+            ref[x] = true;
+        }
+        if (rand() % 4 != 0)
+        {
+            ref[65536 + x] = true;
+        }
+    }
+    for (x = 2 * 65536 + 1000 + seed * 100; x < 2 * 65536 + 30000; ++x)
+    {
+        ref[x] = true;
+    }
+    ref[3 * 65536 + 7] = true;
+    for (x = 0; x < N_VALUE; ++x)
+    {
+        if (ref[x])
+        {
+            assert_true(roaring_add(r, x));
+        }
+    }
+}
+
+static void test_roaring_add_remove(void **state __UNUSED)
+{
+    ROARING r = ROARING_INITIALIZER(&r);
+    uint32_t x;
+
+    /* Test case: Empty */
+    assert_false(roaring_contains(&r, 0));
+    assert_int_equal(roaring_cardinality(&r), 0);
+
+    /* Test case: Add values across containers */
+    fill_roaring(&r, ref_a, 1);
+    validate_roaring(&r, ref_a);
+    assert_int_equal(r.ro_len, 4);
+    assert_int_equal(r.ro_container[0].rc_type, ROARING_ARRAY);
+    assert_int_equal(r.ro_container[1].rc_type, ROARING_BITMAP);
+    for (x = 0; x < N_VALUE; ++x)
+    {
+        assert_int_equal(roaring_contains(&r, x), ref_a[x]);
+    }
+
+    /* Test case: Remove until the bitmap container becomes an array */
+    for (x = 65536; x < 2 * 65536 - ROARING_ARRAY_MAX / 2; ++x)
+    {
+        assert_true(roaring_remove(&r, x));
+        ref_a[x] = false;
+    }
+    assert_int_equal(r.ro_container[1].rc_type, ROARING_ARRAY);
+    validate_roaring(&r, ref_a);
+
+    /* Test case: Remove all values of a container */
+    assert_true(roaring_remove(&r, 3 * 65536 + 7));
+    ref_a[3 * 65536 + 7] = false;
+    assert_int_equal(r.ro_len, 3);
+    validate_roaring(&r, ref_a);
+
+    roaring_free(&r);
+    assert_int_equal(roaring_cardinality(&r), 0);
+}
+
+static void test_roaring_rank_select(void **state __UNUSED)
+{
+    ROARING r = ROARING_INITIALIZER(&r);
+    fill_roaring(&r, ref_a, 2);
+    int pass;
+    for (pass = 0; pass < 2; ++pass)
+    {
+        uint64_t rank = 0;
+        uint32_t x;
+        for (x = 0; x < N_VALUE; ++x)
+        {
+            if (ref_a[x])
+            {
+                uint32_t y;
+                assert_true(roaring_select(&r, rank, &y));
+                assert_int_equal(y, x);
+                ++rank;
+            }
+            if (x % 7 == 0)
+            {
+                assert_int_equal(roaring_rank(&r, x), rank);
+            }
+        }
+        assert_false(roaring_select(&r, rank, &x));
+
+        /* Test case: Same results with run containers */
+        assert_true(roaring_run_optimize(&r));
+        assert_int_equal(r.ro_container[2].rc_type, ROARING_RUN);
+    }
+    roaring_free(&r);
+}
+
+static void test_roaring_run_optimize(void **state __UNUSED)
+{
+    ROARING r = ROARING_INITIALIZER(&r);
+    uint32_t x;
+    fill_roaring(&r, ref_a, 3);
+    assert_true(roaring_run_optimize(&r));
+    assert_int_equal(r.ro_container[0].rc_type, ROARING_ARRAY);
+    assert_int_equal(r.ro_container[1].rc_type, ROARING_BITMAP);
+    assert_int_equal(r.ro_container[2].rc_type, ROARING_RUN);
+    assert_int_equal(r.ro_container[2].rc_len, 1);
+    validate_roaring(&r, ref_a);
+    for (x = 0; x < N_VALUE; ++x)
+    {
+        assert_int_equal(roaring_contains(&r, x), ref_a[x]);
+    }
+
+    /* Test case: Modify run containers */
+    x = 2 * 65536 + 20000;
+    assert_true(roaring_remove(&r, x));
+    ref_a[x] = false;
+    assert_true(roaring_add(&r, x + 20000));
+    ref_a[x + 20000] = true;
+    validate_roaring(&r, ref_a);
+    roaring_free(&r);
+}
+
+static void test_roaring_set_op(void **state __UNUSED)
+{
+    static bool ref[N_VALUE];
+    ROARING a = ROARING_INITIALIZER(&a);
+    ROARING b = ROARING_INITIALIZER(&b);
+    ROARING r = ROARING_INITIALIZER(&r);
+    int pass;
+    uint32_t x;
+    fill_roaring(&a, ref_a, 4);
+    fill_roaring(&b, ref_b, 5);
+    /* Disjoint containers on both sides */
+    assert_true(roaring_remove(&b, 3 * 65536 + 7));
+    ref_b[3 * 65536 + 7] = false;
+    assert_true(roaring_add(&b, N_VALUE - 1));
+    ref_b[N_VALUE - 1] = true;
+
+    for (pass = 0; pass < 2; ++pass)
+    {
+        assert_true(roaring_and(&r, &a, &b));
+        for (x = 0; x < N_VALUE; ++x)
+        {
+            ref[x] = ref_a[x] && ref_b[x];
+        }
+        validate_roaring(&r, ref);
+
+        assert_true(roaring_or(&r, &a, &b));
+        for (x = 0; x < N_VALUE; ++x)
+        {
+            ref[x] = ref_a[x] || ref_b[x];
+        }
+        validate_roaring(&r, ref);
+
+        assert_true(roaring_andnot(&r, &a, &b));
+        for (x = 0; x < N_VALUE; ++x)
+        {
+            ref[x] = ref_a[x] && !ref_b[x];
+        }
+        validate_roaring(&r, ref);
+
+        assert_true(roaring_andnot(&r, &b, &a));
+        for (x = 0; x < N_VALUE; ++x)
+        {
+            ref[x] = ref_b[x] && !ref_a[x];
+        }
+        validate_roaring(&r, ref);
+
+        /* Test case: Same results with run containers */
+        assert_true(roaring_run_optimize(&a));
+        assert_true(roaring_run_optimize(&b));
+    }
+
+    /* Test case: Operations with an empty set */
+    roaring_free(&b);
+    assert_true(roaring_and(&r, &a, &b));
+    assert_int_equal(roaring_cardinality(&r), 0);
+    assert_true(roaring_or(&r, &b, &a));
+    validate_roaring(&r, ref_a);
+
+    roaring_free(&a);
+    roaring_free(&r);
+}
+
+int main(void)
+{
+    const struct CMUnitTest tests[] = {
+            cmocka_unit_test(test_roaring_add_remove),
+            cmocka_unit_test(test_roaring_rank_select),
+            cmocka_unit_test(test_roaring_run_optimize),
+            cmocka_unit_test(test_roaring_set_op),
+    };
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,157 @@
+#include "thread_pool.h"
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define __UNUSED __attribute__((unused))
+
+#define N_WORKER 4
+#define N_ITEM 1000000
+#define N_CALLER 3
+
+static THREAD_POOL pool;
+static uint32_t items[N_ITEM];
+
+typedef struct
+{
+    _Atomic uint64_t sum;
+    _Atomic uint32_t n_call;
+} SUM_CTX;
+
+static void sum_range(void *ctx, size_t lo, size_t hi)
+{
+    SUM_CTX *s = ctx;
+    uint64_t sum = 0;
+    size_t i;
+    for (i = lo; i < hi; ++i)
+    {
+        sum += items[i];
+    }
+    atomic_fetch_add(&s->sum, sum);
+    atomic_fetch_add(&s->n_call, 1);
+}
+
+static int setup(void **state __UNUSED)
+{
+    size_t i;
+    for (i = 0; i < N_ITEM; ++i)
+    {
+        items[i] = (uint32_t) (i * 2654435761u);
+    }
+    return thread_pool_init(&pool, N_WORKER) ? 0 : -1;
+}
+
+static int teardown(void **state __UNUSED)
+{
+    thread_pool_destroy(&pool);
+    return 0;
+}
+
+static uint64_t expected_sum(size_t lo, size_t hi)
+{
+    uint64_t sum = 0;
+    size_t i;
+    for (i = lo; i < hi; ++i)
+    {
+        sum += items[i];
+    }
+    return sum;
+}
+
+static void test_thread_pool_parallel_for(void **state __UNUSED)
+{
+    SUM_CTX s;
+
+    /* Test case: The subranges cover the range exactly once */
+    atomic_init(&s.sum, 0);
+    atomic_init(&s.n_call, 0);
+    thread_pool_parallel_for(&pool, 0, N_ITEM, 1000, sum_range, &s);
+    assert_true(atomic_load(&s.sum) == expected_sum(0, N_ITEM));
+    assert_true(atomic_load(&s.n_call) >= N_ITEM / 1000);
+
+    /* Test case: Empty and small ranges */
+    atomic_store(&s.sum, 0);
+    atomic_store(&s.n_call, 0);
+    thread_pool_parallel_for(&pool, 5, 5, 1, sum_range, &s);
+    assert_int_equal(atomic_load(&s.n_call), 0);
+    thread_pool_parallel_for(&pool, 7, 10, 100, sum_range, &s);
+    assert_int_equal(atomic_load(&s.n_call), 1);
+    assert_true(atomic_load(&s.sum) == expected_sum(7, 10));
+}
+
+typedef struct
+{
+    uint32_t n;
+    uint64_t result;
+} FIB;
+
+static void fib(void *arg)
+{
+    FIB *f = arg;
+    if (f->n < 2)
+    {
+        f->result = f->n;
+        return;
+    }
+    FIB a = { f->n - 1, 0 }, b = { f->n - 2, 0 };
+    thread_pool_fork2(&pool, fib, &a, fib, &b);
+    f->result = a.result + b.result;
+}
+
+static void test_thread_pool_fork2(void **state __UNUSED)
+{
+    /* Test case: Deeply nested fork-join */
+    FIB f = { 24, 0 };
+    thread_pool_run(&pool, fib, &f);
+    assert_int_equal(f.result, 46368);
+
+    /* Test case: Fork from outside the pool */
+    FIB a = { 20, 0 }, b = { 21, 0 };
+    thread_pool_fork2(&pool, fib, &a, fib, &b);
+    assert_int_equal(a.result, 6765);
+    assert_int_equal(b.result, 10946);
+}
+
+static void *caller(void *arg)
+{
+    SUM_CTX *s = arg;
+    int i;
+    for (i = 0; i < 20; ++i)
+    {
+        thread_pool_parallel_for(&pool, 0, N_ITEM / 10, 997, sum_range, s);
+    }
+    return NULL;
+}
+
+static void test_thread_pool_callers(void **state __UNUSED)
+{
+    pthread_t threads[N_CALLER];
+    SUM_CTX s[N_CALLER];
+    int i;
+
+    /* Test case: Concurrent calls from threads outside the pool */
+    for (i = 0; i < N_CALLER; ++i)
+    {
+        atomic_init(&s[i].sum, 0);
+        atomic_init(&s[i].n_call, 0);
+        assert_int_equal(pthread_create(&threads[i], NULL, caller, &s[i]), 0);
+    }
+    for (i = 0; i < N_CALLER; ++i)
+    {
+        assert_int_equal(pthread_join(threads[i], NULL), 0);
+        assert_true(atomic_load(&s[i].sum) == 20 * expected_sum(0, N_ITEM / 10));
+    }
+}
+
+int main(void)
+{
+    const struct CMUnitTest tests[] = {
+            cmocka_unit_test(test_thread_pool_parallel_for),
+            cmocka_unit_test(test_thread_pool_fork2),
+            cmocka_unit_test(test_thread_pool_callers),
+    };
+    return cmocka_run_group_tests(tests, setup, teardown);
+}
@@ -0,0 +1,196 @@
+#include "timer_wheel.h"
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define __UNUSED __attribute__((unused))
+
+#define N_TIMER 2000
+
+typedef struct
+{
+    TIMER timer;
+    uint64_t due;
+    int n_fired;
+} MY_TIMER;
+
+static MY_TIMER timers[N_TIMER];
+static TIMER_WHEEL wheel;
+static uint64_t last_due;
+static bool in_order;
+
+static void on_expire(TIMER *timer)
+{
+    MY_TIMER *t = (MY_TIMER *) timer;
+    ++t->n_fired;
+    if (t->due < last_due || t->due > wheel.tw_now)
+    {
+        in_order = false;
+    }
+    last_due = t->due;
+}
+
+static void arm(MY_TIMER *t, uint64_t expires)
+{
+    timer_wheel_arm(&wheel, &t->timer, expires);
+    t->due = (expires > wheel.tw_now ? expires : wheel.tw_now + 1);
+}
+
+static void test_timer_wheel_basic(void **state __UNUSED)
+{
+    uint64_t when;
+    MY_TIMER *t = &timers[0];
+
+    timer_wheel_init(&wheel, 1000);
+    TIMER_INIT(&t->timer, on_expire);
+    t->n_fired = 0;
+    last_due = 0;
+    in_order = true;
+    assert_false(timer_wheel_next(&wheel, &when));
+
+    /* Test case: A timer far away expires exactly on time */
+    arm(t, 1000 + 300000);
+    assert_true(TIMER_IS_ARMED(&t->timer));
+    assert_true(timer_wheel_next(&wheel, &when));
+    assert_true(when <= 1000 + 300000);
+    assert_int_equal(timer_wheel_advance(&wheel, 1000 + 299999), 0);
+    assert_int_equal(t->n_fired, 0);
+    assert_int_equal(timer_wheel_advance(&wheel, 1000 + 300000), 1);
+    assert_int_equal(t->n_fired, 1);
+    assert_false(TIMER_IS_ARMED(&t->timer));
+
+    /* Test case: Cancel */
+    arm(t, wheel.tw_now + 5);
+    timer_wheel_cancel(&wheel, &t->timer);
+    assert_false(TIMER_IS_ARMED(&t->timer));
+    assert_false(timer_wheel_next(&wheel, &when));
+    assert_int_equal(timer_wheel_advance(&wheel, wheel.tw_now + 100), 0);
+
+    /* Test case: An expired timer fires on the next tick */
+    arm(t, 0);
+    assert_int_equal(timer_wheel_advance(&wheel, wheel.tw_now), 0);
+    assert_int_equal(timer_wheel_advance(&wheel, wheel.tw_now + 1), 1);
+
+    /* Test case: Far future beyond the lower levels */
+    arm(t, UINT64_MAX - 1);
+    assert_int_equal(timer_wheel_advance(&wheel, UINT64_MAX - 2), 0);
+    assert_int_equal(timer_wheel_advance(&wheel, UINT64_MAX - 1), 1);
+    assert_true(in_order);
+}
+
+static void test_timer_wheel_random(void **state __UNUSED)
+{
+    int i, step;
+    uint64_t now = 12345;
+
+    timer_wheel_init(&wheel, now);
+    srand(3);
+    for (i = 0; i < N_TIMER; ++i)
+    {
+        TIMER_INIT(&timers[i].timer, on_expire);
+        timers[i].n_fired = 0;
+    }
+    last_due = 0;
+    in_order = true;
+
+    for (step = 0; step < 3000; ++step)
+    {
+        for (i = 0; i < 20; ++i)
+        {
+            MY_TIMER *t = &timers[rand() % N_TIMER];
+            int op = rand() % 10;
+            if (op == 0)
+            {
+                timer_wheel_cancel(&wheel, &t->timer);
+            }
+            else
+            {
+                /* Mix near and far timeouts, and a few in the past */
+                uint64_t delta = (op < 6 ? (uint64_t) (rand() % 100)
+                        : (uint64_t) rand() * (uint64_t) (rand() % 64 + 1));
+                arm(t, op == 9 ? now - 1 : now + delta);
+            }
+        }
+
+        /* Advance by a tick, a little or a lot */
+        switch (rand() % 3)
+        {
+        case 0: now += 1; break;
+        case 1: now += rand() % 200; break;
+        default: now += (uint64_t) rand() * 16; break;
+        }
+        last_due = 0;
+        timer_wheel_advance(&wheel, now);
+
+        /* Every armed timer is due later; every due timer has fired */
+        for (i = 0; i < N_TIMER; ++i)
+        {
+            if (TIMER_IS_ARMED(&timers[i].timer))
+            {
+                assert_true(timers[i].due > now);
+            }
+        }
+        assert_true(in_order);
+    }
+
+    for (i = 0; i < N_TIMER; ++i)
+    {
+        timer_wheel_cancel(&wheel, &timers[i].timer);
+    }
+    uint64_t when;
+    assert_false(timer_wheel_next(&wheel, &when));
+    for (i = 0; i < TIMER_WHEEL_LEVELS; ++i)
+    {
+        assert_int_equal(wheel.tw_occupied[i], 0);
+    }
+}
+
+static MY_TIMER *periodic;
+static int n_periodic;
+
+static void on_periodic(TIMER *timer)
+{
+    /* Re-arm and cancel from the callback */
+    ++n_periodic;
+    timer_wheel_arm(&wheel, timer, wheel.tw_now + 10);
+    timer_wheel_cancel(&wheel, &timers[1].timer);
+}
+
+static void test_timer_wheel_rearm(void **state __UNUSED)
+{
+    timer_wheel_init(&wheel, 0);
+    periodic = &timers[0];
+    TIMER_INIT(&periodic->timer, on_periodic);
+    TIMER_INIT(&timers[1].timer, on_expire);
+    TIMER_INIT(&timers[2].timer, on_expire);
+    n_periodic = 0;
+
+    timer_wheel_arm(&wheel, &periodic->timer, 10);
+    timer_wheel_arm(&wheel, &timers[1].timer, 10);
+    timer_wheel_arm(&wheel, &timers[2].timer, 10);
+    timers[1].n_fired = timers[2].n_fired = 0;
+    last_due = 0;
+    in_order = true;
+    timers[2].due = 10;
+
+    /* Test case: A periodic timer fires once per period across a long jump */
+    timer_wheel_advance(&wheel, 1000);
+    assert_int_equal(n_periodic, 100);
+    assert_true(TIMER_IS_ARMED(&periodic->timer));
+    assert_int_equal(timers[2].n_fired, 1);
+    assert_true(timers[1].n_fired <= 1);
+    assert_false(TIMER_IS_ARMED(&timers[1].timer));
+}
+
+int main(void)
+{
+    const struct CMUnitTest tests[] = {
+            cmocka_unit_test(test_timer_wheel_basic),
+            cmocka_unit_test(test_timer_wheel_random),
+            cmocka_unit_test(test_timer_wheel_rearm),
+    };
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,333 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016 Kuan-Chung Huang
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#include "thread_pool.h"
+#include <stdlib.h>
+#include <sched.h>
+
+#define STEAL_ROUNDS 64
+
+ARRAY_WSDEQUE_GEN_PROTO(task, THREAD_POOL_DEQUE, THREAD_POOL_TASK *)
+ARRAY_WSDEQUE_GEN(task, THREAD_POOL_DEQUE, THREAD_POOL_TASK *)
+
+static _Thread_local THREAD_POOL_WORKER *current_worker;
+
+static uint32_t next_rand(THREAD_POOL_WORKER *w)
+{
+    /* xorshift64 */
+    w->tpw_rand ^= w->tpw_rand << 13;
+    w->tpw_rand ^= w->tpw_rand >> 7;
+    w->tpw_rand ^= w->tpw_rand << 17;
+    return (uint32_t) (w->tpw_rand >> 32);
+}
+
+static void run_task(THREAD_POOL_TASK *task)
+{
+    task->tpt_func(task->tpt_arg);
+    atomic_store_explicit(&task->tpt_done, true, memory_order_release);
+}
+
+static void wake_workers(THREAD_POOL *pool)
+{
+    atomic_fetch_add(&pool->tp_epoch, 1);
+    if (atomic_load(&pool->tp_sleepers) != 0)
+    {
+        pthread_mutex_lock(&pool->tp_lock);
+        pthread_cond_broadcast(&pool->tp_wake);
+        pthread_mutex_unlock(&pool->tp_lock);
+    }
+}
+
+static bool find_task(THREAD_POOL_WORKER *w, THREAD_POOL_TASK **ptask)
+{
+    THREAD_POOL *pool = w->tpw_pool;
+    uint32_t i;
+
+    if (ARRAY_WSDEQUE_POP(task, &w->tpw_deque, ptask))
+    {
+        return true;
+    }
+    /* Steal from random victims. */
+    for (i = 0; i < pool->tp_nworker; ++i)
+    {
+        THREAD_POOL_WORKER *victim = &pool->tp_worker[next_rand(w) % pool->tp_nworker];
+        if (victim != w && ARRAY_WSDEQUE_STEAL(task, &victim->tpw_deque, ptask))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool take_inbox(THREAD_POOL *pool, THREAD_POOL_TASK **ptask)
+{
+    bool ret;
+    pthread_mutex_lock(&pool->tp_lock);
+    ARRAY_QUEUE_DEQUEUE_RET(&pool->tp_inbox, ptask, ret);
+    pthread_mutex_unlock(&pool->tp_lock);
+    return ret;
+}
+
+static void *worker_main(void *arg)
+{
+    THREAD_POOL_WORKER *w = arg;
+    THREAD_POOL *pool = w->tpw_pool;
+    THREAD_POOL_TASK *task;
+    uint32_t round;
+
+    current_worker = w;
+    while (!atomic_load(&pool->tp_stop))
+    {
+        uint32_t epoch = atomic_load(&pool->tp_epoch);
+        bool found = false;
+        for (round = 0; round < STEAL_ROUNDS && !found; ++round)
+        {
+            found = find_task(w, &task);
+        }
+        if (found)
+        {
+            run_task(task);
+            continue;
+        }
+        if (take_inbox(pool, &task))
+        {
+            /* The caller waits on tp_done, so complete under the lock. */
+            task->tpt_func(task->tpt_arg);
+            pthread_mutex_lock(&pool->tp_lock);
+            atomic_store_explicit(&task->tpt_done, true, memory_order_release);
+            pthread_cond_broadcast(&pool->tp_done);
+            pthread_mutex_unlock(&pool->tp_lock);
+            continue;
+        }
+
+        /* Sleep until new work is published. */
+        pthread_mutex_lock(&pool->tp_lock);
+        atomic_fetch_add(&pool->tp_sleepers, 1);
+        if (atomic_load(&pool->tp_epoch) == epoch && !atomic_load(&pool->tp_stop)
+                && ARRAY_QUEUE_IS_EMPTY(&pool->tp_inbox))
+        {
+            pthread_cond_wait(&pool->tp_wake, &pool->tp_lock);
+        }
+        atomic_fetch_sub(&pool->tp_sleepers, 1);
+        pthread_mutex_unlock(&pool->tp_lock);
+    }
+    current_worker = NULL;
+    return NULL;
+}
+
+bool thread_pool_init(THREAD_POOL *pool, uint32_t nworker)
+{
+    uint32_t i;
+
+    if (nworker == 0)
+    {
+        return false;
+    }
+    pool->tp_worker = malloc(nworker * sizeof(THREAD_POOL_WORKER));
+    if (pool->tp_worker == NULL)
+    {
+        return false;
+    }
+    pool->tp_nworker = nworker;
+    atomic_init(&pool->tp_stop, false);
+    atomic_init(&pool->tp_epoch, 0);
+    atomic_init(&pool->tp_sleepers, 0);
+    pthread_mutex_init(&pool->tp_lock, NULL);
+    pthread_cond_init(&pool->tp_wake, NULL);
+    pthread_cond_init(&pool->tp_done, NULL);
+    ARRAY_QUEUE_INIT(&pool->tp_inbox, pool->tp_inbox_buf, THREAD_POOL_INBOX_SIZE);
+
+    for (i = 0; i < nworker; ++i)
+    {
+        THREAD_POOL_WORKER *w = &pool->tp_worker[i];
+        ARRAY_WSDEQUE_INIT(&w->tpw_deque, w->tpw_buf, THREAD_POOL_DEQUE_SIZE);
+        w->tpw_pool = pool;
+        w->tpw_rand = 0x9e3779b97f4a7c15ULL * (i + 1);
+    }
+    for (i = 0; i < nworker; ++i)
+    {
+        if (pthread_create(&pool->tp_worker[i].tpw_thread, NULL, worker_main,
+                &pool->tp_worker[i]) != 0)
+        {
+            pool->tp_nworker = i;
+            thread_pool_destroy(pool);
+            return false;
+        }
+    }
+    return true;
+}
+
+void thread_pool_destroy(THREAD_POOL *pool)
+{
+    uint32_t i;
+
+    atomic_store(&pool->tp_stop, true);
+    pthread_mutex_lock(&pool->tp_lock);
+    pthread_cond_broadcast(&pool->tp_wake);
+    pthread_mutex_unlock(&pool->tp_lock);
+    for (i = 0; i < pool->tp_nworker; ++i)
+    {
+        pthread_join(pool->tp_worker[i].tpw_thread, NULL);
+    }
+    pthread_cond_destroy(&pool->tp_done);
+    pthread_cond_destroy(&pool->tp_wake);
+    pthread_mutex_destroy(&pool->tp_lock);
+    free(pool->tp_worker);
+    pool->tp_worker = NULL;
+    pool->tp_nworker = 0;
+}
+
+void thread_pool_run(THREAD_POOL *pool, void (*func)(void *), void *arg)
+{
+    THREAD_POOL_TASK task;
+    bool ret = false;
+
+    if (current_worker != NULL && current_worker->tpw_pool == pool)
+    {
+        func(arg);
+        return;
+    }
+    task.tpt_func = func;
+    task.tpt_arg = arg;
+    atomic_init(&task.tpt_done, false);
+
+    pthread_mutex_lock(&pool->tp_lock);
+    while (!ret)
+    {
+        ARRAY_QUEUE_ENQUEUE_RET(&pool->tp_inbox, &task, ret);
+        if (!ret)
+        {
+            pthread_cond_wait(&pool->tp_done, &pool->tp_lock);
+        }
+    }
+    pthread_mutex_unlock(&pool->tp_lock);
+    wake_workers(pool);
+
+    pthread_mutex_lock(&pool->tp_lock);
+    while (!atomic_load_explicit(&task.tpt_done, memory_order_acquire))
+    {
+        pthread_cond_wait(&pool->tp_done, &pool->tp_lock);
+    }
+    pthread_mutex_unlock(&pool->tp_lock);
+}
+
+typedef struct
+{
+    THREAD_POOL *pool;
+    void (*func_a)(void *);
+    void *arg_a;
+    void (*func_b)(void *);
+    void *arg_b;
+} FORK2_ARGS;
+
+static void fork2_from_outside(void *arg)
+{
+    FORK2_ARGS *f = arg;
+    thread_pool_fork2(f->pool, f->func_a, f->arg_a, f->func_b, f->arg_b);
+}
+
+void thread_pool_fork2(THREAD_POOL *pool, void (*func_a)(void *), void *arg_a,
+        void (*func_b)(void *), void *arg_b)
+{
+    THREAD_POOL_WORKER *w = current_worker;
+    THREAD_POOL_TASK task_b;
+    THREAD_POOL_TASK *task;
+
+    if (w == NULL || w->tpw_pool != pool)
+    {
+        FORK2_ARGS f = { pool, func_a, arg_a, func_b, arg_b };
+        thread_pool_run(pool, fork2_from_outside, &f);
+        return;
+    }
+
+    task_b.tpt_func = func_b;
+    task_b.tpt_arg = arg_b;
+    atomic_init(&task_b.tpt_done, false);
+    if (!ARRAY_WSDEQUE_PUSH(task, &w->tpw_deque, &task_b))
+    {
+        /* Deque full: run sequentially. */
+        func_a(arg_a);
+        func_b(arg_b);
+        return;
+    }
+    wake_workers(pool);
+
+    func_a(arg_a);
+
+    /* Forks nested in func_a have been joined, so task_b is on top of the
+     * deque unless it was stolen. */
+    if (ARRAY_WSDEQUE_POP(task, &w->tpw_deque, &task))
+    {
+        run_task(task);
+        return;
+    }
+    /* Help with other work while the thief runs task_b. */
+    while (!atomic_load_explicit(&task_b.tpt_done, memory_order_acquire))
+    {
+        if (find_task(w, &task))
+        {
+            run_task(task);
+        }
+        else
+        {
+            sched_yield();
+        }
+    }
+}
+
+typedef struct
+{
+    THREAD_POOL *pool;
+    size_t lo;
+    size_t hi;
+    size_t grain;
+    void (*body)(void *ctx, size_t lo, size_t hi);
+    void *ctx;
+} PARALLEL_FOR_RANGE;
+
+static void parallel_for_range(void *arg)
+{
+    PARALLEL_FOR_RANGE *r = arg;
+    if (r->hi - r->lo <= r->grain)
+    {
+        r->body(r->ctx, r->lo, r->hi);
+        return;
+    }
+    size_t mid = r->lo + (r->hi - r->lo) / 2;
+    PARALLEL_FOR_RANGE left = *r, right = *r;
+    left.hi = mid;
+    right.lo = mid;
+    thread_pool_fork2(r->pool, parallel_for_range, &left, parallel_for_range, &right);
+}
+
+void thread_pool_parallel_for(THREAD_POOL *pool, size_t begin, size_t end,
+        size_t grain, void (*body)(void *ctx, size_t lo, size_t hi), void *ctx)
+{
+    PARALLEL_FOR_RANGE r = { pool, begin, end, grain < 1 ? 1 : grain, body, ctx };
+    if (begin >= end)
+    {
+        return;
+    }
+    thread_pool_run(pool, parallel_for_range, &r);
+}
@@ -0,0 +1,149 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016 Kuan-Chung Huang
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#ifndef THREAD_POOL_H_
+#define THREAD_POOL_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include "array_queue.h"
+#include "array_wsdeque.h"
+
+/**
+ * @defgroup thread_pool Thread pool
+ * @ingroup array_utils
+ *
+ * @brief A small work-stealing thread pool for fork-join parallelism.
+ *
+ * Each worker owns a #ARRAY_WSDEQUE_TYPE deque. #thread_pool_fork2 pushes one
+ * half of the work onto the caller's deque and runs the other half; idle
+ * workers steal from random victims. #thread_pool_parallel_for splits an
+ * index range recursively on top of it, e.g. to sum an array map:
+ * @code
+ * static void sum_range(void *ctx, size_t lo, size_t hi) { ... }
+ * thread_pool_parallel_for(&pool, 0, map.am_len, 4096, sum_range, &ctx);
+ * @endcode
+ * Calls from threads outside the pool are handed to a worker through a
+ * mutex-guarded queue and block until done.
+ *
+ * Workers and threads are allocated by \c malloc and \c pthread_create.
+ * @{
+ */
+/**@brief Number of tasks a worker deque holds. Forks beyond it run inline. */
+#define THREAD_POOL_DEQUE_SIZE 256
+
+/**@brief Number of pending calls from threads outside the pool. */
+#define THREAD_POOL_INBOX_SIZE 64
+
+/**@brief Forked task. */
+typedef struct
+{
+    void (*tpt_func)(void *arg);
+    void *tpt_arg;
+    _Atomic bool tpt_done;
+} THREAD_POOL_TASK;
+
+ARRAY_WSDEQUE_TYPE(THREAD_POOL_DEQUE, THREAD_POOL_TASK *);
+ARRAY_QUEUE_TYPE_8(THREAD_POOL_INBOX, THREAD_POOL_TASK *);
+
+struct THREAD_POOL_;
+
+/**@brief Worker of a thread pool. */
+typedef struct
+{
+    THREAD_POOL_DEQUE tpw_deque;
+    THREAD_POOL_TASK *tpw_buf[THREAD_POOL_DEQUE_SIZE];
+    struct THREAD_POOL_ *tpw_pool;
+    pthread_t tpw_thread;
+    uint64_t tpw_rand;
+} THREAD_POOL_WORKER;
+
+/**@brief Thread pool. */
+typedef struct THREAD_POOL_
+{
+    THREAD_POOL_WORKER *tp_worker;
+    uint32_t tp_nworker;
+    _Atomic bool tp_stop;
+    /* Idle workers sleep until the epoch changes. */
+    _Atomic uint32_t tp_epoch;
+    _Atomic uint32_t tp_sleepers;
+    pthread_mutex_t tp_lock;
+    pthread_cond_t tp_wake;
+    pthread_cond_t tp_done;
+    THREAD_POOL_INBOX tp_inbox;
+    THREAD_POOL_TASK *tp_inbox_buf[THREAD_POOL_INBOX_SIZE];
+} THREAD_POOL;
+
+/**
+ * @brief Start a thread pool.
+ * @param pool  Pointer to the thread pool.
+ * @param nworker  Number of worker threads, at least 1.
+ * @return  \c true if successful; otherwise, \c false.
+ */
+bool thread_pool_init(THREAD_POOL *pool, uint32_t nworker);
+
+/**
+ * @brief Stop the workers and free a thread pool. No call may be pending.
+ * @param pool  Pointer to the thread pool.
+ */
+void thread_pool_destroy(THREAD_POOL *pool);
+
+/**
+ * @brief Run a function on a worker and wait for it.
+ *
+ * Called from a worker of \a pool, the function runs inline.
+ * @param pool  Pointer to the thread pool.
+ * @param func  Function to run.
+ * @param arg  Argument of \a func.
+ */
+void thread_pool_run(THREAD_POOL *pool, void (*func)(void *), void *arg);
+
+/**
+ * @brief Run two functions in parallel and wait for both.
+ *
+ * \a func_b is made available for stealing while the caller runs \a func_a.
+ * It may be nested to any depth.
+ * @param pool  Pointer to the thread pool.
+ */
+void thread_pool_fork2(THREAD_POOL *pool, void (*func_a)(void *), void *arg_a,
+        void (*func_b)(void *), void *arg_b);
+
+/**
+ * @brief Call \a body over disjoint subranges covering [begin, end) in
+ * parallel, and wait for all of them.
+ * @param pool  Pointer to the thread pool.
+ * @param begin  First index.
+ * @param end  One past the last index.
+ * @param grain  Largest subrange not split further, at least 1.
+ * @param body  Function called with \a ctx and a subrange [lo, hi).
+ * @param ctx  Context of \a body.
+ */
+void thread_pool_parallel_for(THREAD_POOL *pool, size_t begin, size_t end,
+        size_t grain, void (*body)(void *ctx, size_t lo, size_t hi), void *ctx);
+/** @} */
+
+#endif /* THREAD_POOL_H_ */
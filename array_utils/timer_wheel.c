@@ -0,0 +1,169 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016 Kuan-Chung Huang
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#include "timer_wheel.h"
+#include <stddef.h>
+
+#define SLOT_MASK (TIMER_WHEEL_SLOTS - 1)
+
+static inline uint32_t digit(uint64_t t, uint32_t level)
+{
+    return (uint32_t) (t >> (level * TIMER_WHEEL_BITS)) & SLOT_MASK;
+}
+
+static void bucket_link(TIMER_WHEEL *tw, TIMER *timer, uint32_t bucket)
+{
+    TIMER **head = &tw->tw_bucket[bucket];
+    timer->tm_next = *head;
+    if (*head != NULL)
+    {
+        (*head)->tm_pprev = &timer->tm_next;
+    }
+    timer->tm_pprev = head;
+    *head = timer;
+    timer->tm_bucket = (uint16_t) bucket;
+    tw->tw_occupied[bucket / TIMER_WHEEL_SLOTS] |= 1ULL << (bucket & SLOT_MASK);
+}
+
+static void place(TIMER_WHEEL *tw, TIMER *timer)
+{
+    /* Place by the highest 6-bit group where the expiry time and the current
+     * time differ; the lower groups are resolved by cascading. */
+    uint64_t e = timer->tm_expires > tw->tw_now ? timer->tm_expires : tw->tw_now + 1;
+    uint32_t level = (uint32_t) (63 - __builtin_clzll(e ^ tw->tw_now)) / TIMER_WHEEL_BITS;
+    bucket_link(tw, timer, level * TIMER_WHEEL_SLOTS + digit(e, level));
+}
+
+void timer_wheel_init(TIMER_WHEEL *tw, uint64_t now)
+{
+    uint32_t i;
+    for (i = 0; i < TIMER_WHEEL_LEVELS * TIMER_WHEEL_SLOTS; ++i)
+    {
+        tw->tw_bucket[i] = NULL;
+    }
+    for (i = 0; i < TIMER_WHEEL_LEVELS; ++i)
+    {
+        tw->tw_occupied[i] = 0;
+    }
+    tw->tw_now = now;
+}
+
+void timer_wheel_cancel(TIMER_WHEEL *tw, TIMER *timer)
+{
+    if (!TIMER_IS_ARMED(timer))
+    {
+        return;
+    }
+    uint32_t bucket = timer->tm_bucket;
+    *timer->tm_pprev = timer->tm_next;
+    if (timer->tm_next != NULL)
+    {
+        timer->tm_next->tm_pprev = timer->tm_pprev;
+    }
+    if (tw->tw_bucket[bucket] == NULL)
+    {
+        tw->tw_occupied[bucket / TIMER_WHEEL_SLOTS] &= ~(1ULL << (bucket & SLOT_MASK));
+    }
+    timer->tm_next = NULL;
+    timer->tm_pprev = NULL;
+    timer->tm_bucket = TIMER_NO_BUCKET;
+}
+
+void timer_wheel_arm(TIMER_WHEEL *tw, TIMER *timer, uint64_t expires)
+{
+    timer_wheel_cancel(tw, timer);
+    timer->tm_expires = expires;
+    place(tw, timer);
+}
+
+static bool next_bucket(const TIMER_WHEEL *tw, uint64_t *when, uint32_t *bucket)
+{
+    /* Buckets of a level are all due before any bucket of the levels above,
+     * so the first occupied bucket after the current one in the lowest level
+     * comes next. */
+    uint32_t level;
+    for (level = 0; level < TIMER_WHEEL_LEVELS; ++level)
+    {
+        uint32_t d = digit(tw->tw_now, level);
+        uint64_t later = (d == SLOT_MASK ? 0 : tw->tw_occupied[level] & (~0ULL << (d + 1)));
+        if (later != 0)
+        {
+            uint32_t shift = level * TIMER_WHEEL_BITS;
+            uint32_t slot = (uint32_t) __builtin_ctzll(later);
+            uint64_t base = (shift + TIMER_WHEEL_BITS >= 64 ? 0
+                    : tw->tw_now & (~0ULL << (shift + TIMER_WHEEL_BITS)));
+            *when = base + ((uint64_t) slot << shift);
+            *bucket = level * TIMER_WHEEL_SLOTS + slot;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool timer_wheel_next(const TIMER_WHEEL *tw, uint64_t *when)
+{
+    uint32_t bucket;
+    return next_bucket(tw, when, &bucket);
+}
+
+uint32_t timer_wheel_advance(TIMER_WHEEL *tw, uint64_t now)
+{
+    uint32_t n_expired = 0;
+    uint64_t when;
+    uint32_t bucket;
+
+    while (next_bucket(tw, &when, &bucket) && when <= now)
+    {
+        /* Detach the bucket so the callbacks may arm timers into it. */
+        TIMER *list = tw->tw_bucket[bucket];
+        tw->tw_bucket[bucket] = NULL;
+        tw->tw_occupied[bucket / TIMER_WHEEL_SLOTS] &= ~(1ULL << (bucket & SLOT_MASK));
+        list->tm_pprev = &list;
+        tw->tw_now = when;
+
+        while (list != NULL)
+        {
+            TIMER *timer = list;
+            list = timer->tm_next;
+            if (list != NULL)
+            {
+                list->tm_pprev = &list;
+            }
+            timer->tm_next = NULL;
+            timer->tm_pprev = NULL;
+            if (timer->tm_expires <= when)
+            {
+                timer->tm_bucket = TIMER_NO_BUCKET;
+                ++n_expired;
+                timer->tm_func(timer);
+            }
+            else
+            {
+                place(tw, timer);
+            }
+        }
+    }
+    tw->tw_now = now;
+    return n_expired;
+}
@@ -0,0 +1,135 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016 Kuan-Chung Huang
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#ifndef TIMER_WHEEL_H_
+#define TIMER_WHEEL_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * @defgroup timer_wheel Timer wheel
+ * @ingroup array_utils
+ *
+ * @brief A hierarchical timing wheel with O(1) arm and cancel.
+ *
+ * The wheel has #TIMER_WHEEL_LEVELS levels of #TIMER_WHEEL_SLOTS buckets. A
+ * level-L bucket covers 64^L ticks, and a timer goes to the lowest level whose
+ * bucket holds its expiry time relative to the current time. When the current
+ * time reaches a bucket above level 0, its timers cascade to lower levels.
+ * Level-0 buckets expire as a batch.
+ *
+ * Timers are linked into the buckets intrusively, so the wheel never
+ * allocates. A bitmap of occupied buckets per level lets
+ * #timer_wheel_advance jump over idle periods instead of stepping every tick.
+ * @{
+ */
+#define TIMER_WHEEL_BITS    6
+#define TIMER_WHEEL_SLOTS   (1 << TIMER_WHEEL_BITS)
+#define TIMER_WHEEL_LEVELS  11
+
+/**@brief Bucket of a timer not armed. */
+#define TIMER_NO_BUCKET UINT16_MAX
+
+/**@brief Timer. */
+typedef struct TIMER_
+{
+    struct TIMER_ *tm_next;
+    struct TIMER_ **tm_pprev;
+    uint64_t tm_expires;
+    void (*tm_func)(struct TIMER_ *timer);
+    uint16_t tm_bucket;
+} TIMER;
+
+/**@brief Timing wheel. */
+typedef struct
+{
+    TIMER *tw_bucket[TIMER_WHEEL_LEVELS * TIMER_WHEEL_SLOTS];
+    uint64_t tw_occupied[TIMER_WHEEL_LEVELS];
+    uint64_t tw_now;
+} TIMER_WHEEL;
+
+/**
+ * @brief Initialize a timer.
+ * @param timer  Pointer to the timer.
+ * @param func  Function called with the timer when it expires. The timer is
+ * no longer armed then, and may be armed again.
+ */
+#define TIMER_INIT(timer, func) \
+do { \
+    (timer)->tm_next = NULL; \
+    (timer)->tm_pprev = NULL; \
+    (timer)->tm_func = (func); \
+    (timer)->tm_bucket = TIMER_NO_BUCKET; \
+} while (0)
+
+/**@brief Whether a timer is armed. */
+#define TIMER_IS_ARMED(timer) ((timer)->tm_bucket != TIMER_NO_BUCKET)
+
+/**
+ * @brief Initialize a timing wheel.
+ * @param tw  Pointer to the timing wheel.
+ * @param now  Current time in ticks.
+ */
+void timer_wheel_init(TIMER_WHEEL *tw, uint64_t now);
+
+/**
+ * @brief Arm a timer, or re-arm it if already armed.
+ *
+ * A timer whose expiry time is not after the current time expires on the
+ * next tick.
+ * @param tw  Pointer to the timing wheel.
+ * @param timer  Pointer to the timer.
+ * @param expires  Expiry time in ticks.
+ */
+void timer_wheel_arm(TIMER_WHEEL *tw, TIMER *timer, uint64_t expires);
+
+/**
+ * @brief Cancel a timer. Nothing happens if it is not armed.
+ * @param tw  Pointer to the timing wheel.
+ * @param timer  Pointer to the timer.
+ */
+void timer_wheel_cancel(TIMER_WHEEL *tw, TIMER *timer);
+
+/**
+ * @brief Advance the current time and run the expired timers.
+ * @param tw  Pointer to the timing wheel.
+ * @param now  New current time in ticks, not before the current time.
+ * @return  Number of expired timers.
+ */
+uint32_t timer_wheel_advance(TIMER_WHEEL *tw, uint64_t now);
+
+/**
+ * @brief Time the wheel has to be advanced to for its next bucket to be
+ * processed, e.g. to decide how long to sleep.
+ *
+ * No timer expires before it, but the bucket may only cascade.
+ * @param tw  Pointer to the timing wheel.
+ * @param when  Pointer to the returned time.
+ * @return  \c false if no timer is armed; otherwise, \c true.
+ */
+bool timer_wheel_next(const TIMER_WHEEL *tw, uint64_t *when);
+/** @} */
+
+#endif /* TIMER_WHEEL_H_ */
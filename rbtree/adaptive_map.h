@@ -0,0 +1,280 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016 Kuan-Chung Huang
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#ifndef ADAPTIVE_MAP_H_
+#define ADAPTIVE_MAP_H_
+
+#include "rbtree.h"
+
+/* An ordered map of intrusive nodes that is a sorted array of pointers while
+ * small and a red black tree while large.
+ *
+ * The array is searched by binary search without touching the nodes other
+ * than the probed ones, and costs no rebalancing. When an insertion finds the
+ * array holding adm_hi nodes, all nodes are moved into the tree. When a
+ * removal leaves the tree with adm_lo nodes, they are moved back into the
+ * array. adm_lo is less than adm_hi, so that the array always has room for
+ * them and a map of a size near the thresholds does not migrate back and
+ * forth. Migration keeps the order of
+ * nodes, so iteration sees the same sequence in both modes.
+ *
+ * Like RB_INSERT, insertion returns the node already in the map with an equal
+ * key instead of inserting a duplicate.
+ */
+
+typedef struct ADAPTIVE_MAP_ITER_
+{
+    uint32_t adm_index;
+    RB_NODE *adm_node;
+} ADAPTIVE_MAP_ITER;
+
+#define ADAPTIVE_MAP_TYPE(name, type) \
+typedef struct \
+{ \
+    type **adm_item; \
+    uint32_t adm_len; \
+    uint32_t adm_lo; \
+    uint32_t adm_hi; \
+    bool adm_is_tree; \
+    RB_ROOT adm_root; \
+} name
+
+#define _ADAPTIVE_MAP_NO_RET(ret, val)
+#define _ADAPTIVE_MAP_RET(ret, val) ((ret) = (val))
+
+#define _ADAPTIVE_MAP_INIT_IMPL(map, buf, lo, hi, ret_func, ret) \
+do { \
+    uint32_t lo_ = (lo); \
+    uint32_t hi_ = (hi); \
+    (map)->adm_item = (buf); \
+    (map)->adm_len = 0; \
+    (map)->adm_lo = (lo_ < hi_ ? lo_ : (hi_ > 0 ? hi_ - 1 : 0)); \
+    (map)->adm_hi = hi_; \
+    (map)->adm_is_tree = false; \
+    RB_ROOT_INIT(&(map)->adm_root); \
+    ret_func(ret, lo_ < hi_); \
+} while (0)
+
+/* buf holds at least hi pointers. lo is clamped to hi - 1 if not less than
+ * hi; ADAPTIVE_MAP_INIT_RET sets ret to false in that case. */
+#define ADAPTIVE_MAP_INIT(map, buf, lo, hi) \
+    _ADAPTIVE_MAP_INIT_IMPL(map, buf, lo, hi, _ADAPTIVE_MAP_NO_RET,)
+#define ADAPTIVE_MAP_INIT_RET(map, buf, lo, hi, ret) \
+    _ADAPTIVE_MAP_INIT_IMPL(map, buf, lo, hi, _ADAPTIVE_MAP_RET, ret)
+
+#define ADAPTIVE_MAP_LEN(map) ((map)->adm_len)
+#define ADAPTIVE_MAP_IS_TREE(map) ((map)->adm_is_tree)
+
+#define ADAPTIVE_MAP_INSERT(name, map, node) name##_adaptive_map_insert(map, node)
+#define ADAPTIVE_MAP_REMOVE(name, map, key) name##_adaptive_map_remove(map, key)
+#define ADAPTIVE_MAP_FIND(name, map, key) name##_adaptive_map_find(map, key)
+#define ADAPTIVE_MAP_FIRST(name, map, iter) name##_adaptive_map_first(map, iter)
+#define ADAPTIVE_MAP_NEXT(name, map, iter) name##_adaptive_map_next(map, iter)
+
+#define ADAPTIVE_MAP_GENERATE_BSEARCH_IMPL(fname, map_type, arg_type, cmp) \
+static inline bool fname(map_type *map, arg_type arg, uint32_t *index) \
+{ \
+    int low = 0; \
+    int high = map->adm_len - 1; \
+    while (low <= high) \
+    { \
+        int med = (low + high) / 2; \
+        int c = cmp(arg, map->adm_item[med]); \
+        if (c > 0) \
+        { \
+            low = med + 1; \
+        } \
+        else if (c < 0) \
+        { \
+            high = med - 1; \
+        } \
+        else \
+        { \
+            *index = med; \
+            return true; \
+        } \
+    } \
+    *index = low; \
+    return false; \
+}
+
+#define ADAPTIVE_MAP_GENERATE_MIGRATE(name, map_type, type, field) \
+static RB_NODE *name##_adaptive_map_build_next(void *arg) \
+{ \
+    type ***item = arg; \
+    return &(*(*item)++)->field; \
+} \
+static void name##_adaptive_map_to_tree(map_type *map) \
+{ \
+    /* The items are sorted, so link them in O(n) without comparing. */ \
+    type **item = map->adm_item; \
+    RB_ROOT_INIT(&map->adm_root); \
+    rb_build_sorted_next(&map->adm_root, name##_adaptive_map_build_next, \
+            &item, map->adm_len); \
+    map->adm_is_tree = true; \
+} \
+static void name##_adaptive_map_to_array(map_type *map) \
+{ \
+    uint32_t i = 0; \
+    RB_NODE *node; \
+    for (node = rb_first(&map->adm_root); node != NULL; node = rb_next(node)) \
+    { \
+        map->adm_item[i++] = RB_ENTRY(node, type, field); \
+    } \
+    RB_ROOT_INIT(&map->adm_root); \
+    map->adm_is_tree = false; \
+}
+
+#define ADAPTIVE_MAP_GENERATE_INSERT_PROTO(name, map_type, type) \
+type *name##_adaptive_map_insert(map_type *map, type *node)
+#define ADAPTIVE_MAP_GENERATE_INSERT(name, map_type, type) \
+ADAPTIVE_MAP_GENERATE_INSERT_PROTO(name, map_type, type) \
+{ \
+    type *ret; \
+    if (!map->adm_is_tree) \
+    { \
+        uint32_t index; \
+        if (name##_adaptive_map_bsearch_node(map, node, &index)) \
+        { \
+            return map->adm_item[index]; \
+        } \
+        if (map->adm_len < map->adm_hi) \
+        { \
+            uint32_t i; \
+            for (i = map->adm_len; i > index; --i) \
+            { \
+                map->adm_item[i] = map->adm_item[i - 1]; \
+            } \
+            map->adm_item[index] = node; \
+            ++map->adm_len; \
+            return node; \
+        } \
+        name##_adaptive_map_to_tree(map); \
+    } \
+    ret = RB_INSERT(name, &map->adm_root, node); \
+    if (ret == node) \
+    { \
+        ++map->adm_len; \
+    } \
+    return ret; \
+}
+
+#define ADAPTIVE_MAP_GENERATE_REMOVE_PROTO(name, map_type, key_type, type) \
+type *name##_adaptive_map_remove(map_type *map, key_type key)
+#define ADAPTIVE_MAP_GENERATE_REMOVE(name, map_type, key_type, type) \
+ADAPTIVE_MAP_GENERATE_REMOVE_PROTO(name, map_type, key_type, type) \
+{ \
+    type *node = NULL; \
+    if (!map->adm_is_tree) \
+    { \
+        uint32_t index; \
+        if (name##_adaptive_map_bsearch(map, key, &index)) \
+        { \
+            uint32_t i; \
+            node = map->adm_item[index]; \
+            for (i = index; i < map->adm_len - 1; ++i) \
+            { \
+                map->adm_item[i] = map->adm_item[i + 1]; \
+            } \
+            --map->adm_len; \
+        } \
+    } \
+    else \
+    { \
+        node = RB_REMOVE(name, &map->adm_root, key); \
+        if (node != NULL && --map->adm_len <= map->adm_lo) \
+        { \
+            name##_adaptive_map_to_array(map); \
+        } \
+    } \
+    return node; \
+}
+
+#define ADAPTIVE_MAP_GENERATE_FIND_PROTO(name, map_type, key_type, type) \
+type *name##_adaptive_map_find(map_type *map, key_type key)
+#define ADAPTIVE_MAP_GENERATE_FIND(name, map_type, key_type, type) \
+ADAPTIVE_MAP_GENERATE_FIND_PROTO(name, map_type, key_type, type) \
+{ \
+    if (!map->adm_is_tree) \
+    { \
+        uint32_t index; \
+        if (name##_adaptive_map_bsearch(map, key, &index)) \
+        { \
+            return map->adm_item[index]; \
+        } \
+        return NULL; \
+    } \
+    return RB_FIND(name, &map->adm_root, key); \
+}
+
+#define ADAPTIVE_MAP_GENERATE_ITER_PROTO(name, map_type, type) \
+type *name##_adaptive_map_first(map_type *map, ADAPTIVE_MAP_ITER *iter); \
+type *name##_adaptive_map_next(map_type *map, ADAPTIVE_MAP_ITER *iter)
+#define ADAPTIVE_MAP_GENERATE_ITER(name, map_type, type, field) \
+type *name##_adaptive_map_first(map_type *map, ADAPTIVE_MAP_ITER *iter) \
+{ \
+    iter->adm_index = 0; \
+    if (map->adm_is_tree) \
+    { \
+        iter->adm_node = rb_first(&map->adm_root); \
+        return (iter->adm_node != NULL \
+                ? RB_ENTRY(iter->adm_node, type, field) : NULL); \
+    } \
+    iter->adm_node = NULL; \
+    return (map->adm_len > 0 ? map->adm_item[0] : NULL); \
+} \
+type *name##_adaptive_map_next(map_type *map, ADAPTIVE_MAP_ITER *iter) \
+{ \
+    if (map->adm_is_tree) \
+    { \
+        iter->adm_node = rb_next(iter->adm_node); \
+        return (iter->adm_node != NULL \
+                ? RB_ENTRY(iter->adm_node, type, field) : NULL); \
+    } \
+    ++iter->adm_index; \
+    return (iter->adm_index < map->adm_len \
+            ? map->adm_item[iter->adm_index] : NULL); \
+}
+
+#define ADAPTIVE_MAP_GEN_PROTO(name, map_type, key_type, type) \
+RB_GEN_PROTO(name, key_type, type) \
+ADAPTIVE_MAP_GENERATE_INSERT_PROTO(name, map_type, type); \
+ADAPTIVE_MAP_GENERATE_REMOVE_PROTO(name, map_type, key_type, type); \
+ADAPTIVE_MAP_GENERATE_FIND_PROTO(name, map_type, key_type, type); \
+ADAPTIVE_MAP_GENERATE_ITER_PROTO(name, map_type, type);
+
+/* key_cmp and cmp are the same as RB_GEN. The tree functions are generated
+ * under the same name, so RB_* may also be used on adm_root in tree mode.
+ */
+#define ADAPTIVE_MAP_GEN(name, map_type, key_type, type, field, key_cmp, cmp) \
+RB_GEN(name, key_type, type, field, key_cmp, cmp) \
+ADAPTIVE_MAP_GENERATE_BSEARCH_IMPL(name##_adaptive_map_bsearch, map_type, key_type, key_cmp) \
+ADAPTIVE_MAP_GENERATE_BSEARCH_IMPL(name##_adaptive_map_bsearch_node, map_type, type *, cmp) \
+ADAPTIVE_MAP_GENERATE_MIGRATE(name, map_type, type, field) \
+ADAPTIVE_MAP_GENERATE_INSERT(name, map_type, type) \
+ADAPTIVE_MAP_GENERATE_REMOVE(name, map_type, key_type, type) \
+ADAPTIVE_MAP_GENERATE_FIND(name, map_type, key_type, type) \
+ADAPTIVE_MAP_GENERATE_ITER(name, map_type, type, field)
+
+#endif /* ADAPTIVE_MAP_H_ */
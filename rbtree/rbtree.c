@@ -49,7 +49,29 @@ void rb_rotate(RB_ROOT *root, RB_NODE *node, int direction)
     rb_set_parent(node, pivot);
 }
 
-void rb_insert_color(RB_ROOT *root, RB_NODE *node)
+/* The rotated node is now the child of the pivot, so update it first. */
+static inline void rotate(RB_ROOT *root, RB_NODE *node, int direction,
+        const RB_AUGMENT *aug)
+{
+    RB_NODE *pivot = node->rb_child[direction ^ 1];
+    rb_rotate(root, node, direction);
+    if (aug != NULL)
+    {
+        aug->update(node);
+        aug->update(pivot);
+    }
+}
+
+static inline void augment_propagate(RB_NODE *node, const RB_AUGMENT *aug)
+{
+    for (; node != NULL; node = rb_parent(node))
+    {
+        aug->update(node);
+    }
+}
+
+static inline void insert_color(RB_ROOT *root, RB_NODE *node,
+        const RB_AUGMENT *aug)
 {
     RB_NODE *parent;
     while ((parent = rb_parent(node)) != NULL && rb_color(parent) == RB_RED)
@@ -73,7 +95,7 @@ void rb_insert_color(RB_ROOT *root, RB_NODE *node)
                 /* Case 2: Uncle is black and the path from grandparent to
                  * child is not straight.
                  */
-                rb_rotate(root, parent, dir);
+                rotate(root, parent, dir, aug);
                 RB_NODE *t = node;
                 node = parent;
                 parent = t;
@@ -83,13 +105,27 @@ void rb_insert_color(RB_ROOT *root, RB_NODE *node)
              */
             rb_set_color(parent, RB_BLACK);
             rb_set_color(gparent, RB_RED);
-            rb_rotate(root, gparent, dir ^ 1);
+            rotate(root, gparent, dir ^ 1, aug);
         }
     }
     rb_set_color(root->rb_root, RB_BLACK);
 }
 
-void rb_remove_color(RB_ROOT *root, RB_NODE *parent, RB_NODE *node)
+void rb_insert_color(RB_ROOT *root, RB_NODE *node)
+{
+    insert_color(root, node, NULL);
+}
+
+void rb_insert_color_augmented(RB_ROOT *root, RB_NODE *node,
+        const RB_AUGMENT *aug)
+{
+    /* Account for the new leaf first; rotations then keep the data valid. */
+    augment_propagate(node, aug);
+    insert_color(root, node, aug);
+}
+
+static inline void remove_color(RB_ROOT *root, RB_NODE *parent,
+        RB_NODE *node, const RB_AUGMENT *aug)
 {
     while ((node == NULL || rb_color(node) == RB_BLACK)
             && node != root->rb_root)
@@ -106,7 +142,7 @@ void rb_remove_color(RB_ROOT *root, RB_NODE *parent, RB_NODE *node)
              */
             rb_set_color(sibling, RB_BLACK);
             rb_set_color(parent, RB_RED);
-            rb_rotate(root, parent, dir);
+            rotate(root, parent, dir, aug);
             sibling = parent->rb_child[dir ^ 1];
         }
         if (sibling->rb_child[dir ^ 1] == NULL
@@ -128,7 +164,7 @@ void rb_remove_color(RB_ROOT *root, RB_NODE *parent, RB_NODE *node)
              */
             rb_set_color(sibling->rb_child[dir], RB_BLACK);
             rb_set_color(sibling, RB_RED);
-            rb_rotate(root, sibling, dir ^ 1);
+            rotate(root, sibling, dir ^ 1, aug);
             sibling = parent->rb_child[dir ^ 1];
         }
 
@@ -138,7 +174,7 @@ void rb_remove_color(RB_ROOT *root, RB_NODE *parent, RB_NODE *node)
         rb_set_color(sibling, rb_color(parent));
         rb_set_color(parent, RB_BLACK);
         rb_set_color(sibling->rb_child[dir ^ 1], RB_BLACK);
-        rb_rotate(root, parent, dir);
+        rotate(root, parent, dir, aug);
         node = root->rb_root;
         break;
     }
@@ -148,6 +184,11 @@ void rb_remove_color(RB_ROOT *root, RB_NODE *parent, RB_NODE *node)
     }
 }
 
+void rb_remove_color(RB_ROOT *root, RB_NODE *parent, RB_NODE *node)
+{
+    remove_color(root, parent, node, NULL);
+}
+
 static inline void rb_change_child(RB_NODE *parent, RB_NODE *old_child,
         RB_NODE *new_child)
 {
@@ -155,7 +196,8 @@ static inline void rb_change_child(RB_NODE *parent, RB_NODE *old_child,
     parent->rb_child[dir] = new_child;
 }
 
-void rb_remove(RB_ROOT *root, RB_NODE *node)
+static inline void remove_node(RB_ROOT *root, RB_NODE *node,
+        const RB_AUGMENT *aug)
 {
     RB_NODE *replacement;
     RB_NODE *transplanter;
@@ -221,12 +263,27 @@ void rb_remove(RB_ROOT *root, RB_NODE *node)
         root->rb_root = transplanter;
     }
 
+    if (aug != NULL)
+    {
+        /* parent is the lowest node whose subtree lost a node. */
+        augment_propagate(parent, aug);
+    }
     if (deleted_color == RB_BLACK)
     {
-        rb_remove_color(root, parent, replacement);
+        remove_color(root, parent, replacement, aug);
     }
 }
 
+void rb_remove(RB_ROOT *root, RB_NODE *node)
+{
+    remove_node(root, node, NULL);
+}
+
+void rb_remove_augmented(RB_ROOT *root, RB_NODE *node, const RB_AUGMENT *aug)
+{
+    remove_node(root, node, aug);
+}
+
 RB_NODE *rb_iter(RB_ROOT *root, int dir)
 {
     RB_NODE *p = root->rb_root;
@@ -267,3 +324,513 @@ RB_NODE *rb_iter_next(RB_NODE *node, int dir)
     return p;
 }
 
+void rb_insert_color_cached(RB_ROOT_CACHED *root, RB_NODE *node)
+{
+    /* A new minimum is always linked as the left child of the old one. */
+    RB_NODE *parent = rb_parent(node);
+    if (parent == NULL)
+    {
+        root->rb_leftmost = node;
+        root->rb_rightmost = node;
+    }
+    else if (parent->rb_child[RB_LEFT] == node)
+    {
+        if (parent == root->rb_leftmost)
+        {
+            root->rb_leftmost = node;
+        }
+    }
+    else if (parent == root->rb_rightmost)
+    {
+        root->rb_rightmost = node;
+    }
+    insert_color(&root->rb_root, node, NULL);
+}
+
+void rb_remove_cached(RB_ROOT_CACHED *root, RB_NODE *node)
+{
+    /* The neighbor of an end node is its only child or its parent. */
+    if (node == root->rb_leftmost)
+    {
+        root->rb_leftmost = rb_next(node);
+    }
+    if (node == root->rb_rightmost)
+    {
+        root->rb_rightmost = rb_prev(node);
+    }
+    remove_node(&root->rb_root, node, NULL);
+}
+
+RB_NODE *rb_pop_first_cached(RB_ROOT_CACHED *root)
+{
+    RB_NODE *node = root->rb_leftmost;
+    if (node != NULL)
+    {
+        rb_remove_cached(root, node);
+    }
+    return node;
+}
+
+/* Height of the complete levels of a balanced tree of n nodes. */
+static inline int build_red_depth(size_t n)
+{
+    int depth = 0;
+    while (((size_t) 2 << depth) <= n + 1)
+    {
+        ++depth;
+    }
+    return depth;
+}
+
+static RB_NODE *build(RB_NODE *(*next)(void *arg), void *arg, size_t n,
+        int depth, int red_depth, const RB_AUGMENT *aug)
+{
+    if (n == 0)
+    {
+        return NULL;
+    }
+    RB_NODE *left = build(next, arg, n / 2, depth + 1, red_depth, aug);
+    RB_NODE *node = next(arg);
+    RB_NODE *right = build(next, arg, n - n / 2 - 1, depth + 1, red_depth,
+            aug);
+    rb_set_parent_color(node, NULL,
+            (depth == red_depth ? RB_RED : RB_BLACK));
+    node->rb_child[RB_LEFT] = left;
+    node->rb_child[RB_RIGHT] = right;
+    if (left != NULL)
+    {
+        rb_set_parent(left, node);
+    }
+    if (right != NULL)
+    {
+        rb_set_parent(right, node);
+    }
+    if (aug != NULL)
+    {
+        aug->update(node);
+    }
+    return node;
+}
+
+void rb_build_sorted_next(RB_ROOT *root, RB_NODE *(*next)(void *arg),
+        void *arg, size_t n)
+{
+    root->rb_root = build(next, arg, n, 0, build_red_depth(n), NULL);
+}
+
+void rb_build_sorted_next_augmented(RB_ROOT *root,
+        RB_NODE *(*next)(void *arg), void *arg, size_t n,
+        const RB_AUGMENT *aug)
+{
+    /* The children are built first, so aug sees them up to date. */
+    root->rb_root = build(next, arg, n, 0, build_red_depth(n), aug);
+}
+
+static RB_NODE *build_array_next(void *arg)
+{
+    RB_NODE ***nodes = arg;
+    return *(*nodes)++;
+}
+
+void rb_build_sorted(RB_ROOT *root, RB_NODE **nodes, size_t n)
+{
+    rb_build_sorted_next(root, build_array_next, &nodes, n);
+}
+
+void rb_build_sorted_augmented(RB_ROOT *root, RB_NODE **nodes, size_t n,
+        const RB_AUGMENT *aug)
+{
+    rb_build_sorted_next_augmented(root, build_array_next, &nodes, n, aug);
+}
+
+/* A subtree with its black height, the number of black nodes on each path
+ * down to a leaf. Its root may be red. */
+typedef struct JOIN_TREE_
+{
+    RB_NODE *node;
+    int bh;
+} JOIN_TREE;
+
+static inline JOIN_TREE join_tree(RB_ROOT *root)
+{
+    JOIN_TREE t = { root->rb_root, 0 };
+    RB_NODE *p;
+    for (p = t.node; p != NULL; p = p->rb_child[RB_LEFT])
+    {
+        t.bh += (rb_color(p) == RB_BLACK);
+    }
+    root->rb_root = NULL;
+    return t;
+}
+
+static inline void join_finish(RB_ROOT *root, JOIN_TREE t)
+{
+    root->rb_root = t.node;
+    if (t.node != NULL)
+    {
+        rb_set_parent_color(t.node, NULL, RB_BLACK);
+    }
+}
+
+static inline JOIN_TREE join_child(JOIN_TREE t, int dir)
+{
+    JOIN_TREE c = { t.node->rb_child[dir],
+            t.bh - (rb_color(t.node) == RB_BLACK) };
+    return c;
+}
+
+static inline bool join_is_red(RB_NODE *node)
+{
+    return (node != NULL && rb_color(node) == RB_RED);
+}
+
+static inline void join_link(RB_NODE *node, int dir, RB_NODE *child)
+{
+    node->rb_child[dir] = child;
+    if (child != NULL)
+    {
+        rb_set_parent(child, node);
+    }
+}
+
+static inline void join_update(RB_NODE *node, const RB_AUGMENT *aug)
+{
+    if (aug != NULL)
+    {
+        aug->update(node);
+    }
+}
+
+/* Join t and other, whose black height is not larger, at the spine of t in
+ * direction dir, e.g. the right spine when t is on the left. */
+static RB_NODE *join_spine(RB_NODE *t, int bh, RB_NODE *node, JOIN_TREE other,
+        int dir, const RB_AUGMENT *aug)
+{
+    if (bh == other.bh && !join_is_red(t))
+    {
+        rb_set_parent_color(node, NULL, RB_RED);
+        join_link(node, dir ^ 1, t);
+        join_link(node, dir, other.node);
+        join_update(node, aug);
+        return node;
+    }
+    RB_NODE *c = join_spine(t->rb_child[dir], bh - (rb_color(t) == RB_BLACK),
+            node, other, dir, aug);
+    join_link(t, dir, c);
+    if (rb_color(t) == RB_BLACK && rb_color(c) == RB_RED
+            && join_is_red(c->rb_child[dir]))
+    {
+        /* Lift the red c over t to fix the red violation below it; t is
+         * now the child of c, so update it first. */
+        rb_set_color(c->rb_child[dir], RB_BLACK);
+        join_link(t, dir, c->rb_child[dir ^ 1]);
+        join_link(c, dir ^ 1, t);
+        join_update(t, aug);
+        join_update(c, aug);
+        return c;
+    }
+    join_update(t, aug);
+    return t;
+}
+
+/* All of l before node before all of r, in O(|l.bh - r.bh| + 1). */
+static JOIN_TREE join(JOIN_TREE l, RB_NODE *node, JOIN_TREE r,
+        const RB_AUGMENT *aug)
+{
+    JOIN_TREE t;
+    if (l.bh == r.bh)
+    {
+        int color = (join_is_red(l.node) || join_is_red(r.node)
+                ? RB_BLACK : RB_RED);
+        rb_set_parent_color(node, NULL, color);
+        join_link(node, RB_LEFT, l.node);
+        join_link(node, RB_RIGHT, r.node);
+        join_update(node, aug);
+        t.node = node;
+        t.bh = l.bh + (color == RB_BLACK);
+        return t;
+    }
+    int dir = (l.bh > r.bh ? RB_RIGHT : RB_LEFT);
+    t = (dir == RB_RIGHT ? l : r);
+    t.node = join_spine(t.node, t.bh, node, (dir == RB_RIGHT ? r : l), dir,
+            aug);
+    if (rb_color(t.node) == RB_RED && join_is_red(t.node->rb_child[dir]))
+    {
+        rb_set_color(t.node, RB_BLACK);
+        ++t.bh;
+    }
+    return t;
+}
+
+static RB_NODE *split_last(JOIN_TREE t, JOIN_TREE *rest,
+        const RB_AUGMENT *aug)
+{
+    JOIN_TREE l = join_child(t, RB_LEFT);
+    JOIN_TREE r = join_child(t, RB_RIGHT);
+    if (r.node == NULL)
+    {
+        *rest = l;
+        return t.node;
+    }
+    RB_NODE *last = split_last(r, &r, aug);
+    *rest = join(l, t.node, r, aug);
+    return last;
+}
+
+static JOIN_TREE join2(JOIN_TREE l, JOIN_TREE r, const RB_AUGMENT *aug)
+{
+    if (l.node == NULL)
+    {
+        return r;
+    }
+    RB_NODE *last = split_last(l, &l, aug);
+    return join(l, last, r, aug);
+}
+
+static RB_NODE *split(JOIN_TREE t, const void *key,
+        int (*cmp)(const void *key, RB_NODE *node),
+        JOIN_TREE *l, JOIN_TREE *r, const RB_AUGMENT *aug)
+{
+    if (t.node == NULL)
+    {
+        *l = t;
+        *r = t;
+        return NULL;
+    }
+    JOIN_TREE tl = join_child(t, RB_LEFT);
+    JOIN_TREE tr = join_child(t, RB_RIGHT);
+    int c = cmp(key, t.node);
+    if (c == 0)
+    {
+        *l = tl;
+        *r = tr;
+        return t.node;
+    }
+    JOIN_TREE mid;
+    RB_NODE *found;
+    if (c < 0)
+    {
+        found = split(tl, key, cmp, l, &mid, aug);
+        *r = join(mid, t.node, tr, aug);
+    }
+    else
+    {
+        found = split(tr, key, cmp, &mid, r, aug);
+        *l = join(tl, t.node, mid, aug);
+    }
+    return found;
+}
+
+void rb_join(RB_ROOT *root, RB_ROOT *left, RB_NODE *node, RB_ROOT *right)
+{
+    rb_join_augmented(root, left, node, right, NULL);
+}
+
+void rb_join_augmented(RB_ROOT *root, RB_ROOT *left, RB_NODE *node,
+        RB_ROOT *right, const RB_AUGMENT *aug)
+{
+    JOIN_TREE l = join_tree(left);
+    JOIN_TREE r = join_tree(right);
+    join_finish(root, join(l, node, r, aug));
+}
+
+RB_NODE *rb_split(RB_ROOT *root, const void *key,
+        int (*cmp)(const void *key, RB_NODE *node),
+        RB_ROOT *left, RB_ROOT *right)
+{
+    return rb_split_augmented(root, key, cmp, left, right, NULL);
+}
+
+RB_NODE *rb_split_augmented(RB_ROOT *root, const void *key,
+        int (*cmp)(const void *key, RB_NODE *node),
+        RB_ROOT *left, RB_ROOT *right, const RB_AUGMENT *aug)
+{
+    JOIN_TREE l, r;
+    RB_NODE *found = split(join_tree(root), key, cmp, &l, &r, aug);
+    join_finish(left, l);
+    join_finish(right, r);
+    return found;
+}
+
+enum
+{
+    SETOP_UNION,
+    SETOP_INTERSECTION,
+    SETOP_DIFFERENCE
+};
+
+typedef struct SETOP_TASK_
+{
+    JOIN_TREE a;
+    JOIN_TREE b;
+    int kind;
+    int (*cmp)(const void *key, RB_NODE *node);
+    const RB_SETOP *op;
+} SETOP_TASK;
+
+static void drop_tree(RB_NODE *node, const RB_SETOP *op)
+{
+    if (node != NULL)
+    {
+        RB_NODE *right = node->rb_child[RB_RIGHT];
+        drop_tree(node->rb_child[RB_LEFT], op);
+        op->drop(node, op->arg);
+        drop_tree(right, op);
+    }
+}
+
+static inline void drop_node(RB_NODE *node, const RB_SETOP *op)
+{
+    if (node != NULL && op->drop != NULL)
+    {
+        op->drop(node, op->arg);
+    }
+}
+
+static JOIN_TREE setop(SETOP_TASK *task);
+
+static void setop_run(void *arg)
+{
+    SETOP_TASK *task = arg;
+    task->a = setop(task);
+}
+
+/* Divide b at its root and conquer the halves of a split by it, on both
+ * sides in parallel if b is high enough. */
+static JOIN_TREE setop(SETOP_TASK *task)
+{
+    const RB_SETOP *op = task->op;
+    JOIN_TREE a = task->a;
+    JOIN_TREE b = task->b;
+    if (a.node == NULL || b.node == NULL)
+    {
+        if (task->kind != SETOP_UNION && op->drop != NULL)
+        {
+            drop_tree(b.node, op);
+            if (task->kind == SETOP_INTERSECTION)
+            {
+                drop_tree(a.node, op);
+            }
+        }
+        if (task->kind == SETOP_INTERSECTION)
+        {
+            a.node = NULL;
+            a.bh = 0;
+        }
+        return (task->kind == SETOP_UNION && a.node == NULL ? b : a);
+    }
+    RB_NODE *node = b.node;
+    SETOP_TASK sub[2] = { *task, *task };
+    RB_NODE *found = split(a, node, task->cmp, &sub[0].a, &sub[1].a,
+            op->aug);
+    sub[0].b = join_child(b, RB_LEFT);
+    sub[1].b = join_child(b, RB_RIGHT);
+    if (op->fork2 != NULL && b.bh >= op->fork_height)
+    {
+        op->fork2(op->ctx, setop_run, &sub[0], setop_run, &sub[1]);
+    }
+    else
+    {
+        setop_run(&sub[0]);
+        setop_run(&sub[1]);
+    }
+    switch (task->kind)
+    {
+    case SETOP_UNION:
+        if (found != NULL)
+        {
+            drop_node(node, op);
+            node = found;
+        }
+        return join(sub[0].a, node, sub[1].a, op->aug);
+    case SETOP_INTERSECTION:
+        drop_node(node, op);
+        if (found != NULL)
+        {
+            return join(sub[0].a, found, sub[1].a, op->aug);
+        }
+        return join2(sub[0].a, sub[1].a, op->aug);
+    default:
+        drop_node(node, op);
+        drop_node(found, op);
+        return join2(sub[0].a, sub[1].a, op->aug);
+    }
+}
+
+static void setop_root(RB_ROOT *root, RB_ROOT *a, RB_ROOT *b,
+        int (*cmp)(const void *key, RB_NODE *node), const RB_SETOP *op,
+        int kind)
+{
+    static const RB_SETOP seq = { NULL, NULL, NULL, NULL, 0, NULL };
+    SETOP_TASK task;
+    task.a = join_tree(a);
+    task.b = join_tree(b);
+    task.kind = kind;
+    task.cmp = cmp;
+    task.op = (op != NULL ? op : &seq);
+    join_finish(root, setop(&task));
+}
+
+void rb_union(RB_ROOT *root, RB_ROOT *a, RB_ROOT *b,
+        int (*cmp)(const void *key, RB_NODE *node), const RB_SETOP *op)
+{
+    setop_root(root, a, b, cmp, op, SETOP_UNION);
+}
+
+void rb_intersection(RB_ROOT *root, RB_ROOT *a, RB_ROOT *b,
+        int (*cmp)(const void *key, RB_NODE *node), const RB_SETOP *op)
+{
+    setop_root(root, a, b, cmp, op, SETOP_INTERSECTION);
+}
+
+void rb_difference(RB_ROOT *root, RB_ROOT *a, RB_ROOT *b,
+        int (*cmp)(const void *key, RB_NODE *node), const RB_SETOP *op)
+{
+    setop_root(root, a, b, cmp, op, SETOP_DIFFERENCE);
+}
+
+static void size_update(RB_NODE *node)
+{
+    RB_ENTRY(node, RB_SIZE_NODE, rb_node)->rb_size = 1
+            + rb_size(node->rb_child[RB_LEFT]) + rb_size(node->rb_child[RB_RIGHT]);
+}
+
+const RB_AUGMENT rb_size_augment = { size_update };
+
+size_t rb_rank(RB_NODE *node)
+{
+    size_t rank = rb_size(node->rb_child[RB_LEFT]);
+    RB_NODE *parent;
+    while ((parent = rb_parent(node)) != NULL)
+    {
+        if (parent->rb_child[RB_RIGHT] == node)
+        {
+            rank += rb_size(parent->rb_child[RB_LEFT]) + 1;
+        }
+        node = parent;
+    }
+    return rank;
+}
+
+RB_NODE *rb_select(RB_ROOT *root, size_t k)
+{
+    RB_NODE *p = root->rb_root;
+    while (p != NULL)
+    {
+        size_t left = rb_size(p->rb_child[RB_LEFT]);
+        if (k < left)
+        {
+            p = p->rb_child[RB_LEFT];
+        }
+        else if (k > left)
+        {
+            k -= left + 1;
+            p = p->rb_child[RB_RIGHT];
+        }
+        else
+        {
+            break;
+        }
+    }
+    return p;
+}
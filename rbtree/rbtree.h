@@ -28,6 +28,7 @@ SOFTWARE.
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
+#include <string.h>
 
 #define RB_RED      0
 #define RB_BLACK    1
@@ -117,17 +118,197 @@ static inline RB_NODE *rb_prev(RB_NODE *node)
 void rb_insert_color(RB_ROOT *root, RB_NODE *node);
 void rb_remove(RB_ROOT *root, RB_NODE *node);
 
+/* Per-subtree data kept up to date by the augmented insert and remove.
+ *
+ * update recomputes the data of a node from its own and its children's data.
+ * It is called bottom-up on the path changed by an insertion or a removal,
+ * and on both nodes of each rotation.
+ */
+typedef struct RB_AUGMENT_
+{
+    void (*update)(RB_NODE *node);
+} RB_AUGMENT;
+
+void rb_insert_color_augmented(RB_ROOT *root, RB_NODE *node,
+        const RB_AUGMENT *aug);
+void rb_remove_augmented(RB_ROOT *root, RB_NODE *node, const RB_AUGMENT *aug);
+
+/* Node augmented with its subtree size, for order statistics. Embed it
+ * instead of RB_NODE and use RB_GEN_SIZE, with field naming its rb_node.
+ */
+typedef struct RB_SIZE_NODE_
+{
+    RB_NODE rb_node;
+    size_t rb_size;
+} RB_SIZE_NODE;
+
+extern const RB_AUGMENT rb_size_augment;
+
+static inline size_t rb_size(RB_NODE *node)
+{
+    return (node != NULL ? RB_ENTRY(node, RB_SIZE_NODE, rb_node)->rb_size : 0);
+}
+
+/* Number of nodes before node, i.e. its index in order. */
+size_t rb_rank(RB_NODE *node);
+/* The node of index k in order, or NULL if k is out of range. */
+RB_NODE *rb_select(RB_ROOT *root, size_t k);
+
+/* Root caching the leftmost and the rightmost nodes, so the minimum and the
+ * maximum are found in O(1). Use it with RB_GEN_CACHED, or insert and remove
+ * the nodes by the _cached functions below.
+ */
+typedef struct RB_ROOT_CACHED_
+{
+    RB_ROOT rb_root;
+    RB_NODE *rb_leftmost;
+    RB_NODE *rb_rightmost;
+} RB_ROOT_CACHED;
+
+#define RB_ROOT_CACHED_INITIALIZER(root) { { NULL }, NULL, NULL }
+#define RB_ROOT_CACHED_INIT(root) \
+    do \
+    { \
+        RB_ROOT_INIT(&(root)->rb_root); \
+        (root)->rb_leftmost = NULL; \
+        (root)->rb_rightmost = NULL; \
+    } while (0)
+
+static inline RB_NODE *rb_first_cached(RB_ROOT_CACHED *root)
+{
+    return root->rb_leftmost;
+}
+
+static inline RB_NODE *rb_last_cached(RB_ROOT_CACHED *root)
+{
+    return root->rb_rightmost;
+}
+
+/* node is linked as a leaf, as for rb_insert_color(). */
+void rb_insert_color_cached(RB_ROOT_CACHED *root, RB_NODE *node);
+void rb_remove_cached(RB_ROOT_CACHED *root, RB_NODE *node);
+/* Remove and return the leftmost node, or NULL if the tree is empty. */
+RB_NODE *rb_pop_first_cached(RB_ROOT_CACHED *root);
+
+/* Link n nodes, already in order, into the empty tree root in O(n) without
+ * comparing them. The tree is balanced by splitting at the middle, so only
+ * its deepest level can be incomplete; that level is red and the rest black.
+ * nodes is an array of the nodes, and next returns them one by one.
+ * The augmented versions also call aug->update on each node after both of
+ * its children, e.g. to set rb_size with rb_size_augment.
+ */
+void rb_build_sorted(RB_ROOT *root, RB_NODE **nodes, size_t n);
+void rb_build_sorted_next(RB_ROOT *root, RB_NODE *(*next)(void *arg),
+        void *arg, size_t n);
+void rb_build_sorted_augmented(RB_ROOT *root, RB_NODE **nodes, size_t n,
+        const RB_AUGMENT *aug);
+void rb_build_sorted_next_augmented(RB_ROOT *root,
+        RB_NODE *(*next)(void *arg), void *arg, size_t n,
+        const RB_AUGMENT *aug);
+
+/* Join-based operations, in O(log n) for rb_join and rb_split, and in
+ * O(m log(n/m + 1)) for the set operations of trees of m and n nodes,
+ * m <= n. They relink nodes without their augmentation; on an augmented
+ * tree use the _augmented versions, and aug of RB_SETOP, which call
+ * aug->update on each node whose children change.
+ *
+ * cmp compares key with node as the key_cmp of RB_GEN; for the set
+ * operations key is an RB_NODE of b. RB_GEN_JOIN generates typed wrappers.
+ */
+
+/* root = left, node, right, with all of left before node before all of
+ * right. left and right are emptied, and root may be either of them. */
+void rb_join(RB_ROOT *root, RB_ROOT *left, RB_NODE *node, RB_ROOT *right);
+void rb_join_augmented(RB_ROOT *root, RB_ROOT *left, RB_NODE *node,
+        RB_ROOT *right, const RB_AUGMENT *aug);
+/* Move the nodes of root before key to left and after it to right, and
+ * return the node equal to key, which is in neither, or NULL. */
+RB_NODE *rb_split(RB_ROOT *root, const void *key,
+        int (*cmp)(const void *key, RB_NODE *node),
+        RB_ROOT *left, RB_ROOT *right);
+RB_NODE *rb_split_augmented(RB_ROOT *root, const void *key,
+        int (*cmp)(const void *key, RB_NODE *node),
+        RB_ROOT *left, RB_ROOT *right, const RB_AUGMENT *aug);
+
+/* Options of the set operations, NULL for the defaults.
+ *
+ * drop is called, if not NULL, on each node of a and b left out of the
+ * result. Without it the left out subtrees are not visited at all, which
+ * keeps the bounds above for intersection and difference.
+ *
+ * fork2, if not NULL, runs func_a(arg_a) and func_b(arg_b), possibly in
+ * parallel, and returns when both are done, e.g. thread_pool_fork2() of
+ * array_utils with ctx as the pool. It is used where the subtree of b has
+ * a black height of at least fork_height, i.e. at least
+ * 2^fork_height - 1 nodes. drop is then called from concurrent tasks.
+ *
+ * aug, if not NULL, is the augmentation of a, b and the result.
+ */
+typedef struct RB_SETOP_
+{
+    void (*drop)(RB_NODE *node, void *arg);
+    void *arg;
+    void (*fork2)(void *ctx, void (*func_a)(void *), void *arg_a,
+            void (*func_b)(void *), void *arg_b);
+    void *ctx;
+    int fork_height;
+    const RB_AUGMENT *aug;
+} RB_SETOP;
+
+/* root = a op b, emptying a and b; root may be either of them. A node
+ * of a is kept over an equal node of b. */
+void rb_union(RB_ROOT *root, RB_ROOT *a, RB_ROOT *b,
+        int (*cmp)(const void *key, RB_NODE *node), const RB_SETOP *op);
+void rb_intersection(RB_ROOT *root, RB_ROOT *a, RB_ROOT *b,
+        int (*cmp)(const void *key, RB_NODE *node), const RB_SETOP *op);
+void rb_difference(RB_ROOT *root, RB_ROOT *a, RB_ROOT *b,
+        int (*cmp)(const void *key, RB_NODE *node), const RB_SETOP *op);
+
+/* The options of a set operation with aug, which the generated wrappers of
+ * an augmented tree pass on. */
+static inline const RB_SETOP *_rb_setop_augmented(const RB_SETOP *op,
+        const RB_AUGMENT *aug, RB_SETOP *buf)
+{
+    if (aug == NULL)
+    {
+        return op;
+    }
+    if (op != NULL)
+    {
+        *buf = *op;
+    }
+    else
+    {
+        memset(buf, 0, sizeof(*buf));
+    }
+    buf->aug = aug;
+    return buf;
+}
+
 #define RB_INSERT(name, root, node) name##_rb_insert(root, node)
 #define RB_REMOVE(name, root, key) name##_rb_remove(root, key)
 #define RB_FIND(name, root, key) name##_rb_find(root, key)
+#define RB_COUNT_LESS(name, root, key) name##_rb_count_less(root, key)
+#define RB_COUNT_RANGE(name, root, lo, hi) name##_rb_count_range(root, lo, hi)
+#define RB_LOWER_BOUND(name, root, key) name##_rb_lower_bound(root, key)
+#define RB_UPPER_BOUND(name, root, key) name##_rb_upper_bound(root, key)
+#define RB_RANGE_FIRST(name, root, lo, hi) name##_rb_range_first(root, lo, hi)
+#define RB_RANGE_NEXT(name, node, hi) name##_rb_range_next(node, hi)
+
+/* Trace hook of the generated functions, empty unless defined before them,
+ * e.g. by array_trace.h with ARRAY_TRACE_HOOKS. */
+#ifndef RB_TRACE
+#define RB_TRACE(op, root, node)
+#endif
 
 #define RB_GENERATE_INSERT_PROTO(name, type) \
 type *name##_rb_insert(RB_ROOT *root, type *node)
-#define RB_GENERATE_INSERT(name, type, field, cmp) \
-RB_GENERATE_INSERT_PROTO(name, type) \
+#define _RB_GENERATE_INSERT_IMPL(name, root_type, tree, type, field, cmp, \
+        insert_color) \
+type *name##_rb_insert(root_type *root, type *node) \
 { \
     RB_NODE *parent; \
-    RB_NODE *p = root->rb_root; \
+    RB_NODE *p = (tree)->rb_root; \
     if (p != NULL) \
     { \
         int dir; \
@@ -146,6 +327,7 @@ RB_GENERATE_INSERT_PROTO(name, type) \
             } \
             else \
             { \
+                RB_TRACE(INSERT, root, ent); \
                 return ent; \
             } \
             p = p->rb_child[dir]; \
@@ -155,21 +337,29 @@ RB_GENERATE_INSERT_PROTO(name, type) \
     else \
     { \
         parent = NULL; \
-        root->rb_root = &node->field; \
+        (tree)->rb_root = &node->field; \
     } \
     rb_set_parent_color(&node->field, parent, RB_RED); \
     node->field.rb_child[RB_LEFT] = NULL; \
     node->field.rb_child[RB_RIGHT] = NULL; \
-    rb_insert_color(root, &node->field); \
+    RB_TRACE(INSERT, root, node); \
+    insert_color; \
     return node; \
 }
+#define RB_GENERATE_INSERT(name, type, field, cmp) \
+_RB_GENERATE_INSERT_IMPL(name, RB_ROOT, root, type, field, cmp, \
+        rb_insert_color(root, &node->field))
+#define RB_GENERATE_INSERT_AUGMENTED(name, type, field, cmp, aug) \
+_RB_GENERATE_INSERT_IMPL(name, RB_ROOT, root, type, field, cmp, \
+        rb_insert_color_augmented(root, &node->field, aug))
 
 #define RB_GENERATE_FIND_PROTO(name, key_type, type) \
 type *name##_rb_find(RB_ROOT *root, key_type key)
-#define RB_GENERATE_FIND(name, key_type, type, field, key_cmp) \
-RB_GENERATE_FIND_PROTO(name, key_type, type) \
+#define _RB_GENERATE_FIND_IMPL(name, root_type, tree, key_type, type, field, \
+        key_cmp) \
+type *name##_rb_find(root_type *root, key_type key) \
 { \
-    RB_NODE *p = root->rb_root; \
+    RB_NODE *p = (tree)->rb_root; \
     while (p != NULL) \
     { \
         int dir; \
@@ -185,34 +375,441 @@ RB_GENERATE_FIND_PROTO(name, key_type, type) \
         } \
         else \
         { \
+            RB_TRACE(FIND, root, ent); \
             return ent; \
         } \
         p = p->rb_child[dir]; \
     } \
+    RB_TRACE(FIND, root, NULL); \
     return NULL; \
 }
+#define RB_GENERATE_FIND(name, key_type, type, field, key_cmp) \
+_RB_GENERATE_FIND_IMPL(name, RB_ROOT, root, key_type, type, field, key_cmp)
 
 #define RB_GENERATE_REMOVE_PROTO(name, key_type, type) \
 type *name##_rb_remove(RB_ROOT *root, key_type key)
-#define RB_GENERATE_REMOVE(name, key_type, type, field) \
-RB_GENERATE_REMOVE_PROTO(name, key_type, type) \
+#define _RB_GENERATE_REMOVE_IMPL(name, root_type, key_type, type, remove) \
+type *name##_rb_remove(root_type *root, key_type key) \
 { \
     type *node = RB_FIND(name, root, key); \
     if (node != NULL) \
     { \
-        rb_remove(root, &node->field); \
+        remove; \
     } \
+    RB_TRACE(REMOVE, root, node); \
     return node; \
 }
+#define RB_GENERATE_REMOVE(name, key_type, type, field) \
+_RB_GENERATE_REMOVE_IMPL(name, RB_ROOT, key_type, type, \
+        rb_remove(root, &node->field))
+#define RB_GENERATE_REMOVE_AUGMENTED(name, key_type, type, field, aug) \
+_RB_GENERATE_REMOVE_IMPL(name, RB_ROOT, key_type, type, \
+        rb_remove_augmented(root, &node->field, aug))
+
+/* Number of nodes less than key, in O(log n) on a tree of RB_SIZE_NODE. */
+#define RB_GENERATE_COUNT_PROTO(name, key_type) \
+size_t name##_rb_count_less(RB_ROOT *root, key_type key); \
+size_t name##_rb_count_range(RB_ROOT *root, key_type lo, key_type hi)
+#define RB_GENERATE_COUNT(name, key_type, type, field, key_cmp) \
+size_t name##_rb_count_less(RB_ROOT *root, key_type key) \
+{ \
+    size_t cnt = 0; \
+    RB_NODE *p = root->rb_root; \
+    while (p != NULL) \
+    { \
+        type *ent = RB_ENTRY(p, type, field); \
+        if (key_cmp(key, ent) > 0) \
+        { \
+            cnt += rb_size(p->rb_child[RB_LEFT]) + 1; \
+            p = p->rb_child[RB_RIGHT]; \
+        } \
+        else \
+        { \
+            p = p->rb_child[RB_LEFT]; \
+        } \
+    } \
+    return cnt; \
+} \
+size_t name##_rb_count_range(RB_ROOT *root, key_type lo, key_type hi) \
+{ \
+    /* Nodes in [lo, hi). */ \
+    size_t n_lo = name##_rb_count_less(root, lo); \
+    size_t n_hi = name##_rb_count_less(root, hi); \
+    return (n_hi > n_lo ? n_hi - n_lo : 0); \
+}
+
+/* First node not less than, or greater than, key; and the nodes in
+ * [lo, hi) one by one, starting in O(log n). */
+#define RB_GENERATE_BOUND_PROTO(name, key_type, type) \
+type *name##_rb_lower_bound(RB_ROOT *root, key_type key); \
+type *name##_rb_upper_bound(RB_ROOT *root, key_type key); \
+type *name##_rb_range_first(RB_ROOT *root, key_type lo, key_type hi); \
+type *name##_rb_range_next(type *node, key_type hi)
+#define _RB_GENERATE_BOUND_IMPL(name, bound, key_type, type, field, key_cmp, \
+        op) \
+type *name##_rb_##bound(RB_ROOT *root, key_type key) \
+{ \
+    type *found = NULL; \
+    RB_NODE *p = root->rb_root; \
+    while (p != NULL) \
+    { \
+        type *ent = RB_ENTRY(p, type, field); \
+        if (key_cmp(key, ent) op 0) \
+        { \
+            found = ent; \
+            p = p->rb_child[RB_LEFT]; \
+        } \
+        else \
+        { \
+            p = p->rb_child[RB_RIGHT]; \
+        } \
+    } \
+    RB_TRACE(FIND, root, found); \
+    return found; \
+}
+#define RB_GENERATE_BOUND(name, key_type, type, field, key_cmp) \
+_RB_GENERATE_BOUND_IMPL(name, lower_bound, key_type, type, field, key_cmp, \
+        <=) \
+_RB_GENERATE_BOUND_IMPL(name, upper_bound, key_type, type, field, key_cmp, \
+        <) \
+type *name##_rb_range_first(RB_ROOT *root, key_type lo, key_type hi) \
+{ \
+    type *node = name##_rb_lower_bound(root, lo); \
+    key_type key = hi; /* key_cmp may be a macro naming its argument key */ \
+    return (node != NULL && key_cmp(key, node) > 0 ? node : NULL); \
+} \
+type *name##_rb_range_next(type *node, key_type hi) \
+{ \
+    RB_NODE *p = rb_next(&node->field); \
+    key_type key = hi; \
+    if (p == NULL || key_cmp(key, RB_ENTRY(p, type, field)) <= 0) \
+    { \
+        return NULL; \
+    } \
+    return RB_ENTRY(p, type, field); \
+}
 
 #define RB_GEN_PROTO(name, key_type, type) \
 RB_GENERATE_INSERT_PROTO(name, type); \
 RB_GENERATE_REMOVE_PROTO(name, key_type, type); \
-RB_GENERATE_FIND_PROTO(name, key_type, type);
+RB_GENERATE_FIND_PROTO(name, key_type, type); \
+RB_GENERATE_BOUND_PROTO(name, key_type, type);
 
 #define RB_GEN(name, key_type, type, field, key_cmp, cmp) \
 RB_GENERATE_INSERT(name, type, field, cmp) \
 RB_GENERATE_FIND(name, key_type, type, field, key_cmp) \
-RB_GENERATE_REMOVE(name, key_type, type, field)
+RB_GENERATE_REMOVE(name, key_type, type, field) \
+RB_GENERATE_BOUND(name, key_type, type, field, key_cmp)
+
+/* aug is a pointer to the RB_AUGMENT of the tree. */
+#define RB_GEN_AUGMENTED(name, key_type, type, field, key_cmp, cmp, aug) \
+RB_GENERATE_INSERT_AUGMENTED(name, type, field, cmp, aug) \
+RB_GENERATE_FIND(name, key_type, type, field, key_cmp) \
+RB_GENERATE_REMOVE_AUGMENTED(name, key_type, type, field, aug) \
+RB_GENERATE_BOUND(name, key_type, type, field, key_cmp)
+
+#define RB_GEN_SIZE_PROTO(name, key_type, type) \
+RB_GEN_PROTO(name, key_type, type) \
+RB_GENERATE_COUNT_PROTO(name, key_type);
+
+/* field is the rb_node of the RB_SIZE_NODE in type, e.g. snode.rb_node. */
+#define RB_GEN_SIZE(name, key_type, type, field, key_cmp, cmp) \
+RB_GEN_AUGMENTED(name, key_type, type, field, key_cmp, cmp, &rb_size_augment) \
+RB_GENERATE_COUNT(name, key_type, type, field, key_cmp)
+
+/* Same as RB_GEN on an RB_ROOT_CACHED, plus RB_POP_FIRST. */
+#define RB_POP_FIRST(name, root) name##_rb_pop_first(root)
+
+#define RB_GEN_CACHED_PROTO(name, key_type, type) \
+type *name##_rb_insert(RB_ROOT_CACHED *root, type *node); \
+type *name##_rb_remove(RB_ROOT_CACHED *root, key_type key); \
+type *name##_rb_find(RB_ROOT_CACHED *root, key_type key); \
+type *name##_rb_pop_first(RB_ROOT_CACHED *root);
+
+#define RB_GEN_CACHED(name, key_type, type, field, key_cmp, cmp) \
+_RB_GENERATE_INSERT_IMPL(name, RB_ROOT_CACHED, &root->rb_root, type, field, \
+        cmp, rb_insert_color_cached(root, &node->field)) \
+_RB_GENERATE_FIND_IMPL(name, RB_ROOT_CACHED, &root->rb_root, key_type, type, \
+        field, key_cmp) \
+_RB_GENERATE_REMOVE_IMPL(name, RB_ROOT_CACHED, key_type, type, \
+        rb_remove_cached(root, &node->field)) \
+type *name##_rb_pop_first(RB_ROOT_CACHED *root) \
+{ \
+    RB_NODE *p = rb_pop_first_cached(root); \
+    type *node = (p != NULL ? RB_ENTRY(p, type, field) : NULL); \
+    RB_TRACE(REMOVE, root, node); \
+    return node; \
+}
+
+#define RB_JOIN(name, root, left, node, right) \
+    name##_rb_join(root, left, node, right)
+#define RB_SPLIT(name, root, key, left, right) \
+    name##_rb_split(root, key, left, right)
+#define RB_UNION(name, root, a, b, op) name##_rb_union(root, a, b, op)
+#define RB_INTERSECTION(name, root, a, b, op) \
+    name##_rb_intersection(root, a, b, op)
+#define RB_DIFFERENCE(name, root, a, b, op) \
+    name##_rb_difference(root, a, b, op)
+
+#define RB_GEN_JOIN_PROTO(name, key_type, type) \
+void name##_rb_join(RB_ROOT *root, RB_ROOT *left, type *node, \
+        RB_ROOT *right); \
+type *name##_rb_split(RB_ROOT *root, key_type key, RB_ROOT *left, \
+        RB_ROOT *right); \
+void name##_rb_union(RB_ROOT *root, RB_ROOT *a, RB_ROOT *b, \
+        const RB_SETOP *op); \
+void name##_rb_intersection(RB_ROOT *root, RB_ROOT *a, RB_ROOT *b, \
+        const RB_SETOP *op); \
+void name##_rb_difference(RB_ROOT *root, RB_ROOT *a, RB_ROOT *b, \
+        const RB_SETOP *op);
+
+#define _RB_GENERATE_JOIN_IMPL(name, key_type, type, field, key_cmp, cmp, \
+        aug) \
+static int name##_rb_join_key_cmp(const void *key, RB_NODE *node) \
+{ \
+    return key_cmp(*(key_type *) key, RB_ENTRY(node, type, field)); \
+} \
+static int name##_rb_join_cmp(const void *key, RB_NODE *node) \
+{ \
+    return cmp(RB_ENTRY((RB_NODE *) key, type, field), \
+            RB_ENTRY(node, type, field)); \
+} \
+void name##_rb_join(RB_ROOT *root, RB_ROOT *left, type *node, \
+        RB_ROOT *right) \
+{ \
+    rb_join_augmented(root, left, &node->field, right, aug); \
+} \
+type *name##_rb_split(RB_ROOT *root, key_type key, RB_ROOT *left, \
+        RB_ROOT *right) \
+{ \
+    RB_NODE *p = rb_split_augmented(root, &key, name##_rb_join_key_cmp, \
+            left, right, aug); \
+    return (p != NULL ? RB_ENTRY(p, type, field) : NULL); \
+} \
+void name##_rb_union(RB_ROOT *root, RB_ROOT *a, RB_ROOT *b, \
+        const RB_SETOP *op) \
+{ \
+    RB_SETOP buf; \
+    rb_union(root, a, b, name##_rb_join_cmp, \
+            _rb_setop_augmented(op, aug, &buf)); \
+} \
+void name##_rb_intersection(RB_ROOT *root, RB_ROOT *a, RB_ROOT *b, \
+        const RB_SETOP *op) \
+{ \
+    RB_SETOP buf; \
+    rb_intersection(root, a, b, name##_rb_join_cmp, \
+            _rb_setop_augmented(op, aug, &buf)); \
+} \
+void name##_rb_difference(RB_ROOT *root, RB_ROOT *a, RB_ROOT *b, \
+        const RB_SETOP *op) \
+{ \
+    RB_SETOP buf; \
+    rb_difference(root, a, b, name##_rb_join_cmp, \
+            _rb_setop_augmented(op, aug, &buf)); \
+}
+#define RB_GEN_JOIN(name, key_type, type, field, key_cmp, cmp) \
+_RB_GENERATE_JOIN_IMPL(name, key_type, type, field, key_cmp, cmp, NULL)
+/* For trees of RB_GEN_AUGMENTED and RB_GEN_SIZE, keeping aug up to date. */
+#define RB_GEN_JOIN_AUGMENTED(name, key_type, type, field, key_cmp, cmp, \
+        aug) \
+_RB_GENERATE_JOIN_IMPL(name, key_type, type, field, key_cmp, cmp, aug)
+#define RB_GEN_JOIN_SIZE(name, key_type, type, field, key_cmp, cmp) \
+_RB_GENERATE_JOIN_IMPL(name, key_type, type, field, key_cmp, cmp, \
+        &rb_size_augment)
+
+/* Interval tree of closed intervals [start(node), last(node)], ordered by
+ * start, then last, then address, so equal intervals can coexist. start and
+ * last are functions or macros taking a pointer to type, and max names the
+ * member of type caching the largest last in the subtree of the node.
+ *
+ * Nodes are inserted by RB_INSERT, which never finds a duplicate. The
+ * overlap iterators visit in order the nodes overlapping [lo, hi] in
+ * O(log n + k) for k nodes; a stabbing query of point x is [x, x].
+ */
+#define RB_INTERVAL_REMOVE(name, root, node) \
+    name##_rb_interval_remove(root, node)
+#define RB_INTERVAL_FIRST(name, root, lo, hi) \
+    name##_rb_interval_first(root, lo, hi)
+#define RB_INTERVAL_NEXT(name, node, lo, hi) \
+    name##_rb_interval_next(node, lo, hi)
+
+#define RB_GENERATE_INTERVAL_PROTO(name, itype, type) \
+RB_GENERATE_INSERT_PROTO(name, type); \
+void name##_rb_interval_remove(RB_ROOT *root, type *node); \
+type *name##_rb_interval_first(RB_ROOT *root, itype lo, itype hi); \
+type *name##_rb_interval_next(type *node, itype lo, itype hi)
+#define RB_GENERATE_INTERVAL(name, itype, type, field, start, last, max) \
+static void name##_rb_interval_update(RB_NODE *p) \
+{ \
+    type *node = RB_ENTRY(p, type, field); \
+    itype m = last(node); \
+    int dir; \
+    for (dir = RB_LEFT; dir <= RB_RIGHT; ++dir) \
+    { \
+        RB_NODE *c = p->rb_child[dir]; \
+        if (c != NULL && RB_ENTRY(c, type, field)->max > m) \
+        { \
+            m = RB_ENTRY(c, type, field)->max; \
+        } \
+    } \
+    node->max = m; \
+} \
+static const RB_AUGMENT name##_rb_interval_augment = \
+{ \
+    name##_rb_interval_update \
+}; \
+static inline int name##_rb_interval_cmp(type *a, type *b) \
+{ \
+    if (start(a) != start(b)) \
+    { \
+        return (start(a) < start(b) ? -1 : 1); \
+    } \
+    if (last(a) != last(b)) \
+    { \
+        return (last(a) < last(b) ? -1 : 1); \
+    } \
+    return (a < b ? -1 : (a > b)); \
+} \
+/* Leftmost node overlapping [lo, hi] in the subtree p, whose max is not \
+ * less than lo. */ \
+static type *name##_rb_interval_search(RB_NODE *p, itype lo, itype hi) \
+{ \
+    for (;;) \
+    { \
+        type *node = RB_ENTRY(p, type, field); \
+        RB_NODE *c = p->rb_child[RB_LEFT]; \
+        if (c != NULL && RB_ENTRY(c, type, field)->max >= lo) \
+        { \
+            /* The left subtree ends after lo, so either it holds the \
+             * result or everything from it on starts after hi. */ \
+            p = c; \
+            continue; \
+        } \
+        if (start(node) > hi) \
+        { \
+            return NULL; \
+        } \
+        if (last(node) >= lo) \
+        { \
+            return node; \
+        } \
+        p = p->rb_child[RB_RIGHT]; \
+        if (p == NULL || RB_ENTRY(p, type, field)->max < lo) \
+        { \
+            return NULL; \
+        } \
+    } \
+} \
+_RB_GENERATE_INSERT_IMPL(name, RB_ROOT, root, type, field, \
+        name##_rb_interval_cmp, \
+        rb_insert_color_augmented(root, &node->field, \
+            &name##_rb_interval_augment)) \
+void name##_rb_interval_remove(RB_ROOT *root, type *node) \
+{ \
+    rb_remove_augmented(root, &node->field, &name##_rb_interval_augment); \
+    RB_TRACE(REMOVE, root, node); \
+} \
+type *name##_rb_interval_first(RB_ROOT *root, itype lo, itype hi) \
+{ \
+    type *node = NULL; \
+    RB_NODE *p = root->rb_root; \
+    if (p != NULL && RB_ENTRY(p, type, field)->max >= lo) \
+    { \
+        node = name##_rb_interval_search(p, lo, hi); \
+    } \
+    RB_TRACE(FIND, root, node); \
+    return node; \
+} \
+type *name##_rb_interval_next(type *node, itype lo, itype hi) \
+{ \
+    RB_NODE *p = &node->field; \
+    RB_NODE *c = p->rb_child[RB_RIGHT]; \
+    for (;;) \
+    { \
+        if (c != NULL && RB_ENTRY(c, type, field)->max >= lo) \
+        { \
+            return name##_rb_interval_search(c, lo, hi); \
+        } \
+        /* Up to the nearest ancestor having p in its left subtree. */ \
+        do \
+        { \
+            c = p; \
+            p = rb_parent(p); \
+            if (p == NULL) \
+            { \
+                return NULL; \
+            } \
+        } while (c == p->rb_child[RB_RIGHT]); \
+        node = RB_ENTRY(p, type, field); \
+        if (start(node) > hi) \
+        { \
+            return NULL; \
+        } \
+        if (last(node) >= lo) \
+        { \
+            return node; \
+        } \
+        c = p->rb_child[RB_RIGHT]; \
+    } \
+}
+
+#define RB_GEN_INTERVAL_PROTO(name, itype, type) \
+RB_GENERATE_INTERVAL_PROTO(name, itype, type);
+
+#define RB_GEN_INTERVAL(name, itype, type, field, start, last, max) \
+RB_GENERATE_INTERVAL(name, itype, type, field, start, last, max)
+
+/* Join-based operations of RB_GEN_JOIN for an interval tree, keeping max up
+ * to date. The key of RB_SPLIT is a pointer to type, ordered as the nodes;
+ * the set operations match nodes by address. Must follow RB_GEN_INTERVAL. */
+#define RB_GEN_JOIN_INTERVAL_PROTO(name, type) \
+RB_GEN_JOIN_PROTO(name, type *, type)
+#define RB_GEN_JOIN_INTERVAL(name, type, field) \
+_RB_GENERATE_JOIN_IMPL(name, type *, type, field, name##_rb_interval_cmp, \
+        name##_rb_interval_cmp, &name##_rb_interval_augment)
+
+typedef struct RB_STR_KEY_
+{
+    uint64_t rb_prefix;
+    const char *rb_str;
+} RB_STR_KEY;
+
+/* The first 8 bytes of the string packed in big-endian order and padded with
+ * zeros, so comparing prefixes as integers gives the same order as strcmp().
+ */
+static inline uint64_t rb_str_prefix(const char *str)
+{
+    uint64_t prefix = 0;
+    int i;
+    for (i = 0; i < 8; ++i)
+    {
+        prefix <<= 8;
+        if (*str != '\0')
+        {
+            prefix |= (uint8_t) *str++;
+        }
+    }
+    return prefix;
+}
+
+#define RB_STR_KEY_INIT(key, str) \
+do { \
+    (key)->rb_prefix = rb_str_prefix(str); \
+    (key)->rb_str = (str); \
+} while (0)
+
+static inline int rb_str_key_cmp(const RB_STR_KEY *a, const RB_STR_KEY *b)
+{
+    if (a->rb_prefix != b->rb_prefix)
+    {
+        return (a->rb_prefix < b->rb_prefix ? -1 : 1);
+    }
+    if ((a->rb_prefix & 0xff) == 0)
+    {
+        /* Both strings end within the prefix. */
+        return 0;
+    }
+    return strcmp(a->rb_str + 8, b->rb_str + 8);
+}
 
 #endif /* RBTREE_H_ */
@@ -33,7 +33,30 @@ RB_NODE *rb_rotate(RB_NODE *node, int direction)
     return pivot;
 }
 
-void rb_insert_color(RB_ROOT *root, RB_PATH *rp)
+/* The rotated node is now the child of the pivot, so update it first. */
+static inline RB_NODE *rotate(RB_NODE *node, int direction,
+        const RB_AUGMENT *aug)
+{
+    RB_NODE *pivot = rb_rotate(node, direction);
+    if (aug != NULL)
+    {
+        aug->update(node);
+        aug->update(pivot);
+    }
+    return pivot;
+}
+
+static inline void augment_propagate(const RB_PATH_ENTRY *rpe,
+        const RB_AUGMENT *aug)
+{
+    for (; rpe->parent != NULL; --rpe)
+    {
+        aug->update(rpe->parent);
+    }
+}
+
+static inline void insert_color(RB_ROOT *root, RB_PATH *rp,
+        const RB_AUGMENT *aug)
 {
     RB_NODE *parent;
     while ((parent = rp->cur->parent) != NULL && rb_color(parent) == RB_RED)
@@ -60,7 +83,7 @@ void rb_insert_color(RB_ROOT *root, RB_PATH *rp)
                 /* Case 2: Uncle is black and the path from grandparent to
                  * child is not straight.
                  */
-                parent = rb_rotate(parent, dir);
+                parent = rotate(parent, dir, aug);
                 rb_set_child(gparent, dir, parent);
             }
             /* Case 3: Uncle is black and the path from grandparent to child
@@ -68,7 +91,7 @@ void rb_insert_color(RB_ROOT *root, RB_PATH *rp)
              */
             rb_set_color(parent, RB_BLACK);
             rb_set_color(gparent, RB_RED);
-            RB_NODE *t = rb_rotate(gparent, dir ^ 1);
+            RB_NODE *t = rotate(gparent, dir ^ 1, aug);
             RB_NODE *ggparent = rp->cur[-2].parent;
             if (ggparent != NULL)
             {
@@ -84,8 +107,23 @@ void rb_insert_color(RB_ROOT *root, RB_PATH *rp)
     rb_set_color(root->rb_root, RB_BLACK);
 }
 
+void rb_insert_color(RB_ROOT *root, RB_PATH *rp)
+{
+    insert_color(root, rp, NULL);
+}
 
-void rb_remove_color(RB_ROOT *root, RB_NODE *node, RB_PATH *rp)
+void rb_insert_color_augmented(RB_ROOT *root, RB_NODE *node, RB_PATH *rp,
+        const RB_AUGMENT *aug)
+{
+    /* Account for the new leaf first; rotations then keep the data valid. */
+    aug->update(node);
+    augment_propagate(rp->cur, aug);
+    insert_color(root, rp, aug);
+}
+
+
+static inline void remove_color(RB_ROOT *root, RB_NODE *node, RB_PATH *rp,
+        const RB_AUGMENT *aug)
 {
     while ((node == NULL || rb_color(node) == RB_BLACK)
             && node != root->rb_root)
@@ -103,7 +141,7 @@ void rb_remove_color(RB_ROOT *root, RB_NODE *node, RB_PATH *rp)
              */
             rb_set_color(sibling, RB_BLACK);
             rb_set_color(parent, RB_RED);
-            RB_NODE *t = rb_rotate(parent, dir);
+            RB_NODE *t = rotate(parent, dir, aug);
             RB_NODE *gparent = rp->cur[-1].parent;
             if (gparent != NULL)
             {
@@ -140,7 +178,7 @@ void rb_remove_color(RB_ROOT *root, RB_NODE *node, RB_PATH *rp)
             rb_set_color(nibling2, RB_BLACK);
             rb_set_color(sibling, RB_RED);
             nibling = sibling;
-            RB_NODE *t = rb_rotate(sibling, dir ^ 1);
+            RB_NODE *t = rotate(sibling, dir ^ 1, aug);
             rb_set_child(parent, dir ^ 1, t);
             sibling = t;
         }
@@ -151,7 +189,7 @@ void rb_remove_color(RB_ROOT *root, RB_NODE *node, RB_PATH *rp)
         rb_set_color(sibling, rb_color(parent));
         rb_set_color(parent, RB_BLACK);
         rb_set_color(nibling, RB_BLACK);
-        RB_NODE *t = rb_rotate(parent, dir);
+        RB_NODE *t = rotate(parent, dir, aug);
         RB_NODE *gparent = rp->cur[-1].parent;
         if (gparent != NULL)
         {
@@ -170,7 +208,13 @@ void rb_remove_color(RB_ROOT *root, RB_NODE *node, RB_PATH *rp)
     }
 }
 
-void rb_remove(RB_ROOT *root, RB_NODE *node, RB_PATH *rp)
+void rb_remove_color(RB_ROOT *root, RB_NODE *node, RB_PATH *rp)
+{
+    remove_color(root, node, rp, NULL);
+}
+
+static inline void remove_node(RB_ROOT *root, RB_NODE *node, RB_PATH *rp,
+        const RB_AUGMENT *aug)
 {
     RB_NODE *replacement;
     RB_NODE *transplanter;
@@ -224,12 +268,28 @@ void rb_remove(RB_ROOT *root, RB_NODE *node, RB_PATH *rp)
         root->rb_root = transplanter;
     }
 
+    if (aug != NULL)
+    {
+        /* The path ends at the lowest node whose subtree lost a node. */
+        augment_propagate(rp->cur, aug);
+    }
     if (deleted_color == RB_BLACK)
     {
-        rb_remove_color(root, replacement, rp);
+        remove_color(root, replacement, rp, aug);
     }
 }
 
+void rb_remove(RB_ROOT *root, RB_NODE *node, RB_PATH *rp)
+{
+    remove_node(root, node, rp, NULL);
+}
+
+void rb_remove_augmented(RB_ROOT *root, RB_NODE *node, RB_PATH *rp,
+        const RB_AUGMENT *aug)
+{
+    remove_node(root, node, rp, aug);
+}
+
 RB_NODE *rb_iter(RB_ROOT *root, int dir, RB_PATH *rp)
 {
     RB_PATH_INIT(rp);
@@ -286,3 +346,565 @@ RB_NODE *rb_iter_next(RB_NODE *node, int dir,  RB_PATH *rp)
     return p;
 }
 
+static inline RB_PATH *leftmost_path(RB_ROOT_CACHED *root)
+{
+    if (root->rb_path.cur == NULL)
+    {
+        rb_iter(&root->rb_root, RB_LEFT, &root->rb_path);
+    }
+    return &root->rb_path;
+}
+
+RB_NODE *rb_first_cached(RB_ROOT_CACHED *root, RB_PATH *rp)
+{
+    if (rp != NULL)
+    {
+        RB_PATH *lp = leftmost_path(root);
+        size_t n = lp->cur - lp->path;
+        memcpy(rp->path, lp->path, (n + 1) * sizeof(RB_PATH_ENTRY));
+        rp->cur = rp->path + n;
+    }
+    return root->rb_leftmost;
+}
+
+void rb_insert_color_cached(RB_ROOT_CACHED *root, RB_NODE *node,
+        RB_PATH *rp)
+{
+    /* A new minimum is always linked as the left child of the old one. */
+    RB_NODE *parent = rp->cur->parent;
+    if (parent == NULL)
+    {
+        root->rb_leftmost = node;
+        root->rb_rightmost = node;
+        root->rb_path.cur = root->rb_path.path;
+        root->rb_path.cur->parent = NULL;
+    }
+    else
+    {
+        if (rp->cur->dir == RB_LEFT)
+        {
+            if (parent == root->rb_leftmost)
+            {
+                root->rb_leftmost = node;
+                if (root->rb_path.cur != NULL)
+                {
+                    *++root->rb_path.cur = *rp->cur;
+                }
+            }
+        }
+        else if (parent == root->rb_rightmost)
+        {
+            root->rb_rightmost = node;
+        }
+        /* Only a red parent makes rotations that may move the left spine. */
+        if (rb_color(parent) == RB_RED)
+        {
+            root->rb_path.cur = NULL;
+        }
+    }
+    insert_color(&root->rb_root, rp, NULL);
+}
+
+void rb_remove_cached(RB_ROOT_CACHED *root, RB_NODE *node, RB_PATH *rp)
+{
+    /* The neighbor of an end node is its only child or its parent. A red
+     * leaf is removed without rebalancing, and a black end node with a
+     * child is replaced by that red child, so the left spine only changes
+     * at its end in these cases.
+     */
+    RB_NODE *left = rb_child(node, RB_LEFT);
+    RB_NODE *right = rb_child(node, RB_RIGHT);
+    bool red_leaf = (rb_color(node) == RB_RED && left == NULL
+            && right == NULL);
+    int spine = 0;
+    if (node == root->rb_rightmost)
+    {
+        root->rb_rightmost = (left != NULL ? left : rp->cur->parent);
+    }
+    if (node == root->rb_leftmost)
+    {
+        root->rb_leftmost = (right != NULL ? right : rp->cur->parent);
+        spine = (right != NULL ? 0 : (red_leaf ? -1 : 1));
+    }
+    else if (!red_leaf)
+    {
+        spine = 1;
+    }
+    remove_node(&root->rb_root, node, rp, NULL);
+    if (root->rb_path.cur != NULL)
+    {
+        if (spine > 0)
+        {
+            root->rb_path.cur = NULL;
+        }
+        else
+        {
+            root->rb_path.cur += spine;
+        }
+    }
+}
+
+RB_NODE *rb_pop_first_cached(RB_ROOT_CACHED *root)
+{
+    RB_NODE *node = root->rb_leftmost;
+    if (node != NULL)
+    {
+        rb_remove_cached(root, node, leftmost_path(root));
+    }
+    return node;
+}
+
+/* Height of the complete levels of a balanced tree of n nodes. */
+static inline int build_red_depth(size_t n)
+{
+    int depth = 0;
+    while (((size_t) 2 << depth) <= n + 1)
+    {
+        ++depth;
+    }
+    return depth;
+}
+
+static RB_NODE *build(RB_NODE *(*next)(void *arg), void *arg, size_t n,
+        int depth, int red_depth, const RB_AUGMENT *aug)
+{
+    if (n == 0)
+    {
+        return NULL;
+    }
+    RB_NODE *left = build(next, arg, n / 2, depth + 1, red_depth, aug);
+    RB_NODE *node = next(arg);
+    RB_NODE *right = build(next, arg, n - n / 2 - 1, depth + 1, red_depth,
+            aug);
+    rb_set_left_child_color(node, left,
+            (depth == red_depth ? RB_RED : RB_BLACK));
+    rb_set_right_child(node, right);
+    if (aug != NULL)
+    {
+        aug->update(node);
+    }
+    return node;
+}
+
+void rb_build_sorted_next(RB_ROOT *root, RB_NODE *(*next)(void *arg),
+        void *arg, size_t n)
+{
+    root->rb_root = build(next, arg, n, 0, build_red_depth(n), NULL);
+}
+
+void rb_build_sorted_next_augmented(RB_ROOT *root,
+        RB_NODE *(*next)(void *arg), void *arg, size_t n,
+        const RB_AUGMENT *aug)
+{
+    /* The children are built first, so aug sees them up to date. */
+    root->rb_root = build(next, arg, n, 0, build_red_depth(n), aug);
+}
+
+static RB_NODE *build_array_next(void *arg)
+{
+    RB_NODE ***nodes = arg;
+    return *(*nodes)++;
+}
+
+void rb_build_sorted(RB_ROOT *root, RB_NODE **nodes, size_t n)
+{
+    rb_build_sorted_next(root, build_array_next, &nodes, n);
+}
+
+void rb_build_sorted_augmented(RB_ROOT *root, RB_NODE **nodes, size_t n,
+        const RB_AUGMENT *aug)
+{
+    rb_build_sorted_next_augmented(root, build_array_next, &nodes, n, aug);
+}
+
+/* A subtree with its black height, the number of black nodes on each path
+ * down to a leaf. Its root may be red. */
+typedef struct JOIN_TREE_
+{
+    RB_NODE *node;
+    int bh;
+} JOIN_TREE;
+
+static inline JOIN_TREE join_tree(RB_ROOT *root)
+{
+    JOIN_TREE t = { root->rb_root, 0 };
+    RB_NODE *p;
+    for (p = t.node; p != NULL; p = rb_child(p, RB_LEFT))
+    {
+        t.bh += (rb_color(p) == RB_BLACK);
+    }
+    root->rb_root = NULL;
+    return t;
+}
+
+static inline void join_finish(RB_ROOT *root, JOIN_TREE t)
+{
+    root->rb_root = t.node;
+    if (t.node != NULL)
+    {
+        rb_set_color(t.node, RB_BLACK);
+    }
+}
+
+static inline JOIN_TREE join_child(JOIN_TREE t, int dir)
+{
+    JOIN_TREE c = { rb_child(t.node, dir),
+            t.bh - (rb_color(t.node) == RB_BLACK) };
+    return c;
+}
+
+static inline bool join_is_red(RB_NODE *node)
+{
+    return (node != NULL && rb_color(node) == RB_RED);
+}
+
+static inline void join_node(RB_NODE *node, RB_NODE *left, RB_NODE *right,
+        int color)
+{
+    rb_set_left_child_color(node, left, color);
+    rb_set_right_child(node, right);
+}
+
+static inline void join_update(RB_NODE *node, const RB_AUGMENT *aug)
+{
+    if (aug != NULL)
+    {
+        aug->update(node);
+    }
+}
+
+/* Join t and other, whose black height is not larger, at the spine of t in
+ * direction dir, e.g. the right spine when t is on the left. */
+static RB_NODE *join_spine(RB_NODE *t, int bh, RB_NODE *node, JOIN_TREE other,
+        int dir, const RB_AUGMENT *aug)
+{
+    if (bh == other.bh && !join_is_red(t))
+    {
+        join_node(node, (dir == RB_RIGHT ? t : other.node),
+                (dir == RB_RIGHT ? other.node : t), RB_RED);
+        join_update(node, aug);
+        return node;
+    }
+    RB_NODE *c = join_spine(rb_child(t, dir), bh - (rb_color(t) == RB_BLACK),
+            node, other, dir, aug);
+    rb_set_child(t, dir, c);
+    if (rb_color(t) == RB_BLACK && rb_color(c) == RB_RED
+            && join_is_red(rb_child(c, dir)))
+    {
+        /* Lift the red c over t to fix the red violation below it; t is
+         * now the child of c, so update it first. */
+        rb_set_color(rb_child(c, dir), RB_BLACK);
+        rb_set_child(t, dir, rb_child(c, dir ^ 1));
+        rb_set_child(c, dir ^ 1, t);
+        join_update(t, aug);
+        join_update(c, aug);
+        return c;
+    }
+    join_update(t, aug);
+    return t;
+}
+
+/* All of l before node before all of r, in O(|l.bh - r.bh| + 1). */
+static JOIN_TREE join(JOIN_TREE l, RB_NODE *node, JOIN_TREE r,
+        const RB_AUGMENT *aug)
+{
+    JOIN_TREE t;
+    if (l.bh == r.bh)
+    {
+        int color = (join_is_red(l.node) || join_is_red(r.node)
+                ? RB_BLACK : RB_RED);
+        join_node(node, l.node, r.node, color);
+        join_update(node, aug);
+        t.node = node;
+        t.bh = l.bh + (color == RB_BLACK);
+        return t;
+    }
+    int dir = (l.bh > r.bh ? RB_RIGHT : RB_LEFT);
+    t = (dir == RB_RIGHT ? l : r);
+    t.node = join_spine(t.node, t.bh, node, (dir == RB_RIGHT ? r : l), dir,
+            aug);
+    if (rb_color(t.node) == RB_RED && join_is_red(rb_child(t.node, dir)))
+    {
+        rb_set_color(t.node, RB_BLACK);
+        ++t.bh;
+    }
+    return t;
+}
+
+static RB_NODE *split_last(JOIN_TREE t, JOIN_TREE *rest,
+        const RB_AUGMENT *aug)
+{
+    JOIN_TREE l = join_child(t, RB_LEFT);
+    JOIN_TREE r = join_child(t, RB_RIGHT);
+    if (r.node == NULL)
+    {
+        *rest = l;
+        return t.node;
+    }
+    RB_NODE *last = split_last(r, &r, aug);
+    *rest = join(l, t.node, r, aug);
+    return last;
+}
+
+static JOIN_TREE join2(JOIN_TREE l, JOIN_TREE r, const RB_AUGMENT *aug)
+{
+    if (l.node == NULL)
+    {
+        return r;
+    }
+    RB_NODE *last = split_last(l, &l, aug);
+    return join(l, last, r, aug);
+}
+
+static RB_NODE *split(JOIN_TREE t, const void *key,
+        int (*cmp)(const void *key, RB_NODE *node),
+        JOIN_TREE *l, JOIN_TREE *r, const RB_AUGMENT *aug)
+{
+    if (t.node == NULL)
+    {
+        *l = t;
+        *r = t;
+        return NULL;
+    }
+    JOIN_TREE tl = join_child(t, RB_LEFT);
+    JOIN_TREE tr = join_child(t, RB_RIGHT);
+    int c = cmp(key, t.node);
+    if (c == 0)
+    {
+        *l = tl;
+        *r = tr;
+        return t.node;
+    }
+    JOIN_TREE mid;
+    RB_NODE *found;
+    if (c < 0)
+    {
+        found = split(tl, key, cmp, l, &mid, aug);
+        *r = join(mid, t.node, tr, aug);
+    }
+    else
+    {
+        found = split(tr, key, cmp, &mid, r, aug);
+        *l = join(tl, t.node, mid, aug);
+    }
+    return found;
+}
+
+void rb_join(RB_ROOT *root, RB_ROOT *left, RB_NODE *node, RB_ROOT *right)
+{
+    rb_join_augmented(root, left, node, right, NULL);
+}
+
+void rb_join_augmented(RB_ROOT *root, RB_ROOT *left, RB_NODE *node,
+        RB_ROOT *right, const RB_AUGMENT *aug)
+{
+    JOIN_TREE l = join_tree(left);
+    JOIN_TREE r = join_tree(right);
+    join_finish(root, join(l, node, r, aug));
+}
+
+RB_NODE *rb_split(RB_ROOT *root, const void *key,
+        int (*cmp)(const void *key, RB_NODE *node),
+        RB_ROOT *left, RB_ROOT *right)
+{
+    return rb_split_augmented(root, key, cmp, left, right, NULL);
+}
+
+RB_NODE *rb_split_augmented(RB_ROOT *root, const void *key,
+        int (*cmp)(const void *key, RB_NODE *node),
+        RB_ROOT *left, RB_ROOT *right, const RB_AUGMENT *aug)
+{
+    JOIN_TREE l, r;
+    RB_NODE *found = split(join_tree(root), key, cmp, &l, &r, aug);
+    join_finish(left, l);
+    join_finish(right, r);
+    return found;
+}
+
+enum
+{
+    SETOP_UNION,
+    SETOP_INTERSECTION,
+    SETOP_DIFFERENCE
+};
+
+typedef struct SETOP_TASK_
+{
+    JOIN_TREE a;
+    JOIN_TREE b;
+    int kind;
+    int (*cmp)(const void *key, RB_NODE *node);
+    const RB_SETOP *op;
+} SETOP_TASK;
+
+static void drop_tree(RB_NODE *node, const RB_SETOP *op)
+{
+    if (node != NULL)
+    {
+        RB_NODE *right = rb_child(node, RB_RIGHT);
+        drop_tree(rb_child(node, RB_LEFT), op);
+        op->drop(node, op->arg);
+        drop_tree(right, op);
+    }
+}
+
+static inline void drop_node(RB_NODE *node, const RB_SETOP *op)
+{
+    if (node != NULL && op->drop != NULL)
+    {
+        op->drop(node, op->arg);
+    }
+}
+
+static JOIN_TREE setop(SETOP_TASK *task);
+
+static void setop_run(void *arg)
+{
+    SETOP_TASK *task = arg;
+    task->a = setop(task);
+}
+
+/* Divide b at its root and conquer the halves of a split by it, on both
+ * sides in parallel if b is high enough. */
+static JOIN_TREE setop(SETOP_TASK *task)
+{
+    const RB_SETOP *op = task->op;
+    JOIN_TREE a = task->a;
+    JOIN_TREE b = task->b;
+    if (a.node == NULL || b.node == NULL)
+    {
+        if (task->kind != SETOP_UNION && op->drop != NULL)
+        {
+            drop_tree(b.node, op);
+            if (task->kind == SETOP_INTERSECTION)
+            {
+                drop_tree(a.node, op);
+            }
+        }
+        if (task->kind == SETOP_INTERSECTION)
+        {
+            a.node = NULL;
+            a.bh = 0;
+        }
+        return (task->kind == SETOP_UNION && a.node == NULL ? b : a);
+    }
+    RB_NODE *node = b.node;
+    SETOP_TASK sub[2] = { *task, *task };
+    RB_NODE *found = split(a, node, task->cmp, &sub[0].a, &sub[1].a,
+            op->aug);
+    sub[0].b = join_child(b, RB_LEFT);
+    sub[1].b = join_child(b, RB_RIGHT);
+    if (op->fork2 != NULL && b.bh >= op->fork_height)
+    {
+        op->fork2(op->ctx, setop_run, &sub[0], setop_run, &sub[1]);
+    }
+    else
+    {
+        setop_run(&sub[0]);
+        setop_run(&sub[1]);
+    }
+    switch (task->kind)
+    {
+    case SETOP_UNION:
+        if (found != NULL)
+        {
+            drop_node(node, op);
+            node = found;
+        }
+        return join(sub[0].a, node, sub[1].a, op->aug);
+    case SETOP_INTERSECTION:
+        drop_node(node, op);
+        if (found != NULL)
+        {
+            return join(sub[0].a, found, sub[1].a, op->aug);
+        }
+        return join2(sub[0].a, sub[1].a, op->aug);
+    default:
+        drop_node(node, op);
+        drop_node(found, op);
+        return join2(sub[0].a, sub[1].a, op->aug);
+    }
+}
+
+static void setop_root(RB_ROOT *root, RB_ROOT *a, RB_ROOT *b,
+        int (*cmp)(const void *key, RB_NODE *node), const RB_SETOP *op,
+        int kind)
+{
+    static const RB_SETOP seq = { NULL, NULL, NULL, NULL, 0, NULL };
+    SETOP_TASK task;
+    task.a = join_tree(a);
+    task.b = join_tree(b);
+    task.kind = kind;
+    task.cmp = cmp;
+    task.op = (op != NULL ? op : &seq);
+    join_finish(root, setop(&task));
+}
+
+void rb_union(RB_ROOT *root, RB_ROOT *a, RB_ROOT *b,
+        int (*cmp)(const void *key, RB_NODE *node), const RB_SETOP *op)
+{
+    setop_root(root, a, b, cmp, op, SETOP_UNION);
+}
+
+void rb_intersection(RB_ROOT *root, RB_ROOT *a, RB_ROOT *b,
+        int (*cmp)(const void *key, RB_NODE *node), const RB_SETOP *op)
+{
+    setop_root(root, a, b, cmp, op, SETOP_INTERSECTION);
+}
+
+void rb_difference(RB_ROOT *root, RB_ROOT *a, RB_ROOT *b,
+        int (*cmp)(const void *key, RB_NODE *node), const RB_SETOP *op)
+{
+    setop_root(root, a, b, cmp, op, SETOP_DIFFERENCE);
+}
+
+static void size_update(RB_NODE *node)
+{
+    RB_ENTRY(node, RB_SIZE_NODE, rb_node)->rb_size = 1
+            + rb_size(rb_child(node, RB_LEFT)) + rb_size(rb_child(node, RB_RIGHT));
+}
+
+const RB_AUGMENT rb_size_augment = { size_update };
+
+size_t rb_rank(RB_NODE *node, RB_PATH *rp)
+{
+    size_t rank = rb_size(rb_child(node, RB_LEFT));
+    const RB_PATH_ENTRY *rpe;
+    for (rpe = rp->cur; rpe->parent != NULL; --rpe)
+    {
+        if (rpe->dir == RB_RIGHT)
+        {
+            rank += rb_size(rb_child(rpe->parent, RB_LEFT)) + 1;
+        }
+    }
+    return rank;
+}
+
+RB_NODE *rb_select(RB_ROOT *root, size_t k, RB_PATH *rp)
+{
+    RB_PATH_INIT(rp);
+    RB_NODE *p = root->rb_root;
+    while (p != NULL)
+    {
+        size_t left = rb_size(rb_child(p, RB_LEFT));
+        int dir;
+        if (k < left)
+        {
+            dir = RB_LEFT;
+        }
+        else if (k > left)
+        {
+            k -= left + 1;
+            dir = RB_RIGHT;
+        }
+        else
+        {
+            break;
+        }
+        ++rp->cur;
+        rp->cur->parent = p;
+        rp->cur->dir = dir;
+        p = rb_child(p, dir);
+    }
+    return p;
+}
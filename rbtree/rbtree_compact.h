@@ -40,6 +40,7 @@ SOFTWARE.
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
+#include <string.h>
 
 #define RB_RED      0
 #define RB_BLACK    1
@@ -236,6 +237,374 @@ void rb_insert_color(RB_ROOT *root, RB_PATH *rp);
  */
 void rb_remove(RB_ROOT *root, RB_NODE *node, RB_PATH *rp);
 
+/**
+ * @brief Callbacks to keep per-subtree data up to date.
+ *
+ * \a update recomputes the data of a node from its own and its children's
+ * data. It is called bottom-up on the path changed by an insertion or a
+ * removal, and on both nodes of each rotation.
+ */
+typedef struct RB_AUGMENT_
+{
+    void (*update)(RB_NODE *node);
+} RB_AUGMENT;
+/**@}*/
+
+void rb_insert_color_augmented(RB_ROOT *root, RB_NODE *node, RB_PATH *rp,
+        const RB_AUGMENT *aug);
+
+/**
+ * @addtogroup rbtree
+ * @{
+ */
+/**
+ * @brief Remove a node from an augmented red black tree.
+ *
+ * Same as #rb_remove, and updates the data of \a aug.
+ * @param root Red black tree root.
+ * @param node The red black tree node to be removed.
+ * @param rp The corresponding iteration context of \p node.
+ * @param aug Augmentation of the tree.
+ */
+void rb_remove_augmented(RB_ROOT *root, RB_NODE *node, RB_PATH *rp,
+        const RB_AUGMENT *aug);
+
+/**
+ * @brief Red black tree node with its subtree size, for order statistics.
+ *
+ * Embed it instead of #RB_NODE and generate the functions by #RB_GEN_SIZE,
+ * with \a field naming its \c rb_node, e.g. \c snode.rb_node.
+ */
+typedef struct RB_SIZE_NODE_
+{
+    RB_NODE rb_node;
+    size_t rb_size;
+} RB_SIZE_NODE;
+
+/**@brief Augmentation maintaining #RB_SIZE_NODE. */
+extern const RB_AUGMENT rb_size_augment;
+
+/**
+ * @brief Get the number of nodes in a subtree of #RB_SIZE_NODE.
+ * @param node Root of the subtree, or \c NULL.
+ * @return Number of nodes.
+ */
+static inline size_t rb_size(RB_NODE *node)
+{
+    return (node != NULL ? RB_ENTRY(node, RB_SIZE_NODE, rb_node)->rb_size : 0);
+}
+
+/**
+ * @brief Get the index of a node in order, in O(log n).
+ * @param node A node of a tree of #RB_SIZE_NODE.
+ * @param rp The iteration context of \p node.
+ * @return Number of nodes before \p node.
+ */
+size_t rb_rank(RB_NODE *node, RB_PATH *rp);
+
+/**
+ * @brief Get the node of an index in order, in O(log n).
+ * @param root Root of a tree of #RB_SIZE_NODE.
+ * @param k Index of the node.
+ * @param rp The returned context used for iteration.
+ * @return The node, or \c NULL if \p k is not less than the number of nodes.
+ */
+RB_NODE *rb_select(RB_ROOT *root, size_t k, RB_PATH *rp);
+
+/**
+ * @brief Red black tree root caching the leftmost and the rightmost nodes.
+ *
+ * The minimum and the maximum are found in O(1). The path of the leftmost
+ * node is cached too, and rebuilt only when an insertion or a removal may
+ * have rotated it, so removing the minimum repeatedly needs no search. Use
+ * it with #RB_GEN_CACHED, or insert and remove the nodes by
+ * #rb_insert_color_cached and #rb_remove_cached.
+ */
+typedef struct RB_ROOT_CACHED_
+{
+    RB_ROOT rb_root;
+    RB_NODE *rb_leftmost;
+    RB_NODE *rb_rightmost;
+    /** Path of \c rb_leftmost, stale if its \c cur is \c NULL. */
+    RB_PATH rb_path;
+} RB_ROOT_CACHED;
+
+/**
+ * @brief Initializer for cached red black tree root.
+ * @param root Pointer to the cached red black tree root.
+ */
+#define RB_ROOT_CACHED_INITIALIZER(root) \
+    { { NULL }, NULL, NULL, { { { NULL, 0 } }, NULL } }
+/**
+ * @brief Initialize a cached red black tree root.
+ * @param root Pointer to the cached red black tree root.
+ */
+#define RB_ROOT_CACHED_INIT(root) \
+    do \
+    { \
+        RB_ROOT_INIT(&(root)->rb_root); \
+        (root)->rb_leftmost = NULL; \
+        (root)->rb_rightmost = NULL; \
+        (root)->rb_path.cur = NULL; \
+    } while (0)
+
+/**
+ * @brief Get first node in the tree, in O(1).
+ * @param root Cached tree root.
+ * @param rp The returned context used for iteration, or \c NULL if not
+ * needed. It is copied from the cached path, which is rebuilt first if
+ * stale.
+ * @return The first node, or \c NULL if the tree is empty.
+ */
+RB_NODE *rb_first_cached(RB_ROOT_CACHED *root, RB_PATH *rp);
+
+/**
+ * @brief Get last node in the tree, in O(1).
+ * @param root Cached tree root.
+ * @param rp The returned context used for iteration, or \c NULL if not
+ * needed. It is not cached and costs O(log n).
+ * @return The last node, or \c NULL if the tree is empty.
+ */
+static inline RB_NODE *rb_last_cached(RB_ROOT_CACHED *root, RB_PATH *rp)
+{
+    return (rp != NULL ? rb_last(&root->rb_root, rp) : root->rb_rightmost);
+}
+
+/**
+ * @brief Rebalance a cached tree after linking a leaf.
+ *
+ * Same as #rb_insert_color, and updates the cached nodes.
+ * @param root Cached tree root.
+ * @param node The linked leaf.
+ * @param rp The context of \p node, ending at its parent.
+ */
+void rb_insert_color_cached(RB_ROOT_CACHED *root, RB_NODE *node,
+        RB_PATH *rp);
+
+/**
+ * @brief Remove a node from a cached tree.
+ *
+ * Same as #rb_remove, and updates the cached nodes.
+ * @param root Cached tree root.
+ * @param node The red black tree node to be removed.
+ * @param rp The corresponding iteration context of \p node.
+ */
+void rb_remove_cached(RB_ROOT_CACHED *root, RB_NODE *node, RB_PATH *rp);
+
+/**
+ * @brief Remove the first node from a cached tree.
+ * @param root Cached tree root.
+ * @return The removed node, or \c NULL if the tree is empty.
+ */
+RB_NODE *rb_pop_first_cached(RB_ROOT_CACHED *root);
+
+/**
+ * @brief Build a tree from nodes already in order, in O(n).
+ *
+ * The nodes are linked without calling any comparator. The tree is balanced
+ * by splitting at the middle, so only its deepest level can be incomplete;
+ * that level is colored red and the others black.
+ * @param root Empty red black tree root.
+ * @param nodes Array of the nodes in order.
+ * @param n Number of nodes.
+ */
+void rb_build_sorted(RB_ROOT *root, RB_NODE **nodes, size_t n);
+
+/**
+ * @brief Build a tree from nodes already in order, in O(n).
+ *
+ * Same as #rb_build_sorted, with the nodes returned one by one by \p next.
+ * @param root Empty red black tree root.
+ * @param next Callback returning the next node in order.
+ * @param arg Argument of \p next.
+ * @param n Number of nodes.
+ */
+void rb_build_sorted_next(RB_ROOT *root, RB_NODE *(*next)(void *arg),
+        void *arg, size_t n);
+
+/**
+ * @brief Build an augmented tree from nodes already in order, in O(n).
+ *
+ * Same as #rb_build_sorted, and calls \p aug on each node after both of its
+ * children, so the data of \p aug, e.g. #rb_size, is up to date.
+ * @param root Empty red black tree root.
+ * @param nodes Array of the nodes in order.
+ * @param n Number of nodes.
+ * @param aug Augmentation of the tree.
+ */
+void rb_build_sorted_augmented(RB_ROOT *root, RB_NODE **nodes, size_t n,
+        const RB_AUGMENT *aug);
+
+/**
+ * @brief Build an augmented tree from nodes already in order, in O(n).
+ *
+ * Same as #rb_build_sorted_next, and calls \p aug as
+ * #rb_build_sorted_augmented.
+ * @param root Empty red black tree root.
+ * @param next Callback returning the next node in order.
+ * @param arg Argument of \p next.
+ * @param n Number of nodes.
+ * @param aug Augmentation of the tree.
+ */
+void rb_build_sorted_next_augmented(RB_ROOT *root,
+        RB_NODE *(*next)(void *arg), void *arg, size_t n,
+        const RB_AUGMENT *aug);
+
+/**
+ * @brief Join two trees and a node between them, in O(log n).
+ *
+ * The nodes are relinked without their augmentation; use
+ * #rb_join_augmented on an augmented tree.
+ * @param root The joined tree root. It may be \p left or \p right.
+ * @param left Tree of the nodes before \p node. It is emptied.
+ * @param node The node to join.
+ * @param right Tree of the nodes after \p node. It is emptied.
+ */
+void rb_join(RB_ROOT *root, RB_ROOT *left, RB_NODE *node, RB_ROOT *right);
+
+/**
+ * @brief Join two augmented trees and a node between them, in O(log n).
+ *
+ * Same as #rb_join, and calls \p aug on each node whose children change.
+ * @param root The joined tree root. It may be \p left or \p right.
+ * @param left Tree of the nodes before \p node. It is emptied.
+ * @param node The node to join.
+ * @param right Tree of the nodes after \p node. It is emptied.
+ * @param aug Augmentation of the trees.
+ */
+void rb_join_augmented(RB_ROOT *root, RB_ROOT *left, RB_NODE *node,
+        RB_ROOT *right, const RB_AUGMENT *aug);
+
+/**
+ * @brief Split a tree by a key, in O(log n).
+ *
+ * The nodes are relinked without their augmentation; use
+ * #rb_split_augmented on an augmented tree.
+ * @param root Red black tree root. It is emptied.
+ * @param key The key to split at.
+ * @param cmp Comparator for \p key and a node, as the \a key_cmp of #RB_GEN.
+ * @param left The returned tree of the nodes before \p key.
+ * @param right The returned tree of the nodes after \p key.
+ * @return The node equal to \p key, which is in neither tree, or \c NULL.
+ */
+RB_NODE *rb_split(RB_ROOT *root, const void *key,
+        int (*cmp)(const void *key, RB_NODE *node),
+        RB_ROOT *left, RB_ROOT *right);
+
+/**
+ * @brief Split an augmented tree by a key, in O(log n).
+ *
+ * Same as #rb_split, and calls \p aug on each node whose children change.
+ * @param root Red black tree root. It is emptied.
+ * @param key The key to split at.
+ * @param cmp Comparator for \p key and a node, as the \a key_cmp of #RB_GEN.
+ * @param left The returned tree of the nodes before \p key.
+ * @param right The returned tree of the nodes after \p key.
+ * @param aug Augmentation of the trees.
+ * @return The node equal to \p key, which is in neither tree, or \c NULL.
+ */
+RB_NODE *rb_split_augmented(RB_ROOT *root, const void *key,
+        int (*cmp)(const void *key, RB_NODE *node),
+        RB_ROOT *left, RB_ROOT *right, const RB_AUGMENT *aug);
+
+/**
+ * @brief Options of the set operations.
+ *
+ * Pass \c NULL to the set operations for the defaults, all zero.
+ */
+typedef struct RB_SETOP_
+{
+    /**
+     * Called, if not \c NULL, on each node left out of the result.
+     * Without it the left out subtrees are not visited at all, which keeps
+     * the bound of #rb_intersection and #rb_difference.
+     */
+    void (*drop)(RB_NODE *node, void *arg);
+    /** Argument of \a drop. */
+    void *arg;
+    /**
+     * If not \c NULL, runs \a func_a(\a arg_a) and \a func_b(\a arg_b),
+     * possibly in parallel, and returns when both are done, e.g.
+     * thread_pool_fork2() of array_utils with \a ctx as the pool. \a drop
+     * is then called from concurrent tasks.
+     */
+    void (*fork2)(void *ctx, void (*func_a)(void *), void *arg_a,
+            void (*func_b)(void *), void *arg_b);
+    /** Context of \a fork2. */
+    void *ctx;
+    /**
+     * Least black height of a subtree of \a b to fork for, i.e. of at least
+     * 2^fork_height - 1 nodes.
+     */
+    int fork_height;
+    /**
+     * If not \c NULL, the augmentation of \a a, \a b and the result,
+     * called on each node whose children change.
+     */
+    const RB_AUGMENT *aug;
+} RB_SETOP;
+
+/**
+ * @brief Union of two trees, in O(m log(n/m + 1)) for m <= n nodes.
+ *
+ * A node of \p a is kept over an equal node of \p b.
+ * @param root The result tree root. It may be \p a or \p b.
+ * @param a Red black tree root. It is emptied.
+ * @param b Red black tree root. It is emptied.
+ * @param cmp Comparator for a node of \p b, passed as the key, and a node of
+ * \p a, as the \a key_cmp of #RB_GEN.
+ * @param op Options, or \c NULL.
+ */
+void rb_union(RB_ROOT *root, RB_ROOT *a, RB_ROOT *b,
+        int (*cmp)(const void *key, RB_NODE *node), const RB_SETOP *op);
+
+/**
+ * @brief Intersection of two trees, in O(m log(n/m + 1)) for m <= n nodes.
+ *
+ * The nodes of \p a equal to a node of \p b are kept.
+ * @param root The result tree root. It may be \p a or \p b.
+ * @param a Red black tree root. It is emptied.
+ * @param b Red black tree root. It is emptied.
+ * @param cmp Comparator as #rb_union.
+ * @param op Options, or \c NULL.
+ */
+void rb_intersection(RB_ROOT *root, RB_ROOT *a, RB_ROOT *b,
+        int (*cmp)(const void *key, RB_NODE *node), const RB_SETOP *op);
+
+/**
+ * @brief Difference of two trees, in O(m log(n/m + 1)) for m <= n nodes.
+ *
+ * The nodes of \p a not equal to any node of \p b are kept.
+ * @param root The result tree root. It may be \p a or \p b.
+ * @param a Red black tree root. It is emptied.
+ * @param b Red black tree root. It is emptied.
+ * @param cmp Comparator as #rb_union.
+ * @param op Options, or \c NULL.
+ */
+void rb_difference(RB_ROOT *root, RB_ROOT *a, RB_ROOT *b,
+        int (*cmp)(const void *key, RB_NODE *node), const RB_SETOP *op);
+
+/* The options of a set operation with aug, which the generated wrappers of
+ * an augmented tree pass on. */
+static inline const RB_SETOP *_rb_setop_augmented(const RB_SETOP *op,
+        const RB_AUGMENT *aug, RB_SETOP *buf)
+{
+    if (aug == NULL)
+    {
+        return op;
+    }
+    if (op != NULL)
+    {
+        *buf = *op;
+    }
+    else
+    {
+        memset(buf, 0, sizeof(*buf));
+    }
+    buf->aug = aug;
+    return buf;
+}
+
 /**
  * @brief Insert a node into the red black tree.
  *
@@ -265,16 +634,92 @@ void rb_remove(RB_ROOT *root, RB_NODE *node, RB_PATH *rp);
  * @return Pointer to the container, or \c NULL if not found.
  */
 #define RB_FIND(name, root, key, rp) name##_rb_find(root, key, rp)
+/**
+ * @brief Count the nodes less than a key in a tree of #RB_SIZE_NODE.
+ * @param name Identifier.
+ * @param root Pointer to the red black tree root.
+ * @param key The key to compare.
+ * @return Number of nodes less than \p key.
+ */
+#define RB_COUNT_LESS(name, root, key) name##_rb_count_less(root, key)
+/**
+ * @brief Count the nodes in a key range in a tree of #RB_SIZE_NODE.
+ * @param name Identifier.
+ * @param root Pointer to the red black tree root.
+ * @param lo Inclusive lower bound.
+ * @param hi Exclusive upper bound.
+ * @return Number of nodes not less than \p lo and less than \p hi.
+ */
+#define RB_COUNT_RANGE(name, root, lo, hi) name##_rb_count_range(root, lo, hi)
+/**
+ * @brief Find the first node not less than a key.
+ * @param name Identifier.
+ * @param root Pointer to the red black tree root.
+ * @param key The key to search nodes.
+ * @param rp Pointer to #RB_PATH to store the context for iteration.
+ * @return Pointer to the container, or \c NULL if all nodes are less than
+ * \p key.
+ */
+#define RB_LOWER_BOUND(name, root, key, rp) \
+    name##_rb_lower_bound(root, key, rp)
+/**
+ * @brief Find the first node greater than a key.
+ * @param name Identifier.
+ * @param root Pointer to the red black tree root.
+ * @param key The key to search nodes.
+ * @param rp Pointer to #RB_PATH to store the context for iteration.
+ * @return Pointer to the container, or \c NULL if no node is greater than
+ * \p key.
+ */
+#define RB_UPPER_BOUND(name, root, key, rp) \
+    name##_rb_upper_bound(root, key, rp)
+/**
+ * @brief Find the first node in a key range.
+ *
+ * Iterating by #RB_RANGE_NEXT then visits the k nodes of the range in
+ * O(log n + k).
+ * @param name Identifier.
+ * @param root Pointer to the red black tree root.
+ * @param lo Inclusive lower bound.
+ * @param hi Exclusive upper bound.
+ * @param rp Pointer to #RB_PATH to store the context for iteration.
+ * @return Pointer to the container, or \c NULL if the range is empty.
+ */
+#define RB_RANGE_FIRST(name, root, lo, hi, rp) \
+    name##_rb_range_first(root, lo, hi, rp)
+/**
+ * @brief Get the next node in a key range.
+ * @param name Identifier.
+ * @param node The container returned by the previous iteration.
+ * @param hi Exclusive upper bound.
+ * @param rp The context of \p node, updated for the returned one.
+ * @return Pointer to the container, or \c NULL at the end of the range.
+ */
+#define RB_RANGE_NEXT(name, node, hi, rp) name##_rb_range_next(node, hi, rp)
+/**
+ * @brief Trace hook of the generated functions.
+ *
+ * It is empty by default. Define it before generating the functions, or
+ * include array_trace.h with \c ARRAY_TRACE_HOOKS defined, to record each
+ * operation.
+ * @param op Operation token: \c INSERT, \c REMOVE or \c FIND.
+ * @param root Pointer to the red black tree root.
+ * @param node Pointer to the container returned by the operation.
+ */
+#ifndef RB_TRACE
+#define RB_TRACE(op, root, node)
+#endif
 /**@}*/
 
 #define RB_GENERATE_INSERT_PROTO(name, type) \
 type *name##_rb_insert(RB_ROOT *root, type *node)
-#define RB_GENERATE_INSERT(name, type, field, cmp) \
-RB_GENERATE_INSERT_PROTO(name, type) \
+#define _RB_GENERATE_INSERT_IMPL(name, root_type, tree, type, field, cmp, \
+        insert_color) \
+type *name##_rb_insert(root_type *root, type *node) \
 { \
     RB_PATH rp; \
     RB_PATH_INIT(&rp); \
-    RB_NODE *p = root->rb_root; \
+    RB_NODE *p = (tree)->rb_root; \
     if (p != NULL) \
     { \
         int dir; \
@@ -292,6 +737,7 @@ RB_GENERATE_INSERT_PROTO(name, type) \
             } \
             else \
             { \
+                RB_TRACE(INSERT, root, ent); \
                 return ent; \
             } \
             ++rp.cur; \
@@ -303,21 +749,29 @@ RB_GENERATE_INSERT_PROTO(name, type) \
     } \
     else \
     { \
-        root->rb_root = &node->field; \
+        (tree)->rb_root = &node->field; \
     } \
     rb_set_left_child_color(&node->field, NULL, RB_RED); \
     rb_set_right_child(&node->field, NULL); \
-    rb_insert_color(root, &rp); \
+    RB_TRACE(INSERT, root, node); \
+    insert_color; \
     return node; \
 }
+#define RB_GENERATE_INSERT(name, type, field, cmp) \
+_RB_GENERATE_INSERT_IMPL(name, RB_ROOT, root, type, field, cmp, \
+        rb_insert_color(root, &rp))
+#define RB_GENERATE_INSERT_AUGMENTED(name, type, field, cmp, aug) \
+_RB_GENERATE_INSERT_IMPL(name, RB_ROOT, root, type, field, cmp, \
+        rb_insert_color_augmented(root, &node->field, &rp, aug))
 
 #define RB_GENERATE_FIND_PROTO(name, key_type, type) \
 type *name##_rb_find(RB_ROOT *root, key_type key, RB_PATH *rp)
-#define RB_GENERATE_FIND(name, key_type, type, field, key_cmp) \
-RB_GENERATE_FIND_PROTO(name, key_type, type) \
+#define _RB_GENERATE_FIND_IMPL(name, root_type, tree, key_type, type, field, \
+        key_cmp) \
+type *name##_rb_find(root_type *root, key_type key, RB_PATH *rp) \
 { \
     RB_PATH_INIT(rp); \
-    RB_NODE *p = root->rb_root; \
+    RB_NODE *p = (tree)->rb_root; \
     while (p != NULL) \
     { \
         int dir; \
@@ -333,6 +787,7 @@ RB_GENERATE_FIND_PROTO(name, key_type, type) \
         } \
         else \
         { \
+            RB_TRACE(FIND, root, ent); \
             return ent; \
         } \
         ++rp->cur; \
@@ -340,22 +795,119 @@ RB_GENERATE_FIND_PROTO(name, key_type, type) \
         rp->cur->dir = dir; \
         p = rb_child(p, dir); \
     } \
+    RB_TRACE(FIND, root, NULL); \
     return NULL; \
 }
+#define RB_GENERATE_FIND(name, key_type, type, field, key_cmp) \
+_RB_GENERATE_FIND_IMPL(name, RB_ROOT, root, key_type, type, field, key_cmp)
 
 #define RB_GENERATE_REMOVE_PROTO(name, key_type, type) \
 type *name##_rb_remove(RB_ROOT *root, key_type key)
-#define RB_GENERATE_REMOVE(name, key_type, type, field) \
-RB_GENERATE_REMOVE_PROTO(name, key_type, type) \
+#define _RB_GENERATE_REMOVE_IMPL(name, root_type, key_type, type, remove) \
+type *name##_rb_remove(root_type *root, key_type key) \
 { \
     RB_PATH rp; \
     type *node = RB_FIND(name, root, key, &rp); \
     if (node != NULL) \
     { \
-        rb_remove(root, &node->field, &rp); \
+        remove; \
     } \
+    RB_TRACE(REMOVE, root, node); \
     return node; \
 }
+#define RB_GENERATE_REMOVE(name, key_type, type, field) \
+_RB_GENERATE_REMOVE_IMPL(name, RB_ROOT, key_type, type, \
+        rb_remove(root, &node->field, &rp))
+#define RB_GENERATE_REMOVE_AUGMENTED(name, key_type, type, field, aug) \
+_RB_GENERATE_REMOVE_IMPL(name, RB_ROOT, key_type, type, \
+        rb_remove_augmented(root, &node->field, &rp, aug))
+
+#define RB_GENERATE_COUNT_PROTO(name, key_type) \
+size_t name##_rb_count_less(RB_ROOT *root, key_type key); \
+size_t name##_rb_count_range(RB_ROOT *root, key_type lo, key_type hi)
+#define RB_GENERATE_COUNT(name, key_type, type, field, key_cmp) \
+size_t name##_rb_count_less(RB_ROOT *root, key_type key) \
+{ \
+    size_t cnt = 0; \
+    RB_NODE *p = root->rb_root; \
+    while (p != NULL) \
+    { \
+        type *ent = RB_ENTRY(p, type, field); \
+        if (key_cmp(key, ent) > 0) \
+        { \
+            cnt += rb_size(rb_child(p, RB_LEFT)) + 1; \
+            p = rb_child(p, RB_RIGHT); \
+        } \
+        else \
+        { \
+            p = rb_child(p, RB_LEFT); \
+        } \
+    } \
+    return cnt; \
+} \
+size_t name##_rb_count_range(RB_ROOT *root, key_type lo, key_type hi) \
+{ \
+    size_t n_lo = name##_rb_count_less(root, lo); \
+    size_t n_hi = name##_rb_count_less(root, hi); \
+    return (n_hi > n_lo ? n_hi - n_lo : 0); \
+}
+
+#define RB_GENERATE_BOUND_PROTO(name, key_type, type) \
+type *name##_rb_lower_bound(RB_ROOT *root, key_type key, RB_PATH *rp); \
+type *name##_rb_upper_bound(RB_ROOT *root, key_type key, RB_PATH *rp); \
+type *name##_rb_range_first(RB_ROOT *root, key_type lo, key_type hi, \
+        RB_PATH *rp); \
+type *name##_rb_range_next(type *node, key_type hi, RB_PATH *rp)
+#define _RB_GENERATE_BOUND_IMPL(name, bound, key_type, type, field, key_cmp, \
+        op) \
+type *name##_rb_##bound(RB_ROOT *root, key_type key, RB_PATH *rp) \
+{ \
+    type *found = NULL; \
+    RB_PATH_INIT(rp); \
+    RB_PATH_ENTRY *found_cur = rp->cur; \
+    RB_NODE *p = root->rb_root; \
+    while (p != NULL) \
+    { \
+        int dir = RB_RIGHT; \
+        type *ent = RB_ENTRY(p, type, field); \
+        if (key_cmp(key, ent) op 0) \
+        { \
+            found = ent; \
+            found_cur = rp->cur; \
+            dir = RB_LEFT; \
+        } \
+        ++rp->cur; \
+        rp->cur->parent = p; \
+        rp->cur->dir = dir; \
+        p = rb_child(p, dir); \
+    } \
+    /* The entries up to found_cur are still the path of found. */ \
+    rp->cur = found_cur; \
+    RB_TRACE(FIND, root, found); \
+    return found; \
+}
+#define RB_GENERATE_BOUND(name, key_type, type, field, key_cmp) \
+_RB_GENERATE_BOUND_IMPL(name, lower_bound, key_type, type, field, key_cmp, \
+        <=) \
+_RB_GENERATE_BOUND_IMPL(name, upper_bound, key_type, type, field, key_cmp, \
+        <) \
+type *name##_rb_range_first(RB_ROOT *root, key_type lo, key_type hi, \
+        RB_PATH *rp) \
+{ \
+    type *node = name##_rb_lower_bound(root, lo, rp); \
+    key_type key = hi; /* key_cmp may be a macro naming its argument key */ \
+    return (node != NULL && key_cmp(key, node) > 0 ? node : NULL); \
+} \
+type *name##_rb_range_next(type *node, key_type hi, RB_PATH *rp) \
+{ \
+    RB_NODE *p = rb_next(&node->field, rp); \
+    key_type key = hi; \
+    if (p == NULL || key_cmp(key, RB_ENTRY(p, type, field)) <= 0) \
+    { \
+        return NULL; \
+    } \
+    return RB_ENTRY(p, type, field); \
+}
 
 /**
  * @addtogroup rbtree
@@ -373,7 +925,8 @@ RB_GENERATE_REMOVE_PROTO(name, key_type, type) \
 #define RB_GEN_PROTO(name, key_type, type) \
 RB_GENERATE_INSERT_PROTO(name, type); \
 RB_GENERATE_REMOVE_PROTO(name, key_type, type); \
-RB_GENERATE_FIND_PROTO(name, key_type, type);
+RB_GENERATE_FIND_PROTO(name, key_type, type); \
+RB_GENERATE_BOUND_PROTO(name, key_type, type);
 
 /**
  * @brief Generator for red black tree implementation.
@@ -397,7 +950,602 @@ RB_GENERATE_FIND_PROTO(name, key_type, type);
 #define RB_GEN(name, key_type, type, field, key_cmp, cmp) \
 RB_GENERATE_INSERT(name, type, field, cmp) \
 RB_GENERATE_FIND(name, key_type, type, field, key_cmp) \
-RB_GENERATE_REMOVE(name, key_type, type, field)
+RB_GENERATE_REMOVE(name, key_type, type, field) \
+RB_GENERATE_BOUND(name, key_type, type, field, key_cmp)
+
+/**
+ * @brief Generator for augmented red black tree implementation.
+ *
+ * Same as #RB_GEN, and the insertion and the removal keep the data of
+ * \a aug up to date.
+ * @param name Identifier.
+ * @param key_type Type of key.
+ * @param type Type of the container of #RB_NODE.
+ * @param field Member name of #RB_NODE in the container.
+ * @param key_cmp Comparator for key and node, as #RB_GEN.
+ * @param cmp Comparator for two nodes, as #RB_GEN.
+ * @param aug Pointer to the #RB_AUGMENT of the tree.
+ */
+#define RB_GEN_AUGMENTED(name, key_type, type, field, key_cmp, cmp, aug) \
+RB_GENERATE_INSERT_AUGMENTED(name, type, field, cmp, aug) \
+RB_GENERATE_FIND(name, key_type, type, field, key_cmp) \
+RB_GENERATE_REMOVE_AUGMENTED(name, key_type, type, field, aug) \
+RB_GENERATE_BOUND(name, key_type, type, field, key_cmp)
+
+/**
+ * @brief Generator for order statistic tree declaration.
+ * @param name Identifier.
+ * @param key_type Type of key.
+ * @param type Type of structure containing #RB_SIZE_NODE.
+ */
+#define RB_GEN_SIZE_PROTO(name, key_type, type) \
+RB_GEN_PROTO(name, key_type, type) \
+RB_GENERATE_COUNT_PROTO(name, key_type);
+
+/**
+ * @brief Generator for order statistic tree implementation.
+ *
+ * Same as #RB_GEN for a container of #RB_SIZE_NODE, and generates
+ * #RB_COUNT_LESS and #RB_COUNT_RANGE.
+ * @param name Identifier.
+ * @param key_type Type of key.
+ * @param type Type of the container of #RB_SIZE_NODE.
+ * @param field Member name of the \c rb_node of #RB_SIZE_NODE in the
+ * container.
+ * @param key_cmp Comparator for key and node, as #RB_GEN.
+ * @param cmp Comparator for two nodes, as #RB_GEN.
+ */
+#define RB_GEN_SIZE(name, key_type, type, field, key_cmp, cmp) \
+RB_GEN_AUGMENTED(name, key_type, type, field, key_cmp, cmp, &rb_size_augment) \
+RB_GENERATE_COUNT(name, key_type, type, field, key_cmp)
+/**@}*/
+
+/**
+ * @addtogroup rbtree
+ * @{
+ */
+/**
+ * @brief Remove the first node from a cached red black tree.
+ * @param name Identifier.
+ * @param root Pointer to the cached red black tree root.
+ * @return Pointer to the container removed, or \c NULL if the tree is empty.
+ */
+#define RB_POP_FIRST(name, root) name##_rb_pop_first(root)
+
+/**
+ * @brief Generator for cached red black tree declaration.
+ * @param name Identifier.
+ * @param key_type Type of key.
+ * @param type Type of structure containing #RB_NODE.
+ */
+#define RB_GEN_CACHED_PROTO(name, key_type, type) \
+type *name##_rb_insert(RB_ROOT_CACHED *root, type *node); \
+type *name##_rb_remove(RB_ROOT_CACHED *root, key_type key); \
+type *name##_rb_find(RB_ROOT_CACHED *root, key_type key, RB_PATH *rp); \
+type *name##_rb_pop_first(RB_ROOT_CACHED *root);
+
+/**
+ * @brief Generator for cached red black tree implementation.
+ *
+ * Same as #RB_GEN on a #RB_ROOT_CACHED, and generates #RB_POP_FIRST.
+ * @param name Identifier.
+ * @param key_type Type of key.
+ * @param type Type of the container of #RB_NODE.
+ * @param field Member name of #RB_NODE in the container.
+ * @param key_cmp Comparator for key and node, as #RB_GEN.
+ * @param cmp Comparator for two nodes, as #RB_GEN.
+ */
+#define RB_GEN_CACHED(name, key_type, type, field, key_cmp, cmp) \
+_RB_GENERATE_INSERT_IMPL(name, RB_ROOT_CACHED, &root->rb_root, type, field, \
+        cmp, rb_insert_color_cached(root, &node->field, &rp)) \
+_RB_GENERATE_FIND_IMPL(name, RB_ROOT_CACHED, &root->rb_root, key_type, type, \
+        field, key_cmp) \
+_RB_GENERATE_REMOVE_IMPL(name, RB_ROOT_CACHED, key_type, type, \
+        rb_remove_cached(root, &node->field, &rp)) \
+type *name##_rb_pop_first(RB_ROOT_CACHED *root) \
+{ \
+    RB_NODE *p = rb_pop_first_cached(root); \
+    type *node = (p != NULL ? RB_ENTRY(p, type, field) : NULL); \
+    RB_TRACE(REMOVE, root, node); \
+    return node; \
+}
+/**@}*/
+
+#define _RB_GENERATE_JOIN_IMPL(name, key_type, type, field, key_cmp, cmp, \
+        aug) \
+static int name##_rb_join_key_cmp(const void *key, RB_NODE *node) \
+{ \
+    return key_cmp(*(key_type *) key, RB_ENTRY(node, type, field)); \
+} \
+static int name##_rb_join_cmp(const void *key, RB_NODE *node) \
+{ \
+    return cmp(RB_ENTRY((RB_NODE *) key, type, field), \
+            RB_ENTRY(node, type, field)); \
+} \
+void name##_rb_join(RB_ROOT *root, RB_ROOT *left, type *node, \
+        RB_ROOT *right) \
+{ \
+    rb_join_augmented(root, left, &node->field, right, aug); \
+} \
+type *name##_rb_split(RB_ROOT *root, key_type key, RB_ROOT *left, \
+        RB_ROOT *right) \
+{ \
+    RB_NODE *p = rb_split_augmented(root, &key, name##_rb_join_key_cmp, \
+            left, right, aug); \
+    return (p != NULL ? RB_ENTRY(p, type, field) : NULL); \
+} \
+void name##_rb_union(RB_ROOT *root, RB_ROOT *a, RB_ROOT *b, \
+        const RB_SETOP *op) \
+{ \
+    RB_SETOP buf; \
+    rb_union(root, a, b, name##_rb_join_cmp, \
+            _rb_setop_augmented(op, aug, &buf)); \
+} \
+void name##_rb_intersection(RB_ROOT *root, RB_ROOT *a, RB_ROOT *b, \
+        const RB_SETOP *op) \
+{ \
+    RB_SETOP buf; \
+    rb_intersection(root, a, b, name##_rb_join_cmp, \
+            _rb_setop_augmented(op, aug, &buf)); \
+} \
+void name##_rb_difference(RB_ROOT *root, RB_ROOT *a, RB_ROOT *b, \
+        const RB_SETOP *op) \
+{ \
+    RB_SETOP buf; \
+    rb_difference(root, a, b, name##_rb_join_cmp, \
+            _rb_setop_augmented(op, aug, &buf)); \
+}
+
+/**
+ * @addtogroup rbtree
+ * @{
+ */
+/**
+ * @brief Join two trees and a node between them.
+ * @param name Identifier.
+ * @param root Pointer to the joined tree root.
+ * @param left Pointer to the tree root of the nodes before \p node.
+ * @param node The container to join.
+ * @param right Pointer to the tree root of the nodes after \p node.
+ * @sa rb_join
+ */
+#define RB_JOIN(name, root, left, node, right) \
+    name##_rb_join(root, left, node, right)
+/**
+ * @brief Split a tree by a key.
+ * @param name Identifier.
+ * @param root Pointer to the red black tree root.
+ * @param key The key to split at.
+ * @param left Pointer to the returned tree root of the nodes before \p key.
+ * @param right Pointer to the returned tree root of the nodes after \p key.
+ * @return Pointer to the container equal to \p key, or \c NULL.
+ * @sa rb_split
+ */
+#define RB_SPLIT(name, root, key, left, right) \
+    name##_rb_split(root, key, left, right)
+/**
+ * @brief Union of two trees.
+ * @param name Identifier.
+ * @param root Pointer to the result tree root.
+ * @param a Pointer to the red black tree root.
+ * @param b Pointer to the red black tree root.
+ * @param op Pointer to the #RB_SETOP options, or \c NULL.
+ * @sa rb_union
+ */
+#define RB_UNION(name, root, a, b, op) name##_rb_union(root, a, b, op)
+/**
+ * @brief Intersection of two trees.
+ * @param name Identifier.
+ * @param root Pointer to the result tree root.
+ * @param a Pointer to the red black tree root.
+ * @param b Pointer to the red black tree root.
+ * @param op Pointer to the #RB_SETOP options, or \c NULL.
+ * @sa rb_intersection
+ */
+#define RB_INTERSECTION(name, root, a, b, op) \
+    name##_rb_intersection(root, a, b, op)
+/**
+ * @brief Difference of two trees.
+ * @param name Identifier.
+ * @param root Pointer to the result tree root.
+ * @param a Pointer to the red black tree root.
+ * @param b Pointer to the red black tree root.
+ * @param op Pointer to the #RB_SETOP options, or \c NULL.
+ * @sa rb_difference
+ */
+#define RB_DIFFERENCE(name, root, a, b, op) \
+    name##_rb_difference(root, a, b, op)
+
+/**
+ * @brief Generator for join-based operations declaration.
+ * @param name Identifier.
+ * @param key_type Type of key.
+ * @param type Type of structure containing #RB_NODE.
+ */
+#define RB_GEN_JOIN_PROTO(name, key_type, type) \
+void name##_rb_join(RB_ROOT *root, RB_ROOT *left, type *node, \
+        RB_ROOT *right); \
+type *name##_rb_split(RB_ROOT *root, key_type key, RB_ROOT *left, \
+        RB_ROOT *right); \
+void name##_rb_union(RB_ROOT *root, RB_ROOT *a, RB_ROOT *b, \
+        const RB_SETOP *op); \
+void name##_rb_intersection(RB_ROOT *root, RB_ROOT *a, RB_ROOT *b, \
+        const RB_SETOP *op); \
+void name##_rb_difference(RB_ROOT *root, RB_ROOT *a, RB_ROOT *b, \
+        const RB_SETOP *op);
+
+/**
+ * @brief Generator for join-based operations implementation.
+ *
+ * Generates #RB_JOIN, #RB_SPLIT, #RB_UNION, #RB_INTERSECTION and
+ * #RB_DIFFERENCE over the comparators of the tree.
+ * @param name Identifier.
+ * @param key_type Type of key.
+ * @param type Type of the container of #RB_NODE.
+ * @param field Member name of #RB_NODE in the container.
+ * @param key_cmp Comparator for key and node, as #RB_GEN.
+ * @param cmp Comparator for two nodes, as #RB_GEN.
+ */
+#define RB_GEN_JOIN(name, key_type, type, field, key_cmp, cmp) \
+_RB_GENERATE_JOIN_IMPL(name, key_type, type, field, key_cmp, cmp, NULL)
+
+/**
+ * @brief Generator for join-based operations implementation of an augmented
+ * tree.
+ *
+ * Same as #RB_GEN_JOIN for a tree of #RB_GEN_AUGMENTED, and keeps the data
+ * of \p aug up to date.
+ * @param name Identifier.
+ * @param key_type Type of key.
+ * @param type Type of the container of #RB_NODE.
+ * @param field Member name of #RB_NODE in the container.
+ * @param key_cmp Comparator for key and node, as #RB_GEN.
+ * @param cmp Comparator for two nodes, as #RB_GEN.
+ * @param aug Pointer to the #RB_AUGMENT of the tree.
+ */
+#define RB_GEN_JOIN_AUGMENTED(name, key_type, type, field, key_cmp, cmp, \
+        aug) \
+_RB_GENERATE_JOIN_IMPL(name, key_type, type, field, key_cmp, cmp, aug)
+
+/**
+ * @brief Generator for join-based operations implementation of an order
+ * statistic tree.
+ *
+ * Same as #RB_GEN_JOIN for a tree of #RB_GEN_SIZE, and keeps #rb_size up to
+ * date.
+ * @param name Identifier.
+ * @param key_type Type of key.
+ * @param type Type of the container of #RB_SIZE_NODE.
+ * @param field Member name of the \c rb_node of #RB_SIZE_NODE in the
+ * container.
+ * @param key_cmp Comparator for key and node, as #RB_GEN.
+ * @param cmp Comparator for two nodes, as #RB_GEN.
+ */
+#define RB_GEN_JOIN_SIZE(name, key_type, type, field, key_cmp, cmp) \
+_RB_GENERATE_JOIN_IMPL(name, key_type, type, field, key_cmp, cmp, \
+        &rb_size_augment)
+/**@}*/
+
+/**
+ * @addtogroup rbtree
+ * @{
+ */
+/**
+ * @brief Remove a node from an interval tree.
+ * @param name Identifier.
+ * @param root Pointer to the red black tree root.
+ * @param node The container to be removed. It must be in the tree.
+ */
+#define RB_INTERVAL_REMOVE(name, root, node) \
+    name##_rb_interval_remove(root, node)
+/**
+ * @brief Get the first node overlapping an interval, in O(log n).
+ *
+ * A stabbing query of point \c x is the interval <tt>[x, x]</tt>.
+ * @param name Identifier.
+ * @param root Pointer to the red black tree root.
+ * @param lo Start of the closed interval.
+ * @param hi Last of the closed interval.
+ * @param rp The returned context used by #RB_INTERVAL_NEXT.
+ * @return Pointer to the container, or \c NULL if no node overlaps.
+ */
+#define RB_INTERVAL_FIRST(name, root, lo, hi, rp) \
+    name##_rb_interval_first(root, lo, hi, rp)
+/**
+ * @brief Get the next node overlapping an interval.
+ *
+ * Iterating from #RB_INTERVAL_FIRST visits the k overlapping nodes in order
+ * in O(log n + k).
+ * @param name Identifier.
+ * @param node The container returned by the previous iteration.
+ * @param lo Start of the closed interval.
+ * @param hi Last of the closed interval.
+ * @param rp The context of \p node, updated for the returned one.
+ * @return Pointer to the container, or \c NULL if no more node overlaps.
+ */
+#define RB_INTERVAL_NEXT(name, node, lo, hi, rp) \
+    name##_rb_interval_next(node, lo, hi, rp)
+/**@}*/
+
+#define RB_GENERATE_INTERVAL_PROTO(name, itype, type) \
+RB_GENERATE_INSERT_PROTO(name, type); \
+void name##_rb_interval_remove(RB_ROOT *root, type *node); \
+type *name##_rb_interval_first(RB_ROOT *root, itype lo, itype hi, \
+        RB_PATH *rp); \
+type *name##_rb_interval_next(type *node, itype lo, itype hi, RB_PATH *rp)
+#define RB_GENERATE_INTERVAL(name, itype, type, field, start, last, max) \
+static void name##_rb_interval_update(RB_NODE *p) \
+{ \
+    type *node = RB_ENTRY(p, type, field); \
+    itype m = last(node); \
+    int dir; \
+    for (dir = RB_LEFT; dir <= RB_RIGHT; ++dir) \
+    { \
+        RB_NODE *c = rb_child(p, dir); \
+        if (c != NULL && RB_ENTRY(c, type, field)->max > m) \
+        { \
+            m = RB_ENTRY(c, type, field)->max; \
+        } \
+    } \
+    node->max = m; \
+} \
+static const RB_AUGMENT name##_rb_interval_augment = \
+{ \
+    name##_rb_interval_update \
+}; \
+static inline int name##_rb_interval_cmp(type *a, type *b) \
+{ \
+    if (start(a) != start(b)) \
+    { \
+        return (start(a) < start(b) ? -1 : 1); \
+    } \
+    if (last(a) != last(b)) \
+    { \
+        return (last(a) < last(b) ? -1 : 1); \
+    } \
+    return (a < b ? -1 : (a > b)); \
+} \
+/* Leftmost node overlapping [lo, hi] in the subtree p, whose max is not \
+ * less than lo, extending rp down to it. */ \
+static type *name##_rb_interval_search(RB_NODE *p, itype lo, itype hi, \
+        RB_PATH *rp) \
+{ \
+    for (;;) \
+    { \
+        type *node = RB_ENTRY(p, type, field); \
+        RB_NODE *c = rb_child(p, RB_LEFT); \
+        int dir = RB_LEFT; \
+        if (c == NULL || RB_ENTRY(c, type, field)->max < lo) \
+        { \
+            if (start(node) > hi) \
+            { \
+                return NULL; \
+            } \
+            if (last(node) >= lo) \
+            { \
+                return node; \
+            } \
+            c = rb_child(p, RB_RIGHT); \
+            dir = RB_RIGHT; \
+            if (c == NULL || RB_ENTRY(c, type, field)->max < lo) \
+            { \
+                return NULL; \
+            } \
+        } \
+        ++rp->cur; \
+        rp->cur->parent = p; \
+        rp->cur->dir = dir; \
+        p = c; \
+    } \
+} \
+_RB_GENERATE_INSERT_IMPL(name, RB_ROOT, root, type, field, \
+        name##_rb_interval_cmp, \
+        rb_insert_color_augmented(root, &node->field, &rp, \
+            &name##_rb_interval_augment)) \
+void name##_rb_interval_remove(RB_ROOT *root, type *node) \
+{ \
+    RB_PATH rp; \
+    RB_PATH_INIT(&rp); \
+    RB_NODE *p = root->rb_root; \
+    int c; \
+    while ((c = name##_rb_interval_cmp(node, \
+                    RB_ENTRY(p, type, field))) != 0) \
+    { \
+        int dir = (c < 0 ? RB_LEFT : RB_RIGHT); \
+        ++rp.cur; \
+        rp.cur->parent = p; \
+        rp.cur->dir = dir; \
+        p = rb_child(p, dir); \
+    } \
+    rb_remove_augmented(root, p, &rp, &name##_rb_interval_augment); \
+    RB_TRACE(REMOVE, root, node); \
+} \
+type *name##_rb_interval_first(RB_ROOT *root, itype lo, itype hi, \
+        RB_PATH *rp) \
+{ \
+    type *node = NULL; \
+    RB_NODE *p = root->rb_root; \
+    RB_PATH_INIT(rp); \
+    if (p != NULL && RB_ENTRY(p, type, field)->max >= lo) \
+    { \
+        node = name##_rb_interval_search(p, lo, hi, rp); \
+    } \
+    RB_TRACE(FIND, root, node); \
+    return node; \
+} \
+type *name##_rb_interval_next(type *node, itype lo, itype hi, RB_PATH *rp) \
+{ \
+    RB_NODE *p = &node->field; \
+    RB_NODE *c = rb_child(p, RB_RIGHT); \
+    for (;;) \
+    { \
+        int dir; \
+        if (c != NULL && RB_ENTRY(c, type, field)->max >= lo) \
+        { \
+            ++rp->cur; \
+            rp->cur->parent = p; \
+            rp->cur->dir = RB_RIGHT; \
+            return name##_rb_interval_search(c, lo, hi, rp); \
+        } \
+        /* Up to the nearest ancestor having p in its left subtree. */ \
+        do \
+        { \
+            p = rp->cur->parent; \
+            if (p == NULL) \
+            { \
+                return NULL; \
+            } \
+            dir = rp->cur->dir; \
+            --rp->cur; \
+        } while (dir == RB_RIGHT); \
+        node = RB_ENTRY(p, type, field); \
+        if (start(node) > hi) \
+        { \
+            return NULL; \
+        } \
+        if (last(node) >= lo) \
+        { \
+            return node; \
+        } \
+        c = rb_child(p, RB_RIGHT); \
+    } \
+}
+
+/**
+ * @addtogroup rbtree
+ * @{
+ */
+/**
+ * @brief Generator for interval tree declaration.
+ * @param name Identifier.
+ * @param itype Type of interval endpoints.
+ * @param type Type of structure containing #RB_NODE.
+ */
+#define RB_GEN_INTERVAL_PROTO(name, itype, type) \
+RB_GENERATE_INTERVAL_PROTO(name, itype, type);
+
+/**
+ * @brief Generator for interval tree implementation.
+ *
+ * The tree holds closed intervals <tt>[start(node), last(node)]</tt>
+ * ordered by start, then last, then address, so equal intervals can
+ * coexist; #RB_INSERT inserts a node and never finds a duplicate. Each node
+ * caches the largest last of its subtree, which lets #RB_INTERVAL_FIRST and
+ * #RB_INTERVAL_NEXT skip the subtrees ending before the query.
+ * @param name Identifier.
+ * @param itype Type of interval endpoints, compared by the relational
+ * operators.
+ * @param type Type of the container of #RB_NODE.
+ * @param field Member name of #RB_NODE in the container.
+ * @param start Function or macro taking a pointer to \a type and returning
+ * the start of its interval.
+ * @param last Function or macro taking a pointer to \a type and returning
+ * the last of its interval.
+ * @param max Member name of the \a itype in the container caching the
+ * largest last in its subtree.
+ */
+#define RB_GEN_INTERVAL(name, itype, type, field, start, last, max) \
+RB_GENERATE_INTERVAL(name, itype, type, field, start, last, max)
+
+/**
+ * @brief Generator for join-based operations declaration of an interval
+ * tree.
+ * @param name Identifier.
+ * @param type Type of structure containing #RB_NODE.
+ */
+#define RB_GEN_JOIN_INTERVAL_PROTO(name, type) \
+RB_GEN_JOIN_PROTO(name, type *, type)
+
+/**
+ * @brief Generator for join-based operations implementation of an interval
+ * tree.
+ *
+ * Same as #RB_GEN_JOIN for a tree of #RB_GEN_INTERVAL, which it must follow,
+ * and keeps \a max up to date. The key of #RB_SPLIT is a pointer to \a type,
+ * ordered as the nodes, so the set operations match nodes by address.
+ * @param name Identifier.
+ * @param type Type of the container of #RB_NODE.
+ * @param field Member name of #RB_NODE in the container.
+ */
+#define RB_GEN_JOIN_INTERVAL(name, type, field) \
+_RB_GENERATE_JOIN_IMPL(name, type *, type, field, name##_rb_interval_cmp, \
+        name##_rb_interval_cmp, &name##_rb_interval_augment)
+/**@}*/
+
+/**
+ * @addtogroup rbtree
+ * @{
+ */
+/**
+ * @brief String key with a cached prefix.
+ *
+ * Comparing string keys by \c strcmp dereferences the string of every node
+ * on the search path. Embedding this key in the container keeps the first 8
+ * bytes of the string as a big-endian integer in the node, so most
+ * comparisons are resolved without reading the string. Use
+ * <tt>const RB_STR_KEY *</tt> as the key type of #RB_GEN and compare by
+ * #rb_str_key_cmp.
+ */
+typedef struct RB_STR_KEY_
+{
+    uint64_t rb_prefix;
+    const char *rb_str;
+} RB_STR_KEY;
+
+/**
+ * @brief Get the normalized prefix of a string.
+ *
+ * The first 8 bytes of \a str are packed in big-endian order and padded with
+ * zeros, so comparing prefixes as integers gives the same order as \c strcmp.
+ * @param str Null-terminated string.
+ * @return The prefix of \a str.
+ */
+static inline uint64_t rb_str_prefix(const char *str)
+{
+    uint64_t prefix = 0;
+    int i;
+    for (i = 0; i < 8; ++i)
+    {
+        prefix <<= 8;
+        if (*str != '\0')
+        {
+            prefix |= (uint8_t) *str++;
+        }
+    }
+    return prefix;
+}
+
+/**
+ * @brief Initialize a string key.
+ * @param key Pointer to the #RB_STR_KEY.
+ * @param str Null-terminated string. It is referenced, not copied.
+ */
+#define RB_STR_KEY_INIT(key, str) \
+do { \
+    (key)->rb_prefix = rb_str_prefix(str); \
+    (key)->rb_str = (str); \
+} while (0)
+
+/**
+ * @brief Compare two string keys.
+ * @param a Pointer to the first key.
+ * @param b Pointer to the second key.
+ * @return A value less than, equal to, or greater than zero if \a a is less
+ * than, equal to, or greater than \a b.
+ */
+static inline int rb_str_key_cmp(const RB_STR_KEY *a, const RB_STR_KEY *b)
+{
+    if (a->rb_prefix != b->rb_prefix)
+    {
+        return (a->rb_prefix < b->rb_prefix ? -1 : 1);
+    }
+    if ((a->rb_prefix & 0xff) == 0)
+    {
+        /* Both strings end within the prefix. */
+        return 0;
+    }
+    return strcmp(a->rb_str + 8, b->rb_str + 8);
+}
 /**@}*/
 
 #endif /* RBTREE_COMPACT_H_ */
@@ -0,0 +1,266 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016 Kuan-Chung Huang
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#ifndef RBTREE_FC_H_
+#define RBTREE_FC_H_
+
+#if !defined(RBTREE_H_) && !defined(RBTREE_COMPACT_H_)
+#error "Include rbtree.h or rbtree_compact.h before rbtree_fc.h."
+#endif
+
+#include <stdatomic.h>
+#include <sched.h>
+
+/* A red black tree shared by many threads through flat combining.
+ *
+ * Each thread owns a slot in which it publishes one request at a time. The
+ * thread that takes the combiner lock applies the pending requests of all
+ * slots to the tree and releases it; the other threads wait for their slot to
+ * be served, or take the lock themselves once it is free. The tree is then
+ * modified by one core at a time in batches, instead of bouncing the tree
+ * and the lock between cores on every operation.
+ *
+ * RB_FC_APPLY runs any callback on the tree as a request, e.g. an iteration
+ * or a compound update that must be atomic.
+ *
+ * Works with either rbtree.h or rbtree_compact.h, whichever is included
+ * first.
+ */
+
+#define RB_FC_OP_NONE   0
+#define RB_FC_OP_INSERT 1
+#define RB_FC_OP_REMOVE 2
+#define RB_FC_OP_FIND   3
+#define RB_FC_OP_APPLY  4
+
+#ifndef RB_FC_CACHE_LINE
+#define RB_FC_CACHE_LINE 64
+#endif
+
+/* Passes over the slots per combining round, to pick up requests published
+ * while combining. */
+#ifndef RB_FC_PASSES
+#define RB_FC_PASSES 2
+#endif
+
+/* Called by a thread waiting for its request. */
+#ifndef RB_FC_YIELD
+#define RB_FC_YIELD() sched_yield()
+#endif
+
+typedef void *(*RB_FC_FUNC)(RB_ROOT *root, void *arg);
+
+/* Defines name##_SLOT as well, which is one cache line per thread. */
+#define RB_FC_TYPE(name, key_type, type) \
+typedef struct \
+{ \
+    _Alignas(RB_FC_CACHE_LINE) _Atomic uint32_t rfc_op; \
+    key_type rfc_key; \
+    type *rfc_node; \
+    RB_FC_FUNC rfc_func; \
+    void *rfc_arg; \
+} name##_SLOT; \
+typedef struct \
+{ \
+    _Alignas(RB_FC_CACHE_LINE) _Atomic bool rfc_lock; \
+    RB_ROOT rfc_root; \
+    name##_SLOT *rfc_slot; \
+    uint32_t rfc_nslot; \
+    _Atomic uint32_t rfc_nused; \
+} name
+
+/* slots holds nslot slots, one for each thread using the tree. */
+#define RB_FC_INIT(fc, slots, nslot) \
+do { \
+    uint32_t i_; \
+    for (i_ = 0; i_ < (nslot); ++i_) \
+    { \
+        atomic_init(&(slots)[i_].rfc_op, RB_FC_OP_NONE); \
+    } \
+    atomic_init(&(fc)->rfc_lock, false); \
+    RB_ROOT_INIT(&(fc)->rfc_root); \
+    (fc)->rfc_slot = (slots); \
+    (fc)->rfc_nslot = (nslot); \
+    atomic_init(&(fc)->rfc_nused, 0); \
+} while (0)
+
+/* Take a slot for the calling thread, or NULL if none is left. */
+#define RB_FC_REGISTER(name, fc) name##_rb_fc_register(fc)
+
+#define RB_FC_INSERT(name, fc, slot, node) name##_rb_fc_insert(fc, slot, node)
+#define RB_FC_REMOVE(name, fc, slot, key) name##_rb_fc_remove(fc, slot, key)
+#define RB_FC_FIND(name, fc, slot, key) name##_rb_fc_find(fc, slot, key)
+#define RB_FC_APPLY(name, fc, slot, func, arg) name##_rb_fc_apply(fc, slot, func, arg)
+
+#ifdef RBTREE_COMPACT_H_
+#define _RB_FC_GENERATE_TREE_FIND(name, key_type, type) \
+static inline type *name##_rb_fc_tree_find(RB_ROOT *root, key_type key) \
+{ \
+    RB_PATH rp; \
+    return RB_FIND(name, root, key, &rp); \
+}
+#else
+#define _RB_FC_GENERATE_TREE_FIND(name, key_type, type) \
+static inline type *name##_rb_fc_tree_find(RB_ROOT *root, key_type key) \
+{ \
+    return RB_FIND(name, root, key); \
+}
+#endif
+
+#define RB_FC_GENERATE_REGISTER_PROTO(name, fc_type) \
+fc_type##_SLOT *name##_rb_fc_register(fc_type *fc)
+#define RB_FC_GENERATE_REGISTER(name, fc_type) \
+RB_FC_GENERATE_REGISTER_PROTO(name, fc_type) \
+{ \
+    uint32_t i = atomic_load_explicit(&fc->rfc_nused, memory_order_relaxed); \
+    do \
+    { \
+        if (i >= fc->rfc_nslot) \
+        { \
+            return NULL; \
+        } \
+    } while (!atomic_compare_exchange_weak_explicit(&fc->rfc_nused, &i, i + 1, \
+            memory_order_relaxed, memory_order_relaxed)); \
+    return &fc->rfc_slot[i]; \
+}
+
+#define RB_FC_GENERATE_COMBINE(name, fc_type, key_type, type) \
+_RB_FC_GENERATE_TREE_FIND(name, key_type, type) \
+static void name##_rb_fc_combine(fc_type *fc) \
+{ \
+    int pass; \
+    for (pass = 0; pass < RB_FC_PASSES; ++pass) \
+    { \
+        uint32_t n = atomic_load_explicit(&fc->rfc_nused, memory_order_acquire); \
+        uint32_t i; \
+        for (i = 0; i < n; ++i) \
+        { \
+            fc_type##_SLOT *s = &fc->rfc_slot[i]; \
+            uint32_t op = atomic_load_explicit(&s->rfc_op, memory_order_acquire); \
+            switch (op) \
+            { \
+            case RB_FC_OP_INSERT: \
+                s->rfc_node = RB_INSERT(name, &fc->rfc_root, s->rfc_node); \
+                break; \
+            case RB_FC_OP_REMOVE: \
+                s->rfc_node = RB_REMOVE(name, &fc->rfc_root, s->rfc_key); \
+                break; \
+            case RB_FC_OP_FIND: \
+                s->rfc_node = name##_rb_fc_tree_find(&fc->rfc_root, s->rfc_key); \
+                break; \
+            case RB_FC_OP_APPLY: \
+                s->rfc_arg = s->rfc_func(&fc->rfc_root, s->rfc_arg); \
+                break; \
+            default: \
+                continue; \
+            } \
+            atomic_store_explicit(&s->rfc_op, RB_FC_OP_NONE, memory_order_release); \
+        } \
+    } \
+} \
+static void name##_rb_fc_request(fc_type *fc, fc_type##_SLOT *slot, uint32_t op) \
+{ \
+    atomic_store_explicit(&slot->rfc_op, op, memory_order_release); \
+    for (;;) \
+    { \
+        if (!atomic_load_explicit(&fc->rfc_lock, memory_order_relaxed) \
+                && !atomic_exchange_explicit(&fc->rfc_lock, true, \
+                        memory_order_acquire)) \
+        { \
+            name##_rb_fc_combine(fc); \
+            atomic_store_explicit(&fc->rfc_lock, false, memory_order_release); \
+        } \
+        if (atomic_load_explicit(&slot->rfc_op, memory_order_acquire) \
+                == RB_FC_OP_NONE) \
+        { \
+            return; \
+        } \
+        RB_FC_YIELD(); \
+    } \
+}
+
+#define RB_FC_GENERATE_INSERT_PROTO(name, fc_type, type) \
+type *name##_rb_fc_insert(fc_type *fc, fc_type##_SLOT *slot, type *node)
+#define RB_FC_GENERATE_INSERT(name, fc_type, type) \
+RB_FC_GENERATE_INSERT_PROTO(name, fc_type, type) \
+{ \
+    slot->rfc_node = node; \
+    name##_rb_fc_request(fc, slot, RB_FC_OP_INSERT); \
+    return slot->rfc_node; \
+}
+
+#define RB_FC_GENERATE_REMOVE_PROTO(name, fc_type, key_type, type) \
+type *name##_rb_fc_remove(fc_type *fc, fc_type##_SLOT *slot, key_type key)
+#define RB_FC_GENERATE_REMOVE(name, fc_type, key_type, type) \
+RB_FC_GENERATE_REMOVE_PROTO(name, fc_type, key_type, type) \
+{ \
+    slot->rfc_key = key; \
+    name##_rb_fc_request(fc, slot, RB_FC_OP_REMOVE); \
+    return slot->rfc_node; \
+}
+
+#define RB_FC_GENERATE_FIND_PROTO(name, fc_type, key_type, type) \
+type *name##_rb_fc_find(fc_type *fc, fc_type##_SLOT *slot, key_type key)
+#define RB_FC_GENERATE_FIND(name, fc_type, key_type, type) \
+RB_FC_GENERATE_FIND_PROTO(name, fc_type, key_type, type) \
+{ \
+    slot->rfc_key = key; \
+    name##_rb_fc_request(fc, slot, RB_FC_OP_FIND); \
+    return slot->rfc_node; \
+}
+
+#define RB_FC_GENERATE_APPLY_PROTO(name, fc_type) \
+void *name##_rb_fc_apply(fc_type *fc, fc_type##_SLOT *slot, RB_FC_FUNC func, \
+        void *arg)
+#define RB_FC_GENERATE_APPLY(name, fc_type) \
+RB_FC_GENERATE_APPLY_PROTO(name, fc_type) \
+{ \
+    slot->rfc_func = func; \
+    slot->rfc_arg = arg; \
+    name##_rb_fc_request(fc, slot, RB_FC_OP_APPLY); \
+    return slot->rfc_arg; \
+}
+
+#define RB_FC_GEN_PROTO(name, fc_type, key_type, type) \
+RB_GEN_PROTO(name, key_type, type) \
+RB_FC_GENERATE_REGISTER_PROTO(name, fc_type); \
+RB_FC_GENERATE_INSERT_PROTO(name, fc_type, type); \
+RB_FC_GENERATE_REMOVE_PROTO(name, fc_type, key_type, type); \
+RB_FC_GENERATE_FIND_PROTO(name, fc_type, key_type, type); \
+RB_FC_GENERATE_APPLY_PROTO(name, fc_type);
+
+/* key_cmp and cmp are the same as RB_GEN. The tree functions are generated
+ * under the same name, so RB_* may also be used on rfc_root while no other
+ * thread uses the tree.
+ */
+#define RB_FC_GEN(name, fc_type, key_type, type, field, key_cmp, cmp) \
+RB_GEN(name, key_type, type, field, key_cmp, cmp) \
+RB_FC_GENERATE_REGISTER(name, fc_type) \
+RB_FC_GENERATE_COMBINE(name, fc_type, key_type, type) \
+RB_FC_GENERATE_INSERT(name, fc_type, type) \
+RB_FC_GENERATE_REMOVE(name, fc_type, key_type, type) \
+RB_FC_GENERATE_FIND(name, fc_type, key_type, type) \
+RB_FC_GENERATE_APPLY(name, fc_type)
+
+#endif /* RBTREE_FC_H_ */
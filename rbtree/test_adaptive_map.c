@@ -0,0 +1,266 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016 Kuan-Chung Huang
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#include "adaptive_map.h"
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define __UNUSED __attribute__((unused))
+
+#define ARRAY_SIZE(arr) (sizeof(arr) / sizeof((arr)[0]))
+
+typedef struct A_NODE_
+{
+    int val;
+    RB_NODE node;
+} A_NODE;
+
+ADAPTIVE_MAP_TYPE(A_NODE_ADAPTIVE_MAP, A_NODE);
+
+#define A_NODE_KEY_CMP(key, node) ((key) - (node)->val)
+#define A_NODE_CMP(n1, n2) ((n1)->val - (n2)->val)
+ADAPTIVE_MAP_GEN(A_NODE_MAP, A_NODE_ADAPTIVE_MAP, int, A_NODE, node, A_NODE_KEY_CMP, A_NODE_CMP)
+
+#define LO 4
+#define HI 8
+#define N 32
+
+static int get_rbtree_black_height(RB_NODE *node)
+{
+    if (node == NULL)
+    {
+        return 0;
+    }
+    int lbh = get_rbtree_black_height(rb_child(node, RB_LEFT));
+    int rbh = get_rbtree_black_height(rb_child(node, RB_RIGHT));
+    assert_int_equal(lbh, rbh);
+    if (rb_color(node) == RB_RED)
+    {
+        assert_true(node->rb_child[RB_LEFT] == NULL
+                || rb_color(node->rb_child[RB_LEFT]) == RB_BLACK);
+        assert_true(node->rb_child[RB_RIGHT] == NULL
+                || rb_color(node->rb_child[RB_RIGHT]) == RB_BLACK);
+    }
+    return (rb_color(node) == RB_BLACK ? 1 : 0) + lbh;
+}
+
+/* Check the map holds exactly the values flagged in present, in order. */
+static void validate_adaptive_map(A_NODE_ADAPTIVE_MAP *map, const bool *present)
+{
+    ADAPTIVE_MAP_ITER iter;
+    A_NODE *node = ADAPTIVE_MAP_FIRST(A_NODE_MAP, map, &iter);
+    uint32_t len = 0;
+    int i;
+    for (i = 0; i < N; ++i)
+    {
+        assert_int_equal(ADAPTIVE_MAP_FIND(A_NODE_MAP, map, i) != NULL, present[i]);
+        if (present[i])
+        {
+            assert_non_null(node);
+            assert_int_equal(node->val, i);
+            node = ADAPTIVE_MAP_NEXT(A_NODE_MAP, map, &iter);
+            ++len;
+        }
+    }
+    assert_null(node);
+    assert_int_equal(ADAPTIVE_MAP_LEN(map), len);
+    if (ADAPTIVE_MAP_IS_TREE(map))
+    {
+        assert_int_equal(rb_color(map->adm_root.rb_root), RB_BLACK);
+        get_rbtree_black_height(map->adm_root.rb_root);
+    }
+}
+
+static void test_adaptive_map(void **state __UNUSED)
+{
+    A_NODE *buf[HI];
+    A_NODE node[N];
+    bool present[N] = { false };
+    A_NODE_ADAPTIVE_MAP map;
+    int i;
+    ADAPTIVE_MAP_INIT(&map, buf, LO, HI);
+    for (i = 0; i < N; ++i)
+    {
+        node[i].val = i;
+    }
+
+    /* Test case: Stay an array up to the upper threshold */
+    for (i = 0; i < HI; ++i)
+    {
+        int v = (i * 5) % N;
+        assert_ptr_equal(ADAPTIVE_MAP_INSERT(A_NODE_MAP, &map, &node[v]), &node[v]);
+        present[v] = true;
+        assert_false(ADAPTIVE_MAP_IS_TREE(&map));
+        validate_adaptive_map(&map, present);
+    }
+    {
+        A_NODE dup = { .val = 0 };
+        assert_ptr_equal(ADAPTIVE_MAP_INSERT(A_NODE_MAP, &map, &dup), &node[0]);
+        assert_int_equal(ADAPTIVE_MAP_LEN(&map), HI);
+    }
+
+    /* Test case: Promote to a tree beyond the upper threshold */
+    for (i = 0; i < N; ++i)
+    {
+        if (present[i])
+        {
+            continue;
+        }
+        assert_ptr_equal(ADAPTIVE_MAP_INSERT(A_NODE_MAP, &map, &node[i]), &node[i]);
+        present[i] = true;
+        assert_true(ADAPTIVE_MAP_LEN(&map) <= HI || ADAPTIVE_MAP_IS_TREE(&map));
+        validate_adaptive_map(&map, present);
+    }
+    assert_true(ADAPTIVE_MAP_IS_TREE(&map));
+    {
+        A_NODE dup = { .val = 1 };
+        assert_ptr_equal(ADAPTIVE_MAP_INSERT(A_NODE_MAP, &map, &dup), &node[1]);
+        assert_int_equal(ADAPTIVE_MAP_LEN(&map), N);
+    }
+
+    /* Test case: Hysteresis keeps the tree between the thresholds */
+    for (i = 0; i < N - HI; ++i)
+    {
+        assert_ptr_equal(ADAPTIVE_MAP_REMOVE(A_NODE_MAP, &map, i * 3 % N), &node[i * 3 % N]);
+        present[i * 3 % N] = false;
+        validate_adaptive_map(&map, present);
+    }
+    assert_true(ADAPTIVE_MAP_IS_TREE(&map));
+    assert_null(ADAPTIVE_MAP_REMOVE(A_NODE_MAP, &map, 0));
+
+    /* Test case: Demote to an array at the lower threshold */
+    for (i = 0; ADAPTIVE_MAP_LEN(&map) > 0; ++i)
+    {
+        if (present[i])
+        {
+            assert_ptr_equal(ADAPTIVE_MAP_REMOVE(A_NODE_MAP, &map, i), &node[i]);
+            present[i] = false;
+            assert_int_equal(ADAPTIVE_MAP_IS_TREE(&map), ADAPTIVE_MAP_LEN(&map) > LO);
+            validate_adaptive_map(&map, present);
+        }
+    }
+}
+
+static void test_adaptive_map_init(void **state __UNUSED)
+{
+    A_NODE *buf[HI];
+    A_NODE node[N];
+    bool present[N] = { false };
+    A_NODE_ADAPTIVE_MAP map;
+    bool ret;
+    int i;
+    for (i = 0; i < N; ++i)
+    {
+        node[i].val = i;
+    }
+
+    /* Test case: Reject a lower threshold not less than the upper one */
+    ADAPTIVE_MAP_INIT_RET(&map, buf, HI, HI, ret);
+    assert_false(ret);
+    ADAPTIVE_MAP_INIT_RET(&map, buf, 0, 0, ret);
+    assert_false(ret);
+    ADAPTIVE_MAP_INIT_RET(&map, buf, LO, HI, ret);
+    assert_true(ret);
+    assert_int_equal(map.adm_lo, LO);
+
+    /* Test case: Clamp it so a demotion fits in buf */
+    ADAPTIVE_MAP_INIT(&map, buf, 2 * HI, HI);
+    assert_int_equal(map.adm_lo, HI - 1);
+    for (i = 0; i < HI + 3; ++i)
+    {
+        ADAPTIVE_MAP_INSERT(A_NODE_MAP, &map, &node[i]);
+        present[i] = true;
+    }
+    assert_true(ADAPTIVE_MAP_IS_TREE(&map));
+    for (i = 0; i < 4; ++i)
+    {
+        ADAPTIVE_MAP_REMOVE(A_NODE_MAP, &map, i);
+        present[i] = false;
+    }
+    assert_false(ADAPTIVE_MAP_IS_TREE(&map));
+    assert_int_equal(ADAPTIVE_MAP_LEN(&map), HI - 1);
+    validate_adaptive_map(&map, present);
+}
+
+static void test_adaptive_map_threshold(void **state __UNUSED)
+{
+    A_NODE *buf[HI];
+    A_NODE node[N];
+    bool present[N] = { false };
+    A_NODE_ADAPTIVE_MAP map;
+    int i;
+    ADAPTIVE_MAP_INIT(&map, buf, LO, HI);
+    for (i = 0; i < N; ++i)
+    {
+        node[i].val = i;
+    }
+
+    /* Test case: Exactly hi nodes stay an array, one more promotes */
+    for (i = 0; i < HI; ++i)
+    {
+        ADAPTIVE_MAP_INSERT(A_NODE_MAP, &map, &node[i]);
+        present[i] = true;
+    }
+    assert_false(ADAPTIVE_MAP_IS_TREE(&map));
+    ADAPTIVE_MAP_INSERT(A_NODE_MAP, &map, &node[HI]);
+    present[HI] = true;
+    assert_true(ADAPTIVE_MAP_IS_TREE(&map));
+    validate_adaptive_map(&map, present);
+
+    /* Test case: lo + 1 nodes stay a tree, exactly lo demotes */
+    for (i = HI; ADAPTIVE_MAP_LEN(&map) > LO + 1; --i)
+    {
+        ADAPTIVE_MAP_REMOVE(A_NODE_MAP, &map, i);
+        present[i] = false;
+    }
+    assert_true(ADAPTIVE_MAP_IS_TREE(&map));
+    ADAPTIVE_MAP_REMOVE(A_NODE_MAP, &map, i);
+    present[i] = false;
+    assert_false(ADAPTIVE_MAP_IS_TREE(&map));
+    assert_int_equal(ADAPTIVE_MAP_LEN(&map), LO);
+    validate_adaptive_map(&map, present);
+
+    /* Test case: Growing back to hi does not promote again */
+    for (i = LO; ADAPTIVE_MAP_LEN(&map) < HI; ++i)
+    {
+        ADAPTIVE_MAP_INSERT(A_NODE_MAP, &map, &node[i]);
+        present[i] = true;
+    }
+    assert_false(ADAPTIVE_MAP_IS_TREE(&map));
+    validate_adaptive_map(&map, present);
+}
+
+int main(void)
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(test_adaptive_map),
+        cmocka_unit_test(test_adaptive_map_init),
+        cmocka_unit_test(test_adaptive_map_threshold),
+    };
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
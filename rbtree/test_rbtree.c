@@ -33,7 +33,9 @@ SOFTWARE.
 #include <cmocka.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
+#include <pthread.h>
 
 #define __UNUSED __attribute__((unused))
 
@@ -479,6 +481,1008 @@ static void test_rbtree_iter(void ** state __UNUSED)
     }
 }
 
+typedef struct S_NODE_
+{
+    RB_STR_KEY key;
+    RB_NODE node;
+} S_NODE;
+
+#define S_NODE_KEY_CMP(key, n) rb_str_key_cmp((key), &(n)->key)
+#define S_NODE_CMP(n1, n2) rb_str_key_cmp(&(n1)->key, &(n2)->key)
+RB_GEN(S_NODE_MAP, const RB_STR_KEY *, S_NODE, node, S_NODE_KEY_CMP, S_NODE_CMP)
+
+static void test_rbtree_str_key(void **state __UNUSED)
+{
+    static const char *str[] = {
+        "applesauce_b", "", "apple", "applesauce_a", "\xff",
+        "applesau", "b", "applesauce",
+    };
+    static const char *sorted_str[] = {
+        "", "apple", "applesau", "applesauce", "applesauce_a",
+        "applesauce_b", "b", "\xff",
+    };
+    const int N = ARRAY_SIZE(str);
+    S_NODE node[ARRAY_SIZE(str)];
+    RB_ROOT root = RB_ROOT_INITIALIZER(&root);
+    int i;
+    for (i = 0; i < N; ++i)
+    {
+        RB_STR_KEY_INIT(&node[i].key, str[i]);
+        assert_ptr_equal(RB_INSERT(S_NODE_MAP, &root, &node[i]), &node[i]);
+    }
+
+    RB_NODE *iter;
+#ifdef RB_COMPACT
+    RB_PATH rp;
+    iter = rb_first(&root, &rp);
+#else
+    iter = rb_first(&root);
+#endif
+    for (i = 0; i < N; ++i)
+    {
+        assert_string_equal(RB_ENTRY(iter, S_NODE, node)->key.rb_str, sorted_str[i]);
+#ifdef RB_COMPACT
+        iter = rb_next(iter, &rp);
+#else
+        iter = rb_next(iter);
+#endif
+    }
+    assert_null(iter);
+
+    for (i = 0; i < N; ++i)
+    {
+        char copy[16];
+        RB_STR_KEY key;
+        strcpy(copy, str[i]);
+        RB_STR_KEY_INIT(&key, copy);
+#ifdef RB_COMPACT
+        assert_ptr_equal(RB_FIND(S_NODE_MAP, &root, &key, &rp), &node[i]);
+#else
+        assert_ptr_equal(RB_FIND(S_NODE_MAP, &root, &key), &node[i]);
+#endif
+    }
+
+    {
+        static const char *missing[] = { "applesauce_c", "applesauc", "apples", "a" };
+        for (i = 0; i < (int) ARRAY_SIZE(missing); ++i)
+        {
+            RB_STR_KEY key;
+            RB_STR_KEY_INIT(&key, missing[i]);
+            assert_null(RB_REMOVE(S_NODE_MAP, &root, &key));
+        }
+    }
+}
+
+typedef struct Z_NODE_
+{
+    int val;
+    RB_SIZE_NODE snode;
+} Z_NODE;
+
+RB_GEN_SIZE(Z_NODE_MAP, int, Z_NODE, snode.rb_node, A_NODE_KEY_CMP, A_NODE_CMP)
+
+static size_t validate_rbtree_size(RB_NODE *node)
+{
+    if (node == NULL)
+    {
+        return 0;
+    }
+    size_t size = 1 + validate_rbtree_size(rb_child(node, RB_LEFT))
+            + validate_rbtree_size(rb_child(node, RB_RIGHT));
+    assert_int_equal(rb_size(node), size);
+    return size;
+}
+
+static void test_rbtree_size(void **state __UNUSED)
+{
+    int i;
+    const int N = 200;
+    Z_NODE node_buf[N];
+    bool in_tree[N];
+    RB_ROOT root = RB_ROOT_INITIALIZER(&root);
+    for (i = 0; i < N; ++i)
+    {
+        node_buf[i].val = 2 * i;
+        in_tree[i] = false;
+    }
+
+    int run;
+    for (run = 0; run < 5000; ++run)
+    {
+        /* Test case: Random inserts and removes keep subtree sizes */
+        i = rand() % N;
+        if (in_tree[i])
+        {
+            assert_ptr_equal(RB_REMOVE(Z_NODE_MAP, &root, 2 * i), &node_buf[i]);
+        }
+        else
+        {
+            assert_ptr_equal(RB_INSERT(Z_NODE_MAP, &root, &node_buf[i]), &node_buf[i]);
+        }
+        in_tree[i] = !in_tree[i];
+        get_rbtree_black_height(root.rb_root);
+        size_t n = validate_rbtree_size(root.rb_root);
+        if (run % 100 != 0)
+        {
+            continue;
+        }
+
+        /* Test case: rank and select agree with the order */
+        size_t k = 0;
+        for (i = 0; i < N; ++i)
+        {
+            if (!in_tree[i])
+            {
+                continue;
+            }
+#ifdef RB_COMPACT
+            RB_PATH rp;
+            RB_NODE *sel = rb_select(&root, k, &rp);
+            assert_ptr_equal(sel, &node_buf[i].snode.rb_node);
+            assert_int_equal(rb_rank(sel, &rp), k);
+            assert_ptr_equal(RB_FIND(Z_NODE_MAP, &root, 2 * i, &rp), &node_buf[i]);
+            assert_int_equal(rb_rank(&node_buf[i].snode.rb_node, &rp), k);
+#else
+            assert_ptr_equal(rb_select(&root, k), &node_buf[i].snode.rb_node);
+            assert_int_equal(rb_rank(&node_buf[i].snode.rb_node), k);
+#endif
+            ++k;
+        }
+        assert_int_equal(k, n);
+#ifdef RB_COMPACT
+        RB_PATH rp;
+        assert_null(rb_select(&root, n, &rp));
+#else
+        assert_null(rb_select(&root, n));
+#endif
+
+        /* Test case: Range counts */
+        int lo = rand() % (2 * N + 2) - 1;
+        int hi = rand() % (2 * N + 2) - 1;
+        size_t cnt = 0;
+        for (i = 0; i < N; ++i)
+        {
+            cnt += (in_tree[i] && 2 * i >= lo && 2 * i < hi);
+        }
+        assert_int_equal(RB_COUNT_RANGE(Z_NODE_MAP, &root, lo, hi), cnt);
+        assert_int_equal(RB_COUNT_LESS(Z_NODE_MAP, &root, 2 * N), n);
+    }
+}
+
+RB_GEN_CACHED(C_NODE_MAP, int, A_NODE, node, A_NODE_KEY_CMP, A_NODE_CMP)
+
+static void validate_rbtree_cached(RB_ROOT_CACHED *root)
+{
+#ifdef RB_COMPACT
+    RB_PATH rp, rp2;
+    assert_ptr_equal(rb_first_cached(root, NULL), rb_first(&root->rb_root, &rp2));
+    assert_ptr_equal(rb_first_cached(root, &rp), rb_first(&root->rb_root, &rp2));
+    assert_int_equal(rp.cur - rp.path, rp2.cur - rp2.path);
+    for (; rp.cur != rp.path; --rp.cur, --rp2.cur)
+    {
+        assert_ptr_equal(rp.cur->parent, rp2.cur->parent);
+        assert_int_equal(rp.cur->dir, rp2.cur->dir);
+    }
+    assert_ptr_equal(rb_last_cached(root, NULL), rb_last(&root->rb_root, &rp2));
+#else
+    assert_ptr_equal(rb_first_cached(root), rb_first(&root->rb_root));
+    assert_ptr_equal(rb_last_cached(root), rb_last(&root->rb_root));
+#endif
+}
+
+static void test_rbtree_cached(void **state __UNUSED)
+{
+    int i;
+    const int N = 200;
+    A_NODE node_buf[N];
+    bool in_tree[N];
+    RB_ROOT_CACHED root = RB_ROOT_CACHED_INITIALIZER(&root);
+    for (i = 0; i < N; ++i)
+    {
+        node_buf[i].val = i;
+        in_tree[i] = false;
+    }
+    assert_null(RB_POP_FIRST(C_NODE_MAP, &root));
+    validate_rbtree_cached(&root);
+
+    int run;
+    for (run = 0; run < 5000; ++run)
+    {
+        /* Test case: Random inserts, removes and pops keep the ends */
+        i = rand() % N;
+        if (run % 5 == 0)
+        {
+            A_NODE *min = RB_POP_FIRST(C_NODE_MAP, &root);
+            if (min != NULL)
+            {
+                assert_true(in_tree[min->val]);
+                for (i = 0; i < min->val; ++i)
+                {
+                    assert_false(in_tree[i]);
+                }
+                in_tree[min->val] = false;
+            }
+        }
+        else if (in_tree[i])
+        {
+            assert_ptr_equal(RB_REMOVE(C_NODE_MAP, &root, i), &node_buf[i]);
+            in_tree[i] = false;
+        }
+        else
+        {
+            assert_ptr_equal(RB_INSERT(C_NODE_MAP, &root, &node_buf[i]), &node_buf[i]);
+            in_tree[i] = true;
+        }
+        get_rbtree_black_height(root.rb_root.rb_root);
+        validate_rbtree_cached(&root);
+    }
+
+    /* Test case: Pops drain the tree in order */
+    int prev = -1;
+    A_NODE *min;
+    while ((min = RB_POP_FIRST(C_NODE_MAP, &root)) != NULL)
+    {
+        assert_true(min->val > prev);
+        assert_true(in_tree[min->val]);
+        in_tree[min->val] = false;
+        prev = min->val;
+        validate_rbtree_cached(&root);
+    }
+    for (i = 0; i < N; ++i)
+    {
+        assert_false(in_tree[i]);
+    }
+    assert_true(RB_EMPTY(&root.rb_root));
+}
+
+typedef struct I_NODE_
+{
+    int start;
+    int last;
+    int max;
+    RB_NODE node;
+} I_NODE;
+
+#define I_NODE_START(n) ((n)->start)
+#define I_NODE_LAST(n) ((n)->last)
+
+RB_GEN_INTERVAL(I_NODE_MAP, int, I_NODE, node, I_NODE_START, I_NODE_LAST, max)
+
+static int validate_rbtree_interval(RB_NODE *node)
+{
+    if (node == NULL)
+    {
+        return -1;
+    }
+    I_NODE *ent = RB_ENTRY(node, I_NODE, node);
+    int max = ent->last;
+    int m = validate_rbtree_interval(rb_child(node, RB_LEFT));
+    max = (m > max ? m : max);
+    m = validate_rbtree_interval(rb_child(node, RB_RIGHT));
+    max = (m > max ? m : max);
+    assert_int_equal(ent->max, max);
+    return max;
+}
+
+static void test_rbtree_interval(void **state __UNUSED)
+{
+    int i;
+    const int N = 200;
+    const int SPAN = 500;
+    I_NODE node_buf[N];
+    bool in_tree[N];
+    bool hit[N];
+    RB_ROOT root = RB_ROOT_INITIALIZER(&root);
+    for (i = 0; i < N; ++i)
+    {
+        /* Short and long intervals with duplicates. */
+        node_buf[i].start = rand() % SPAN;
+        node_buf[i].last = node_buf[i].start
+                + (i % 10 == 0 ? rand() % SPAN : rand() % 8);
+        if (i % 7 == 1)
+        {
+            node_buf[i].start = node_buf[i - 1].start;
+            node_buf[i].last = node_buf[i - 1].last;
+        }
+        in_tree[i] = false;
+    }
+
+    int run;
+    for (run = 0; run < 5000; ++run)
+    {
+        /* Test case: Random inserts and removes keep subtree max */
+        i = rand() % N;
+        if (in_tree[i])
+        {
+            RB_INTERVAL_REMOVE(I_NODE_MAP, &root, &node_buf[i]);
+        }
+        else
+        {
+            assert_ptr_equal(RB_INSERT(I_NODE_MAP, &root, &node_buf[i]), &node_buf[i]);
+        }
+        in_tree[i] = !in_tree[i];
+        get_rbtree_black_height(root.rb_root);
+        validate_rbtree_interval(root.rb_root);
+        if (run % 50 != 0)
+        {
+            continue;
+        }
+
+        /* Test case: Overlap and stabbing queries visit exactly the
+         * overlapping nodes in order */
+        int q;
+        for (q = 0; q < 20; ++q)
+        {
+            int lo = rand() % (2 * SPAN) - 10;
+            int hi = (q % 2 == 0 ? lo : lo + rand() % 50);
+            memset(hit, 0, sizeof(hit));
+            I_NODE *prev = NULL;
+#ifdef RB_COMPACT
+            RB_PATH rp;
+            I_NODE *n = RB_INTERVAL_FIRST(I_NODE_MAP, &root, lo, hi, &rp);
+#else
+            I_NODE *n = RB_INTERVAL_FIRST(I_NODE_MAP, &root, lo, hi);
+#endif
+            while (n != NULL)
+            {
+                assert_true(n->start <= hi && n->last >= lo);
+                assert_true(prev == NULL || n->start >= prev->start);
+                assert_false(hit[n - node_buf]);
+                hit[n - node_buf] = true;
+                prev = n;
+#ifdef RB_COMPACT
+                n = RB_INTERVAL_NEXT(I_NODE_MAP, n, lo, hi, &rp);
+#else
+                n = RB_INTERVAL_NEXT(I_NODE_MAP, n, lo, hi);
+#endif
+            }
+            for (i = 0; i < N; ++i)
+            {
+                bool overlap = (in_tree[i] && node_buf[i].start <= hi
+                        && node_buf[i].last >= lo);
+                assert_int_equal(hit[i], overlap);
+            }
+        }
+    }
+}
+
+static int validate_rbtree_red(RB_NODE *node, int depth)
+{
+    /* Returns the height; a red node has no red child. */
+    if (node == NULL)
+    {
+        return depth;
+    }
+    int dir;
+    int height = depth;
+    for (dir = RB_LEFT; dir <= RB_RIGHT; ++dir)
+    {
+        RB_NODE *child = rb_child(node, dir);
+        if (child != NULL)
+        {
+            assert_false(rb_color(node) == RB_RED && rb_color(child) == RB_RED);
+#ifndef RB_COMPACT
+            assert_ptr_equal(rb_parent(child), node);
+#endif
+        }
+        int h = validate_rbtree_red(child, depth + 1);
+        height = (h > height ? h : height);
+    }
+    return height;
+}
+
+static RB_NODE *build_list_next(void *arg)
+{
+    A_NODE **p = arg;
+    return &(*p)++->node;
+}
+
+static RB_NODE *build_size_list_next(void *arg)
+{
+    Z_NODE **p = arg;
+    return &(*p)++->snode.rb_node;
+}
+
+static void test_rbtree_build_sorted(void **state __UNUSED)
+{
+    int i;
+    const int N = 300;
+    A_NODE node_buf[N];
+    RB_NODE *node[N];
+    for (i = 0; i < N; ++i)
+    {
+        node_buf[i].val = 2 * i;
+        node[i] = &node_buf[i].node;
+    }
+
+    int n;
+    for (n = 0; n <= N; ++n)
+    {
+        /* Test case: The built tree is a valid, balanced red black tree */
+        RB_ROOT root = RB_ROOT_INITIALIZER(&root);
+        A_NODE *p = node_buf;
+        if (n % 2 == 0)
+        {
+            rb_build_sorted(&root, node, n);
+        }
+        else
+        {
+            rb_build_sorted_next(&root, build_list_next, &p, n);
+            assert_ptr_equal(p, node_buf + n);
+        }
+        validate_rbtree_sorted_order(&root, node_buf, n);
+        assert_true(root.rb_root == NULL || rb_color(root.rb_root) == RB_BLACK);
+        get_rbtree_black_height(root.rb_root);
+        int height = validate_rbtree_red(root.rb_root, 0);
+        int min_height = 0;
+        while ((1 << min_height) <= n)
+        {
+            ++min_height;
+        }
+        assert_int_equal(height, min_height);
+
+        /* Test case: The built tree supports the usual operations */
+        for (i = 0; i < n; ++i)
+        {
+#ifdef RB_COMPACT
+            RB_PATH rp;
+            assert_ptr_equal(RB_FIND(A_NODE_MAP, &root, 2 * i, &rp), &node_buf[i]);
+#else
+            assert_ptr_equal(RB_FIND(A_NODE_MAP, &root, 2 * i), &node_buf[i]);
+#endif
+        }
+        A_NODE extra = { .val = 1 };
+        assert_ptr_equal(RB_INSERT(A_NODE_MAP, &root, &extra), &extra);
+        for (i = 0; i < n; i += 3)
+        {
+            assert_ptr_equal(RB_REMOVE(A_NODE_MAP, &root, 2 * i), &node_buf[i]);
+            get_rbtree_black_height(root.rb_root);
+            validate_rbtree_red(root.rb_root, 0);
+        }
+    }
+
+    Z_NODE znode_buf[N];
+    for (i = 0; i < N; ++i)
+    {
+        znode_buf[i].val = 2 * i;
+        node[i] = &znode_buf[i].snode.rb_node;
+    }
+    for (n = 0; n <= N; n += 7)
+    {
+        /* Test case: The augmented build sets the subtree sizes */
+        RB_ROOT root = RB_ROOT_INITIALIZER(&root);
+        Z_NODE *p = znode_buf;
+        if (n % 2 == 0)
+        {
+            rb_build_sorted_augmented(&root, node, n, &rb_size_augment);
+        }
+        else
+        {
+            rb_build_sorted_next_augmented(&root, build_size_list_next, &p, n,
+                    &rb_size_augment);
+            assert_ptr_equal(p, znode_buf + n);
+        }
+        get_rbtree_black_height(root.rb_root);
+        assert_int_equal(validate_rbtree_size(root.rb_root), n);
+        for (i = 0; i < n; ++i)
+        {
+#ifdef RB_COMPACT
+            RB_PATH rp;
+            RB_NODE *sel = rb_select(&root, i, &rp);
+            assert_ptr_equal(sel, node[i]);
+            assert_int_equal(rb_rank(sel, &rp), i);
+#else
+            assert_ptr_equal(rb_select(&root, i), node[i]);
+            assert_int_equal(rb_rank(node[i]), i);
+#endif
+        }
+        assert_int_equal(RB_COUNT_LESS(Z_NODE_MAP, &root, 2 * N), n);
+    }
+}
+
+RB_GEN_JOIN(A_NODE_MAP, int, A_NODE, node, A_NODE_KEY_CMP, A_NODE_CMP)
+
+static void collect_rbtree(RB_NODE *node, A_NODE **out, size_t *n)
+{
+    if (node != NULL)
+    {
+        collect_rbtree(rb_child(node, RB_LEFT), out, n);
+        out[(*n)++] = RB_ENTRY(node, A_NODE, node);
+        collect_rbtree(rb_child(node, RB_RIGHT), out, n);
+    }
+}
+
+/* Checks the tree is a valid red black tree holding exactly nodes in
+ * order. */
+static void validate_rbtree_nodes(RB_ROOT *root, A_NODE **nodes, size_t n)
+{
+    A_NODE **out = malloc((n + 1) * sizeof(*out));
+    size_t cnt = 0;
+    collect_rbtree(root->rb_root, out, &cnt);
+    assert_int_equal(cnt, n);
+    size_t i;
+    for (i = 0; i < n; ++i)
+    {
+        assert_ptr_equal(out[i], nodes[i]);
+    }
+    free(out);
+    assert_true(root->rb_root == NULL || rb_color(root->rb_root) == RB_BLACK);
+#ifndef RB_COMPACT
+    assert_true(root->rb_root == NULL || rb_parent(root->rb_root) == NULL);
+#endif
+    get_rbtree_black_height(root->rb_root);
+    validate_rbtree_red(root->rb_root, 0);
+}
+
+static void test_rbtree_join_split(void **state __UNUSED)
+{
+    int i;
+    const int N = 300;
+    A_NODE node_buf[N];
+    A_NODE *node[N];
+    for (i = 0; i < N; ++i)
+    {
+        node_buf[i].val = 2 * i;
+        node[i] = &node_buf[i];
+    }
+
+    int run;
+    for (run = 0; run < 300; ++run)
+    {
+        /* Test case: Split at a present or absent key */
+        int n = rand() % (N + 1);
+        RB_ROOT root = RB_ROOT_INITIALIZER(&root);
+        for (i = 0; i < n; ++i)
+        {
+            RB_INSERT(A_NODE_MAP, &root, node[i]);
+        }
+        int key = rand() % (2 * N + 1) - 1;
+        RB_ROOT left, right;
+        A_NODE *found = RB_SPLIT(A_NODE_MAP, &root, key, &left, &right);
+        assert_true(RB_EMPTY(&root));
+        int n_left = (key < 0 ? 0 : (key + 1) / 2);
+        n_left = (n_left > n ? n : n_left);
+        bool present = (key % 2 == 0 && key >= 0 && key / 2 < n);
+        assert_ptr_equal(found, (present ? &node_buf[key / 2] : NULL));
+        validate_rbtree_nodes(&left, node, n_left);
+        validate_rbtree_nodes(&right, node + n_left + present,
+                n - n_left - present);
+
+        /* Test case: Join the parts back around a node */
+        A_NODE *mid = found;
+        if (mid == NULL && !RB_EMPTY(&right))
+        {
+            mid = RB_SPLIT(A_NODE_MAP, &right, node[n_left]->val, &root, &right);
+            assert_ptr_equal(mid, node[n_left]);
+            assert_true(RB_EMPTY(&root));
+        }
+        if (mid != NULL)
+        {
+            RB_JOIN(A_NODE_MAP, &left, &left, mid, &right);
+            validate_rbtree_nodes(&left, node, n);
+        }
+
+        /* Test case: Join trees of very different heights */
+        RB_ROOT small = RB_ROOT_INITIALIZER(&small);
+        RB_ROOT large = RB_ROOT_INITIALIZER(&large);
+        int n_small = rand() % 4;
+        for (i = 0; i < N; ++i)
+        {
+            if (i != n_small)
+            {
+                RB_INSERT(A_NODE_MAP, (i < n_small ? &small : &large), node[i]);
+            }
+        }
+        RB_JOIN(A_NODE_MAP, &root, &small, node[n_small], &large);
+        assert_true(RB_EMPTY(&small) && RB_EMPTY(&large));
+        validate_rbtree_nodes(&root, node, N);
+        A_NODE *first = RB_SPLIT(A_NODE_MAP, &root, 0, &small, &large);
+        assert_ptr_equal(first, node[0]);
+        assert_true(RB_EMPTY(&small));
+        RB_JOIN(A_NODE_MAP, &root, &small, first, &large);
+        validate_rbtree_nodes(&root, node, N);
+    }
+}
+
+/* drop and fork2 may run on other threads, where cmocka cannot assert, so
+ * they record failures to be checked after the operation. */
+typedef struct SETOP_STATE_
+{
+    bool *dropped;
+    A_NODE *base;
+    int n_dropped;
+    int n_dropped_twice;
+} SETOP_STATE;
+
+static pthread_mutex_t setop_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void setop_drop(RB_NODE *node, void *arg)
+{
+    SETOP_STATE *st = arg;
+    A_NODE *ent = RB_ENTRY(node, A_NODE, node);
+    pthread_mutex_lock(&setop_lock);
+    st->n_dropped_twice += st->dropped[ent - st->base];
+    st->dropped[ent - st->base] = true;
+    ++st->n_dropped;
+    pthread_mutex_unlock(&setop_lock);
+}
+
+typedef struct SETOP_FORK_
+{
+    void (*func)(void *);
+    void *arg;
+} SETOP_FORK;
+
+static void *setop_thread(void *arg)
+{
+    SETOP_FORK *fork = arg;
+    fork->func(fork->arg);
+    return NULL;
+}
+
+static int n_forks;
+static int n_fork_errors;
+
+static void setop_fork2(void *ctx __UNUSED, void (*func_a)(void *),
+        void *arg_a, void (*func_b)(void *), void *arg_b)
+{
+    SETOP_FORK fork = { func_b, arg_b };
+    pthread_t thread;
+    __atomic_fetch_add(&n_forks, 1, __ATOMIC_RELAXED);
+    if (pthread_create(&thread, NULL, setop_thread, &fork) != 0)
+    {
+        __atomic_fetch_add(&n_fork_errors, 1, __ATOMIC_RELAXED);
+        func_a(arg_a);
+        func_b(arg_b);
+        return;
+    }
+    func_a(arg_a);
+    pthread_join(thread, NULL);
+}
+
+static void test_rbtree_setop(void **state __UNUSED)
+{
+    int i;
+    const int N = 2000;
+    const int SPAN = 3000;
+    A_NODE *node_buf = malloc(2 * N * sizeof(*node_buf));
+    A_NODE **expect = malloc(2 * N * sizeof(*expect));
+    bool *dropped = malloc(2 * N * sizeof(*dropped));
+    bool *in_a = malloc(SPAN * sizeof(*in_a));
+    bool *in_b = malloc(SPAN * sizeof(*in_b));
+    A_NODE *a_buf = node_buf;
+    A_NODE *b_buf = node_buf + N;
+    RB_SETOP op = { setop_drop, NULL, NULL, NULL, 0, NULL };
+
+    int run;
+    for (run = 0; run < 60; ++run)
+    {
+        int kind = run % 3;
+        /* Sizes from tiny to large on either side. */
+        int n_a = (run / 3 % 4 == 0 ? rand() % 8 : rand() % (N + 1));
+        int n_b = (run / 3 % 4 == 1 ? rand() % 8 : rand() % (N + 1));
+        RB_ROOT a = RB_ROOT_INITIALIZER(&a);
+        RB_ROOT b = RB_ROOT_INITIALIZER(&b);
+        memset(in_a, 0, SPAN * sizeof(*in_a));
+        memset(in_b, 0, SPAN * sizeof(*in_b));
+        memset(dropped, 0, 2 * N * sizeof(*dropped));
+        for (i = 0; i < n_a; ++i)
+        {
+            do
+            {
+                a_buf[i].val = rand() % SPAN;
+            } while (in_a[a_buf[i].val]);
+            in_a[a_buf[i].val] = true;
+            RB_INSERT(A_NODE_MAP, &a, &a_buf[i]);
+        }
+        for (i = 0; i < n_b; ++i)
+        {
+            do
+            {
+                b_buf[i].val = rand() % SPAN;
+            } while (in_b[b_buf[i].val]);
+            in_b[b_buf[i].val] = true;
+            RB_INSERT(A_NODE_MAP, &b, &b_buf[i]);
+        }
+
+        /* Expected nodes, from a where both have the key. */
+        A_NODE *a_of[SPAN];
+        A_NODE *b_of[SPAN];
+        for (i = 0; i < n_a; ++i)
+        {
+            a_of[a_buf[i].val] = &a_buf[i];
+        }
+        for (i = 0; i < n_b; ++i)
+        {
+            b_of[b_buf[i].val] = &b_buf[i];
+        }
+        size_t n = 0;
+        int v;
+        for (v = 0; v < SPAN; ++v)
+        {
+            if (kind == 0 && (in_a[v] || in_b[v]))
+            {
+                expect[n++] = (in_a[v] ? a_of[v] : b_of[v]);
+            }
+            else if (kind == 1 && in_a[v] && in_b[v])
+            {
+                expect[n++] = a_of[v];
+            }
+            else if (kind == 2 && in_a[v] && !in_b[v])
+            {
+                expect[n++] = a_of[v];
+            }
+        }
+
+        /* Test case: Set operations, sequential and forked */
+        SETOP_STATE st = { dropped, node_buf, 0, 0 };
+        op.arg = &st;
+        op.fork2 = (run % 2 == 0 ? setop_fork2 : NULL);
+        op.fork_height = 3;
+        n_forks = 0;
+        n_fork_errors = 0;
+        RB_ROOT *root = (run % 4 < 2 ? &a : &b);
+        switch (kind)
+        {
+        case 0:
+            RB_UNION(A_NODE_MAP, root, &a, &b, &op);
+            break;
+        case 1:
+            RB_INTERSECTION(A_NODE_MAP, root, &a, &b, &op);
+            break;
+        default:
+            RB_DIFFERENCE(A_NODE_MAP, root, &a, &b, &op);
+            break;
+        }
+        assert_true(root == &a || RB_EMPTY(&a));
+        assert_true(root == &b || RB_EMPTY(&b));
+        assert_int_equal(n_fork_errors, 0);
+        assert_int_equal(st.n_dropped_twice, 0);
+        validate_rbtree_nodes(root, expect, n);
+        assert_int_equal(st.n_dropped, n_a + n_b - (int) n);
+        size_t k;
+        for (k = 0; k < n; ++k)
+        {
+            assert_false(dropped[expect[k] - node_buf]);
+        }
+        if (op.fork2 == NULL || n_a == 0 || n_b < 100)
+        {
+            continue;
+        }
+        assert_true(n_forks > 0);
+    }
+
+    /* Test case: Without drop, NULL options */
+    RB_ROOT a = RB_ROOT_INITIALIZER(&a);
+    RB_ROOT b = RB_ROOT_INITIALIZER(&b);
+    for (i = 0; i < N; ++i)
+    {
+        a_buf[i].val = 2 * i;
+        b_buf[i].val = 3 * i;
+        RB_INSERT(A_NODE_MAP, &a, &a_buf[i]);
+        RB_INSERT(A_NODE_MAP, &b, &b_buf[i]);
+    }
+    RB_INTERSECTION(A_NODE_MAP, &a, &a, &b, NULL);
+    size_t n = 0;
+    for (i = 0; i < N; i += 3)
+    {
+        expect[n++] = &a_buf[i];
+    }
+    validate_rbtree_nodes(&a, expect, n);
+
+    free(in_b);
+    free(in_a);
+    free(dropped);
+    free(expect);
+    free(node_buf);
+}
+
+RB_GEN_JOIN_SIZE(Z_NODE_MAP, int, Z_NODE, snode.rb_node, A_NODE_KEY_CMP, A_NODE_CMP)
+RB_GEN_JOIN_INTERVAL(I_NODE_MAP, I_NODE, node)
+
+/* Checks the sizes of a tree of Z_NODE holding exactly nodes in order. */
+static void validate_rbtree_size_nodes(RB_ROOT *root, Z_NODE **nodes, size_t n)
+{
+    get_rbtree_black_height(root->rb_root);
+    validate_rbtree_red(root->rb_root, 0);
+    assert_int_equal(validate_rbtree_size(root->rb_root), n);
+    size_t k;
+    for (k = 0; k < n; ++k)
+    {
+#ifdef RB_COMPACT
+        RB_PATH rp;
+        assert_ptr_equal(rb_select(root, k, &rp), &nodes[k]->snode.rb_node);
+        assert_int_equal(rb_rank(&nodes[k]->snode.rb_node, &rp), k);
+#else
+        assert_ptr_equal(rb_select(root, k), &nodes[k]->snode.rb_node);
+        assert_int_equal(rb_rank(&nodes[k]->snode.rb_node), k);
+#endif
+    }
+}
+
+static void test_rbtree_join_augmented(void **state __UNUSED)
+{
+    int i;
+    const int N = 300;
+    Z_NODE node_buf[N];
+    Z_NODE *node[N];
+    Z_NODE other_buf[N];
+    for (i = 0; i < N; ++i)
+    {
+        node_buf[i].val = 2 * i;
+        node[i] = &node_buf[i];
+    }
+
+    int run;
+    for (run = 0; run < 100; ++run)
+    {
+        /* Test case: Split keeps the subtree sizes */
+        int n = rand() % (N + 1);
+        RB_ROOT root = RB_ROOT_INITIALIZER(&root);
+        for (i = 0; i < n; ++i)
+        {
+            RB_INSERT(Z_NODE_MAP, &root, node[i]);
+        }
+        int key = 2 * (rand() % (n + 1));
+        RB_ROOT left, right;
+        Z_NODE *found = RB_SPLIT(Z_NODE_MAP, &root, key, &left, &right);
+        int n_left = key / 2;
+        bool present = (n_left < n);
+        assert_ptr_equal(found, (present ? node[n_left] : NULL));
+        validate_rbtree_size_nodes(&left, node, n_left);
+        validate_rbtree_size_nodes(&right, node + n_left + present,
+                n - n_left - present);
+
+        /* Test case: Join keeps the subtree sizes */
+        if (found != NULL)
+        {
+            RB_JOIN(Z_NODE_MAP, &root, &left, found, &right);
+            validate_rbtree_size_nodes(&root, node, n);
+        }
+
+        /* Test case: Set operations keep the subtree sizes */
+        RB_ROOT a = RB_ROOT_INITIALIZER(&a);
+        RB_ROOT b = RB_ROOT_INITIALIZER(&b);
+        for (i = 0; i < N; ++i)
+        {
+            RB_INSERT(Z_NODE_MAP, (i % 3 == 0 ? &b : &a), node[i]);
+        }
+        RB_SETOP op = { NULL, NULL, (run % 2 == 0 ? setop_fork2 : NULL), NULL,
+                1, NULL };
+        n_fork_errors = 0;
+        RB_UNION(Z_NODE_MAP, &a, &a, &b, &op);
+        assert_int_equal(n_fork_errors, 0);
+        validate_rbtree_size_nodes(&a, node, N);
+        for (i = 0; i < N; i += 3)
+        {
+            other_buf[i].val = 2 * i;
+            RB_INSERT(Z_NODE_MAP, &b, &other_buf[i]);
+        }
+        RB_DIFFERENCE(Z_NODE_MAP, &a, &a, &b, NULL);
+        Z_NODE *expect[N];
+        size_t cnt = 0;
+        for (i = 0; i < N; ++i)
+        {
+            if (i % 3 != 0)
+            {
+                expect[cnt++] = node[i];
+            }
+        }
+        validate_rbtree_size_nodes(&a, expect, cnt);
+    }
+
+    /* Test case: Join, split and union keep the max of interval trees */
+    I_NODE inode_buf[N];
+    RB_ROOT a = RB_ROOT_INITIALIZER(&a);
+    RB_ROOT b = RB_ROOT_INITIALIZER(&b);
+    for (i = 0; i < N; ++i)
+    {
+        inode_buf[i].start = rand() % 1000;
+        inode_buf[i].last = inode_buf[i].start + rand() % 100;
+        RB_INSERT(I_NODE_MAP, (i % 2 == 0 ? &a : &b), &inode_buf[i]);
+    }
+    RB_UNION(I_NODE_MAP, &a, &a, &b, NULL);
+    validate_rbtree_interval(a.rb_root);
+    get_rbtree_black_height(a.rb_root);
+    RB_ROOT left, right;
+    I_NODE *mid = RB_SPLIT(I_NODE_MAP, &a, &inode_buf[N / 2], &left, &right);
+    assert_ptr_equal(mid, &inode_buf[N / 2]);
+    validate_rbtree_interval(left.rb_root);
+    validate_rbtree_interval(right.rb_root);
+    RB_JOIN(I_NODE_MAP, &a, &left, mid, &right);
+    validate_rbtree_interval(a.rb_root);
+    get_rbtree_black_height(a.rb_root);
+}
+
+static void test_rbtree_bound(void **state __UNUSED)
+{
+    int i;
+    const int N = 200;
+    A_NODE node_buf[N];
+    bool in_tree[N];
+    RB_ROOT root = RB_ROOT_INITIALIZER(&root);
+    for (i = 0; i < N; ++i)
+    {
+        node_buf[i].val = 2 * i;
+        in_tree[i] = (rand() % 3 != 0);
+        if (in_tree[i])
+        {
+            RB_INSERT(A_NODE_MAP, &root, &node_buf[i]);
+        }
+    }
+
+    int key;
+    for (key = -1; key <= 2 * N; ++key)
+    {
+        /* Test case: Bounds agree with a linear scan */
+        A_NODE *lower = NULL;
+        A_NODE *upper = NULL;
+        A_NODE *prev = NULL;
+        for (i = N - 1; i >= 0; --i)
+        {
+            if (!in_tree[i])
+            {
+                continue;
+            }
+            if (node_buf[i].val >= key)
+            {
+                lower = &node_buf[i];
+            }
+            else if (prev == NULL)
+            {
+                prev = &node_buf[i];
+            }
+            if (node_buf[i].val > key)
+            {
+                upper = &node_buf[i];
+            }
+        }
+#ifdef RB_COMPACT
+        RB_PATH rp;
+        assert_ptr_equal(RB_UPPER_BOUND(A_NODE_MAP, &root, key, &rp), upper);
+        A_NODE *n = RB_LOWER_BOUND(A_NODE_MAP, &root, key, &rp);
+        assert_ptr_equal(n, lower);
+        if (n != NULL)
+        {
+            /* The path is primed for iteration both ways. */
+            RB_NODE *p = rb_prev(&n->node, &rp);
+            assert_ptr_equal(p, (prev != NULL ? &prev->node : NULL));
+        }
+#else
+        assert_ptr_equal(RB_UPPER_BOUND(A_NODE_MAP, &root, key), upper);
+        assert_ptr_equal(RB_LOWER_BOUND(A_NODE_MAP, &root, key), lower);
+#endif
+
+        /* Test case: Range iteration visits [key, hi) in order */
+        int hi = key + rand() % 40 - 5;
+        size_t cnt = 0;
+        for (i = 0; i < N; ++i)
+        {
+            cnt += (in_tree[i] && node_buf[i].val >= key && node_buf[i].val < hi);
+        }
+#ifdef RB_COMPACT
+        n = RB_RANGE_FIRST(A_NODE_MAP, &root, key, hi, &rp);
+#else
+        A_NODE *n = RB_RANGE_FIRST(A_NODE_MAP, &root, key, hi);
+#endif
+        size_t k = 0;
+        while (n != NULL)
+        {
+            assert_true(n->val >= key && n->val < hi);
+            assert_true(in_tree[n->val / 2]);
+            assert_true(k == 0 || n->val > prev->val);
+            prev = n;
+            ++k;
+#ifdef RB_COMPACT
+            n = RB_RANGE_NEXT(A_NODE_MAP, n, hi, &rp);
+#else
+            n = RB_RANGE_NEXT(A_NODE_MAP, n, hi);
+#endif
+        }
+        assert_int_equal(k, cnt);
+    }
+}
+
 int main(void)
 {
     srand(time(NULL));
@@ -491,6 +1495,15 @@ int main(void)
         cmocka_unit_test(test_rbtree_remove_simple2),
         cmocka_unit_test(test_rbtree_remove_random),
         cmocka_unit_test(test_rbtree_iter),
+        cmocka_unit_test(test_rbtree_str_key),
+        cmocka_unit_test(test_rbtree_size),
+        cmocka_unit_test(test_rbtree_interval),
+        cmocka_unit_test(test_rbtree_cached),
+        cmocka_unit_test(test_rbtree_build_sorted),
+        cmocka_unit_test(test_rbtree_join_split),
+        cmocka_unit_test(test_rbtree_setop),
+        cmocka_unit_test(test_rbtree_join_augmented),
+        cmocka_unit_test(test_rbtree_bound),
     };
     return cmocka_run_group_tests(tests, NULL, NULL);
 }
@@ -0,0 +1,174 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2016 Kuan-Chung Huang
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#ifdef RB_COMPACT
+#include "rbtree_compact.h"
+#else
+#include "rbtree.h"
+#endif
+#include "rbtree_fc.h"
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+
+#define __UNUSED __attribute__((unused))
+
+#define N_THREAD 4
+#define N_NODE 2000
+
+typedef struct A_NODE_
+{
+    int val;
+    RB_NODE node;
+} A_NODE;
+
+#define A_NODE_KEY_CMP(key, node) ((key) - (node)->val)
+#define A_NODE_CMP(n1, n2) ((n1)->val - (n2)->val)
+RB_FC_TYPE(A_NODE_FC, int, A_NODE);
+RB_FC_GEN(A_NODE_MAP, A_NODE_FC, int, A_NODE, node, A_NODE_KEY_CMP, A_NODE_CMP)
+
+A_NODE nodes[N_THREAD * N_NODE];
+A_NODE_FC_SLOT slots[N_THREAD + 1];
+A_NODE_FC fc;
+
+static size_t count_nodes(RB_NODE *node)
+{
+    if (node == NULL)
+    {
+        return 0;
+    }
+    return 1 + count_nodes(rb_child(node, RB_LEFT))
+            + count_nodes(rb_child(node, RB_RIGHT));
+}
+
+static void *count_apply(RB_ROOT *root, __UNUSED void *arg)
+{
+    return (void *) count_nodes(root->rb_root);
+}
+
+static void test_rbtree_fc_basic(__UNUSED void **state)
+{
+    RB_FC_INIT(&fc, slots, 2);
+    A_NODE_FC_SLOT *slot = RB_FC_REGISTER(A_NODE_MAP, &fc);
+    assert_ptr_equal(slot, &slots[0]);
+    assert_ptr_equal(RB_FC_REGISTER(A_NODE_MAP, &fc), &slots[1]);
+    assert_null(RB_FC_REGISTER(A_NODE_MAP, &fc));
+
+    int i;
+    for (i = 0; i < 10; ++i)
+    {
+        nodes[i].val = i;
+        assert_ptr_equal(RB_FC_INSERT(A_NODE_MAP, &fc, slot, &nodes[i]), &nodes[i]);
+    }
+
+    /* Test case: Duplicates return the node in the tree */
+    nodes[10].val = 3;
+    assert_ptr_equal(RB_FC_INSERT(A_NODE_MAP, &fc, slot, &nodes[10]), &nodes[3]);
+
+    assert_ptr_equal(RB_FC_FIND(A_NODE_MAP, &fc, slot, 7), &nodes[7]);
+    assert_null(RB_FC_FIND(A_NODE_MAP, &fc, slot, 10));
+    assert_ptr_equal(RB_FC_REMOVE(A_NODE_MAP, &fc, slot, 7), &nodes[7]);
+    assert_null(RB_FC_REMOVE(A_NODE_MAP, &fc, slot, 7));
+    assert_int_equal((size_t) RB_FC_APPLY(A_NODE_MAP, &fc, slot, count_apply, NULL), 9);
+}
+
+static void *worker_main(void *arg)
+{
+    int id = (int) (intptr_t) arg;
+    A_NODE_FC_SLOT *slot = RB_FC_REGISTER(A_NODE_MAP, &fc);
+    int i;
+    for (i = 0; i < N_NODE; ++i)
+    {
+        A_NODE *n = &nodes[id * N_NODE + i];
+        n->val = i * N_THREAD + id;
+        if (RB_FC_INSERT(A_NODE_MAP, &fc, slot, n) != n)
+        {
+            return (void *) 1;
+        }
+    }
+    for (i = 0; i < N_NODE; ++i)
+    {
+        int key = i * N_THREAD + id;
+        if (RB_FC_FIND(A_NODE_MAP, &fc, slot, key) != &nodes[id * N_NODE + i])
+        {
+            return (void *) 1;
+        }
+        if (i % 2 == 0
+                && RB_FC_REMOVE(A_NODE_MAP, &fc, slot, key) != &nodes[id * N_NODE + i])
+        {
+            return (void *) 1;
+        }
+    }
+    return NULL;
+}
+
+static void test_rbtree_fc_threads(__UNUSED void **state)
+{
+    pthread_t threads[N_THREAD];
+    RB_FC_INIT(&fc, slots, N_THREAD + 1);
+
+    /* Test case: Concurrent inserts, finds and removes of disjoint keys */
+    intptr_t i;
+    for (i = 0; i < N_THREAD; ++i)
+    {
+        pthread_create(&threads[i], NULL, worker_main, (void *) i);
+    }
+    for (i = 0; i < N_THREAD; ++i)
+    {
+        void *ret;
+        pthread_join(threads[i], &ret);
+        assert_null(ret);
+    }
+
+    A_NODE_FC_SLOT *slot = RB_FC_REGISTER(A_NODE_MAP, &fc);
+    assert_int_equal((size_t) RB_FC_APPLY(A_NODE_MAP, &fc, slot, count_apply, NULL),
+            N_THREAD * N_NODE / 2);
+    int key;
+    for (key = 0; key < N_THREAD * N_NODE; ++key)
+    {
+        A_NODE *n = RB_FC_FIND(A_NODE_MAP, &fc, slot, key);
+        if ((key / N_THREAD) % 2 == 0)
+        {
+            assert_null(n);
+        }
+        else
+        {
+            assert_non_null(n);
+            assert_int_equal(n->val, key);
+        }
+    }
+}
+
+int main(void)
+{
+    const struct CMUnitTest tests[] = {
+            cmocka_unit_test(test_rbtree_fc_basic),
+            cmocka_unit_test(test_rbtree_fc_threads),
+    };
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}